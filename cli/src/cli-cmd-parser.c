@@ -636,6 +636,177 @@ out:
         return ret;
 }
 
+/* The index of the last entry of the batch for volname if that is a set,
+ * which further keys of the volume are added to, else -1.
+ */
+static int
+cli_cmd_volume_batch_last_set (dict_t *dict, int count, const char *volname)
+{
+        char    key[256] = {0,};
+        char    *str = NULL;
+        int     i = 0;
+
+        for (i = count - 1; i >= 0; i--) {
+                snprintf (key, sizeof (key), "batch%d.volname", i);
+                if (dict_get_str (dict, key, &str) || strcmp (str, volname))
+                        continue;
+
+                snprintf (key, sizeof (key), "batch%d.op", i);
+                if (dict_get_str (dict, key, &str) || strcmp (str, "set"))
+                        return -1;
+                return i;
+        }
+
+        return -1;
+}
+
+/* Reads a batch of volume operations from file, one per line:
+ *
+ *      set <VOLNAME> <KEY> <VALUE>
+ *      start <VOLNAME> [force]
+ *      stop <VOLNAME> [force]
+ *
+ * Blank lines and lines starting with '#' are skipped. Consecutive sets
+ * of a volume go in one entry, so that the volume is regenerated once.
+ */
+int32_t
+cli_cmd_volume_batch_parse (const char *file, dict_t **options)
+{
+        FILE    *fp = NULL;
+        dict_t  *dict = NULL;
+        char    line[4096] = {0,};
+        char    key[256] = {0,};
+        char    *words[5] = {0,};
+        char    *tok = NULL;
+        char    *save = NULL;
+        int     nwords = 0;
+        int     lineno = 0;
+        int     count = 0;
+        int     entry = 0;
+        int     keys = 0;
+        int     ret = -1;
+
+        GF_ASSERT (file);
+        GF_ASSERT (options);
+
+        fp = fopen (file, "r");
+        if (!fp) {
+                cli_out ("Unable to open %s: %s", file, strerror (errno));
+                goto out;
+        }
+
+        dict = dict_new ();
+        if (!dict)
+                goto out;
+
+        while (fgets (line, sizeof (line), fp)) {
+                lineno++;
+                nwords = 0;
+                for (tok = strtok_r (line, " \t\r\n", &save); tok;
+                     tok = strtok_r (NULL, " \t\r\n", &save)) {
+                        if ((nwords == 0) && (tok[0] == '#'))
+                                break;
+                        if (nwords == 5)
+                                goto invalid;
+                        words[nwords++] = tok;
+                }
+
+                if (!nwords)
+                        continue;
+
+                if (!strcmp (words[0], "set") && (nwords == 4)) {
+                        entry = cli_cmd_volume_batch_last_set (dict, count,
+                                                               words[1]);
+                        keys = 0;
+                        if (entry < 0) {
+                                entry = count++;
+                                snprintf (key, sizeof (key), "batch%d.op",
+                                          entry);
+                                ret = dict_set_str (dict, key, "set");
+                                if (ret)
+                                        goto out;
+                                snprintf (key, sizeof (key), "batch%d.volname",
+                                          entry);
+                                ret = dict_set_dynstr (dict, key,
+                                                       gf_strdup (words[1]));
+                                if (ret)
+                                        goto out;
+                        } else {
+                                snprintf (key, sizeof (key), "batch%d.count",
+                                          entry);
+                                ret = dict_get_int32 (dict, key, &keys);
+                                if (ret)
+                                        goto out;
+                        }
+
+                        keys++;
+                        snprintf (key, sizeof (key), "batch%d.key%d", entry,
+                                  keys);
+                        ret = dict_set_dynstr (dict, key, gf_strdup (words[2]));
+                        if (ret)
+                                goto out;
+                        snprintf (key, sizeof (key), "batch%d.value%d", entry,
+                                  keys);
+                        ret = dict_set_dynstr (dict, key, gf_strdup (words[3]));
+                        if (ret)
+                                goto out;
+                        snprintf (key, sizeof (key), "batch%d.count", entry);
+                        ret = dict_set_int32 (dict, key, keys);
+                        if (ret)
+                                goto out;
+
+                } else if ((!strcmp (words[0], "start") ||
+                            !strcmp (words[0], "stop")) &&
+                           ((nwords == 2) ||
+                            ((nwords == 3) && !strcmp (words[2], "force")))) {
+                        entry = count++;
+                        snprintf (key, sizeof (key), "batch%d.op", entry);
+                        ret = dict_set_str (dict, key, strcmp (words[0],
+                                            "start") ? "stop" : "start");
+                        if (ret)
+                                goto out;
+                        snprintf (key, sizeof (key), "batch%d.volname", entry);
+                        ret = dict_set_dynstr (dict, key, gf_strdup (words[1]));
+                        if (ret)
+                                goto out;
+                        snprintf (key, sizeof (key), "batch%d.flags", entry);
+                        ret = dict_set_int32 (dict, key, (nwords == 3) ?
+                                              GF_CLI_FLAG_OP_FORCE : 0);
+                        if (ret)
+                                goto out;
+
+                } else {
+                        goto invalid;
+                }
+        }
+
+        if (!count) {
+                cli_out ("No operations in %s", file);
+                ret = -1;
+                goto out;
+        }
+
+        ret = dict_set_int32 (dict, "count", count);
+        if (ret)
+                goto out;
+
+        *options = dict;
+        goto out;
+
+invalid:
+        cli_out ("%s:%d: expected set <VOLNAME> <KEY> <VALUE>, "
+                 "start <VOLNAME> [force] or stop <VOLNAME> [force]",
+                 file, lineno);
+        ret = -1;
+out:
+        if (fp)
+                fclose (fp);
+        if (ret && dict)
+                dict_destroy (dict);
+
+        return ret;
+}
+
 int32_t
 cli_cmd_volume_add_brick_parse (const char **words, int wordcount,
                                 dict_t **options)
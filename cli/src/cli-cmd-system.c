@@ -32,6 +32,7 @@
 #include "cli-cmd.h"
 #include "cli-mem-types.h"
 #include "protocol-common.h"
+#include "cli1.h"
 
 
 extern struct rpc_clnt *global_rpc;
@@ -178,6 +179,39 @@ out:
         return ret;
 }
 
+int
+cli_cmd_txn_stats_cbk (struct cli_state *state, struct cli_cmd_word *word,
+                       const char **words, int wordcount)
+{
+        int                             ret = -1;
+        rpc_clnt_procedure_t            *proc = NULL;
+        call_frame_t                    *frame = NULL;
+        int                             flags = 0;
+
+        if ((wordcount != 2) && (wordcount != 3)) {
+                cli_usage_out (word->pattern);
+                goto out;
+        }
+
+        if (wordcount == 3) {
+                if (strcmp (words[2], "reset")) {
+                        cli_usage_out (word->pattern);
+                        goto out;
+                }
+                flags |= GF_CLI_TXN_STATS_RESET;
+        }
+
+        proc = &cli_rpc_prog->proctable[GLUSTER_CLI_TXN_STATS];
+        if (proc && proc->fn) {
+                frame = create_frame (THIS, THIS->ctx->pool);
+                if (!frame)
+                        goto out;
+                ret = proc->fn (frame, THIS, &flags);
+        }
+out:
+        return ret;
+}
+
 struct cli_cmd cli_system_cmds[] = {
         { "system:: getspec <VOLID>",
           cli_cmd_getspec_cbk,
@@ -195,6 +229,10 @@ struct cli_cmd cli_system_cmds[] = {
           cli_cmd_getwd_cbk,
           "query glusterd work directory"},
 
+        { "system:: txn-stats [reset]",
+          cli_cmd_txn_stats_cbk,
+          "display per-phase latencies of glusterd transactions"},
+
         { "system:: help",
            cli_cmd_system_help_cbk,
            "display help for system commands"},
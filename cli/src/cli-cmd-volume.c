@@ -675,6 +675,52 @@ out:
 
 }
 
+int
+cli_cmd_volume_batch_cbk (struct cli_state *state, struct cli_cmd_word *word,
+                          const char **words, int wordcount)
+{
+        int                     sent = 0;
+        int                     parse_error = 0;
+        int                     ret = -1;
+        rpc_clnt_procedure_t    *proc = NULL;
+        call_frame_t            *frame = NULL;
+        dict_t                  *options = NULL;
+
+        proc = &cli_rpc_prog->proctable[GLUSTER_CLI_BATCH_VOLUME];
+
+        frame = create_frame (THIS, THIS->ctx->pool);
+        if (!frame)
+                goto out;
+
+        if (wordcount != 3) {
+                cli_usage_out (word->pattern);
+                parse_error = 1;
+                goto out;
+        }
+
+        ret = cli_cmd_volume_batch_parse (words[2], &options);
+        if (ret) {
+                parse_error = 1;
+                goto out;
+        }
+
+        if (proc->fn) {
+                ret = proc->fn (frame, THIS, options);
+        }
+
+out:
+        if (options)
+                dict_unref (options);
+
+        if (ret) {
+                cli_cmd_sent_status_get (&sent);
+                if ((sent == 0) && (parse_error == 0))
+                        cli_out ("Volume batch failed");
+        }
+
+        return ret;
+}
+
 int
 cli_cmd_volume_add_brick_cbk (struct cli_state *state,
                               struct cli_cmd_word *word, const char **words,
@@ -1243,6 +1289,11 @@ struct cli_cmd volume_cmds[] = {
           cli_cmd_volume_set_cbk,
          "set options for volume <VOLNAME>"},
 
+        { "volume batch <FILE>",
+          cli_cmd_volume_batch_cbk,
+          "run the volume set, start and stop operations listed in <FILE> "
+          "as one operation"},
+
         { "volume help",
           cli_cmd_volume_help_cbk,
           "display help for the volume command"},
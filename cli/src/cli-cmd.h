@@ -44,6 +44,7 @@ struct cli_cmd {
 struct cli_cmd_volume_get_ctx_ {
         char            *volname;
         int             flags;
+        int             max_count;      /* volumes per reply, paging */
 };
 
 typedef struct cli_profile_info_ {
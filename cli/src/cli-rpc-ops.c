@@ -442,9 +442,10 @@ gf_cli3_1_get_volume_cbk (struct rpc_req *req, struct iovec *iov,
                 local = ((call_frame_t *)myframe)->local;
                 //cli_out ("Number of Volumes: %d", count);
 
+                local->u.get_vol.more = 0;
+
                 if (!count && (local->u.get_vol.flags ==
                                         GF_CLI_GET_NEXT_VOLUME)) {
-                        local->u.get_vol.volname = NULL;
                         ret = 0;
                         goto out;
                 } else if (!count && (local->u.get_vol.flags ==
@@ -541,8 +542,10 @@ gf_cli3_1_get_volume_cbk (struct rpc_req *req, struct iovec *iov,
                         if (ret)
                             goto out;
 
-                        if (!opt_count)
-                            goto out;
+                        if (!opt_count) {
+                                i++;
+                                continue;
+                        }
 
                         cli_out ("Options Reconfigured:");
                         k = 0;
@@ -568,6 +571,11 @@ gf_cli3_1_get_volume_cbk (struct rpc_req *req, struct iovec *iov,
                        i++;
                 }
 
+                /* an older glusterd sends one volume at a time, without
+                 * telling if there are more: ask until it sends none */
+                if ((local->u.get_vol.flags == GF_CLI_GET_NEXT_VOLUME) &&
+                    dict_get_int32 (dict, "more", &local->u.get_vol.more))
+                        local->u.get_vol.more = 1;
 
         } else {
                 ret = -1;
@@ -991,6 +999,38 @@ out:
         return ret;
 }
 
+int
+gf_cli3_1_batch_volume_cbk (struct rpc_req *req, struct iovec *iov,
+                            int count, void *myframe)
+{
+        gf1_cli_batch_vol_rsp  rsp   = {0,};
+        int                    ret   = 0;
+
+        if (-1 == req->rpc_status) {
+                goto out;
+        }
+
+        ret = gf_xdr_to_cli_batch_vol_rsp (*iov, &rsp);
+        if (ret < 0) {
+                gf_log ("", GF_LOG_ERROR, "error");
+                goto out;
+        }
+
+        gf_log ("cli", GF_LOG_INFO, "Received resp to volume batch");
+
+        if (rsp.op_ret && strcmp (rsp.op_errstr, ""))
+                cli_out ("%s", rsp.op_errstr);
+        else
+                cli_out ("Volume batch %s", (rsp.op_ret) ? "unsuccessful":
+                                                           "successful");
+
+        ret = rsp.op_ret;
+
+out:
+        cli_cmd_broadcast_response (ret);
+        return ret;
+}
+
 int
 gf_cli3_1_add_brick_cbk (struct rpc_req *req, struct iovec *iov,
                              int count, void *myframe)
@@ -1637,24 +1677,23 @@ gf_cli3_1_get_next_volume (call_frame_t *frame, xlator_t *this,
         }
 
         ctx = data;
-
-        ret = gf_cli3_1_get_volume (frame, this, data);
-
+        ctx->max_count = CLI_GET_VOLUME_PAGE_SIZE;
         local = frame->local;
 
-        if (!local || !local->u.get_vol.volname) {
-                cli_out ("No volumes present");
-                goto out;
-        }
-
-        ctx->volname = local->u.get_vol.volname;
-
-        while (ctx->volname) {
+        /* each page is printed as it comes, starting after the last
+         * volume of the previous one */
+        do {
                 ret = gf_cli3_1_get_volume (frame, this, ctx);
                 if (ret)
                         goto out;
+
+                if (!local || !local->u.get_vol.volname) {
+                        cli_out ("No volumes present");
+                        goto out;
+                }
+
                 ctx->volname = local->u.get_vol.volname;
-        }
+        } while (local->u.get_vol.more);
 
 out:
         return ret;
@@ -1687,6 +1726,12 @@ gf_cli3_1_get_volume (call_frame_t *frame, xlator_t *this,
                         goto out;
         }
 
+        if (ctx->max_count) {
+                ret = dict_set_int32 (dict, "max-count", ctx->max_count);
+                if (ret)
+                        goto out;
+        }
+
         ret = dict_allocate_and_serialize (dict,
                                            &req.dict.dict_val,
                                            (size_t *)&req.dict.dict_len);
@@ -2056,6 +2101,44 @@ out:
         return ret;
 }
 
+int32_t
+gf_cli3_1_batch_volume (call_frame_t *frame, xlator_t *this,
+                        void *data)
+{
+        gf1_cli_batch_vol_req   req = {{0,},};
+        int                     ret = 0;
+        dict_t                  *dict = NULL;
+        size_t                  len = 0;
+
+        if (!frame || !this ||  !data) {
+                ret = -1;
+                goto out;
+        }
+
+        dict = data;
+
+        ret = dict_allocate_and_serialize (dict, &req.dict.dict_val, &len);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "failed to get serialized length of dict");
+                goto out;
+        }
+        req.dict.dict_len = len;
+
+        ret = cli_cmd_submit (&req, frame, cli_rpc_prog,
+                              GLUSTER_CLI_BATCH_VOLUME, NULL,
+                              gf_xdr_from_cli_batch_vol_req,
+                              this, gf_cli3_1_batch_volume_cbk);
+
+out:
+        if (req.dict.dict_val)
+                GF_FREE (req.dict.dict_val);
+
+        gf_log ("cli", GF_LOG_DEBUG, "Returning %d", ret);
+
+        return ret;
+}
+
 int32_t
 gf_cli3_1_add_brick (call_frame_t *frame, xlator_t *this,
                          void *data)
@@ -2662,6 +2745,218 @@ out:
         return ret;
 }
 
+static char *cli_txn_phases[] = {
+        "lock", "stage-local", "stage", "brick-op", "commit-local", "commit",
+        "unlock", "total", NULL
+};
+
+/* buckets is the comma separated list of counts glusterd keeps per phase,
+ * bucket 0 under 1ms and bucket n in [2^(n-1), 2^n) ms. Prints the
+ * non-empty ones. */
+static void
+cli_txn_hist_str (char *buckets, char *buf, size_t size)
+{
+        char            *tmp = NULL;
+        char            *save = NULL;
+        char            *tok = NULL;
+        int             i = 0;
+        int             len = 0;
+
+        buf[0] = '\0';
+        tmp = gf_strdup (buckets);
+        if (!tmp)
+                return;
+
+        for (tok = strtok_r (tmp, ",", &save); tok && (len < size);
+             tok = strtok_r (NULL, ",", &save), i++) {
+                if (!strcmp (tok, "0"))
+                        continue;
+                if (i == 0)
+                        len += snprintf (buf + len, size - len, "<1:%s ",
+                                         tok);
+                else
+                        len += snprintf (buf + len, size - len,
+                                         "%lu-%lu:%s ", 1UL << (i - 1),
+                                         1UL << i, tok);
+        }
+
+        GF_FREE (tmp);
+}
+
+static int
+gf_cli3_1_txn_stats_cbk (struct rpc_req *req, struct iovec *iov,
+                         int count, void *myframe)
+{
+        gf1_cli_txn_stats_rsp      rsp   = {0,};
+        int                        ret   = -1;
+        dict_t                     *dict = NULL;
+        int32_t                    op_count = 0;
+        int32_t                    peer_count = 0;
+        int64_t                    since = 0;
+        time_t                     since_time = 0;
+        char                       timestr[256] = {0};
+        char                       key[256] = {0};
+        char                       hist[512] = {0};
+        char                       *name = NULL;
+        char                       *buckets = NULL;
+        uint64_t                   samples = 0;
+        uint64_t                   avg = 0;
+        uint64_t                   max = 0;
+        uint64_t                   timeouts = 0;
+        int                        i = 0;
+        int                        p = 0;
+
+        if (-1 == req->rpc_status) {
+                goto out;
+        }
+
+        ret = gf_xdr_to_cli_txn_stats_rsp (*iov, &rsp);
+        if (ret < 0) {
+                gf_log ("", GF_LOG_ERROR, "error");
+                goto out;
+        }
+
+        if (rsp.op_ret) {
+                if (strcmp (rsp.op_errstr, ""))
+                        cli_out ("%s", rsp.op_errstr);
+                else
+                        cli_out ("txn-stats unsuccessful");
+                ret = rsp.op_ret;
+                goto out;
+        }
+
+        dict = dict_new ();
+        if (!dict) {
+                ret = -1;
+                goto out;
+        }
+
+        ret = dict_unserialize (rsp.stats.stats_val, rsp.stats.stats_len,
+                                &dict);
+        if (ret) {
+                cli_out ("bad response");
+                goto out;
+        }
+
+        ret = dict_get_int64 (dict, "since", &since);
+        if (ret)
+                goto out;
+        since_time = since;
+        strftime (timestr, sizeof (timestr), "%Y-%m-%d %H:%M:%S",
+                  localtime (&since_time));
+        cli_out ("Transactions since %s", timestr);
+
+        ret = dict_get_int32 (dict, "count", &op_count);
+        if (!op_count)
+                cli_out ("No transactions");
+
+        for (i = 0; i < op_count; i++) {
+                snprintf (key, sizeof (key), "op%d.name", i);
+                ret = dict_get_str (dict, key, &name);
+                if (ret)
+                        goto out;
+
+                cli_out ("Operation: %s", name);
+                cli_out ("  %-14s %10s %12s %12s  %s", "phase", "count",
+                         "avg(ms)", "max(ms)", "latency(ms):count");
+
+                for (p = 0; cli_txn_phases[p]; p++) {
+                        snprintf (key, sizeof (key), "op%d.%s.count", i,
+                                  cli_txn_phases[p]);
+                        ret = dict_get_uint64 (dict, key, &samples);
+                        if (ret || !samples)
+                                continue;
+
+                        snprintf (key, sizeof (key), "op%d.%s.avg_us", i,
+                                  cli_txn_phases[p]);
+                        ret = dict_get_uint64 (dict, key, &avg);
+                        if (ret)
+                                goto out;
+                        snprintf (key, sizeof (key), "op%d.%s.max_us", i,
+                                  cli_txn_phases[p]);
+                        ret = dict_get_uint64 (dict, key, &max);
+                        if (ret)
+                                goto out;
+                        snprintf (key, sizeof (key), "op%d.%s.buckets", i,
+                                  cli_txn_phases[p]);
+                        ret = dict_get_str (dict, key, &buckets);
+                        if (ret)
+                                goto out;
+
+                        cli_txn_hist_str (buckets, hist, sizeof (hist));
+                        cli_out ("  %-14s %10"PRIu64" %12.3f %12.3f  %s",
+                                 cli_txn_phases[p], samples, avg / 1000.0,
+                                 max / 1000.0, hist);
+                }
+                cli_out (" ");
+        }
+
+        ret = dict_get_int32 (dict, "peer-count", &peer_count);
+        if (peer_count)
+                cli_out ("  %-30s %10s %12s %12s %10s", "peer", "answers",
+                         "avg(ms)", "max(ms)", "timeouts");
+
+        for (i = 0; i < peer_count; i++) {
+                snprintf (key, sizeof (key), "peer%d.hostname", i);
+                ret = dict_get_str (dict, key, &name);
+                if (ret)
+                        goto out;
+                snprintf (key, sizeof (key), "peer%d.answers", i);
+                ret = dict_get_uint64 (dict, key, &samples);
+                if (ret)
+                        goto out;
+                snprintf (key, sizeof (key), "peer%d.avg_us", i);
+                ret = dict_get_uint64 (dict, key, &avg);
+                if (ret)
+                        goto out;
+                snprintf (key, sizeof (key), "peer%d.max_us", i);
+                ret = dict_get_uint64 (dict, key, &max);
+                if (ret)
+                        goto out;
+                snprintf (key, sizeof (key), "peer%d.timeouts", i);
+                ret = dict_get_uint64 (dict, key, &timeouts);
+                if (ret)
+                        goto out;
+
+                cli_out ("  %-30s %10"PRIu64" %12.3f %12.3f %10"PRIu64,
+                         name, samples, avg / 1000.0, max / 1000.0, timeouts);
+        }
+
+        ret = rsp.op_ret;
+
+out:
+        if (dict)
+                dict_unref (dict);
+        if (rsp.stats.stats_val)
+                free (rsp.stats.stats_val);
+        cli_cmd_broadcast_response (ret);
+        return ret;
+}
+
+int32_t
+gf_cli3_1_txn_stats (call_frame_t *frame, xlator_t *this, void *data)
+{
+        int                        ret = -1;
+        gf1_cli_txn_stats_req      req = {0,};
+
+        GF_ASSERT (frame);
+        GF_ASSERT (this);
+        GF_ASSERT (data);
+
+        if (!frame || !this || !data)
+                goto out;
+        req.flags = *(int *)data;
+        ret = cli_cmd_submit (&req, frame, cli_rpc_prog,
+                              GLUSTER_CLI_TXN_STATS, NULL,
+                              gf_xdr_from_cli_txn_stats_req,
+                              this, gf_cli3_1_txn_stats_cbk);
+
+out:
+        gf_log ("cli", GF_LOG_DEBUG, "Returning %d", ret);
+
+        return ret;
+}
+
 int
 gf_cli3_1_gsync_config_command (dict_t *dict)
 {
@@ -3520,7 +3815,9 @@ struct rpc_clnt_procedure gluster_cli_actors[GLUSTER_CLI_MAXVALUE] = {
         [GLUSTER_CLI_QUOTA]            = {"QUOTA", gf_cli3_1_quota},
         [GLUSTER_CLI_TOP_VOLUME]       = {"TOP_VOLUME", gf_cli3_1_top_volume},
         [GLUSTER_CLI_LOG_LEVEL]        = {"VOLUME_LOGLEVEL", gf_cli3_1_log_level},
-        [GLUSTER_CLI_GETWD]            = {"GETWD", gf_cli3_1_getwd}
+        [GLUSTER_CLI_GETWD]            = {"GETWD", gf_cli3_1_getwd},
+        [GLUSTER_CLI_TXN_STATS]        = {"TXN_STATS", gf_cli3_1_txn_stats},
+        [GLUSTER_CLI_BATCH_VOLUME]     = {"BATCH_VOLUME", gf_cli3_1_batch_volume}
 };
 
 struct rpc_clnt_program cli_prog = {
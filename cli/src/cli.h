@@ -33,6 +33,7 @@
 #define CLI_GLUSTERD_PORT                  24007
 #define CLI_DEFAULT_CONN_TIMEOUT             120
 #define CLI_DEFAULT_CMD_TIMEOUT              120
+#define CLI_GET_VOLUME_PAGE_SIZE              64 /* volumes per info reply */
 #define DEFAULT_CLI_LOG_FILE_DIRECTORY     DATADIR "/log/glusterfs"
 
 enum argp_option_keys {
@@ -140,6 +141,7 @@ struct cli_local {
                 struct {
                         char    *volname;
                         int     flags;
+                        int     more;   /* volumes left after the page */
                 } get_vol;
         } u;
 };
@@ -200,6 +202,9 @@ int32_t
 cli_cmd_volume_set_parse (const char **words, int wordcount,
                           dict_t **options);
 
+int32_t
+cli_cmd_volume_batch_parse (const char *file, dict_t **options);
+
 int32_t
 cli_cmd_volume_add_brick_parse (const char **words, int wordcount,
                                 dict_t **options);
@@ -0,0 +1,265 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * dict-bm: times dict_set, dict_get, dict_del, dict_foreach and a
+ * serialize/unserialize round trip on dicts of 8 to 100000 keys named
+ * like those of glusterd's volume dicts (volume1.brickN.path), and the
+ * creation and destruction of small dicts as the fops use them, with the
+ * allocations that takes as counted by the memory accounting. Then
+ * compares unserializing an xattr sized dict by copying every value with
+ * leaving them in an iobuf, and serializing a big dict into one buffer
+ * with serializing it into iobufs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "dict.h"
+#include "iobuf.h"
+#include "mem-types.h"
+
+#define SMALL_DICTS     100000
+#define XATTR_DICTS     100000
+#define BIG_DICT_KEYS   10000
+#define BIG_DICT_ROUNDS 100
+
+static double
+now_us (void)
+{
+        struct timeval tv = {0,};
+
+        gettimeofday (&tv, NULL);
+        return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static uint64_t
+total_allocs (void)
+{
+        xlator_t *this = THIS;
+        uint64_t  total = 0;
+        int       i = 0;
+
+        for (i = 0; i < this->mem_acct.num_types; i++) {
+                gf_mem_acct_fold (this, i);
+                total += this->mem_acct.rec[i].total_allocs;
+        }
+
+        return total;
+}
+
+static void
+count_pair (dict_t *dict, char *key, data_t *value, void *data)
+{
+        (*(int *)data)++;
+}
+
+static void
+run (int count, char **keys)
+{
+        dict_t  *dict = NULL;
+        dict_t  *copy = NULL;
+        char    *buf = NULL;
+        int32_t  len = 0;
+        double   t[6] = {0,};
+        int      seen = 0;
+        int      i = 0;
+
+        dict = dict_new ();
+
+        t[0] = now_us ();
+        for (i = 0; i < count; i++)
+                dict_set_str (dict, keys[i], "/export/brick");
+        t[1] = now_us ();
+        for (i = 0; i < count; i++) {
+                if (!dict_get (dict, keys[i]))
+                        abort ();
+        }
+        t[2] = now_us ();
+        dict_foreach (dict, count_pair, &seen);
+        t[3] = now_us ();
+
+        len = dict_serialized_length (dict);
+        buf = malloc (len);
+        dict_serialize (dict, buf);
+        copy = dict_new ();
+        dict_unserialize (buf, len, &copy);
+        t[4] = now_us ();
+
+        for (i = 0; i < count; i++)
+                dict_del (dict, keys[i]);
+        t[5] = now_us ();
+
+        if (seen != count || copy->count != count || dict->count)
+                abort ();
+
+        printf ("%8d %10.1f %10.1f %10.1f %12.1f %10.1f\n", count,
+                (t[1] - t[0]) * 1000 / count, (t[2] - t[1]) * 1000 / count,
+                (t[3] - t[2]) * 1000 / count, (t[4] - t[3]) * 1000 / count,
+                (t[5] - t[4]) * 1000 / count);
+
+        dict_unref (copy);
+        dict_unref (dict);
+        free (buf);
+}
+
+static void
+run_zerocopy (char **keys)
+{
+        struct iobuf_pool *pool = NULL;
+        struct iobuf      *iobuf = NULL;
+        struct iobref     *iobref = NULL;
+        struct iovec       vec[8];
+        dict_t            *dict = NULL;
+        dict_t            *copy = NULL;
+        char              *buf = NULL;
+        char              *value = NULL;
+        size_t             size = 0;
+        size_t             len = 0;
+        double             start = 0;
+        double             t_copy = 0;
+        double             t_pool = 0;
+        int                count = 0;
+        int                i = 0;
+
+        pool = iobuf_pool_new (8 * 128 * 1024, 128 * 1024);
+
+        for (size = 256; size <= 4096; size *= 16) {
+                value = calloc (1, size);
+                dict = dict_new ();
+                for (i = 0; i < 8; i++)
+                        dict_set_static_bin (dict, keys[i], value, size);
+                dict_allocate_and_serialize (dict, &buf, &len);
+                dict_unref (dict);
+
+                start = now_us ();
+                for (i = 0; i < XATTR_DICTS; i++) {
+                        copy = dict_new ();
+                        dict_unserialize (buf, len, &copy);
+                        dict_unref (copy);
+                }
+                t_copy = now_us () - start;
+
+                start = now_us ();
+                for (i = 0; i < XATTR_DICTS; i++) {
+                        copy = dict_new ();
+                        dict_unserialize_pool (pool, buf, len, &copy);
+                        dict_unref (copy);
+                }
+                t_pool = now_us () - start;
+
+                /* as the server does, having decoded it into an iobuf */
+                iobuf = iobuf_get (pool);
+                iobref = iobref_new ();
+                iobref_add (iobref, iobuf);
+                memcpy (iobuf_ptr (iobuf), buf, len);
+                start = now_us ();
+                for (i = 0; i < XATTR_DICTS; i++) {
+                        copy = dict_new ();
+                        dict_unserialize_iobref (iobuf_ptr (iobuf), len,
+                                                 &copy, iobref);
+                        dict_unref (copy);
+                }
+                printf ("xattr dict (%zu bytes) unserialize: %.1f ns copying "
+                        "values, %.1f ns copied into an iobuf, %.1f ns in "
+                        "place\n", len, t_copy * 1000 / XATTR_DICTS,
+                        t_pool * 1000 / XATTR_DICTS,
+                        (now_us () - start) * 1000 / XATTR_DICTS);
+                iobref_unref (iobref);
+                iobuf_unref (iobuf);
+                GF_FREE (buf);
+                free (value);
+        }
+
+        dict = dict_new ();
+        for (i = 0; i < BIG_DICT_KEYS; i++)
+                dict_set_str (dict, keys[i], "/export/brick");
+
+        start = now_us ();
+        for (i = 0; i < BIG_DICT_ROUNDS; i++) {
+                dict_allocate_and_serialize (dict, &buf, &len);
+                GF_FREE (buf);
+        }
+        t_copy = now_us () - start;
+
+        start = now_us ();
+        for (i = 0; i < BIG_DICT_ROUNDS; i++) {
+                iobref = iobref_new ();
+                count = 8;
+                if (dict_serialize_iobref (dict, pool, iobref, vec,
+                                           &count) != len)
+                        abort ();
+                iobref_unref (iobref);
+        }
+        printf ("%d key dict (%zu bytes) serialize: %.1f us into a buffer, "
+                "%.1f us into %d iobufs\n", BIG_DICT_KEYS, len,
+                t_copy / BIG_DICT_ROUNDS,
+                (now_us () - start) / BIG_DICT_ROUNDS, count);
+
+        dict_unref (dict);
+}
+
+int
+main (int argc, char *argv[])
+{
+        int       counts[] = {8, 64, 1000, 10000, 100000};
+        int       max = 100000;
+        char    **keys = NULL;
+        dict_t   *dict = NULL;
+        double    start = 0;
+        uint64_t  allocs = 0;
+        int       i = 0;
+
+        /* turn on memory accounting */
+        setenv ("GLUSTERFS_DISABLE_MEM_ACCT", "0", 1);
+        glusterfs_globals_init ();
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        keys = calloc (max, sizeof (*keys));
+        for (i = 0; i < max; i++) {
+                keys[i] = malloc (64);
+                snprintf (keys[i], 64, "volume1.brick%d.path", i);
+        }
+
+        printf ("%8s %10s %10s %10s %12s %10s   (ns per key)\n", "keys",
+                "set", "get", "foreach", "serialize", "del");
+        for (i = 0; i < sizeof (counts) / sizeof (counts[0]); i++)
+                run (counts[i], keys);
+
+        allocs = total_allocs ();
+        start = now_us ();
+        for (i = 0; i < SMALL_DICTS; i++) {
+                dict = dict_new ();
+                dict_set_int32 (dict, "gfid-req", i);
+                dict_set_str (dict, "trusted.glusterfs.dht", "x");
+                dict_get (dict, "gfid-req");
+                dict_unref (dict);
+        }
+        printf ("small dict new/set/get/unref: %.1f ns, %.1f allocations\n",
+                (now_us () - start) * 1000 / SMALL_DICTS,
+                (double)(total_allocs () - allocs) / SMALL_DICTS);
+
+        run_zerocopy (keys);
+
+        return 0;
+}
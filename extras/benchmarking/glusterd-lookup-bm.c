@@ -0,0 +1,235 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * glusterd-lookup-bm: compares the cost of looking up a volume by name and
+ * a brick by port with a scan of the volume (and brick) lists against the
+ * hash buckets glusterd keeps alongside them, for 10 to 10000 volumes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "list.h"
+#include "hashfn.h"
+
+#define HASH_SIZE       4099    /* GLUSTERD_HASH_SIZE */
+#define BRICKS_PER_VOL  4
+#define LOOKUPS         100000
+
+struct brick {
+        char             path[256];
+        int              port;
+        struct list_head brick_list;
+        struct list_head port_hash;
+};
+
+struct volume {
+        char             volname[64];
+        struct list_head vol_list;
+        struct list_head vol_hash;
+        struct list_head bricks;
+};
+
+static struct list_head volumes;
+static struct list_head vol_table[HASH_SIZE];
+static struct list_head port_table[HASH_SIZE];
+
+static uint32_t
+hash_str (const char *str)
+{
+        return SuperFastHash (str, strlen (str)) % HASH_SIZE;
+}
+
+static void
+populate (struct volume *vols, struct brick *bricks, int count)
+{
+        int i = 0;
+        int j = 0;
+        struct brick *brick = NULL;
+
+        INIT_LIST_HEAD (&volumes);
+        for (i = 0; i < HASH_SIZE; i++) {
+                INIT_LIST_HEAD (&vol_table[i]);
+                INIT_LIST_HEAD (&port_table[i]);
+        }
+
+        for (i = 0; i < count; i++) {
+                snprintf (vols[i].volname, sizeof (vols[i].volname),
+                          "vol%d", i);
+                INIT_LIST_HEAD (&vols[i].bricks);
+                list_add_tail (&vols[i].vol_list, &volumes);
+                list_add (&vols[i].vol_hash,
+                          &vol_table[hash_str (vols[i].volname)]);
+
+                for (j = 0; j < BRICKS_PER_VOL; j++) {
+                        brick = &bricks[i * BRICKS_PER_VOL + j];
+                        snprintf (brick->path, sizeof (brick->path),
+                                  "/export/vol%d/brick%d", i, j);
+                        brick->port = 24009 + i * BRICKS_PER_VOL + j;
+                        list_add_tail (&brick->brick_list, &vols[i].bricks);
+                        list_add (&brick->port_hash,
+                                  &port_table[brick->port % HASH_SIZE]);
+                }
+        }
+}
+
+static struct volume *
+volume_scan (const char *volname)
+{
+        struct volume *vol = NULL;
+
+        list_for_each_entry (vol, &volumes, vol_list) {
+                if (!strcmp (vol->volname, volname))
+                        return vol;
+        }
+        return NULL;
+}
+
+static struct volume *
+volume_hashed (const char *volname)
+{
+        struct volume *vol = NULL;
+
+        list_for_each_entry (vol, &vol_table[hash_str (volname)], vol_hash) {
+                if (!strcmp (vol->volname, volname))
+                        return vol;
+        }
+        return NULL;
+}
+
+static struct brick *
+brick_scan (const char *path, int port)
+{
+        struct volume *vol = NULL;
+        struct brick  *brick = NULL;
+
+        list_for_each_entry (vol, &volumes, vol_list) {
+                list_for_each_entry (brick, &vol->bricks, brick_list) {
+                        if (!strcmp (brick->path, path) &&
+                            (brick->port == port))
+                                return brick;
+                }
+        }
+        return NULL;
+}
+
+static struct brick *
+brick_hashed (const char *path, int port)
+{
+        struct brick  *brick = NULL;
+
+        list_for_each_entry (brick, &port_table[port % HASH_SIZE], port_hash) {
+                if (!strcmp (brick->path, path) && (brick->port == port))
+                        return brick;
+        }
+        return NULL;
+}
+
+static double
+elapsed_ns (struct timeval *start, struct timeval *end)
+{
+        return ((end->tv_sec - start->tv_sec) * 1e9 +
+                (end->tv_usec - start->tv_usec) * 1e3) / LOOKUPS;
+}
+
+int
+main (int argc, char *argv[])
+{
+        int             counts[] = {10, 100, 1000, 10000};
+        int             c = 0;
+        int             i = 0;
+        int             n = 0;
+        int             idx = 0;
+        struct volume   *vols = NULL;
+        struct brick    *bricks = NULL;
+        char            name[64] = {0,};
+        char            path[256] = {0,};
+        struct timeval  start = {0,};
+        struct timeval  end = {0,};
+        double          vol_scan = 0;
+        double          vol_hash = 0;
+        double          brick_scan_ns = 0;
+        double          brick_hash_ns = 0;
+        unsigned long   found = 0;
+
+        printf ("%8s %14s %14s %14s %14s\n", "volumes", "vol-scan(ns)",
+                "vol-hash(ns)", "port-scan(ns)", "port-hash(ns)");
+
+        for (c = 0; c < sizeof (counts) / sizeof (counts[0]); c++) {
+                n = counts[c];
+                vols = calloc (n, sizeof (*vols));
+                bricks = calloc (n * BRICKS_PER_VOL, sizeof (*bricks));
+                if (!vols || !bricks) {
+                        fprintf (stderr, "out of memory\n");
+                        return 1;
+                }
+                populate (vols, bricks, n);
+
+                gettimeofday (&start, NULL);
+                for (i = 0; i < LOOKUPS; i++) {
+                        snprintf (name, sizeof (name), "vol%d", i % n);
+                        found += (volume_scan (name) != NULL);
+                }
+                gettimeofday (&end, NULL);
+                vol_scan = elapsed_ns (&start, &end);
+
+                gettimeofday (&start, NULL);
+                for (i = 0; i < LOOKUPS; i++) {
+                        snprintf (name, sizeof (name), "vol%d", i % n);
+                        found += (volume_hashed (name) != NULL);
+                }
+                gettimeofday (&end, NULL);
+                vol_hash = elapsed_ns (&start, &end);
+
+                gettimeofday (&start, NULL);
+                for (i = 0; i < LOOKUPS; i++) {
+                        idx = i % (n * BRICKS_PER_VOL);
+                        snprintf (path, sizeof (path), "/export/vol%d/brick%d",
+                                  idx / BRICKS_PER_VOL, idx % BRICKS_PER_VOL);
+                        found += (brick_scan (path, 24009 + idx) != NULL);
+                }
+                gettimeofday (&end, NULL);
+                brick_scan_ns = elapsed_ns (&start, &end);
+
+                gettimeofday (&start, NULL);
+                for (i = 0; i < LOOKUPS; i++) {
+                        idx = i % (n * BRICKS_PER_VOL);
+                        snprintf (path, sizeof (path), "/export/vol%d/brick%d",
+                                  idx / BRICKS_PER_VOL, idx % BRICKS_PER_VOL);
+                        found += (brick_hashed (path, 24009 + idx) != NULL);
+                }
+                gettimeofday (&end, NULL);
+                brick_hash_ns = elapsed_ns (&start, &end);
+
+                printf ("%8d %14.1f %14.1f %14.1f %14.1f\n", n, vol_scan,
+                        vol_hash, brick_scan_ns, brick_hash_ns);
+
+                free (vols);
+                free (bricks);
+        }
+
+        if (found != 4UL * LOOKUPS * c)
+                fprintf (stderr, "lookup failures: %lu\n",
+                         4UL * LOOKUPS * c - found);
+
+        return 0;
+}
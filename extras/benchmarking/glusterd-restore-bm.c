@@ -0,0 +1,407 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * glusterd-restore-bm: lays out a glusterd store of 100 to 10000 volumes
+ * under a temporary directory and times the two ways glusterd_restore ()
+ * can load it: parsing the text store the way glusterd_store_retrieve_
+ * volumes () does (stat, open and line by line parse of every info and
+ * brick file, plus the cksum file write), and mapping the store snapshot
+ * (one mmap, a readdir and a stat per info file to check it is current).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define BRICKS_PER_VOL  4
+#define OPTS_PER_VOL    4
+
+static char     workdir[] = "/tmp/glusterd-restore-bm.XXXXXX";
+static char     *snapbuf;
+static size_t   snaplen;
+static size_t   snapsize;
+
+static void
+snap_put (const void *data, size_t len)
+{
+        while (snaplen + len > snapsize) {
+                snapsize = snapsize ? snapsize * 2 : 4096;
+                snapbuf = realloc (snapbuf, snapsize);
+                if (!snapbuf) {
+                        fprintf (stderr, "out of memory\n");
+                        exit (1);
+                }
+        }
+        memcpy (snapbuf + snaplen, data, len);
+        snaplen += len;
+}
+
+static void
+snap_put_str (const char *str)
+{
+        uint32_t len = strlen (str) + 1;
+
+        snap_put (&len, sizeof (len));
+        snap_put (str, len);
+}
+
+static void
+write_file (const char *path, const char *buf)
+{
+        FILE *fp = fopen (path, "w");
+
+        if (!fp) {
+                perror (path);
+                exit (1);
+        }
+        fputs (buf, fp);
+        fclose (fp);
+}
+
+static void
+populate (int count)
+{
+        int             i = 0;
+        int             j = 0;
+        uint32_t        u32 = 0;
+        char            path[4096] = {0,};
+        char            buf[8192] = {0,};
+        char            brick[256] = {0,};
+        int             len = 0;
+        struct stat     stbuf = {0,};
+        uint64_t        stamp[4] = {0,};
+
+        snprintf (path, sizeof (path), "%s/vols", workdir);
+        mkdir (path, 0777);
+
+        snaplen = 0;
+        u32 = 0;
+        snap_put (&u32, sizeof (u32));          /* volume count */
+
+        for (i = 0; i < count; i++) {
+                snprintf (path, sizeof (path), "%s/vols/vol%d/bricks",
+                          workdir, i);
+                snprintf (buf, sizeof (buf), "%s/vols/vol%d", workdir, i);
+                mkdir (buf, 0777);
+                mkdir (path, 0777);
+
+                len = snprintf (buf, sizeof (buf),
+                                "type=2\ncount=%d\nstatus=1\nsub_count=2\n"
+                                "version=7\ntransport-type=0\nvolume-id="
+                                "6a4d2c1e-7f0b-4c5e-9a3d-%012d\n",
+                                BRICKS_PER_VOL, i);
+                for (j = 0; j < OPTS_PER_VOL; j++)
+                        len += snprintf (buf + len, sizeof (buf) - len,
+                                         "performance.option-%d=%dMB\n",
+                                         j, j + 1);
+                for (j = 0; j < BRICKS_PER_VOL; j++)
+                        len += snprintf (buf + len, sizeof (buf) - len,
+                                         "brick-%d=server%d:-export-vol%d-"
+                                         "brick%d\n", j, j, i, j);
+                snprintf (path, sizeof (path), "%s/vols/vol%d/info",
+                          workdir, i);
+                write_file (path, buf);
+
+                stat (path, &stbuf);
+                stamp[0] = stbuf.st_ino;
+                stamp[1] = stbuf.st_size;
+                stamp[2] = stbuf.st_mtime;
+
+                snprintf (buf, sizeof (buf), "vol%d", i);
+                snap_put_str (buf);
+                snap_put (stamp, sizeof (stamp));
+                for (j = 0; j < 7; j++)
+                        snap_put (&j, sizeof (uint32_t));
+                snap_put (stamp, 16);                   /* volume-id */
+                u32 = OPTS_PER_VOL;
+                snap_put (&u32, sizeof (u32));
+                for (j = 0; j < OPTS_PER_VOL; j++) {
+                        snprintf (buf, sizeof (buf), "performance.option-%d",
+                                  j);
+                        snap_put_str (buf);
+                        snprintf (buf, sizeof (buf), "%dMB", j + 1);
+                        snap_put_str (buf);
+                }
+                u32 = 0;
+                snap_put (&u32, sizeof (u32));          /* slaves */
+                u32 = BRICKS_PER_VOL;
+                snap_put (&u32, sizeof (u32));
+
+                for (j = 0; j < BRICKS_PER_VOL; j++) {
+                        snprintf (brick, sizeof (brick),
+                                  "/export/vol%d/brick%d", i, j);
+                        snprintf (buf, sizeof (buf),
+                                  "hostname=server%d\npath=%s\n"
+                                  "listen-port=%d\nrdma.listen-port=0\n",
+                                  j, brick, 24009 + i * BRICKS_PER_VOL + j);
+                        snprintf (path, sizeof (path),
+                                  "%s/vols/vol%d/bricks/server%d:-export-"
+                                  "vol%d-brick%d", workdir, i, j, i, j);
+                        write_file (path, buf);
+
+                        snprintf (buf, sizeof (buf), "server%d", j);
+                        snap_put_str (buf);
+                        snap_put_str (brick);
+                        u32 = 24009 + i * BRICKS_PER_VOL + j;
+                        snap_put (&u32, sizeof (u32));
+                        u32 = 0;
+                        snap_put (&u32, sizeof (u32));
+                        snap_put (stamp, 16);           /* uuid */
+                }
+        }
+
+        u32 = count;
+        memcpy (snapbuf, &u32, sizeof (u32));
+        snprintf (path, sizeof (path), "%s/store.snap", workdir);
+        len = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if ((len < 0) || (write (len, snapbuf, snaplen) != snaplen)) {
+                perror (path);
+                exit (1);
+        }
+        close (len);
+}
+
+/* one store file the way glusterd reads it: stat and open/close from
+ * glusterd_store_handle_retrieve (), then fgets/strtok/strdup per line */
+static int
+parse_file (const char *path, char *match, char *found, size_t size)
+{
+        struct stat     stbuf = {0,};
+        char            line[4096] = {0,};
+        char            *key = NULL;
+        char            *value = NULL;
+        FILE            *fp = NULL;
+        int             fd = -1;
+        int             lines = 0;
+
+        if (stat (path, &stbuf))
+                return -1;
+        fd = open (path, O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd < 0)
+                return -1;
+        close (fd);
+
+        fp = fopen (path, "r");
+        if (!fp)
+                return -1;
+        while (fgets (line, sizeof (line), fp)) {
+                line[strcspn (line, "\n")] = '\0';
+                key = strdup (strtok (line, "="));
+                value = strtok (NULL, "=");
+                value = value ? strdup (value) : NULL;
+                if (match && value && !strncmp (key, match, strlen (match)))
+                        snprintf (found + lines * 256, size, "%s", value);
+                if (match && !strncmp (key, match, strlen (match)))
+                        lines++;
+                free (key);
+                free (value);
+        }
+        fclose (fp);
+        return lines;
+}
+
+static int
+restore_text (int count)
+{
+        DIR             *dir = NULL;
+        struct dirent   *entry = NULL;
+        char            path[4096] = {0,};
+        char            bricks[BRICKS_PER_VOL * 256] = {0,};
+        int             restored = 0;
+        int             nbricks = 0;
+        int             j = 0;
+        int             fd = -1;
+
+        snprintf (path, sizeof (path), "%s/vols", workdir);
+        dir = opendir (path);
+        while ((entry = readdir (dir))) {
+                if (entry->d_name[0] == '.')
+                        continue;
+                snprintf (path, sizeof (path), "%s/vols/%s/info", workdir,
+                          entry->d_name);
+                nbricks = parse_file (path, "brick-", bricks, 256);
+                for (j = 0; j < nbricks; j++) {
+                        snprintf (path, sizeof (path), "%s/vols/%s/bricks/%s",
+                                  workdir, entry->d_name, bricks + j * 256);
+                        parse_file (path, NULL, NULL, 0);
+                }
+
+                /* glusterd_volume_compute_cksum () */
+                snprintf (path, sizeof (path), "%s/vols/%s/cksum", workdir,
+                          entry->d_name);
+                fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd >= 0) {
+                        if (write (fd, "info=0\n", 7) != 7)
+                                perror (path);
+                        close (fd);
+                }
+                restored++;
+        }
+        closedir (dir);
+        return restored;
+}
+
+static uint32_t
+get_u32 (char **cur)
+{
+        uint32_t val = 0;
+
+        memcpy (&val, *cur, sizeof (val));
+        *cur += sizeof (val);
+        return val;
+}
+
+static char *
+get_str (char **cur)
+{
+        uint32_t        len = get_u32 (cur);
+        char            *str = *cur;
+
+        *cur += len;
+        return str;
+}
+
+static int
+restore_snapshot (int count)
+{
+        DIR             *dir = NULL;
+        struct dirent   *entry = NULL;
+        struct stat     stbuf = {0,};
+        char            path[4096] = {0,};
+        char            *map = NULL;
+        char            *cur = NULL;
+        char            *name = NULL;
+        uint32_t        nvols = 0;
+        uint32_t        n = 0;
+        uint32_t        i = 0;
+        uint32_t        j = 0;
+        int             fd = -1;
+        int             entries = 0;
+
+        snprintf (path, sizeof (path), "%s/store.snap", workdir);
+        fd = open (path, O_RDONLY);
+        fstat (fd, &stbuf);
+        map = mmap (NULL, stbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+                perror ("mmap");
+                exit (1);
+        }
+
+        snprintf (path, sizeof (path), "%s/vols", workdir);
+        dir = opendir (path);
+        while ((entry = readdir (dir)))
+                if (entry->d_name[0] != '.')
+                        entries++;
+        closedir (dir);
+
+        cur = map;
+        nvols = get_u32 (&cur);
+        if (nvols != entries)
+                fprintf (stderr, "snapshot count mismatch\n");
+
+        for (i = 0; i < nvols; i++) {
+                name = get_str (&cur);
+                snprintf (path, sizeof (path), "%s/vols/%s/info", workdir,
+                          name);
+                stat (path, &stbuf);
+                cur += 4 * sizeof (uint64_t) + 7 * sizeof (uint32_t) + 16;
+                n = get_u32 (&cur);
+                for (j = 0; j < 2 * n; j++)
+                        free (strdup (get_str (&cur)));
+                n = get_u32 (&cur);
+                for (j = 0; j < 2 * n; j++)
+                        free (strdup (get_str (&cur)));
+                n = get_u32 (&cur);
+                for (j = 0; j < n; j++) {
+                        get_str (&cur);
+                        get_str (&cur);
+                        cur += 2 * sizeof (uint32_t) + 16;
+                }
+        }
+
+        munmap (map, snaplen);
+        close (fd);
+        return nvols;
+}
+
+static double
+elapsed_ms (struct timeval *start, struct timeval *end)
+{
+        return (end->tv_sec - start->tv_sec) * 1e3 +
+                (end->tv_usec - start->tv_usec) / 1e3;
+}
+
+int
+main (int argc, char *argv[])
+{
+        int             counts[] = {100, 1000, 10000};
+        int             c = 0;
+        int             restored = 0;
+        char            cmd[4096] = {0,};
+        struct timeval  start = {0,};
+        struct timeval  end = {0,};
+        double          text_ms = 0;
+        double          snap_ms = 0;
+
+        if (!mkdtemp (workdir)) {
+                perror ("mkdtemp");
+                return 1;
+        }
+
+        printf ("%8s %12s %12s %12s\n", "volumes", "text(ms)",
+                "snapshot(ms)", "snap-size");
+
+        for (c = 0; c < sizeof (counts) / sizeof (counts[0]); c++) {
+                populate (counts[c]);
+
+                gettimeofday (&start, NULL);
+                restored = restore_text (counts[c]);
+                gettimeofday (&end, NULL);
+                text_ms = elapsed_ms (&start, &end);
+                if (restored != counts[c])
+                        fprintf (stderr, "text restore: %d volumes\n",
+                                 restored);
+
+                gettimeofday (&start, NULL);
+                restored = restore_snapshot (counts[c]);
+                gettimeofday (&end, NULL);
+                snap_ms = elapsed_ms (&start, &end);
+                if (restored != counts[c])
+                        fprintf (stderr, "snapshot restore: %d volumes\n",
+                                 restored);
+
+                printf ("%8d %12.1f %12.1f %12zu\n", counts[c], text_ms,
+                        snap_ms, snaplen);
+        }
+
+        snprintf (cmd, sizeof (cmd), "rm -rf %s", workdir);
+        if (system (cmd))
+                fprintf (stderr, "could not remove %s\n", workdir);
+        free (snapbuf);
+
+        return 0;
+}
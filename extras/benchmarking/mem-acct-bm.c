@@ -0,0 +1,156 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * mem-acct-bm: 1 to 64 threads GF_CALLOC and GF_FREE small buffers of the
+ * same two memory types of one xlator, as io-threads and write-behind do,
+ * with memory accounting on. Compares the sharded counters against the
+ * counters under the lock of each type (which the accounting falls back
+ * to when an xlator has no shards) and against calloc/free with no
+ * accounting at all.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "mem-types.h"
+
+#define OPS_PER_THREAD  1000000
+#define DEPTH           4
+
+enum {
+        MODE_NONE,
+        MODE_LOCKED,
+        MODE_SHARDED,
+};
+
+static int                mode;
+static pthread_barrier_t  barrier;
+
+static double
+now_us (void)
+{
+        struct timeval tv = {0,};
+
+        gettimeofday (&tv, NULL);
+        return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void *
+worker (void *data)
+{
+        void  *bufs[DEPTH];
+        int    rounds = OPS_PER_THREAD / DEPTH;
+        int    r = 0;
+        int    i = 0;
+
+        pthread_barrier_wait (&barrier);
+
+        for (r = 0; r < rounds; r++) {
+                for (i = 0; i < DEPTH; i++) {
+                        if (mode == MODE_NONE)
+                                bufs[i] = calloc (1, 64 + i * 32);
+                        else
+                                bufs[i] = GF_CALLOC (1, 64 + i * 32,
+                                                     (i & 1) ?
+                                                     gf_common_mt_char :
+                                                     gf_common_mt_strdup);
+                }
+                for (i = DEPTH - 1; i >= 0; i--) {
+                        if (mode == MODE_NONE)
+                                free (bufs[i]);
+                        else
+                                GF_FREE (bufs[i]);
+                }
+        }
+
+        return NULL;
+}
+
+static double
+run (int threads)
+{
+        pthread_t *tids = NULL;
+        double     start = 0;
+        long       i = 0;
+
+        tids = calloc (threads, sizeof (*tids));
+        pthread_barrier_init (&barrier, NULL, threads + 1);
+
+        for (i = 0; i < threads; i++)
+                pthread_create (&tids[i], NULL, worker, NULL);
+
+        start = now_us ();
+        pthread_barrier_wait (&barrier);
+        for (i = 0; i < threads; i++)
+                pthread_join (tids[i], NULL);
+
+        pthread_barrier_destroy (&barrier);
+        free (tids);
+
+        return (now_us () - start) * 1000 / ((double)threads * OPS_PER_THREAD);
+}
+
+int
+main (int argc, char *argv[])
+{
+        struct mem_acct_shard *shards[GF_MEM_ACCT_SHARDS];
+        int                    counts[] = {1, 4, 16, 64};
+        double                 t[3] = {0,};
+        xlator_t              *this = NULL;
+        int                    i = 0;
+
+        /* turn on memory accounting */
+        setenv ("GLUSTERFS_DISABLE_MEM_ACCT", "0", 1);
+        glusterfs_globals_init ();
+        this = THIS;
+        xlator_mem_acct_init (this, gf_common_mt_end + 1);
+        memcpy (shards, this->mem_acct.shards, sizeof (shards));
+
+        printf ("%8s %10s %10s %10s   (ns per alloc and free)\n",
+                "threads", "none", "locked", "sharded");
+        for (i = 0; i < sizeof (counts) / sizeof (counts[0]); i++) {
+                mode = MODE_NONE;
+                t[0] = run (counts[i]);
+
+                mode = MODE_LOCKED;
+                memset (this->mem_acct.shards, 0, sizeof (shards));
+                t[1] = run (counts[i]);
+
+                mode = MODE_SHARDED;
+                memcpy (this->mem_acct.shards, shards, sizeof (shards));
+                t[2] = run (counts[i]);
+
+                printf ("%8d %10.1f %10.1f %10.1f\n", counts[i], t[0], t[1],
+                        t[2]);
+        }
+
+        gf_mem_acct_fold (this, gf_common_mt_char);
+        if (this->mem_acct.rec[gf_common_mt_char].num_allocs)
+                printf ("leak: %u gf_common_mt_char buffers counted\n",
+                        this->mem_acct.rec[gf_common_mt_char].num_allocs);
+
+        return 0;
+}
@@ -0,0 +1,250 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * mem-pool-bm: 1 to 64 threads each take and give back call frame sized
+ * objects of one shared pool, a few at a time as a fop winds and unwinds,
+ * from mem_get ()/mem_put () and from a pool with a single lock and a
+ * malloc fallback like the one they had before per-thread magazines.
+ * With "handoff" every other round a thread passes the objects it got to
+ * the next thread to put, as when a reply is handled by another thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "mem-pool.h"
+
+#define OPS_PER_THREAD  1000000
+#define DEPTH           8
+#define POOL_COUNT      16384
+#define OBJ_SIZE        200
+#define RING_SIZE       1024
+
+struct locked_pool {
+        pthread_mutex_t  lock;
+        void            *free;
+        char            *start;
+        char            *end;
+};
+
+static struct locked_pool  old_pool;
+static struct mem_pool    *new_pool;
+static int                 use_new;
+static pthread_barrier_t   barrier;
+static pthread_barrier_t   done;
+
+/* objects handed to a thread by the one before it, single producer and
+ * single consumer */
+struct ring {
+        void            *slots[RING_SIZE];
+        volatile int     head;
+        volatile int     tail;
+} __attribute__ ((aligned (64)));
+
+static struct ring rings[64];
+static int         nthreads;
+static int         handoff;
+
+static double
+now_us (void)
+{
+        struct timeval tv = {0,};
+
+        gettimeofday (&tv, NULL);
+        return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void
+old_pool_init (void)
+{
+        char *obj = NULL;
+        int   i = 0;
+
+        pthread_mutex_init (&old_pool.lock, NULL);
+        old_pool.start = calloc (POOL_COUNT, OBJ_SIZE);
+        old_pool.end = old_pool.start + POOL_COUNT * OBJ_SIZE;
+        for (i = 0; i < POOL_COUNT; i++) {
+                obj = old_pool.start + i * OBJ_SIZE;
+                *(void **)obj = old_pool.free;
+                old_pool.free = obj;
+        }
+}
+
+static void *
+old_get (void)
+{
+        void *obj = NULL;
+
+        pthread_mutex_lock (&old_pool.lock);
+        obj = old_pool.free;
+        if (obj)
+                old_pool.free = *(void **)obj;
+        else
+                obj = malloc (OBJ_SIZE);
+        pthread_mutex_unlock (&old_pool.lock);
+
+        return obj;
+}
+
+static void
+old_put (void *obj)
+{
+        pthread_mutex_lock (&old_pool.lock);
+        if ((char *)obj >= old_pool.start && (char *)obj < old_pool.end) {
+                *(void **)obj = old_pool.free;
+                old_pool.free = obj;
+        } else {
+                free (obj);
+        }
+        pthread_mutex_unlock (&old_pool.lock);
+}
+
+static void *
+get (void)
+{
+        return use_new ? mem_get (new_pool) : old_get ();
+}
+
+static void
+put (void *obj)
+{
+        if (use_new)
+                mem_put (new_pool, obj);
+        else
+                old_put (obj);
+}
+
+static void *
+worker (void *data)
+{
+        long         me = (long)data;
+        struct ring *ring = NULL;
+        void        *objs[DEPTH];
+        int          depth = DEPTH;
+        int          n = 0;
+        int          rounds = OPS_PER_THREAD / DEPTH;
+        int          r = 0;
+        int          i = 0;
+
+        pthread_barrier_wait (&barrier);
+
+        for (r = 0; r < rounds; r++) {
+                for (i = 0; i < DEPTH; i++) {
+                        objs[i] = get ();
+                        memset (objs[i], 0, 64);
+                }
+
+                if (handoff && (r & 1) && nthreads > 1) {
+                        ring = &rings[(me + 1) % nthreads];
+                        for (i = 0; i < DEPTH; i++) {
+                                if (ring->head - ring->tail == RING_SIZE)
+                                        break;
+                                ring->slots[ring->head % RING_SIZE] = objs[i];
+                                __sync_synchronize ();
+                                ring->head++;
+                        }
+                        n = i;
+                        ring = &rings[me];
+                        for (i = 0; i < n && ring->tail != ring->head; i++) {
+                                objs[i] = ring->slots[ring->tail % RING_SIZE];
+                                __sync_synchronize ();
+                                ring->tail++;
+                        }
+                        /* whatever was not swapped stays ours */
+                        memmove (objs + i, objs + n,
+                                 (DEPTH - n) * sizeof (void *));
+                        depth = i + DEPTH - n;
+                }
+
+                for (i = depth - 1; i >= 0; i--)
+                        put (objs[i]);
+                depth = DEPTH;
+        }
+
+        pthread_barrier_wait (&done);
+
+        /* what is left in the ring went unput */
+        ring = &rings[me];
+        while (ring->tail != ring->head)
+                put (ring->slots[ring->tail++ % RING_SIZE]);
+
+        return NULL;
+}
+
+static double
+run (int threads)
+{
+        pthread_t *tids = NULL;
+        double     start = 0;
+        long       i = 0;
+
+        nthreads = threads;
+        tids = calloc (threads, sizeof (*tids));
+        pthread_barrier_init (&barrier, NULL, threads + 1);
+        pthread_barrier_init (&done, NULL, threads);
+
+        for (i = 0; i < threads; i++)
+                pthread_create (&tids[i], NULL, worker, (void *)i);
+
+        start = now_us ();
+        pthread_barrier_wait (&barrier);
+        for (i = 0; i < threads; i++)
+                pthread_join (tids[i], NULL);
+
+        pthread_barrier_destroy (&barrier);
+        pthread_barrier_destroy (&done);
+        free (tids);
+
+        return (now_us () - start) * 1000 / ((double)threads * OPS_PER_THREAD);
+}
+
+int
+main (int argc, char *argv[])
+{
+        int    counts[] = {1, 4, 16, 64};
+        double t_old = 0;
+        double t_new = 0;
+        int    i = 0;
+
+        glusterfs_globals_init ();
+
+        old_pool_init ();
+        new_pool = mem_pool_new_fn (OBJ_SIZE, POOL_COUNT, "bm");
+
+        printf ("%8s %8s %14s %14s   (ns per get and put, all threads)\n",
+                "threads", "handoff", "single lock", "magazines");
+        for (handoff = 0; handoff < 2; handoff++) {
+                for (i = 0; i < sizeof (counts) / sizeof (counts[0]); i++) {
+                        use_new = 0;
+                        t_old = run (counts[i]);
+                        use_new = 1;
+                        t_new = run (counts[i]);
+                        printf ("%8d %8s %14.1f %14.1f\n", counts[i],
+                                handoff ? "yes" : "no", t_old, t_new);
+                }
+        }
+
+        return 0;
+}
@@ -0,0 +1,168 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * runner-spawn-bm: times starting /bin/true the way runner_start () did,
+ * fork (2) then closing descriptors through /proc/self/fd, against
+ * posix_spawn (3) closing them with posix_spawn_file_actions_addclosefrom_np,
+ * with 0 to 4GB of memory touched in the parent. Only the time until the
+ * child is started is counted, not the wait for it.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define SPAWNS          200
+#define PAGE            4096
+
+static char *argv_true[] = {"/bin/true", NULL};
+
+static double
+now_us (void)
+{
+        struct timeval tv = {0,};
+
+        gettimeofday (&tv, NULL);
+        return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static pid_t
+spawn_fork (void)
+{
+        pid_t          pid = -1;
+        DIR           *d = NULL;
+        struct dirent *de = NULL;
+        char          *e = NULL;
+        int            i = 0;
+        sigset_t       set;
+
+        pid = fork ();
+        if (pid)
+                return pid;
+
+        d = opendir ("/proc/self/fd");
+        if (d) {
+                while ((de = readdir (d))) {
+                        i = strtoul (de->d_name, &e, 10);
+                        if (*e == '\0' && i > 2 && i != dirfd (d))
+                                close (i);
+                }
+                closedir (d);
+        }
+        sigemptyset (&set);
+        sigprocmask (SIG_SETMASK, &set, NULL);
+        execv (argv_true[0], argv_true);
+        _exit (1);
+}
+
+static pid_t
+spawn_posix (void)
+{
+        posix_spawn_file_actions_t fa;
+        posix_spawnattr_t          attr;
+        sigset_t                   set;
+        pid_t                      pid = -1;
+
+        posix_spawn_file_actions_init (&fa);
+        posix_spawn_file_actions_addclosefrom_np (&fa, 3);
+        posix_spawnattr_init (&attr);
+        sigemptyset (&set);
+        posix_spawnattr_setsigmask (&attr, &set);
+        posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGMASK);
+
+        if (posix_spawn (&pid, argv_true[0], &fa, &attr, argv_true,
+                         environ))
+                pid = -1;
+
+        posix_spawnattr_destroy (&attr);
+        posix_spawn_file_actions_destroy (&fa);
+
+        return pid;
+}
+
+static double
+run (pid_t (*spawn) (void))
+{
+        double start = 0;
+        double total = 0;
+        pid_t  pid = -1;
+        int    i = 0;
+
+        for (i = 0; i < SPAWNS; i++) {
+                start = now_us ();
+                pid = spawn ();
+                total += now_us () - start;
+                if (pid == -1) {
+                        perror ("spawn");
+                        exit (1);
+                }
+                waitpid (pid, NULL, 0);
+        }
+
+        return total / SPAWNS;
+}
+
+int
+main (int argc, char *argv[])
+{
+        size_t  sizes[] = {0, 64, 256, 1024, 4096};
+        size_t  max_mb = 4096;
+        size_t  len = 0;
+        size_t  off = 0;
+        char   *mem = NULL;
+        int     i = 0;
+
+        if (argc > 1)
+                max_mb = strtoul (argv[1], NULL, 10);
+
+        printf ("%10s %12s %17s\n", "rss (MB)", "fork (us)",
+                "posix_spawn (us)");
+
+        for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+                if (sizes[i] > max_mb)
+                        break;
+
+                len = sizes[i] << 20;
+                mem = len ? malloc (len) : NULL;
+                if (len && !mem) {
+                        perror ("malloc");
+                        return 1;
+                }
+                /* touch every page, so that it is mapped */
+                for (off = 0; off < len; off += PAGE)
+                        mem[off] = 1;
+
+                printf ("%10zu %12.1f %17.1f\n", sizes[i], run (spawn_fork),
+                        run (spawn_posix));
+
+                free (mem);
+        }
+
+        return 0;
+}
@@ -0,0 +1,222 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * volume-cksum-bm: writes volume info files of 4 to 1024 bricks with 8 to
+ * 256 options and times the two ways glusterd_volume_compute_cksum () has
+ * computed the checksum peers compare: running sort(1) on the info file
+ * into a temporary file, checksumming it and then the cksum file, and
+ * sorting the lines in memory with the checksums taken over the buffers.
+ * Both have to come to the same checksum, a mismatch is reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "common-utils.h"
+#include "run.h"
+
+#define ROUNDS  200
+
+static char      dir[] = "/tmp/volume-cksum-bm.XXXXXX";
+static locale_t  collate;
+
+static double
+now_us (void)
+{
+        struct timeval tv = {0,};
+
+        gettimeofday (&tv, NULL);
+        return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void
+write_info (char *path, int bricks, int options)
+{
+        FILE *fp = NULL;
+        int   i = 0;
+
+        fp = fopen (path, "w");
+        fprintf (fp, "type=2\ncount=%d\nstatus=1\nsub_count=2\nversion=42\n"
+                 "transport-type=0\nvolume-id=6a9ebc4e-1d7c-4b6b-9d2f-"
+                 "0c1c1d1e9f77\n", bricks);
+        for (i = 0; i < options; i++)
+                fprintf (fp, "performance.option-%d=%d\n", options - i, i);
+        for (i = 0; i < bricks; i++)
+                fprintf (fp, "brick-%d=server%d:-export-brick%d\n", i,
+                         i % 16, i);
+        fclose (fp);
+}
+
+/* as glusterd did before: sort(1) and three passes over files */
+static uint32_t
+cksum_sort (char *info, char *cksum_path)
+{
+        char      sorted[PATH_MAX] = {0,};
+        char      buf[64] = {0,};
+        uint32_t  cksum = 0;
+        int       fd = -1;
+
+        snprintf (sorted, sizeof (sorted), "%s/sorted.XXXXXX", dir);
+        close (mkstemp (sorted));
+        runcmd ("sort", info, "-o", sorted, NULL);
+        get_checksum_for_path (sorted, &cksum);
+        unlink (sorted);
+
+        fd = open (cksum_path, O_RDWR | O_APPEND | O_CREAT | O_TRUNC, 0644);
+        snprintf (buf, sizeof (buf), "info=%u\n", cksum);
+        write (fd, buf, strlen (buf));
+        get_checksum_for_file (fd, &cksum);
+        close (fd);
+
+        return cksum;
+}
+
+static int
+line_cmp (const void *a, const void *b)
+{
+        int ret = 0;
+
+        if (collate)
+                ret = strcoll_l (*(char **)a, *(char **)b, collate);
+        if (!ret)
+                ret = strcmp (*(char **)a, *(char **)b);
+        return ret;
+}
+
+/* as glusterd_sort_file () and glusterd_volume_compute_cksum () do now */
+static uint32_t
+cksum_mem (char *info, char *cksum_path)
+{
+        struct stat  st = {0,};
+        char        *data = NULL;
+        char        *sorted = NULL;
+        char       **lines = NULL;
+        char        *pos = NULL;
+        char        *eol = NULL;
+        char         buf[64] = {0,};
+        size_t       count = 0;
+        size_t       i = 0;
+        size_t       n = 0;
+        uint32_t     cksum = 0;
+        int          fd = -1;
+
+        fd = open (info, O_RDONLY);
+        fstat (fd, &st);
+        data = malloc (st.st_size + 1);
+        read (fd, data, st.st_size);
+        close (fd);
+
+        for (pos = data; pos < data + st.st_size; pos = eol + 1) {
+                eol = memchr (pos, '\n', data + st.st_size - pos);
+                if (!eol)
+                        break;
+                count++;
+        }
+        lines = malloc (count * sizeof (*lines));
+        for (i = 0, pos = data; i < count; i++, pos = eol + 1) {
+                lines[i] = pos;
+                eol = memchr (pos, '\n', data + st.st_size - pos);
+                *eol = '\0';
+        }
+        qsort (lines, count, sizeof (*lines), line_cmp);
+
+        sorted = malloc (st.st_size + 2);
+        for (i = 0, pos = sorted; i < count; i++) {
+                n = strlen (lines[i]);
+                memcpy (pos, lines[i], n);
+                pos += n;
+                *pos++ = '\n';
+        }
+        get_checksum_for_buf (sorted, pos - sorted, &cksum);
+
+        fd = open (cksum_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        snprintf (buf, sizeof (buf), "info=%u\n", cksum);
+        write (fd, buf, strlen (buf));
+        close (fd);
+        get_checksum_for_buf (buf, strlen (buf), &cksum);
+
+        free (data);
+        free (lines);
+        free (sorted);
+        return cksum;
+}
+
+int
+main (int argc, char *argv[])
+{
+        int       bricks[] = {4, 64, 1024};
+        int       options[] = {8, 256};
+        char      info[PATH_MAX] = {0,};
+        char      cksum_path[PATH_MAX] = {0,};
+        uint32_t  c_sort = 0;
+        uint32_t  c_mem = 0;
+        double    start = 0;
+        double    t_sort = 0;
+        double    t_mem = 0;
+        int       b = 0;
+        int       o = 0;
+        int       r = 0;
+
+        glusterfs_globals_init ();
+        collate = newlocale (LC_COLLATE_MASK, "", (locale_t) 0);
+
+        if (!mkdtemp (dir)) {
+                perror ("mkdtemp");
+                return 1;
+        }
+        snprintf (info, sizeof (info), "%s/info", dir);
+        snprintf (cksum_path, sizeof (cksum_path), "%s/cksum", dir);
+
+        printf ("%8s %8s %12s %12s   (us per checksum)\n", "bricks",
+                "options", "sort(1)", "in memory");
+        for (b = 0; b < sizeof (bricks) / sizeof (bricks[0]); b++) {
+                for (o = 0; o < sizeof (options) / sizeof (options[0]); o++) {
+                        write_info (info, bricks[b], options[o]);
+
+                        start = now_us ();
+                        for (r = 0; r < ROUNDS; r++)
+                                c_sort = cksum_sort (info, cksum_path);
+                        t_sort = (now_us () - start) / ROUNDS;
+
+                        start = now_us ();
+                        for (r = 0; r < ROUNDS; r++)
+                                c_mem = cksum_mem (info, cksum_path);
+                        t_mem = (now_us () - start) / ROUNDS;
+
+                        printf ("%8d %8d %12.1f %12.1f%s\n", bricks[b],
+                                options[o], t_sort, t_mem,
+                                (c_sort != c_mem) ? "   MISMATCH" : "");
+                }
+        }
+
+        unlink (info);
+        unlink (cksum_path);
+        rmdir (dir);
+
+        return 0;
+}
@@ -0,0 +1,101 @@
+#!/bin/bash
+
+#   Copyright (c) 2006-2011 Gluster, Inc. <http://www.gluster.com>
+#   This file is part of GlusterFS.
+
+#   GlusterFS is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published
+#   by the Free Software Foundation; either version 3 of the License,
+#   or (at your option) any later version.
+
+#   GlusterFS is distributed in the hope that it will be useful, but
+#   WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+#   General Public License for more details.
+
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see
+#   <http://www.gnu.org/licenses/>.
+
+# Stress test for concurrent glusterd transactions. Starts NODES glusterds
+# on 127.0.0.1..127.0.0.NODES (glusterd must be built with
+# -DGD_SCALABILITY_TEST so that each one binds to its own address), creates
+# VOLS volumes and then runs ROUNDS rounds of VOLS parallel 'volume set'
+# operations, one per volume. Reports how many succeeded and the throughput.
+#
+# usage: glusterd_parallel_ops.sh [NODES] [VOLS] [ROUNDS]
+
+NODES=${1:-3}
+VOLS=${2:-8}
+ROUNDS=${3:-5}
+WORKDIR=${WORKDIR:-/tmp/gd-parallel-ops}
+
+GLUSTER="gluster --remote-host=127.0.0.1"
+
+cleanup ()
+{
+    for pid in $WORKDIR/node*/glusterd.pid; do
+        [ -f $pid ] && kill -9 `cat $pid` 2>/dev/null
+    done
+}
+
+trap cleanup EXIT
+
+rm -rf $WORKDIR
+
+echo "Starting $NODES glusterds"
+for i in `seq 1 $NODES`; do
+    dir=$WORKDIR/node$i
+    mkdir -p $dir/etc $dir/exports
+    cat > $dir/glusterd.vol <<EOF
+volume management
+    type mgmt/glusterd
+    option working-directory $dir/etc
+    option transport-type socket
+    option transport.socket.bind-address 127.0.0.$i
+end-volume
+EOF
+    glusterd -f $dir/glusterd.vol -p $dir/glusterd.pid \
+        -l $dir/glusterd.log
+    if [ $? -ne 0 ]; then
+        echo "Could not start glusterd $i. Exiting"
+        exit 1
+    fi
+done
+
+sleep 2
+
+for i in `seq 2 $NODES`; do
+    $GLUSTER peer probe 127.0.0.$i > /dev/null || exit 1
+done
+
+sleep 2
+
+echo "Creating $VOLS volumes"
+for v in `seq 1 $VOLS`; do
+    node=$(( (v % NODES) + 1 ))
+    mkdir -p $WORKDIR/node$node/exports/vol$v
+    $GLUSTER volume create vol$v \
+        127.0.0.$node:$WORKDIR/node$node/exports/vol$v > /dev/null || exit 1
+done
+
+echo "Running $ROUNDS rounds of $VOLS parallel operations"
+failed=0
+start=`date +%s.%N`
+for r in `seq 1 $ROUNDS`; do
+    for v in `seq 1 $VOLS`; do
+        $GLUSTER volume set vol$v performance.cache-size ${r}MB \
+            > /dev/null 2>&1 &
+    done
+    for job in `jobs -p`; do
+        wait $job || failed=$(( failed + 1 ))
+    done
+done
+end=`date +%s.%N`
+
+total=$(( ROUNDS * VOLS ))
+elapsed=`echo "$end - $start" | bc`
+echo "ops: $total failed: $failed elapsed: ${elapsed}s"
+echo "throughput: `echo "scale=2; ($total - $failed) / $elapsed" | bc` ops/s"
+
+[ $failed -eq 0 ]
@@ -33,6 +33,7 @@
 #include "dict.h"
 #include "event.h"
 #include "defaults.h"
+#include "byte-order.h"
 
 #include "rpc-clnt.h"
 #include "protocol-common.h"
@@ -45,6 +46,10 @@
 
 static char is_mgmt_rpc_reconnect;
 
+/* version of the volfile we hold as told by glusterd at getspec time,
+ * 0 if it did not say */
+static uint32_t volfile_version;
+
 typedef ssize_t (*mgmt_serialize_t) (struct iovec outmsg, void *args);
 typedef ssize_t (*gf_serialize_t) (struct iovec outmsg, void *args);
 
@@ -58,8 +63,27 @@ int
 mgmt_cbk_spec (void *data)
 {
         glusterfs_ctx_t *ctx = NULL;
+        struct iovec    *iov = NULL;
+        uint32_t         version = 0;
 
         ctx = glusterfs_ctx_get ();
+        iov = data;
+
+        /* Versions only grow for a volume, a notification that is not
+         * newer than what we fetched (a brick started by the very change
+         * it announces, say) needs no fetch.
+         */
+        if (volfile_version && iov && (iov->iov_len >= sizeof (version))) {
+                memcpy (&version, iov->iov_base, sizeof (version));
+                version = ntoh32 (version);
+                if (version <= volfile_version) {
+                        gf_log ("mgmt", GF_LOG_DEBUG, "Volume file version "
+                                "%u already fetched (have %u)", version,
+                                volfile_version);
+                        return 0;
+                }
+        }
+
         gf_log ("mgmt", GF_LOG_INFO, "Volume file changed");
 
         glusterfs_volfile_fetch (ctx);
@@ -631,6 +655,15 @@ mgmt_getspec_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
+        /* glusterd had nothing newer than the version we sent */
+        if ((0 == rsp.op_ret) && volfile_version &&
+            (rsp.op_errno == volfile_version)) {
+                gf_log (frame->this->name, GF_LOG_DEBUG,
+                        "volfile version %u not modified", volfile_version);
+                ret = 0;
+                goto out;
+        }
+
         ret = 0;
         size = rsp.op_ret;
 
@@ -682,6 +715,10 @@ mgmt_getspec_cbk (struct rpc_req *req, struct iovec *iov, int count,
         }
 
 out:
+        /* glusterd returns the volfile version in the cookie */
+        if (!ret)
+                volfile_version = rsp.op_errno;
+
         STACK_DESTROY (frame->root);
 
         if (rsp.spec)
@@ -713,7 +750,7 @@ glusterfs_volfile_fetch (glusterfs_ctx_t *ctx)
         frame = create_frame (THIS, ctx->pool);
 
         req.key = cmd_args->volfile_id;
-        req.flags = 0;
+        req.flags = volfile_version;
 
         ret = mgmt_submit_request (&req, frame, ctx, &clnt_handshake_prog,
                                    GF_HNDSK_GETSPEC, xdr_from_getspec_req,
@@ -735,6 +772,8 @@ mgmt_rpc_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
 
         switch (event) {
         case RPC_CLNT_DISCONNECT:
+                /* versions are only good for the glusterd that gave them */
+                volfile_version = 0;
                 if (!ctx->active) {
                         gf_log ("glusterfsd-mgmt", GF_LOG_ERROR,
                                 "failed to connect with remote-host: %s",
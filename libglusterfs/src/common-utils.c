@@ -1525,6 +1525,28 @@ get_checksum_for_file (int fd, uint32_t *checksum)
 }
 
 
+/* The checksum get_checksum_for_file () gives for a file holding the len
+ * bytes of data, to be used on contents already in memory.
+ */
+int
+get_checksum_for_buf (char *data, size_t len, uint32_t *checksum)
+{
+        char    buf[GF_CHECKSUM_BUF_SIZE] = {0,};
+        size_t  off = 0;
+        size_t  n = 0;
+
+        GF_ASSERT (checksum);
+
+        /* a short last read leaves the tail of the one before in buf */
+        for (off = 0; off < len; off += n) {
+                n = min (len - off, GF_CHECKSUM_BUF_SIZE);
+                memcpy (buf, data + off, n);
+                compute_checksum (buf, GF_CHECKSUM_BUF_SIZE, checksum);
+        }
+
+        return 0;
+}
+
 int
 get_checksum_for_path (char *path, uint32_t *checksum)
 {
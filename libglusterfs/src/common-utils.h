@@ -345,6 +345,7 @@ int get_checksum_for_file (int fd, uint32_t *checksum);
 int log_base2 (unsigned long x);
 
 int get_checksum_for_path (char *path, uint32_t *checksum);
+int get_checksum_for_buf (char *data, size_t len, uint32_t *checksum);
 
 char *strtail (char *str, const char *pattern);
 
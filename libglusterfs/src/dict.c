@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <stdarg.h>
 
 #ifndef _CONFIG_H
 #define _CONFIG_H
@@ -35,6 +36,7 @@
 #include "logging.h"
 #include "compat.h"
 #include "byte-order.h"
+#include "iobuf.h"
 
 data_pair_t *
 get_new_data_pair ()
@@ -56,26 +58,159 @@ get_new_data ()
                 return NULL;
         }
 
+#ifndef HAVE_ATOMIC_BUILTINS
         LOCK_INIT (&data->lock);
+#endif
+        return data;
+}
+
+/* a data_t with @size bytes for its value right after it, allocated and
+ * freed along with it */
+static data_t *
+get_new_data_inline (size_t size)
+{
+        data_t *data = NULL;
+
+        data = (data_t *) GF_CALLOC (1, sizeof (data_t) + size,
+                                     gf_common_mt_data_t);
+        if (!data) {
+                return NULL;
+        }
+
+#ifndef HAVE_ATOMIC_BUILTINS
+        LOCK_INIT (&data->lock);
+#endif
+        data->data = (char *) (data + 1);
+        data->is_inline = 1;
+        return data;
+}
+
+static data_t *
+data_from_fmt (const char *fmt, ...)
+{
+        va_list  ap;
+        data_t  *data = NULL;
+        int      len = 0;
+
+        va_start (ap, fmt);
+        len = vsnprintf (NULL, 0, fmt, ap);
+        va_end (ap);
+        if (len < 0) {
+                gf_log ("dict", GF_LOG_DEBUG, "vsnprintf failed");
+                return NULL;
+        }
+
+        data = get_new_data_inline (len + 1);
+        if (!data) {
+                return NULL;
+        }
+
+        va_start (ap, fmt);
+        vsnprintf (data->data, len + 1, fmt, ap);
+        va_end (ap);
+        data->len = len + 1;
+
         return data;
 }
 
+/* resizes the hash table of @this to @size slots and indexes all its
+ * pairs there */
+static int
+_dict_hash_resize (dict_t *this, int32_t size)
+{
+        data_pair_t **members = NULL;
+        data_pair_t  *pair = NULL;
+        uint32_t      mask = size - 1;
+        uint32_t      i = 0;
+
+        members = GF_CALLOC (size, sizeof (*members),
+                             gf_common_mt_data_pair_t);
+        if (!members)
+                return -1;
+
+        for (pair = this->members_list; pair; pair = pair->next) {
+                for (i = pair->hash & mask; members[i]; i = (i + 1) & mask)
+                        ;
+                members[i] = pair;
+        }
+
+        if (this->members)
+                GF_FREE (this->members);
+        this->members = members;
+        this->hash_size = size;
+
+        return 0;
+}
+
+static data_pair_t *
+_dict_pair_alloc (dict_t *this)
+{
+        int i = 0;
+
+        for (i = 0; i < DICT_ARENA_PAIRS; i++) {
+                if (this->arena_pairs_used & (1 << i))
+                        continue;
+                this->arena_pairs_used |= (1 << i);
+                memset (&this->arena_pairs[i], 0, sizeof (data_pair_t));
+                return &this->arena_pairs[i];
+        }
+
+        return GF_CALLOC (1, sizeof (data_pair_t), gf_common_mt_data_pair_t);
+}
+
+static char *
+_dict_key_alloc (dict_t *this, size_t len)
+{
+        char *key = NULL;
+
+        if (this->arena_keys_used + len <= DICT_ARENA_KEYS) {
+                key = this->arena_keys + this->arena_keys_used;
+                this->arena_keys_used += len;
+                return key;
+        }
+
+        return GF_CALLOC (1, len, gf_common_mt_char);
+}
+
+static void
+_dict_key_free (dict_t *this, char *key)
+{
+        if (key && ((key < this->arena_keys) ||
+                    (key >= this->arena_keys + DICT_ARENA_KEYS)))
+                GF_FREE (key);
+}
+
+/* frees @pair and its key, but not its value */
+static void
+_dict_pair_free (dict_t *this, data_pair_t *pair)
+{
+        _dict_key_free (this, pair->key);
+
+        if ((pair >= this->arena_pairs) &&
+            (pair < this->arena_pairs + DICT_ARENA_PAIRS))
+                this->arena_pairs_used &= ~(1 << (pair - this->arena_pairs));
+        else
+                GF_FREE (pair);
+}
+
 dict_t *
 get_new_dict_full (int size_hint)
 {
-        dict_t *dict = GF_CALLOC (1, sizeof (dict_t), gf_common_mt_dict_t);
+        dict_t  *dict = GF_CALLOC (1, sizeof (dict_t), gf_common_mt_dict_t);
+        int32_t  size = DICT_HASH_MIN;
 
         if (!dict) {
                 return NULL;
         }
 
-        dict->hash_size = size_hint;
-        dict->members = GF_CALLOC (size_hint, sizeof (data_pair_t *),
-                                   gf_common_mt_data_pair_t);
-
-        if (!dict->members) {
-                GF_FREE (dict);
-                return NULL;
+        /* size the table for @size_hint pairs up front */
+        if (size_hint > DICT_LINEAR_MAX) {
+                while (size * 3 < size_hint * 4)
+                        size *= 2;
+                if (_dict_hash_resize (dict, size)) {
+                        GF_FREE (dict);
+                        return NULL;
+                }
         }
 
         LOCK_INIT (&dict->lock);
@@ -86,7 +221,7 @@ get_new_dict_full (int size_hint)
 dict_t *
 get_new_dict (void)
 {
-        return get_new_dict_full (1);
+        return get_new_dict_full (0);
 }
 
 dict_t *
@@ -94,7 +229,7 @@ dict_new (void)
 {
         dict_t *dict = NULL;
 
-        dict = get_new_dict_full(1);
+        dict = get_new_dict_full (0);
 
         if (dict)
                 dict_ref (dict);
@@ -130,9 +265,11 @@ void
 data_destroy (data_t *data)
 {
         if (data) {
+#ifndef HAVE_ATOMIC_BUILTINS
                 LOCK_DESTROY (&data->lock);
+#endif
 
-                if (!data->is_static) {
+                if (!data->is_static && !data->is_inline) {
                         if (data->data) {
                                 if (data->is_stdalloc)
                                         free (data->data);
@@ -143,6 +280,9 @@ data_destroy (data_t *data)
                                 GF_FREE (data->vec);
                 }
 
+                if (data->iobref)
+                        iobref_unref (data->iobref);
+
                 data->len = 0xbabababa;
                 if (!data->is_const)
                         GF_FREE (data);
@@ -180,7 +320,9 @@ data_copy (data_t *old)
                 }
         }
 
+#ifndef HAVE_ATOMIC_BUILTINS
         LOCK_INIT (&newdata->lock);
+#endif
         return newdata;
 
 err_out:
@@ -194,6 +336,30 @@ err_out:
         return NULL;
 }
 
+static data_pair_t *
+_dict_lookup_hash (dict_t *this, char *key, uint32_t hash)
+{
+        data_pair_t *pair = NULL;
+        uint32_t     mask = 0;
+        uint32_t     i = 0;
+
+        if (!this->members) {
+                for (pair = this->members_list; pair; pair = pair->next) {
+                        if (pair->hash == hash && !strcmp (pair->key, key))
+                                return pair;
+                }
+                return NULL;
+        }
+
+        mask = this->hash_size - 1;
+        for (i = hash & mask; (pair = this->members[i]); i = (i + 1) & mask) {
+                if (pair->hash == hash && !strcmp (pair->key, key))
+                        return pair;
+        }
+
+        return NULL;
+}
+
 static data_pair_t *
 _dict_lookup (dict_t *this, char *key)
 {
@@ -203,15 +369,59 @@ _dict_lookup (dict_t *this, char *key)
                 return NULL;
         }
 
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
-        data_pair_t *pair;
+        return _dict_lookup_hash (this, key, SuperFastHash (key, strlen (key)));
+}
 
-        for (pair = this->members[hashval]; pair != NULL; pair = pair->hash_next) {
-                if (pair->key && !strcmp (pair->key, key))
-                        return pair;
+/* takes @pair out of the hash table, moving back the pairs after it in
+ * its run which would no longer be found past the hole */
+static void
+_dict_hash_remove (dict_t *this, data_pair_t *pair)
+{
+        uint32_t mask = this->hash_size - 1;
+        uint32_t hole = 0;
+        uint32_t i = 0;
+        uint32_t home = 0;
+
+        for (hole = pair->hash & mask; this->members[hole] != pair;
+             hole = (hole + 1) & mask)
+                ;
+
+        for (i = (hole + 1) & mask; this->members[i]; i = (i + 1) & mask) {
+                home = this->members[i]->hash & mask;
+                /* stays if its home slot lies cyclically in (hole, i] */
+                if ((hole < i) ? (home > hole && home <= i)
+                               : (home > hole || home <= i))
+                        continue;
+                this->members[hole] = this->members[i];
+                hole = i;
         }
 
-        return NULL;
+        this->members[hole] = NULL;
+}
+
+/* unlinks @pair from @this and frees it. Called with the dict lock held. */
+static void
+_dict_pair_remove (dict_t *this, data_pair_t *pair)
+{
+        if (this->members)
+                _dict_hash_remove (this, pair);
+
+        data_unref (pair->value);
+
+        if (pair->prev)
+                pair->prev->next = pair->next;
+        else
+                this->members_list = pair->next;
+
+        if (pair->next)
+                pair->next->prev = pair->prev;
+
+        _dict_pair_free (this, pair);
+        this->count--;
+
+        /* no key is left in the arena, it can be reused */
+        if (!this->count)
+                this->arena_keys_used = 0;
 }
 
 int32_t
@@ -240,10 +450,11 @@ _dict_set (dict_t *this,
            char *key,
            data_t *value)
 {
-        int hashval;
+        uint32_t hash = 0;
+        uint32_t mask = 0;
+        uint32_t i = 0;
         data_pair_t *pair;
         char key_free = 0;
-        int tmp = 0;
         int ret = 0;
 
         if (!key) {
@@ -255,9 +466,8 @@ _dict_set (dict_t *this,
                 key_free = 1;
         }
 
-        tmp = SuperFastHash (key, strlen (key));
-        hashval = (tmp % this->hash_size);
-        pair = _dict_lookup (this, key);
+        hash = SuperFastHash (key, strlen (key));
+        pair = _dict_lookup_hash (this, key, hash);
 
         if (pair) {
                 data_t *unref_data = pair->value;
@@ -268,16 +478,28 @@ _dict_set (dict_t *this,
                 /* Indicates duplicate key */
                 return 0;
         }
-        pair = (data_pair_t *) GF_CALLOC (1, sizeof (*pair),
-                                          gf_common_mt_data_pair_t);
+
+        if ((this->count >= DICT_LINEAR_MAX) &&
+            (!this->members || ((this->count + 1) * 4 > this->hash_size * 3))) {
+                ret = _dict_hash_resize (this, this->members ?
+                                         this->hash_size * 2 : DICT_HASH_MIN);
+                if (ret) {
+                        if (key_free)
+                                GF_FREE (key);
+                        return -1;
+                }
+        }
+
+        pair = _dict_pair_alloc (this);
         if (!pair) {
+                if (key_free)
+                        GF_FREE (key);
                 return -1;
         }
 
-        pair->key = (char *) GF_CALLOC (1, strlen (key) + 1,
-                                        gf_common_mt_char);
+        pair->key = _dict_key_alloc (this, strlen (key) + 1);
         if (!pair->key) {
-                GF_FREE (pair);
+                _dict_pair_free (this, pair);
 
                 if (key_free)
                         GF_FREE (key);
@@ -286,9 +508,14 @@ _dict_set (dict_t *this,
 
         strcpy (pair->key, key);
         pair->value = data_ref (value);
+        pair->hash = hash;
 
-        pair->hash_next = this->members[hashval];
-        this->members[hashval] = pair;
+        if (this->members) {
+                mask = this->hash_size - 1;
+                for (i = hash & mask; this->members[i]; i = (i + 1) & mask)
+                        ;
+                this->members[i] = pair;
+        }
 
         pair->next = this->members_list;
         pair->prev = NULL;
@@ -351,6 +578,8 @@ dict_get (dict_t *this, char *key)
 void
 dict_del (dict_t *this, char *key)
 {
+        data_pair_t *pair = NULL;
+
         if (!this || !key) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING,
                                   "!this || key=%s", key);
@@ -359,40 +588,77 @@ dict_del (dict_t *this, char *key)
 
         LOCK (&this->lock);
 
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
-        data_pair_t *pair = this->members[hashval];
-        data_pair_t *prev = NULL;
+        pair = _dict_lookup (this, key);
+        if (pair)
+                _dict_pair_remove (this, pair);
 
-        while (pair) {
-                if (strcmp (pair->key, key) == 0) {
-                        if (prev)
-                                prev->hash_next = pair->hash_next;
-                        else
-                                this->members[hashval] = pair->hash_next;
-
-                        data_unref (pair->value);
-
-                        if (pair->prev)
-                                pair->prev->next = pair->next;
-                        else
-                                this->members_list = pair->next;
-
-                        if (pair->next)
-                                pair->next->prev = pair->prev;
-
-                        GF_FREE (pair->key);
-                        GF_FREE (pair);
-                        this->count--;
-                        break;
-                }
+        UNLOCK (&this->lock);
 
-                prev = pair;
-                pair = pair->hash_next;
+        return;
+}
+
+/* Gives the pair of @key the key @replace_key, replacing the pair that
+ * had it if any. The pair keeps its place in members_list, so callers
+ * walking it may rename the pair they are on.
+ */
+int32_t
+dict_rename_key (dict_t *this, char *key, char *replace_key)
+{
+        data_pair_t *pair = NULL;
+        data_pair_t *old = NULL;
+        char        *new_key = NULL;
+        uint32_t     hash = 0;
+        uint32_t     mask = 0;
+        uint32_t     i = 0;
+        int32_t      ret = -1;
+
+        if (!this || !key || !replace_key) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING,
+                                  "!this || !key || !replace_key");
+                return -1;
         }
 
+        LOCK (&this->lock);
+
+        pair = _dict_lookup (this, key);
+        if (!pair)
+                goto unlock;
+
+        ret = 0;
+        if (!strcmp (key, replace_key))
+                goto unlock;
+
+        ret = -1;
+        new_key = _dict_key_alloc (this, strlen (replace_key) + 1);
+        if (!new_key)
+                goto unlock;
+        strcpy (new_key, replace_key);
+        hash = SuperFastHash (new_key, strlen (new_key));
+
+        old = _dict_lookup_hash (this, new_key, hash);
+        if (old)
+                _dict_pair_remove (this, old);
+
+        /* the pair moves to the slots of its new hash */
+        if (this->members)
+                _dict_hash_remove (this, pair);
+
+        _dict_key_free (this, pair->key);
+        pair->key = new_key;
+        pair->hash = hash;
+
+        if (this->members) {
+                mask = this->hash_size - 1;
+                for (i = hash & mask; this->members[i]; i = (i + 1) & mask)
+                        ;
+                this->members[i] = pair;
+        }
+
+        ret = 0;
+unlock:
         UNLOCK (&this->lock);
 
-        return;
+        return ret;
 }
 
 void
@@ -411,12 +677,12 @@ dict_destroy (dict_t *this)
         while (prev) {
                 pair = pair->next;
                 data_unref (prev->value);
-                GF_FREE (prev->key);
-                GF_FREE (prev);
+                _dict_pair_free (this, prev);
                 prev = pair;
         }
 
-        GF_FREE (this->members);
+        if (this->members)
+                GF_FREE (this->members);
 
         if (this->extra_free)
                 GF_FREE (this->extra_free);
@@ -477,12 +743,16 @@ data_unref (data_t *this)
                 return;
         }
 
+#ifdef HAVE_ATOMIC_BUILTINS
+        ref = __sync_sub_and_fetch (&this->refcount, 1);
+#else
         LOCK (&this->lock);
 
         this->refcount--;
         ref = this->refcount;
 
         UNLOCK (&this->lock);
+#endif
 
         if (!ref)
                 data_destroy (this);
@@ -496,11 +766,15 @@ data_ref (data_t *this)
                 return NULL;
         }
 
+#ifdef HAVE_ATOMIC_BUILTINS
+        __sync_add_and_fetch (&this->refcount, 1);
+#else
         LOCK (&this->lock);
 
         this->refcount++;
 
         UNLOCK (&this->lock);
+#endif
 
         return this;
 }
@@ -738,182 +1012,57 @@ dict_to_iovec (dict_t *this,
 data_t *
 int_to_data (int64_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-
-        ret = gf_asprintf (&data->data, "%"PRId64, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRId64, value);
 }
 
 data_t *
 data_from_int64 (int64_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRId64, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRId64, value);
 }
 
 data_t *
 data_from_int32 (int32_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRId32, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRId32, value);
 }
 
 data_t *
 data_from_int16 (int16_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRId16, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRId16, value);
 }
 
 data_t *
 data_from_int8 (int8_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%d", value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%d", value);
 }
 
 data_t *
 data_from_uint64 (uint64_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRIu64, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRIu64, value);
 }
 
 static data_t *
 data_from_double (double value)
 {
-        data_t *data = NULL;
-        int     ret  = 0;
-
-        data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-
-        ret = gf_asprintf (&data->data, "%f", value);
-        if (ret == -1) {
-                return NULL;
-        }
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%f", value);
 }
 
 
 data_t *
 data_from_uint32 (uint32_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRIu32, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRIu32, value);
 }
 
 
 data_t *
 data_from_uint16 (uint16_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRIu16, value);
-        if (-1 == ret) {
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRIu16, value);
 }
 
 
@@ -2447,19 +2596,180 @@ out:
 }
 
 
+/* where dict_serialize_iobref () is writing: the last of the @count
+ * vectors is filled up to a page before the next iobuf is taken */
+struct dict_iov_writer {
+        struct iobuf_pool *pool;
+        struct iobref     *iobref;
+        struct iovec      *vec;
+        int                max;
+        int                count;
+};
+
+static int
+_dict_iov_write (struct dict_iov_writer *w, const void *src, size_t len)
+{
+        struct iobuf *iobuf = NULL;
+        struct iovec *vec   = NULL;
+        size_t        page  = iobpool_pagesize (w->pool);
+        size_t        n     = 0;
+        int           ret   = 0;
+
+        while (len) {
+                vec = w->count ? &w->vec[w->count - 1] : NULL;
+
+                if (!vec || vec->iov_len == page) {
+                        if (w->count == w->max)
+                                return -ENOBUFS;
+
+                        iobuf = iobuf_get (w->pool);
+                        if (!iobuf)
+                                return -ENOMEM;
+
+                        ret = iobref_add (w->iobref, iobuf);
+                        iobuf_unref (iobuf);
+                        if (ret)
+                                return -ENOBUFS;
+
+                        vec = &w->vec[w->count++];
+                        vec->iov_base = iobuf_ptr (iobuf);
+                        vec->iov_len  = 0;
+                }
+
+                n = min (len, page - vec->iov_len);
+                memcpy ((char *)vec->iov_base + vec->iov_len, src, n);
+                vec->iov_len += n;
+                src = (const char *)src + n;
+                len -= n;
+        }
+
+        return 0;
+}
+
 /**
- * dict_unserialize - unserialize a buffer into a dict
+ * dict_serialize_iobref - serialize a dictionary into iobufs, in one pass
+ *                         over it and without a contiguous buffer
  *
- * @buf:  buf containing serialized dict
- * @size: size of the @buf
- * @fill: dict to fill in
+ * @this:   dict to serialize
+ * @pool:   pool to take the iobufs from
+ * @iobref: gets the iobufs added, at most as many as it has slots for
+ * @vec:    filled with the serialized dict, one vector per iobuf
+ * @count:  in: number of vectors in @vec, out: number used
  *
- * @return: success: 0
+ * @return: success: length of the serialized dict
  *          failure: -errno
  */
 
 int32_t
-dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
+dict_serialize_iobref (dict_t *this, struct iobuf_pool *pool,
+                       struct iobref *iobref, struct iovec *vec, int *count)
+{
+        struct dict_iov_writer  w       = {0, };
+        data_pair_t            *pair    = NULL;
+        struct iovec           *cur     = NULL;
+        char                   *ptr     = NULL;
+        size_t                  page    = 0;
+        size_t                  itemlen = 0;
+        int32_t                 netword = 0;
+        int32_t                 keylen  = 0;
+        int32_t                 total   = 0;
+        int                     ret     = -EINVAL;
+
+        if (!this || !pool || !iobref || !vec || !count || *count <= 0) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING,
+                                  "invalid argument");
+                goto out;
+        }
+
+        w.pool   = pool;
+        w.iobref = iobref;
+        w.vec    = vec;
+        w.max    = *count;
+        page     = iobpool_pagesize (pool);
+
+        LOCK (&this->lock);
+        {
+                netword = hton32 (this->count);
+                ret = _dict_iov_write (&w, &netword, DICT_HDR_LEN);
+                if (ret)
+                        goto unlock;
+                total = DICT_HDR_LEN;
+
+                for (pair = this->members_list; pair; pair = pair->next) {
+                        if (!pair->key || !pair->value ||
+                            (pair->value->len && !pair->value->data)) {
+                                gf_log ("dict", GF_LOG_ERROR,
+                                        "incomplete pair in dict");
+                                ret = -EINVAL;
+                                goto unlock;
+                        }
+
+                        keylen  = strlen (pair->key);
+                        itemlen = DICT_DATA_HDR_KEY_LEN +
+                                  DICT_DATA_HDR_VAL_LEN +
+                                  keylen + 1 + pair->value->len;
+                        total  += itemlen;
+
+                        /* most pairs fit in what is left of the page */
+                        cur = &w.vec[w.count - 1];
+                        if (itemlen <= page - cur->iov_len) {
+                                ptr = (char *)cur->iov_base + cur->iov_len;
+                                netword = hton32 (keylen);
+                                memcpy (ptr, &netword, sizeof (netword));
+                                ptr += DICT_DATA_HDR_KEY_LEN;
+                                netword = hton32 (pair->value->len);
+                                memcpy (ptr, &netword, sizeof (netword));
+                                ptr += DICT_DATA_HDR_VAL_LEN;
+                                memcpy (ptr, pair->key, keylen + 1);
+                                ptr += keylen + 1;
+                                memcpy (ptr, pair->value->data,
+                                        pair->value->len);
+                                cur->iov_len += itemlen;
+                                continue;
+                        }
+
+                        netword = hton32 (keylen);
+                        ret = _dict_iov_write (&w, &netword,
+                                               DICT_DATA_HDR_KEY_LEN);
+                        if (ret)
+                                goto unlock;
+
+                        netword = hton32 (pair->value->len);
+                        ret = _dict_iov_write (&w, &netword,
+                                               DICT_DATA_HDR_VAL_LEN);
+                        if (ret)
+                                goto unlock;
+
+                        ret = _dict_iov_write (&w, pair->key, keylen + 1);
+                        if (ret)
+                                goto unlock;
+
+                        ret = _dict_iov_write (&w, pair->value->data,
+                                               pair->value->len);
+                        if (ret)
+                                goto unlock;
+                }
+        }
+unlock:
+        UNLOCK (&this->lock);
+
+        *count = w.count;
+        if (!ret)
+                ret = total;
+out:
+        return ret;
+}
+
+
+/**
+ * _dict_unserialize - unserialize a buffer into a dict. With @iobref the
+ *                     values are left in @orig_buf, which must lie in one of
+ *                     its iobufs, and hold a ref on it instead of a copy.
+ */
+
+static int32_t
+_dict_unserialize (char *orig_buf, int32_t size, dict_t **fill,
+                   struct iobref *iobref)
 {
         char   *buf = NULL;
         int     ret   = -1;
@@ -2561,11 +2871,22 @@ dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
                                           "available (%lu) < required (%lu)",
                                           (long)(orig_buf + size),
                                           (long)(buf + vallen));
+                        goto out;
                 }
                 value = get_new_data ();
+                if (!value) {
+                        ret = -ENOMEM;
+                        goto out;
+                }
                 value->len  = vallen;
-                value->data = memdup (buf, vallen);
-                value->is_static = 0;
+                if (iobref) {
+                        value->data      = buf;
+                        value->is_static = 1;
+                        value->iobref    = iobref_ref (iobref);
+                } else {
+                        value->data      = memdup (buf, vallen);
+                        value->is_static = 0;
+                }
                 buf += vallen;
 
                 dict_set (*fill, key, value);
@@ -2577,6 +2898,104 @@ out:
 }
 
 
+/**
+ * dict_unserialize - unserialize a buffer into a dict
+ *
+ * @buf:  buf containing serialized dict
+ * @size: size of the @buf
+ * @fill: dict to fill in
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_unserialize (char *buf, int32_t size, dict_t **fill)
+{
+        return _dict_unserialize (buf, size, fill, NULL);
+}
+
+
+/**
+ * dict_unserialize_iobref - unserialize a buffer into a dict without
+ *                           copying the values
+ *
+ * @buf:    buf containing serialized dict, inside an iobuf of @iobref
+ * @size:   size of the @buf
+ * @fill:   dict to fill in
+ * @iobref: keeps @buf alive for as long as any of the values is
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_unserialize_iobref (char *buf, int32_t size, dict_t **fill,
+                         struct iobref *iobref)
+{
+        if (!iobref) {
+                gf_log_callingfn ("dict", GF_LOG_ERROR, "iobref is null!");
+                return -1;
+        }
+
+        return _dict_unserialize (buf, size, fill, iobref);
+}
+
+
+/**
+ * dict_unserialize_pool - unserialize a buffer into a dict, copying it as a
+ *                         whole into an iobuf of @pool which the values then
+ *                         point into. Buffers smaller than
+ *                         DICT_UNSERIALIZE_POOL_MIN, which are not worth
+ *                         holding an iobuf for, and those which do not fit
+ *                         in one are unserialized value by value.
+ *
+ * @pool: pool to take the iobuf from
+ * @buf:  buf containing serialized dict
+ * @size: size of the @buf
+ * @fill: dict to fill in
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_unserialize_pool (struct iobuf_pool *pool, char *buf, int32_t size,
+                       dict_t **fill)
+{
+        struct iobuf  *iobuf  = NULL;
+        struct iobref *iobref = NULL;
+        int32_t        ret    = -1;
+
+        if (!pool || !buf || size < DICT_UNSERIALIZE_POOL_MIN ||
+            (size_t)size > iobpool_pagesize (pool))
+                return _dict_unserialize (buf, size, fill, NULL);
+
+        iobuf = iobuf_get (pool);
+        if (!iobuf)
+                goto out;
+
+        iobref = iobref_new ();
+        if (!iobref)
+                goto out;
+
+        ret = iobref_add (iobref, iobuf);
+        if (ret)
+                goto out;
+
+        memcpy (iobuf_ptr (iobuf), buf, size);
+
+        ret = _dict_unserialize (iobuf_ptr (iobuf), size, fill, iobref);
+out:
+        if (iobref)
+                iobref_unref (iobref);
+        if (iobuf)
+                iobuf_unref (iobuf);
+
+        return ret;
+}
+
+
 /**
  * dict_allocate_and_serialize - serialize a dictionary into an allocated buffer
  *
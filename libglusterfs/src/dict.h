@@ -31,6 +31,9 @@
 
 #include "common-utils.h"
 
+struct iobref;
+struct iobuf_pool;
+
 typedef struct _data data_t;
 typedef struct _dict dict_t;
 typedef struct _data_pair data_pair_t;
@@ -39,21 +42,43 @@ struct _data {
         unsigned char  is_static:1;
         unsigned char  is_const:1;
         unsigned char  is_stdalloc:1;
+        unsigned char  is_inline:1;
         int32_t        len;
         struct iovec  *vec;
         char          *data;
         int32_t        refcount;
         gf_lock_t      lock;
+        struct iobref *iobref;  /* holds @data when it is not a copy */
 };
 
 struct _data_pair {
-        struct _data_pair *hash_next;
+        uint32_t           hash;
         struct _data_pair *prev;
         struct _data_pair *next;
         data_t            *value;
         char              *key;
 };
 
+/* Up to DICT_LINEAR_MAX pairs are only kept on members_list, newest
+ * first, and looked up by walking it. Bigger dicts also index the pairs
+ * in members, an open addressed (linear probing) table of hash_size
+ * slots, a power of two, grown to keep it at most 3/4 full.
+ */
+#define DICT_LINEAR_MAX  8
+#define DICT_HASH_MIN    32
+
+/* The first DICT_ARENA_PAIRS pairs of a dict, and their keys while they
+ * fit in DICT_ARENA_KEYS bytes, are carved out of the dict itself rather
+ * than allocated one by one.
+ */
+#define DICT_ARENA_PAIRS 4
+#define DICT_ARENA_KEYS  128
+
+/* Smallest serialized dict dict_unserialize_pool () copies into an iobuf,
+ * below it copying the values one by one is as fast.
+ */
+#define DICT_UNSERIALIZE_POOL_MIN 4096
+
 struct _dict {
         unsigned char   is_static:1;
         int32_t         hash_size;
@@ -64,6 +89,10 @@ struct _dict {
         char           *extra_free;
         char           *extra_stdfree;
         gf_lock_t       lock;
+        uint32_t        arena_pairs_used;
+        int32_t         arena_keys_used;
+        data_pair_t     arena_pairs[DICT_ARENA_PAIRS];
+        char            arena_keys[DICT_ARENA_KEYS];
 };
 
 
@@ -73,10 +102,18 @@ void data_destroy (data_t *data);
 int32_t dict_set (dict_t *this, char *key, data_t *value);
 data_t *dict_get (dict_t *this, char *key);
 void dict_del (dict_t *this, char *key);
+int32_t dict_rename_key (dict_t *this, char *key, char *replace_key);
 
 int32_t dict_serialized_length (dict_t *dict);
 int32_t dict_serialize (dict_t *dict, char *buf);
 int32_t dict_unserialize (char *buf, int32_t size, dict_t **fill);
+int32_t dict_unserialize_iobref (char *buf, int32_t size, dict_t **fill,
+                                 struct iobref *iobref);
+int32_t dict_unserialize_pool (struct iobuf_pool *pool, char *buf,
+                               int32_t size, dict_t **fill);
+int32_t dict_serialize_iobref (dict_t *this, struct iobuf_pool *pool,
+                               struct iobref *iobref, struct iovec *vec,
+                               int *count);
 
 int32_t dict_allocate_and_serialize (dict_t *this, char **buf, size_t *length);
 
@@ -20,13 +20,25 @@
 #include "mem-pool.h"
 #include "logging.h"
 #include "xlator.h"
+#include "statedump.h"
 #include <stdlib.h>
 #include <stdarg.h>
+#include <pthread.h>
 
+/* a chunk is its list head, its pool, an in-use flag padded to a long and
+ * then the object itself */
 #define GF_MEM_POOL_LIST_BOUNDARY        (sizeof(struct list_head))
-#define GF_MEM_POOL_PAD_BOUNDARY         (GF_MEM_POOL_LIST_BOUNDARY + sizeof(int))
+#define GF_MEM_POOL_PTR_BOUNDARY         (sizeof(struct mem_pool *))
+#define GF_MEM_POOL_PAD_BOUNDARY         (GF_MEM_POOL_LIST_BOUNDARY +   \
+                                          GF_MEM_POOL_PTR_BOUNDARY +    \
+                                          sizeof(long))
 #define mem_pool_chunkhead2ptr(head)     ((head) + GF_MEM_POOL_PAD_BOUNDARY)
 #define mem_pool_ptr2chunkhead(ptr)      ((ptr) - GF_MEM_POOL_PAD_BOUNDARY)
+#define mem_pool_chunkhead2pool(head)                                   \
+        (*(struct mem_pool **)((head) + GF_MEM_POOL_LIST_BOUNDARY))
+#define mem_pool_chunkhead2inuse(head)                                  \
+        ((int *)((head) + GF_MEM_POOL_LIST_BOUNDARY +                   \
+                 GF_MEM_POOL_PTR_BOUNDARY))
 #define is_mem_chunk_in_use(ptr)         (*ptr == 1)
 
 #define GF_MEM_HEADER_SIZE  (4 + sizeof (size_t) + sizeof (xlator_t *) + 4 + 8)
@@ -70,6 +82,170 @@ gf_mem_acct_enable_set ()
 
 }
 
+#ifdef HAVE_ATOMIC_BUILTINS
+static pthread_once_t mem_acct_shard_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  mem_acct_shard_key;
+static long           mem_acct_shard_next;
+
+static void
+mem_acct_shard_init (void)
+{
+        pthread_key_create (&mem_acct_shard_key, NULL);
+}
+
+/* the shard of the calling thread, handed out round robin. Only called
+ * once gf_mem_acct_shards_init () has created the key. */
+static int
+gf_mem_acct_shard (void)
+{
+        long shard = 0;
+
+        shard = (long) pthread_getspecific (mem_acct_shard_key);
+        if (!shard) {
+                shard = __sync_add_and_fetch (&mem_acct_shard_next, 1);
+                pthread_setspecific (mem_acct_shard_key, (void *) shard);
+        }
+
+        return shard % GF_MEM_ACCT_SHARDS;
+}
+#endif
+
+/* gives @xl sharded counters; without them, as without atomic builtins,
+ * the counters of a type are kept under its lock */
+int
+gf_mem_acct_shards_init (xlator_t *xl)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+        int i = 0;
+
+        pthread_once (&mem_acct_shard_once, mem_acct_shard_init);
+
+        for (i = 0; i < GF_MEM_ACCT_SHARDS; i++) {
+                xl->mem_acct.shards[i] =
+                        CALLOC (xl->mem_acct.num_types,
+                                sizeof (struct mem_acct_shard));
+                if (!xl->mem_acct.shards[i])
+                        break;
+        }
+        if (i == GF_MEM_ACCT_SHARDS)
+                return 0;
+
+        while (i--) {
+                FREE (xl->mem_acct.shards[i]);
+                xl->mem_acct.shards[i] = NULL;
+        }
+#endif
+        return -1;
+}
+
+void
+gf_mem_acct_fold (xlator_t *xl, uint32_t type)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+        struct mem_acct_shard *shard = NULL;
+        struct mem_acct_rec   *rec = NULL;
+        int64_t                size = 0;
+        int64_t                num_allocs = 0;
+        uint64_t               total_allocs = 0;
+        uint64_t               total_frees = 0;
+        size_t                 old_size = 0;
+        uint32_t               old_num = 0;
+        int                    i = 0;
+
+        if (!xl || !xl->mem_acct.rec || !xl->mem_acct.shards[0] ||
+            type >= xl->mem_acct.num_types)
+                return;
+
+        /* shards are read without stopping the others, so the sums
+         * are only as exact as the moment allows */
+        for (i = 0; i < GF_MEM_ACCT_SHARDS; i++) {
+                shard = &xl->mem_acct.shards[i][type];
+                size         += shard->size;
+                total_allocs += shard->total_allocs;
+                total_frees  += shard->total_frees;
+        }
+        num_allocs = total_allocs - total_frees;
+        if (size < 0)
+                size = 0;
+        if (num_allocs < 0)
+                num_allocs = 0;
+
+        rec = &xl->mem_acct.rec[type];
+        rec->size         = size;
+        rec->num_allocs   = num_allocs;
+        rec->total_allocs = total_allocs;
+
+        /* folds can race each other, the maxima only ever go up */
+        do {
+                old_size = rec->max_size;
+                if ((size_t)size <= old_size)
+                        break;
+        } while (!__sync_bool_compare_and_swap (&rec->max_size, old_size,
+                                                (size_t)size));
+        do {
+                old_num = rec->max_num_allocs;
+                if ((uint32_t)num_allocs <= old_num)
+                        break;
+        } while (!__sync_bool_compare_and_swap (&rec->max_num_allocs,
+                                                old_num,
+                                                (uint32_t)num_allocs));
+#endif
+}
+
+static void
+gf_mem_acct_add (xlator_t *xl, uint32_t type, size_t size)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+        struct mem_acct_shard *shard = NULL;
+
+        if (xl->mem_acct.shards[0]) {
+                shard = &xl->mem_acct.shards[gf_mem_acct_shard ()][type];
+                __sync_fetch_and_add (&shard->size, size);
+                if (!(__sync_add_and_fetch (&shard->total_allocs, 1) %
+                      GF_MEM_ACCT_FOLD_INTERVAL))
+                        gf_mem_acct_fold (xl, type);
+                return;
+        }
+#endif
+        LOCK(&xl->mem_acct.rec[type].lock);
+        {
+                xl->mem_acct.rec[type].size += size;
+                xl->mem_acct.rec[type].num_allocs++;
+                xl->mem_acct.rec[type].total_allocs++;
+                xl->mem_acct.rec[type].max_size =
+                        max (xl->mem_acct.rec[type].max_size,
+                             xl->mem_acct.rec[type].size);
+                xl->mem_acct.rec[type].max_num_allocs =
+                        max (xl->mem_acct.rec[type].max_num_allocs,
+                             xl->mem_acct.rec[type].num_allocs);
+        }
+        UNLOCK(&xl->mem_acct.rec[type].lock);
+}
+
+static void
+gf_mem_acct_sub (xlator_t *xl, uint32_t type, size_t size)
+{
+#ifdef HAVE_ATOMIC_BUILTINS
+        struct mem_acct_shard *shard = NULL;
+
+        /* a free is counted in the shard of the freeing thread, whose
+         * size may go negative; only the sum over the shards means
+         * anything */
+        if (xl->mem_acct.shards[0]) {
+                shard = &xl->mem_acct.shards[gf_mem_acct_shard ()][type];
+                __sync_fetch_and_sub (&shard->size, size);
+                __sync_fetch_and_add (&shard->total_frees, 1);
+                return;
+        }
+#endif
+        LOCK (&xl->mem_acct.rec[type].lock);
+        {
+                xl->mem_acct.rec[type].size -= size;
+                xl->mem_acct.rec[type].num_allocs--;
+        }
+        UNLOCK (&xl->mem_acct.rec[type].lock);
+}
+
 void
 gf_mem_set_acct_info (xlator_t *xl, char **alloc_ptr,
                       size_t size, uint32_t type)
@@ -94,18 +270,7 @@ gf_mem_set_acct_info (xlator_t *xl, char **alloc_ptr,
                 GF_ASSERT (0);
         }
 
-        LOCK(&xl->mem_acct.rec[type].lock);
-        {
-                xl->mem_acct.rec[type].size += size;
-                xl->mem_acct.rec[type].num_allocs++;
-                xl->mem_acct.rec[type].max_size =
-                        max (xl->mem_acct.rec[type].max_size,
-                             xl->mem_acct.rec[type].size);
-                xl->mem_acct.rec[type].max_num_allocs =
-                        max (xl->mem_acct.rec[type].max_num_allocs,
-                             xl->mem_acct.rec[type].num_allocs);
-        }
-        UNLOCK(&xl->mem_acct.rec[type].lock);
+        gf_mem_acct_add (xl, type, size);
 
         *(uint32_t *)(ptr) = type;
         ptr = ptr + 4;
@@ -178,6 +343,7 @@ void *
 __gf_realloc (void *ptr, size_t size)
 {
         size_t          tot_size = 0;
+        size_t          old_size = 0;
         char            *orig_ptr = NULL;
         xlator_t        *xl = NULL;
         uint32_t        type = 0;
@@ -196,6 +362,7 @@ __gf_realloc (void *ptr, size_t size)
 
         orig_ptr = (char *)ptr - GF_MEM_HEADER_SIZE;
         type = *(uint32_t *)orig_ptr;
+        memcpy (&old_size, orig_ptr + 4, sizeof (size_t));
 
         ptr = realloc (orig_ptr, tot_size);
         if (!ptr) {
@@ -203,6 +370,8 @@ __gf_realloc (void *ptr, size_t size)
                 return NULL;
         }
 
+        /* the old block is accounted afresh below */
+        gf_mem_acct_sub (xl, type, old_size);
         gf_mem_set_acct_info (xl, (char **)&ptr, size, type);
 
         return (void *)ptr;
@@ -298,33 +467,185 @@ __gf_free (void *free_ptr)
         }
         *(uint32_t *) ((char *)free_ptr + req_size) = 0;
 
-        LOCK (&xl->mem_acct.rec[type].lock);
-        {
-                xl->mem_acct.rec[type].size -= req_size;
-                xl->mem_acct.rec[type].num_allocs--;
-        }
-        UNLOCK (&xl->mem_acct.rec[type].lock);
+        gf_mem_acct_sub (xl, type, req_size);
 free:
         FREE (ptr);
 }
 
 
 
+/* The chunks of one pool which a thread holds on to, most recently put
+ * last. @gen is that of the pool the chunks came from.
+ */
+struct mem_pool_magazine {
+        uint64_t          gen;
+        int               count;
+        void             *chunks[GF_MEM_POOL_MAGAZINE_SIZE];
+};
+
+/* the magazines of a thread, indexed by mem_pool->id */
+struct mem_pool_rack {
+        struct list_head          list;
+        struct mem_pool_magazine *magazines[GF_MEM_POOL_MAX];
+};
+
+/* mem_pool_mutex guards the table of pools with magazines, the list of
+ * racks and the generation counter. It is taken before a pool lock.
+ */
+static pthread_once_t   mem_pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t    mem_pool_rack_key;
+static pthread_mutex_t  mem_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct mem_pool *mem_pools[GF_MEM_POOL_MAX];
+static struct list_head mem_pool_racks = {&mem_pool_racks, &mem_pool_racks};
+static uint64_t         mem_pool_gen;
+
+
+/* returns the magazines of an exiting thread to their pools */
+static void
+mem_pool_rack_destroy (void *data)
+{
+        struct mem_pool_rack     *rack = data;
+        struct mem_pool_magazine *mag = NULL;
+        struct mem_pool          *pool = NULL;
+        struct list_head         *list = NULL;
+        int                       i = 0;
+
+        pthread_mutex_lock (&mem_pool_mutex);
+        {
+                for (i = 0; i < GF_MEM_POOL_MAX; i++) {
+                        mag = rack->magazines[i];
+                        if (!mag)
+                                continue;
+
+                        pool = mem_pools[i];
+                        if (pool && pool->gen == mag->gen) {
+                                LOCK (&pool->lock);
+                                {
+                                        while (mag->count) {
+                                                list = mag->chunks[--mag->count];
+                                                list_add (list, &pool->list);
+                                                pool->hot_count--;
+                                                pool->cold_count++;
+                                        }
+                                }
+                                UNLOCK (&pool->lock);
+                        }
+
+                        FREE (mag);
+                }
+
+                list_del (&rack->list);
+        }
+        pthread_mutex_unlock (&mem_pool_mutex);
+
+        FREE (rack);
+}
+
+
+static void
+mem_pool_init_once (void)
+{
+        if (pthread_key_create (&mem_pool_rack_key, mem_pool_rack_destroy))
+                gf_log ("mem-pool", GF_LOG_ERROR,
+                        "pthread_key_create failed, mem pools will not use "
+                        "per-thread magazines");
+}
+
+
+/* the magazine of the calling thread for @pool, created on first use.
+ * NULL if it cannot be, which only costs the lock-free paths.
+ */
+static struct mem_pool_magazine *
+mem_pool_magazine_get (struct mem_pool *pool)
+{
+        struct mem_pool_rack     *rack = NULL;
+        struct mem_pool_magazine *mag = NULL;
+
+        rack = pthread_getspecific (mem_pool_rack_key);
+        if (!rack) {
+                rack = CALLOC (1, sizeof (*rack));
+                if (!rack)
+                        return NULL;
+
+                if (pthread_setspecific (mem_pool_rack_key, rack)) {
+                        FREE (rack);
+                        return NULL;
+                }
+
+                pthread_mutex_lock (&mem_pool_mutex);
+                {
+                        list_add (&rack->list, &mem_pool_racks);
+                }
+                pthread_mutex_unlock (&mem_pool_mutex);
+        }
+
+        mag = rack->magazines[pool->id];
+        if (!mag) {
+                mag = CALLOC (1, sizeof (*mag));
+                if (!mag)
+                        return NULL;
+                mag->gen = pool->gen;
+                rack->magazines[pool->id] = mag;
+        }
+
+        if (mag->gen != pool->gen) {
+                /* left over from a destroyed pool, whose slabs are gone */
+                mag->count = 0;
+                mag->gen   = pool->gen;
+        }
+
+        return mag;
+}
+
+
+static int
+__mem_pool_add_slab (struct mem_pool *pool)
+{
+        struct list_head *slab = NULL;
+        struct list_head *list = NULL;
+        void             *head = NULL;
+        unsigned long     i = 0;
+
+        slab = GF_CALLOC (1, sizeof (*slab) +
+                          pool->count * pool->padded_sizeof_type,
+                          gf_common_mt_long);
+        if (!slab)
+                return -1;
+
+        list_add_tail (slab, &pool->slabs);
+
+        for (i = 0; i < pool->count; i++) {
+                head = (void *)(slab + 1) + i * pool->padded_sizeof_type;
+                list = head;
+                INIT_LIST_HEAD (list);
+                mem_pool_chunkhead2pool (head) = pool;
+                list_add_tail (list, &pool->list);
+        }
+
+        pool->cold_count += pool->count;
+        pool->slab_count++;
+
+        return 0;
+}
+
+
 struct mem_pool *
 mem_pool_new_fn (unsigned long sizeof_type,
-                 unsigned long count)
+                 unsigned long count, const char *name)
 {
         struct mem_pool  *mem_pool = NULL;
         unsigned long     padded_sizeof_type = 0;
-        void             *pool = NULL;
         int               i = 0;
-        struct list_head *list = NULL;
 
         if (!sizeof_type || !count) {
                 gf_log ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return NULL;
         }
-        padded_sizeof_type = sizeof_type + GF_MEM_POOL_PAD_BOUNDARY;
+        /* keep the objects of all the chunks long aligned */
+        padded_sizeof_type = GF_MEM_POOL_PAD_BOUNDARY +
+                ((sizeof_type + sizeof (long) - 1) & ~(sizeof (long) - 1));
+
+        pthread_once (&mem_pool_once, mem_pool_init_once);
 
         mem_pool = GF_CALLOC (sizeof (*mem_pool), 1, gf_common_mt_mem_pool);
         if (!mem_pool)
@@ -332,25 +653,38 @@ mem_pool_new_fn (unsigned long sizeof_type,
 
         LOCK_INIT (&mem_pool->lock);
         INIT_LIST_HEAD (&mem_pool->list);
+        INIT_LIST_HEAD (&mem_pool->slabs);
 
         mem_pool->padded_sizeof_type = padded_sizeof_type;
-        mem_pool->cold_count = count;
         mem_pool->real_sizeof_type = sizeof_type;
+        mem_pool->count = count;
+        mem_pool->name = name;
+        mem_pool->id = -1;
 
-        pool = GF_CALLOC (count, padded_sizeof_type, gf_common_mt_long);
-        if (!pool) {
+        if (__mem_pool_add_slab (mem_pool) < 0) {
+                LOCK_DESTROY (&mem_pool->lock);
                 GF_FREE (mem_pool);
                 return NULL;
         }
 
-        for (i = 0; i < count; i++) {
-                list = pool + (i * (padded_sizeof_type));
-                INIT_LIST_HEAD (list);
-                list_add_tail (list, &mem_pool->list);
-        }
+        /* a thread caches at most an eighth of a slab */
+        mem_pool->magazine_size = min (GF_MEM_POOL_MAGAZINE_SIZE, count / 8);
+        if (mem_pool->magazine_size < 2)
+                mem_pool->magazine_size = 0;
 
-        mem_pool->pool = pool;
-        mem_pool->pool_end = pool + (count * (padded_sizeof_type));
+        pthread_mutex_lock (&mem_pool_mutex);
+        {
+                mem_pool->gen = ++mem_pool_gen;
+
+                for (i = 0; i < GF_MEM_POOL_MAX; i++) {
+                        if (!mem_pools[i]) {
+                                mem_pools[i] = mem_pool;
+                                mem_pool->id = i;
+                                break;
+                        }
+                }
+        }
+        pthread_mutex_unlock (&mem_pool_mutex);
 
         return mem_pool;
 }
@@ -376,141 +710,128 @@ mem_get0 (struct mem_pool *mem_pool)
 void *
 mem_get (struct mem_pool *mem_pool)
 {
-        struct list_head *list = NULL;
-        void             *ptr = NULL;
-        int             *in_use = NULL;
+        struct mem_pool_rack     *rack = NULL;
+        struct mem_pool_magazine *mag = NULL;
+        struct list_head         *list = NULL;
+        void                     *head = NULL;
+        int                      *in_use = NULL;
 
         if (!mem_pool) {
                 gf_log ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return NULL;
         }
 
+        if (mem_pool->id >= 0 && mem_pool->magazine_size) {
+                rack = pthread_getspecific (mem_pool_rack_key);
+                if (rack)
+                        mag = rack->magazines[mem_pool->id];
+                if (mag && mag->gen == mem_pool->gen && mag->count) {
+                        head = mag->chunks[--mag->count];
+                        goto out;
+                }
+
+                mag = mem_pool_magazine_get (mem_pool);
+        }
+
         LOCK (&mem_pool->lock);
         {
-                if (mem_pool->cold_count) {
+                if (!mem_pool->cold_count) {
+                        /* grow by a whole slab rather than by a chunk */
+                        if (__mem_pool_add_slab (mem_pool) < 0) {
+                                UNLOCK (&mem_pool->lock);
+                                gf_log ("mem-pool", GF_LOG_ERROR,
+                                        "out of memory growing mem pool "
+                                        "of %s", mem_pool->name);
+                                return NULL;
+                        }
+                        mem_pool->overflow_count++;
+                }
+
+                head = list = mem_pool->list.next;
+                list_del (list);
+                mem_pool->hot_count++;
+                mem_pool->cold_count--;
+
+                /* take half a magazine along for the next gets */
+                while (mag && mag->count < mem_pool->magazine_size / 2 &&
+                       mem_pool->cold_count) {
                         list = mem_pool->list.next;
                         list_del (list);
-
+                        mag->chunks[mag->count++] = list;
                         mem_pool->hot_count++;
                         mem_pool->cold_count--;
-
-                        ptr = list;
-                        in_use = (ptr + GF_MEM_POOL_LIST_BOUNDARY);
-                        *in_use = 1;
-
-                        goto fwd_addr_out;
                 }
-
-                /* This is a problem area. If we've run out of
-                 * chunks in our slab above, we need to allocate
-                 * enough memory to service this request.
-                 * The problem is, these indvidual chunks will fail
-                 * the first address range check in __is_member. Now, since
-                 * we're not allocating a full second slab, we wont have
-                 * enough info perform the range check in __is_member.
-                 *
-                 * I am working around this by performing a regular allocation
-                 * , just the way the caller would've done when not using the
-                 * mem-pool. That also means, we're not padding the size with
-                 * the list_head structure because, this will not be added to
-                 * the list of chunks that belong to the mem-pool allocated
-                 * initially.
-                 *
-                 * This is the best we can do without adding functionality for
-                 * managing multiple slabs. That does not interest us at present
-                 * because it is too much work knowing that a better slab
-                 * allocator is coming RSN.
-                 */
-                ptr = MALLOC (mem_pool->real_sizeof_type);
-
-                /* Memory coming from the heap need not be transformed from a
-                 * chunkhead to a usable pointer since it is not coming from
-                 * the pool.
-                 */
-                goto unlocked_out;
         }
-fwd_addr_out:
-        ptr = mem_pool_chunkhead2ptr (ptr);
-unlocked_out:
         UNLOCK (&mem_pool->lock);
+out:
+        in_use = mem_pool_chunkhead2inuse (head);
+        *in_use = 1;
 
-        return ptr;
-}
-
-
-static int
-__is_member (struct mem_pool *pool, void *ptr)
-{
-        if (!pool || !ptr) {
-                gf_log ("mem-pool", GF_LOG_ERROR, "invalid argument");
-                return -1;
-        }
-
-        if (ptr < pool->pool || ptr >= pool->pool_end)
-                return 0;
-
-        if ((mem_pool_ptr2chunkhead (ptr) - pool->pool)
-            % pool->padded_sizeof_type)
-                return -1;
-
-        return 1;
+        return mem_pool_chunkhead2ptr (head);
 }
 
 
 void
 mem_put (struct mem_pool *pool, void *ptr)
 {
-        struct list_head *list = NULL;
-        int    *in_use = NULL;
-        void   *head = NULL;
+        struct mem_pool_rack     *rack = NULL;
+        struct mem_pool_magazine *mag = NULL;
+        struct list_head         *list = NULL;
+        int                      *in_use = NULL;
+        void                     *head = NULL;
 
         if (!pool || !ptr) {
                 gf_log ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return;
         }
 
+        head = mem_pool_ptr2chunkhead (ptr);
+        if (mem_pool_chunkhead2pool (head) != pool) {
+                /* Either not from a mem pool at all, or a chunk of another
+                 * one. Sounds like a problem in layers of clouds up above
+                 * us. ;)
+                 */
+                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
+                                  "mem_put called on %p which is not of mem "
+                                  "pool %p", ptr, pool);
+                return;
+        }
+
+        in_use = mem_pool_chunkhead2inuse (head);
+        if (!is_mem_chunk_in_use (in_use)) {
+                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
+                                  "mem_put called on freed ptr %p of mem "
+                                  "pool %p", ptr, pool);
+                return;
+        }
+        *in_use = 0;
+
+        if (pool->id >= 0 && pool->magazine_size) {
+                rack = pthread_getspecific (mem_pool_rack_key);
+                if (rack)
+                        mag = rack->magazines[pool->id];
+                if (!mag || mag->gen != pool->gen)
+                        mag = mem_pool_magazine_get (pool);
+
+                if (mag && mag->count < pool->magazine_size) {
+                        mag->chunks[mag->count++] = head;
+                        return;
+                }
+        }
+
         LOCK (&pool->lock);
         {
-
-                switch (__is_member (pool, ptr))
-                {
-                case 1:
-                        list = head = mem_pool_ptr2chunkhead (ptr);
-                        in_use = (head + GF_MEM_POOL_LIST_BOUNDARY);
-                        if (!is_mem_chunk_in_use(in_use)) {
-                                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
-                                                  "mem_put called on freed ptr %p of mem "
-                                                  "pool %p", ptr, pool);
-                                break;
-                        }
+                list = head;
+                list_add (list, &pool->list);
+                pool->hot_count--;
+                pool->cold_count++;
+
+                /* the magazine is full, hand back half of it */
+                while (mag && mag->count > pool->magazine_size / 2) {
+                        list = mag->chunks[--mag->count];
+                        list_add (list, &pool->list);
                         pool->hot_count--;
                         pool->cold_count++;
-                        *in_use = 0;
-                        list_add (list, &pool->list);
-                        break;
-                case -1:
-                        /* For some reason, the address given is within
-                         * the address range of the mem-pool but does not align
-                         * with the expected start of a chunk that includes
-                         * the list headers also. Sounds like a problem in
-                         * layers of clouds up above us. ;)
-                         */
-                        abort ();
-                        break;
-                case 0:
-                        /* The address is outside the range of the mem-pool. We
-                         * assume here that this address was allocated at a
-                         * point when the mem-pool was out of chunks in mem_get
-                         * or the programmer has made a mistake by calling the
-                         * wrong de-allocation interface. We do
-                         * not have enough info to distinguish between the two
-                         * situations.
-                         */
-                        FREE (ptr);
-                        break;
-                default:
-                        /* log error */
-                        break;
                 }
         }
         UNLOCK (&pool->lock);
@@ -520,12 +841,78 @@ mem_put (struct mem_pool *pool, void *ptr)
 void
 mem_pool_destroy (struct mem_pool *pool)
 {
+        struct list_head *slab = NULL;
+
         if (!pool)
                 return;
 
+        /* chunks still in magazines are dropped along with the slabs,
+         * mem_pool_magazine_get () tells them apart by their gen */
+        pthread_mutex_lock (&mem_pool_mutex);
+        {
+                if (pool->id >= 0)
+                        mem_pools[pool->id] = NULL;
+        }
+        pthread_mutex_unlock (&mem_pool_mutex);
+
+        while (!list_empty (&pool->slabs)) {
+                slab = pool->slabs.next;
+                list_del (slab);
+                GF_FREE (slab);
+        }
+
         LOCK_DESTROY (&pool->lock);
-        GF_FREE (pool->pool);
         GF_FREE (pool);
 
         return;
 }
+
+
+void
+mem_pool_stats_dump (void)
+{
+        struct mem_pool_rack     *rack = NULL;
+        struct mem_pool_magazine *mag = NULL;
+        struct mem_pool          *pool = NULL;
+        char                      key[GF_DUMP_MAX_BUF_LEN];
+        int                       cached = 0;
+        int                       i = 0;
+
+        pthread_mutex_lock (&mem_pool_mutex);
+        for (i = 0; i < GF_MEM_POOL_MAX; i++) {
+                pool = mem_pools[i];
+                if (!pool)
+                        continue;
+
+                /* magazines are read unlocked, a count may be stale */
+                cached = 0;
+                list_for_each_entry (rack, &mem_pool_racks, list) {
+                        mag = rack->magazines[i];
+                        if (mag && mag->gen == pool->gen)
+                                cached += mag->count;
+                }
+
+                snprintf (key, sizeof (key), "mempool.%d", i);
+                gf_proc_dump_add_section (key);
+
+                LOCK (&pool->lock);
+                {
+                        gf_proc_dump_write ("name", "%s", pool->name);
+                        gf_proc_dump_write ("sizeof_type", "%d",
+                                            pool->real_sizeof_type);
+                        gf_proc_dump_write ("slab_count", "%d",
+                                            pool->slab_count);
+                        gf_proc_dump_write ("chunks_per_slab", "%lu",
+                                            pool->count);
+                        gf_proc_dump_write ("hot_count", "%d",
+                                            pool->hot_count - cached);
+                        gf_proc_dump_write ("cached_count", "%d", cached);
+                        gf_proc_dump_write ("cold_count", "%d",
+                                            pool->cold_count);
+                        gf_proc_dump_write ("overflow_count", "%"PRIu64,
+                                            pool->overflow_count);
+                }
+                UNLOCK (&pool->lock);
+        }
+        pthread_mutex_unlock (&mem_pool_mutex);
+}
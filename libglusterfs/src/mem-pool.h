@@ -30,9 +30,25 @@
 #include <stdarg.h>
 
 
+/* With atomic builtins the counters of every type are spread over this
+ * many shards, a thread always using the same one, so that allocating
+ * threads do not meet on a lock or a cache line. gf_mem_acct_fold () sums
+ * them up into the mem_acct_rec of the type, every
+ * GF_MEM_ACCT_FOLD_INTERVAL allocations of a shard and for statedump.
+ */
+#define GF_MEM_ACCT_SHARDS              8
+#define GF_MEM_ACCT_FOLD_INTERVAL       1024
+
+struct mem_acct_shard {
+        int64_t         size;
+        uint64_t        total_allocs;
+        uint64_t        total_frees;
+};
+
 struct mem_acct {
         uint32_t            num_types;
         struct mem_acct_rec     *rec;
+        struct mem_acct_shard   *shards[GF_MEM_ACCT_SHARDS];
 };
 
 struct mem_acct_rec {
@@ -40,9 +56,15 @@ struct mem_acct_rec {
         size_t          max_size;
         uint32_t        num_allocs;
         uint32_t        max_num_allocs;
+        uint64_t        total_allocs;
         gf_lock_t       lock;
 };
 
+struct _xlator;
+
+int gf_mem_acct_shards_init (struct _xlator *xl);
+void gf_mem_acct_fold (struct _xlator *xl, uint32_t type);
+
 
 void *
 __gf_calloc (size_t cnt, size_t size, uint32_t type);
@@ -136,27 +158,45 @@ char * gf_strdup (const char *src)
         return dup_str;
 }
 
+/* chunks a thread keeps of each pool, to get and put them without taking
+ * the pool lock. Only the first GF_MEM_POOL_MAX pools get magazines, the
+ * others always go through the lock.
+ */
+#define GF_MEM_POOL_MAGAZINE_SIZE        32
+#define GF_MEM_POOL_MAX                  1024
+
 struct mem_pool {
-        struct list_head  list;
-        int               hot_count;
+        struct list_head  list;     /* cold chunks, shared by all threads */
+        int               hot_count;   /* chunks off the list, including
+                                          those cached in magazines */
         int               cold_count;
         gf_lock_t         lock;
         unsigned long     padded_sizeof_type;
-        void             *pool;
-        void             *pool_end;
+        struct list_head  slabs;
+        unsigned long     count;    /* chunks in each slab */
+        int               slab_count;
+        uint64_t          overflow_count; /* gets which had to add a slab */
         int               real_sizeof_type;
+        const char       *name;
+        int               id;       /* index in the magazines of a thread,
+                                       -1 if the pool has none */
+        int               magazine_size;
+        uint64_t          gen;      /* tells the magazines of a destroyed
+                                       pool from those of one reusing id */
 };
 
 struct mem_pool *
-mem_pool_new_fn (unsigned long sizeof_type, unsigned long count);
+mem_pool_new_fn (unsigned long sizeof_type, unsigned long count,
+                 const char *name);
 
-#define mem_pool_new(type,count) mem_pool_new_fn (sizeof(type), count)
+#define mem_pool_new(type,count) mem_pool_new_fn (sizeof(type), count, #type)
 
 void mem_put (struct mem_pool *pool, void *ptr);
 void *mem_get (struct mem_pool *pool);
 void *mem_get0 (struct mem_pool *pool);
 
 void mem_pool_destroy (struct mem_pool *pool);
+void mem_pool_stats_dump (void);
 
 int gf_mem_acct_is_enabled ();
 void gf_mem_acct_enable_set ();
@@ -31,6 +31,7 @@
 #include <dirent.h>
 #include <assert.h>
 #include <sys/wait.h>
+#include <signal.h>
 
 #ifdef RUN_STANDALONE
 #define GF_CALLOC(n, s, t) calloc(n, s)
@@ -50,6 +51,10 @@
 #include "common-utils.h"
 #endif
 
+#ifdef HAVE_POSIX_SPAWN_CLOSEFROM
+#include <spawn.h>
+#endif
+
 #include "run.h"
 
 void
@@ -204,40 +209,141 @@ runner_redir (runner_t *runner, int fd, int tgt_fd)
         runner->chfd[fd] = (tgt_fd >= 0) ? tgt_fd : -2;
 }
 
-int
-runner_start (runner_t *runner)
+#ifdef HAVE_POSIX_SPAWN_CLOSEFROM
+/* posix_spawn (3) runs the child in our address space until it execs, so
+ * its cost does not grow with the size of the caller as that of fork (2)
+ * does, and it reports exec failures by itself. @pi are the pipes of
+ * runner_start ().
+ */
+static int
+runner_exec (runner_t *runner, int pi[3][2])
 {
-        int pi[3][2] = {{-1, -1}, {-1, -1}, {-1, -1}};
-        int xpi[2];
+        posix_spawn_file_actions_t fa;
+        posix_spawnattr_t attr;
+        sigset_t set;
         int ret = 0;
-        int errno_priv = 0;
         int i = 0;
-        sigset_t set;
 
-        if (runner->runerr) {
-                errno = runner->runerr;
+        ret = posix_spawn_file_actions_init (&fa);
+        if (ret)
+                goto out;
+        ret = posix_spawnattr_init (&attr);
+        if (ret) {
+                posix_spawn_file_actions_destroy (&fa);
+                goto out;
+        }
+
+        for (i = 0; i < 3; i++) {
+                if (ret)
+                        break;
+                switch (runner->chfd[i]) {
+                case -1:
+                        /* no redir */
+                        break;
+                case -2:
+                        /* redir to pipe */
+                        ret = posix_spawn_file_actions_adddup2
+                                (&fa, pi[i][i ? 1 : 0], i);
+                        break;
+                default:
+                        /* redir to file */
+                        ret = posix_spawn_file_actions_adddup2
+                                (&fa, runner->chfd[i], i);
+                }
+        }
+        if (!ret)
+                ret = posix_spawn_file_actions_addclosefrom_np (&fa, 3);
+
+        /* save child from inheriting our singal handling */
+        sigemptyset (&set);
+        if (!ret)
+                ret = posix_spawnattr_setsigmask (&attr, &set);
+        if (!ret)
+                ret = posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGMASK);
+
+        if (!ret)
+                ret = posix_spawnp (&runner->chpid, runner->argv[0], &fa,
+                                    &attr, runner->argv, environ);
+
+        posix_spawnattr_destroy (&attr);
+        posix_spawn_file_actions_destroy (&fa);
+out:
+        if (ret) {
+                /* a child that failed to exec is reaped by posix_spawn */
+                runner->chpid = -1;
+                errno = ret;
                 return -1;
         }
 
-        GF_ASSERT (runner->argv[0]);
+        return 0;
+}
+#else /* ! HAVE_POSIX_SPAWN_CLOSEFROM */
+/* closes the descriptors of a forked child above stderr, but @keep */
+static int
+runner_close_fds (int keep)
+{
+        int i = 0;
+        int ret = 0;
+
+#ifdef HAVE_CLOSE_RANGE
+        if (keep < 3) {
+                ret = close_range (3, ~0U, 0);
+        } else {
+                if (keep > 3)
+                        ret = close_range (3, keep - 1, 0);
+                if (ret != -1)
+                        ret = close_range (keep + 1, ~0U, 0);
+        }
+        if (ret != -1)
+                return 0;
+        /* the kernel does not have it, fall back to closing one by one */
+        ret = 0;
+#endif
+
+#ifdef GF_LINUX_HOST_OS
+        {
+                DIR *d = NULL;
+                struct dirent *de = NULL;
+                char *e = NULL;
+
+                d = opendir ("/proc/self/fd");
+                if (d) {
+                        while ((de = readdir (d))) {
+                                i = strtoul (de->d_name, &e, 10);
+                                if (*e == '\0' && i > 2 &&
+                                    i != dirfd (d) && i != keep)
+                                        close (i);
+                        }
+                        closedir (d);
+                } else
+                        ret = -1;
+        }
+#else
+        for (i = 3; i < 65536; i++) {
+                if (i != keep)
+                        close (i);
+        }
+#endif
+
+        return ret;
+}
+
+static int
+runner_exec (runner_t *runner, int pi[3][2])
+{
+        int xpi[2];
+        int ret = 0;
+        int errno_priv = 0;
+        int i = 0;
+        sigset_t set;
 
         /* set up a channel to child to communicate back
          * possible execve(2) failures
          */
         ret = pipe(xpi);
-        if (ret != -1)
-                ret = fcntl (xpi[1], F_SETFD, FD_CLOEXEC);
-
-        for (i = 0; i < 3; i++) {
-                if (runner->chfd[i] != -2)
-                        continue;
-                ret = pipe (pi[i]);
-                if (ret != -1) {
-                        runner->chio[i] = fdopen (pi[i][i ? 0 : 1], i ? "r" : "w");
-                        if (!runner->chio[i])
-                                ret = -1;
-                }
-        }
+        if (ret == -1)
+                return -1;
+        ret = fcntl (xpi[1], F_SETFD, FD_CLOEXEC);
 
         if (ret != -1)
                 runner->chpid = fork ();
@@ -246,10 +352,6 @@ runner_start (runner_t *runner)
                 errno_priv = errno;
                 close (xpi[0]);
                 close (xpi[1]);
-                for (i = 0; i < 3; i++) {
-                        close (pi[i][0]);
-                        close (pi[i][1]);
-                }
                 errno = errno_priv;
                 return -1;
         case 0:
@@ -257,34 +359,9 @@ runner_start (runner_t *runner)
                         close (pi[i][i ? 0 : 1]);
                 close (xpi[0]);
                 ret = 0;
-#ifdef GF_LINUX_HOST_OS
-                {
-                        DIR *d = NULL;
-                        struct dirent *de = NULL;
-                        char *e = NULL;
-
-                        d = opendir ("/proc/self/fd");
-                        if (d) {
-                                while ((de = readdir (d))) {
-                                        i = strtoul (de->d_name, &e, 10);
-                                        if (*e == '\0' &&
-                                            i > 2 && i != dirfd (d) &&
-                                            i != pi[0][0] && i != pi[1][1] &&
-                                            i != pi[2][1] && i != xpi[1])
-                                                close (i);
-                                }
-                                closedir (d);
-                        } else
-                                ret = -1;
-                }
-#else
-                for (i = 3; i < 65536; i++) {
-                        if (i != pi[0][0] && i != pi[1][1] &&
-                            i != pi[2][1] && i != xpi[1])
-                                close (i);
-                }
-#endif
 
+                /* redirect before closing the rest, the descriptors we
+                 * redirect to are among those */
                 for (i = 0; i < 3; i++) {
                         if (ret == -1)
                                 break;
@@ -295,9 +372,6 @@ runner_start (runner_t *runner)
                         case -2:
                                 /* redir to pipe */
                                 ret = dup2 (pi[i][i ? 1 : 0], i);
-                                errno_priv = errno;
-                                close (pi[i][i ? 1 : 0]);
-                                errno = errno_priv;
                                 break;
                         default:
                                 /* redir to file */
@@ -305,6 +379,9 @@ runner_start (runner_t *runner)
                         }
                 }
 
+                if (ret != -1)
+                        ret = runner_close_fds (xpi[1]);
+
                 if (ret != -1) {
                         /* save child from inheriting our singal handling */
                         sigemptyset (&set);
@@ -316,26 +393,64 @@ runner_start (runner_t *runner)
                 _exit (1);
         }
 
+        close (xpi[1]);
+        ret = read (xpi[0], (char *)&errno_priv, sizeof (errno_priv));
+        close (xpi[0]);
+        if (ret <= 0)
+                return 0;
+        GF_ASSERT (ret == sizeof (errno_priv));
+
+        errno = errno_priv;
+        return -1;
+}
+#endif /* ! HAVE_POSIX_SPAWN_CLOSEFROM */
+
+int
+runner_start (runner_t *runner)
+{
+        int pi[3][2] = {{-1, -1}, {-1, -1}, {-1, -1}};
+        int ret = 0;
+        int errno_priv = 0;
+        int i = 0;
+
+        if (runner->runerr) {
+                errno = runner->runerr;
+                return -1;
+        }
+
+        GF_ASSERT (runner->argv[0]);
+
+        for (i = 0; i < 3; i++) {
+                if (runner->chfd[i] != -2)
+                        continue;
+                ret = pipe (pi[i]);
+                if (ret == -1)
+                        break;
+                runner->chio[i] = fdopen (pi[i][i ? 0 : 1], i ? "r" : "w");
+                if (!runner->chio[i]) {
+                        ret = -1;
+                        break;
+                }
+        }
+
+        if (ret != -1)
+                ret = runner_exec (runner, pi);
+
         errno_priv = errno;
         for (i = 0; i < 3; i++)
                 close (pi[i][i ? 1 : 0]);
-        close (xpi[1]);
         if (ret == -1) {
                 for (i = 0; i < 3; i++) {
                         if (runner->chio[i]) {
                                 fclose (runner->chio[i]);
                                 runner->chio[i] = NULL;
-                        }
+                        } else
+                                close (pi[i][i ? 0 : 1]);
                 }
-        } else {
-                ret = read (xpi[0], (char *)&errno_priv, sizeof (errno_priv));
-                close (xpi[0]);
-                if (ret <= 0)
-                        return 0;
-                GF_ASSERT (ret == sizeof (errno_priv));
         }
         errno = errno_priv;
-        return -1;
+
+        return ret;
 }
 
 int
@@ -378,6 +493,21 @@ runner_end (runner_t *runner)
         return ret;
 }
 
+pid_t
+runner_detach (runner_t *runner)
+{
+        pid_t pid = -1;
+
+        if (runner->chpid > 0)
+                pid = runner->chpid;
+
+        /* keep runner_end () from waiting */
+        runner->chpid = -1;
+        runner_end (runner);
+
+        return pid;
+}
+
 static int
 runner_run_generic (runner_t *runner, int (*rfin)(runner_t *runner))
 {
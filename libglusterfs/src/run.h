@@ -159,6 +159,21 @@ int runner_end (runner_t *runner);
  */
 int runner_end_reuse (runner_t *runner);
 
+/**
+ * free resources without waiting for the child.
+ *
+ * Redirections will be closed and dynamically allocated memory
+ * freed as with runner_end(), the child is left running and the
+ * caller becomes responsible for reaping it.
+ *
+ * @param runner  pointer to runner_t instance
+ *
+ * @return  pid of the child, or -1 if there is no running child
+ *
+ * @see runner_end()
+ */
+pid_t runner_detach (runner_t *runner);
+
 /**
  * spawn and child, take it to completion and free resources.
  *
@@ -141,7 +141,6 @@ gf_proc_dump_xlator_mem_info (xlator_t *xl)
         char    key[GF_DUMP_MAX_BUF_LEN];
         char    prefix[GF_DUMP_MAX_BUF_LEN];
         int     i = 0;
-        struct mem_acct rec = {0,};
 
         if (!xl)
                 return;
@@ -153,8 +152,8 @@ gf_proc_dump_xlator_mem_info (xlator_t *xl)
         gf_proc_dump_write ("num_types", "%d", xl->mem_acct.num_types);
 
         for (i = 0; i < xl->mem_acct.num_types; i++) {
-                if (!(memcmp (&xl->mem_acct.rec[i], &rec,
-                              sizeof (struct mem_acct))))
+                gf_mem_acct_fold (xl, i);
+                if (!xl->mem_acct.rec[i].total_allocs)
                         continue;
 
                 gf_proc_dump_add_section ("%s.%s - usage-type %d", xl->type,
@@ -169,6 +168,9 @@ gf_proc_dump_xlator_mem_info (xlator_t *xl)
                 gf_proc_dump_write (key, "%u", xl->mem_acct.rec[i].max_size);
                 gf_proc_dump_build_key (key, prefix, "max_num_allocs");
                 gf_proc_dump_write (key, "%u", xl->mem_acct.rec[i].max_num_allocs);
+                gf_proc_dump_build_key (key, prefix, "total_allocs");
+                gf_proc_dump_write (key, "%"PRIu64,
+                                    xl->mem_acct.rec[i].total_allocs);
         }
 
         return;
@@ -199,6 +201,7 @@ gf_proc_dump_mem_info ()
         gf_proc_dump_write ("mallinfo_keepcost", "%d", info.keepcost);
 #endif
         gf_proc_dump_xlator_mem_info(&global_xlator);
+        mem_pool_stats_dump ();
 
 }
 
@@ -1075,8 +1075,8 @@ validate_xlator_volume_options_attacherr (xlator_t *xl,
                                                 "preferred is '%s', continuing"
                                                 " with correction",
                                                 trav->key[i], trav->key[0]);
-                                        /* TODO: some bytes lost */
-                                        pairs->key = gf_strdup (trav->key[0]);
+                                        dict_rename_key (xl->options, pairs->key,
+                                                         trav->key[0]);
                                 }
                                 break;
                         }
@@ -1135,8 +1135,8 @@ validate_xlator_volume_options (xlator_t *xl, volume_option_t *opt)
 						"preferred is '%s', continuing"
 						" with correction",
 						trav->key[i], trav->key[0]);
-					/* TODO: some bytes lost */
-                                        pairs->key = gf_strdup (trav->key[0]);
+					dict_rename_key (xl->options, pairs->key,
+					                 trav->key[0]);
 				}
 				break;
 			}
@@ -1578,6 +1578,8 @@ xlator_mem_acct_init (xlator_t *xl, int num_types)
                 }
         }
 
+        gf_mem_acct_shards_init (xl);
+
         return 0;
 }
 
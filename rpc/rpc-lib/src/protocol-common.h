@@ -201,6 +201,8 @@ enum gluster_cli_procnum {
         GLUSTER_CLI_TOP_VOLUME,
         GLUSTER_CLI_GETWD,
         GLUSTER_CLI_LOG_LEVEL,
+        GLUSTER_CLI_TXN_STATS,
+        GLUSTER_CLI_BATCH_VOLUME,
         GLUSTER_CLI_MAXVALUE,
 };
 
@@ -222,6 +224,7 @@ enum gf_brick_procnum {
 
 #define GD_MGMT_PROGRAM          1238433 /* Completely random */
 #define GD_MGMT_VERSION          1   /* 0.0.1 */
+#define GD_MGMT_V2_VERSION       2   /* txn ids, volume scoped locks */
 #define GD_MGMT_PROCCNT          GLUSTERD_MGMT_MAXVALUE
 
 #define GLUSTER_CLI_PROGRAM      1238463 /* Completely random */
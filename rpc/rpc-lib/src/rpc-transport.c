@@ -445,8 +445,8 @@ validate_volume_options (char *name, dict_t *options, volume_option_t *opt)
 						"preferred is '%s', continuing"
 						" with correction",
 						trav->key[i], trav->key[0]);
-					/* TODO: some bytes lost */
-					pairs->key = gf_strdup (trav->key[0]);
+					dict_rename_key (options, pairs->key,
+					                 trav->key[0]);
 				}
 				break;
 			}
@@ -786,6 +786,7 @@ rpcsvc_callback_submit (rpcsvc_t *rpc, rpc_transport_t *trans,
                         struct iovec *proghdr, int proghdrcount)
 {
         struct iobuf          *request_iob = NULL;
+        struct iobref         *iobref      = NULL;
         struct iovec           rpchdr      = {0,};
         rpc_transport_req_t    req;
         int                    ret         = -1;
@@ -814,10 +815,28 @@ rpcsvc_callback_submit (rpcsvc_t *rpc, rpc_transport_t *trans,
                 goto out;
         }
 
+        /* The transport may queue the message, so the payload is copied
+         * in behind the header and the iobuf handed over in an iobref.
+         */
+        if (proglen) {
+                if (rpchdr.iov_len + proglen > iobuf_pagesize (request_iob)) {
+                        gf_log ("rpcsvc", GF_LOG_WARNING,
+                                "callback payload too large (%d)", proglen);
+                        goto out;
+                }
+                iov_unload ((char *)rpchdr.iov_base + rpchdr.iov_len,
+                            proghdr, proghdrcount);
+                rpchdr.iov_len += proglen;
+        }
+
+        iobref = iobref_new ();
+        if (!iobref)
+                goto out;
+        iobref_add (iobref, request_iob);
+
         req.msg.rpchdr = &rpchdr;
         req.msg.rpchdrcount = 1;
-        req.msg.proghdr = proghdr;
-        req.msg.proghdrcount = proghdrcount;
+        req.msg.iobref = iobref;
 
         ret = rpc_transport_submit_request (trans, &req);
         if (ret == -1) {
@@ -829,7 +848,10 @@ rpcsvc_callback_submit (rpcsvc_t *rpc, rpc_transport_t *trans,
         ret = 0;
 
 out:
-        iobuf_unref (request_iob);
+        if (iobref)
+                iobref_unref (iobref);
+        if (request_iob)
+                iobuf_unref (request_iob);
 
         return ret;
 }
@@ -805,6 +805,48 @@ xdr_gf1_cli_getwd_rsp (XDR *xdrs, gf1_cli_getwd_rsp *objp)
 	return TRUE;
 }
 
+bool_t
+xdr_gf1_cli_txn_stats_req (XDR *xdrs, gf1_cli_txn_stats_req *objp)
+{
+	 if (!xdr_int (xdrs, &objp->flags))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gf1_cli_txn_stats_rsp (XDR *xdrs, gf1_cli_txn_stats_rsp *objp)
+{
+	 if (!xdr_int (xdrs, &objp->op_ret))
+		 return FALSE;
+	 if (!xdr_int (xdrs, &objp->op_errno))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->op_errstr, ~0))
+		 return FALSE;
+	 if (!xdr_bytes (xdrs, (char **)&objp->stats.stats_val, (u_int *) &objp->stats.stats_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gf1_cli_batch_vol_req (XDR *xdrs, gf1_cli_batch_vol_req *objp)
+{
+	 if (!xdr_bytes (xdrs, (char **)&objp->dict.dict_val, (u_int *) &objp->dict.dict_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_gf1_cli_batch_vol_rsp (XDR *xdrs, gf1_cli_batch_vol_rsp *objp)
+{
+	 if (!xdr_int (xdrs, &objp->op_ret))
+		 return FALSE;
+	 if (!xdr_int (xdrs, &objp->op_errno))
+		 return FALSE;
+	 if (!xdr_string (xdrs, &objp->op_errstr, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
 bool_t
 xdr_gf1_cli_log_level_req (XDR *xdrs, gf1_cli_log_level_req *objp)
 {
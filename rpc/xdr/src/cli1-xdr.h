@@ -514,6 +514,37 @@ struct gf1_cli_getwd_rsp {
 };
 typedef struct gf1_cli_getwd_rsp gf1_cli_getwd_rsp;
 
+struct gf1_cli_txn_stats_req {
+	int flags;
+};
+typedef struct gf1_cli_txn_stats_req gf1_cli_txn_stats_req;
+
+struct gf1_cli_txn_stats_rsp {
+	int op_ret;
+	int op_errno;
+	char *op_errstr;
+	struct {
+		u_int stats_len;
+		char *stats_val;
+	} stats;
+};
+typedef struct gf1_cli_txn_stats_rsp gf1_cli_txn_stats_rsp;
+
+struct gf1_cli_batch_vol_req {
+	struct {
+		u_int dict_len;
+		char *dict_val;
+	} dict;
+};
+typedef struct gf1_cli_batch_vol_req gf1_cli_batch_vol_req;
+
+struct gf1_cli_batch_vol_rsp {
+	int op_ret;
+	int op_errno;
+	char *op_errstr;
+};
+typedef struct gf1_cli_batch_vol_rsp gf1_cli_batch_vol_rsp;
+
 struct gf1_cli_log_level_req {
         char *volname;
         char *xlator;
@@ -592,6 +623,10 @@ extern  bool_t xdr_gf1_cli_log_level_req (XDR *, gf1_cli_log_level_req *);
 extern  bool_t xdr_gf1_cli_log_level_rsp (XDR *, gf1_cli_log_level_rsp *);
 extern  bool_t xdr_gf1_cli_getwd_req (XDR *, gf1_cli_getwd_req*);
 extern  bool_t xdr_gf1_cli_getwd_rsp (XDR *, gf1_cli_getwd_rsp*);
+extern  bool_t xdr_gf1_cli_txn_stats_req (XDR *, gf1_cli_txn_stats_req*);
+extern  bool_t xdr_gf1_cli_txn_stats_rsp (XDR *, gf1_cli_txn_stats_rsp*);
+extern  bool_t xdr_gf1_cli_batch_vol_req (XDR *, gf1_cli_batch_vol_req*);
+extern  bool_t xdr_gf1_cli_batch_vol_rsp (XDR *, gf1_cli_batch_vol_rsp*);
 
 #else /* K&R C */
 extern bool_t xdr_gf1_cluster_type ();
@@ -655,6 +690,10 @@ extern bool_t xdr_gf1_cli_log_level_req ();
 extern bool_t xdr_gf1_cli_log_level_rsp ();
 extern bool_t xdr_gf1_cli_getwd_req ();
 extern bool_t xdr_gf1_cli_getwd_rsp ();
+extern bool_t xdr_gf1_cli_txn_stats_req ();
+extern bool_t xdr_gf1_cli_txn_stats_rsp ();
+extern bool_t xdr_gf1_cli_batch_vol_req ();
+extern bool_t xdr_gf1_cli_batch_vol_rsp ();
 
 #endif /* K&R C */
 
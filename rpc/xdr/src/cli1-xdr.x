@@ -377,6 +377,27 @@ struct gf1_cli_getwd_rsp {
         string  wd<>;
 };
 
+struct gf1_cli_txn_stats_req {
+        int     flags;
+};
+
+struct gf1_cli_txn_stats_rsp {
+        int     op_ret;
+        int     op_errno;
+        string  op_errstr<>;
+        opaque  stats<>;
+};
+
+struct gf1_cli_batch_vol_req {
+        opaque  dict<>;
+};
+
+struct gf1_cli_batch_vol_rsp {
+        int     op_ret;
+        int     op_errno;
+        string  op_errstr<>;
+};
+
 struct gf1_cli_log_level_req {
        char *volname;
        char *xlator;
@@ -741,6 +741,62 @@ gf_xdr_from_cli_getwd_rsp (struct iovec outmsg, void *args)
                                       (xdrproc_t)xdr_gf1_cli_getwd_rsp);
 }
 
+ssize_t
+gf_xdr_to_cli_txn_stats_req (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gf1_cli_txn_stats_req);
+}
+
+ssize_t
+gf_xdr_from_cli_txn_stats_req (struct iovec outmsg, void *args)
+{
+        return xdr_serialize_generic (outmsg, (void *)args,
+                                     (xdrproc_t)xdr_gf1_cli_txn_stats_req);
+}
+
+ssize_t
+gf_xdr_to_cli_txn_stats_rsp (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gf1_cli_txn_stats_rsp);
+}
+
+ssize_t
+gf_xdr_from_cli_txn_stats_rsp (struct iovec outmsg, void *args)
+{
+        return xdr_serialize_generic (outmsg, (void *)args,
+                                      (xdrproc_t)xdr_gf1_cli_txn_stats_rsp);
+}
+
+ssize_t
+gf_xdr_to_cli_batch_vol_req (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gf1_cli_batch_vol_req);
+}
+
+ssize_t
+gf_xdr_from_cli_batch_vol_req (struct iovec outmsg, void *args)
+{
+        return xdr_serialize_generic (outmsg, (void *)args,
+                                      (xdrproc_t)xdr_gf1_cli_batch_vol_req);
+}
+
+ssize_t
+gf_xdr_to_cli_batch_vol_rsp (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gf1_cli_batch_vol_rsp);
+}
+
+ssize_t
+gf_xdr_from_cli_batch_vol_rsp (struct iovec outmsg, void *args)
+{
+        return xdr_serialize_generic (outmsg, (void *)args,
+                                      (xdrproc_t)xdr_gf1_cli_batch_vol_rsp);
+}
+
 ssize_t
 gf_xdr_serialize_cli_log_level_rsp (struct iovec outmsg, void *rsp)
 {
@@ -33,6 +33,10 @@ enum gf_cli_defrag_type {
         GF_DEFRAG_CMD_START_MIGRATE_DATA,
 };
 
+enum gf_cli_txn_stats_flags {
+        GF_CLI_TXN_STATS_RESET = 1,     /* clear them once fetched */
+};
+
 ssize_t
 gf_xdr_serialize_cli_probe_rsp (struct iovec outmsg, void *rsp);
 
@@ -342,4 +346,28 @@ gf_xdr_to_cli_getwd_rsp (struct iovec inmsg, void *args);
 
 ssize_t
 gf_xdr_from_cli_getwd_rsp (struct iovec outmsg, void *args);
+
+ssize_t
+gf_xdr_to_cli_txn_stats_req (struct iovec inmsg, void *args);
+
+ssize_t
+gf_xdr_from_cli_txn_stats_req (struct iovec outmsg, void *args);
+
+ssize_t
+gf_xdr_to_cli_txn_stats_rsp (struct iovec inmsg, void *args);
+
+ssize_t
+gf_xdr_from_cli_txn_stats_rsp (struct iovec outmsg, void *args);
+
+ssize_t
+gf_xdr_to_cli_batch_vol_req (struct iovec inmsg, void *args);
+
+ssize_t
+gf_xdr_from_cli_batch_vol_req (struct iovec outmsg, void *args);
+
+ssize_t
+gf_xdr_to_cli_batch_vol_rsp (struct iovec inmsg, void *args);
+
+ssize_t
+gf_xdr_from_cli_batch_vol_rsp (struct iovec outmsg, void *args);
 #endif /* !_CLI1_H */
@@ -117,6 +117,42 @@ struct gd1_mgmt_cluster_unlock_rsp {
 };
 typedef struct gd1_mgmt_cluster_unlock_rsp gd1_mgmt_cluster_unlock_rsp;
 
+struct gd1_mgmt_v2_cluster_lock_req {
+	u_char uuid[16];
+	u_char txn_id[16];
+	char *volname;
+};
+typedef struct gd1_mgmt_v2_cluster_lock_req gd1_mgmt_v2_cluster_lock_req;
+
+struct gd1_mgmt_v2_cluster_unlock_req {
+	u_char uuid[16];
+	u_char txn_id[16];
+	char *volname;
+};
+typedef struct gd1_mgmt_v2_cluster_unlock_req gd1_mgmt_v2_cluster_unlock_req;
+
+struct gd1_mgmt_v2_stage_op_req {
+	u_char uuid[16];
+	u_char txn_id[16];
+	int op;
+	struct {
+		u_int buf_len;
+		char *buf_val;
+	} buf;
+};
+typedef struct gd1_mgmt_v2_stage_op_req gd1_mgmt_v2_stage_op_req;
+
+struct gd1_mgmt_v2_commit_op_req {
+	u_char uuid[16];
+	u_char txn_id[16];
+	int op;
+	struct {
+		u_int buf_len;
+		char *buf_val;
+	} buf;
+};
+typedef struct gd1_mgmt_v2_commit_op_req gd1_mgmt_v2_commit_op_req;
+
 struct gd1_mgmt_stage_op_req {
 	u_char uuid[16];
 	int op;
@@ -216,6 +252,10 @@ extern  bool_t xdr_gd1_mgmt_cluster_lock_req (XDR *, gd1_mgmt_cluster_lock_req*)
 extern  bool_t xdr_gd1_mgmt_cluster_lock_rsp (XDR *, gd1_mgmt_cluster_lock_rsp*);
 extern  bool_t xdr_gd1_mgmt_cluster_unlock_req (XDR *, gd1_mgmt_cluster_unlock_req*);
 extern  bool_t xdr_gd1_mgmt_cluster_unlock_rsp (XDR *, gd1_mgmt_cluster_unlock_rsp*);
+extern  bool_t xdr_gd1_mgmt_v2_cluster_lock_req (XDR *, gd1_mgmt_v2_cluster_lock_req*);
+extern  bool_t xdr_gd1_mgmt_v2_cluster_unlock_req (XDR *, gd1_mgmt_v2_cluster_unlock_req*);
+extern  bool_t xdr_gd1_mgmt_v2_stage_op_req (XDR *, gd1_mgmt_v2_stage_op_req*);
+extern  bool_t xdr_gd1_mgmt_v2_commit_op_req (XDR *, gd1_mgmt_v2_commit_op_req*);
 extern  bool_t xdr_gd1_mgmt_stage_op_req (XDR *, gd1_mgmt_stage_op_req*);
 extern  bool_t xdr_gd1_mgmt_stage_op_rsp (XDR *, gd1_mgmt_stage_op_rsp*);
 extern  bool_t xdr_gd1_mgmt_commit_op_req (XDR *, gd1_mgmt_commit_op_req*);
@@ -237,6 +277,10 @@ extern bool_t xdr_gd1_mgmt_cluster_lock_req ();
 extern bool_t xdr_gd1_mgmt_cluster_lock_rsp ();
 extern bool_t xdr_gd1_mgmt_cluster_unlock_req ();
 extern bool_t xdr_gd1_mgmt_cluster_unlock_rsp ();
+extern bool_t xdr_gd1_mgmt_v2_cluster_lock_req ();
+extern bool_t xdr_gd1_mgmt_v2_cluster_unlock_req ();
+extern bool_t xdr_gd1_mgmt_v2_stage_op_req ();
+extern bool_t xdr_gd1_mgmt_v2_commit_op_req ();
 extern bool_t xdr_gd1_mgmt_stage_op_req ();
 extern bool_t xdr_gd1_mgmt_stage_op_rsp ();
 extern bool_t xdr_gd1_mgmt_commit_op_req ();
@@ -67,6 +67,34 @@ struct gd1_mgmt_cluster_unlock_rsp {
         int     op_errno;
 }  ;
 
+/* version 2 of the mgmt program: the transaction a request belongs to
+ * and the volume it locks, "" for the whole cluster */
+struct gd1_mgmt_v2_cluster_lock_req {
+        unsigned char  uuid[16];
+        unsigned char  txn_id[16];
+        string  volname<>;
+}  ;
+
+struct gd1_mgmt_v2_cluster_unlock_req {
+        unsigned char  uuid[16];
+        unsigned char  txn_id[16];
+        string  volname<>;
+}  ;
+
+struct gd1_mgmt_v2_stage_op_req {
+        unsigned char  uuid[16];
+        unsigned char  txn_id[16];
+        int     op;
+        opaque  buf<>;
+}  ;
+
+struct gd1_mgmt_v2_commit_op_req {
+        unsigned char  uuid[16];
+        unsigned char  txn_id[16];
+        int     op;
+        opaque  buf<>;
+}  ;
+
 struct gd1_mgmt_stage_op_req {
         unsigned char  uuid[16];
         int     op;
@@ -114,6 +114,34 @@ gd_xdr_to_mgmt_cluster_unlock_req (struct iovec inmsg, void *args)
                                (xdrproc_t)xdr_gd1_mgmt_cluster_unlock_req);
 }
 
+ssize_t
+gd_xdr_to_mgmt_v2_cluster_lock_req (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gd1_mgmt_v2_cluster_lock_req);
+}
+
+ssize_t
+gd_xdr_to_mgmt_v2_cluster_unlock_req (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gd1_mgmt_v2_cluster_unlock_req);
+}
+
+ssize_t
+gd_xdr_to_mgmt_v2_stage_op_req (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gd1_mgmt_v2_stage_op_req);
+}
+
+ssize_t
+gd_xdr_to_mgmt_v2_commit_op_req (struct iovec inmsg, void *args)
+{
+        return xdr_to_generic (inmsg, (void *)args,
+                               (xdrproc_t)xdr_gd1_mgmt_v2_commit_op_req);
+}
+
 ssize_t
 gd_xdr_to_mgmt_stage_op_req (struct iovec inmsg, void *args)
 {
@@ -218,6 +246,36 @@ gd_xdr_from_mgmt_cluster_unlock_req (struct iovec outmsg, void *req)
 
 }
 
+ssize_t
+gd_xdr_from_mgmt_v2_cluster_lock_req (struct iovec outmsg, void *req)
+{
+        return xdr_serialize_generic (outmsg, (void *)req,
+                                      (xdrproc_t)xdr_gd1_mgmt_v2_cluster_lock_req);
+
+}
+
+ssize_t
+gd_xdr_from_mgmt_v2_cluster_unlock_req (struct iovec outmsg, void *req)
+{
+        return xdr_serialize_generic (outmsg, (void *)req,
+                                      (xdrproc_t)xdr_gd1_mgmt_v2_cluster_unlock_req);
+
+}
+
+ssize_t
+gd_xdr_from_mgmt_v2_stage_op_req (struct iovec outmsg, void *req)
+{
+        return xdr_serialize_generic (outmsg, (void *)req,
+                                      (xdrproc_t)xdr_gd1_mgmt_v2_stage_op_req);
+}
+
+ssize_t
+gd_xdr_from_mgmt_v2_commit_op_req (struct iovec outmsg, void *req)
+{
+        return xdr_serialize_generic (outmsg, (void *)req,
+                                      (xdrproc_t)xdr_gd1_mgmt_v2_commit_op_req);
+}
+
 ssize_t
 gd_xdr_from_mgmt_stage_op_req (struct iovec outmsg, void *req)
 {
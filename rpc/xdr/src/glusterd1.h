@@ -74,6 +74,30 @@ gd_xdr_serialize_mgmt_cluster_unlock_rsp (struct iovec outmsg, void *rsp);
 ssize_t
 gd_xdr_from_mgmt_cluster_unlock_req (struct iovec outmsg, void *req);
 
+ssize_t
+gd_xdr_to_mgmt_v2_cluster_lock_req (struct iovec inmsg, void *args);
+
+ssize_t
+gd_xdr_from_mgmt_v2_cluster_lock_req (struct iovec outmsg, void *req);
+
+ssize_t
+gd_xdr_to_mgmt_v2_cluster_unlock_req (struct iovec inmsg, void *args);
+
+ssize_t
+gd_xdr_from_mgmt_v2_cluster_unlock_req (struct iovec outmsg, void *req);
+
+ssize_t
+gd_xdr_to_mgmt_v2_stage_op_req (struct iovec inmsg, void *args);
+
+ssize_t
+gd_xdr_from_mgmt_v2_stage_op_req (struct iovec outmsg, void *req);
+
+ssize_t
+gd_xdr_to_mgmt_v2_commit_op_req (struct iovec inmsg, void *args);
+
+ssize_t
+gd_xdr_from_mgmt_v2_commit_op_req (struct iovec outmsg, void *req);
+
 ssize_t
 gd_xdr_to_mgmt_stage_op_req (struct iovec inmsg, void *args);
 
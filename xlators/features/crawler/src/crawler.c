@@ -0,0 +1,829 @@
+/*
+  Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+/*
+ * features/crawler: once its subvolume comes up, looks up every entry in
+ * the volume so that the xlators below it on the bricks (marker's quota
+ * accounting, in particular) get to see each of them. Up to 'concurrency'
+ * directories are read at a time, each by its own synctask. Every
+ * 'checkpoint-interval' directories, the ones not yet finished are written
+ * to 'checkpoint-file', and a later crawl with the same file starts from
+ * them instead of from the root.
+ */
+
+#include <signal.h>
+
+#include "crawler.h"
+#include "defaults.h"
+#include "statedump.h"
+
+static void crawler_dispatch (xlator_t *this);
+
+static void
+crawler_dir_free (crawler_dir_t *dir)
+{
+        loc_wipe (&dir->loc);
+        GF_FREE (dir);
+}
+
+static int
+crawler_queue_path (xlator_t *this, const char *path)
+{
+        crawler_private_t *priv = NULL;
+        crawler_dir_t     *dir = NULL;
+
+        priv = this->private;
+
+        dir = GF_CALLOC (1, sizeof (*dir), gf_crawler_mt_dir_t);
+        if (!dir)
+                return -1;
+
+        INIT_LIST_HEAD (&dir->list);
+        dir->loc.path = gf_strdup (path);
+        if (!dir->loc.path) {
+                GF_FREE (dir);
+                return -1;
+        }
+
+        list_add_tail (&dir->list, &priv->pending);
+        LOCK (&priv->lock);
+        {
+                priv->queued++;
+        }
+        UNLOCK (&priv->lock);
+
+        return 0;
+}
+
+static int
+crawler_loc_child (loc_t *parent, loc_t *child, const char *name)
+{
+        int ret = -1;
+
+        if (!strcmp (parent->path, "/"))
+                ret = gf_asprintf ((char **)&child->path, "/%s", name);
+        else
+                ret = gf_asprintf ((char **)&child->path, "%s/%s",
+                                   parent->path, name);
+        if (ret < 0) {
+                child->path = NULL;
+                return -1;
+        }
+
+        child->name = strrchr (child->path, '/') + 1;
+        child->parent = inode_ref (parent->inode);
+        child->inode = inode_new (parent->inode->table);
+        if (!child->inode) {
+                loc_wipe (child);
+                return -1;
+        }
+
+        return 0;
+}
+
+static void
+crawler_loc_fill (loc_t *loc, struct iatt *iatt)
+{
+        loc->ino = iatt->ia_ino;
+        loc->inode->ino = iatt->ia_ino;
+        memcpy (loc->inode->gfid, iatt->ia_gfid, 16);
+}
+
+/* looks up each component of a directory read back from the checkpoint,
+ * so that it and its parents are known to the subvolume (dht needs the
+ * parent's layout) before it is opened.
+ */
+static int
+crawler_resolve (xlator_t *this, crawler_dir_t *dir, dict_t *xattr_req)
+{
+        crawler_private_t *priv = NULL;
+        loc_t              loc = {0, };
+        loc_t              child = {0, };
+        struct iatt        iatt = {0, };
+        struct iatt        parent = {0, };
+        char              *path = NULL;
+        char              *component = NULL;
+        char              *saveptr = NULL;
+        int                ret = -1;
+
+        priv = this->private;
+
+        path = gf_strdup (dir->loc.path);
+        loc.path = gf_strdup ("/");
+        if (!path || !loc.path)
+                goto out;
+        loc.name = "";
+        loc.ino = 1;
+        loc.inode = inode_ref (priv->itable->root);
+
+        ret = syncop_lookup (FIRST_CHILD (this), &loc, xattr_req, &iatt,
+                             NULL, &parent);
+        if (ret)
+                goto out;
+        crawler_loc_fill (&loc, &iatt);
+
+        for (component = strtok_r (path, "/", &saveptr); component;
+             component = strtok_r (NULL, "/", &saveptr)) {
+                ret = crawler_loc_child (&loc, &child, component);
+                if (ret)
+                        goto out;
+
+                loc_wipe (&loc);
+                loc = child;
+                memset (&child, 0, sizeof (child));
+
+                ret = syncop_lookup (FIRST_CHILD (this), &loc, xattr_req,
+                                     &iatt, NULL, &parent);
+                if (ret)
+                        goto out;
+                if (!IA_ISDIR (iatt.ia_type)) {
+                        errno = ENOTDIR;
+                        ret = -1;
+                        goto out;
+                }
+                crawler_loc_fill (&loc, &iatt);
+        }
+
+        loc_wipe (&dir->loc);
+        dir->loc = loc;
+        memset (&loc, 0, sizeof (loc));
+        dir->resolved = _gf_true;
+out:
+        loc_wipe (&loc);
+        if (path)
+                GF_FREE (path);
+
+        return ret;
+}
+
+static void
+crawler_entry (xlator_t *this, crawler_dir_t *parent, const char *name,
+               dict_t *xattr_req)
+{
+        crawler_private_t *priv = NULL;
+        crawler_dir_t     *dir = NULL;
+        loc_t              loc = {0, };
+        struct iatt        iatt = {0, };
+        struct iatt        postparent = {0, };
+        int                ret = -1;
+
+        priv = this->private;
+
+        ret = crawler_loc_child (&parent->loc, &loc, name);
+        if (ret)
+                goto err;
+
+        ret = syncop_lookup (FIRST_CHILD (this), &loc, xattr_req, &iatt,
+                             NULL, &postparent);
+        if (ret) {
+                /* removed since the readdir */
+                if (errno == ENOENT)
+                        goto out;
+                gf_log (this->name, GF_LOG_DEBUG, "lookup on %s failed (%s)",
+                        loc.path, strerror (errno));
+                goto err;
+        }
+        crawler_loc_fill (&loc, &iatt);
+
+        if (!IA_ISDIR (iatt.ia_type)) {
+                LOCK (&priv->lock);
+                {
+                        priv->files++;
+                }
+                UNLOCK (&priv->lock);
+                goto out;
+        }
+
+        dir = GF_CALLOC (1, sizeof (*dir), gf_crawler_mt_dir_t);
+        if (!dir)
+                goto err;
+
+        INIT_LIST_HEAD (&dir->list);
+        dir->loc = loc;
+        memset (&loc, 0, sizeof (loc));
+        dir->resolved = _gf_true;
+
+        /* depth first, which keeps the pending list (and the checkpoint)
+           short */
+        list_add (&dir->list, &priv->pending);
+        LOCK (&priv->lock);
+        {
+                priv->queued++;
+        }
+        UNLOCK (&priv->lock);
+
+        crawler_dispatch (this);
+        goto out;
+err:
+        LOCK (&priv->lock);
+        {
+                priv->errors++;
+        }
+        UNLOCK (&priv->lock);
+out:
+        loc_wipe (&loc);
+}
+
+/* a queued directory, possibly one from the checkpoint, that is not
+ * there any more has nothing left to crawl */
+static gf_boolean_t
+crawler_gone (int op_errno)
+{
+        return (op_errno == ENOENT || op_errno == ESTALE);
+}
+
+static int
+crawler_dir_task (void *data)
+{
+        xlator_t          *this = NULL;
+        call_frame_t      *frame = NULL;
+        crawler_dir_t     *dir = NULL;
+        dict_t            *xattr_req = NULL;
+        fd_t              *fd = NULL;
+        gf_dirent_t        entries;
+        gf_dirent_t       *entry = NULL;
+        off_t              offset = 0;
+        int                ret = -1;
+
+        this = THIS;
+        frame = data;
+        dir = frame->local;
+
+        INIT_LIST_HEAD (&entries.list);
+
+        /* marker only asks for its quota xattrs on lookups that carry a
+           dict to add them to */
+        xattr_req = dict_new ();
+        if (!xattr_req)
+                goto out;
+
+        if (!dir->resolved) {
+                ret = crawler_resolve (this, dir, xattr_req);
+                if (ret) {
+                        if (crawler_gone (errno)) {
+                                ret = 0;
+                                goto gone;
+                        }
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "lookup on %s failed (%s)", dir->loc.path,
+                                strerror (errno));
+                        goto out;
+                }
+        }
+
+        fd = fd_create (dir->loc.inode, frame->root->pid);
+        if (!fd) {
+                ret = -1;
+                goto out;
+        }
+
+        ret = syncop_opendir (FIRST_CHILD (this), &dir->loc, fd);
+        if (ret) {
+                if (crawler_gone (errno)) {
+                        ret = 0;
+                        goto gone;
+                }
+                gf_log (this->name, GF_LOG_WARNING,
+                        "opendir on %s failed (%s)", dir->loc.path,
+                        strerror (errno));
+                goto out;
+        }
+
+        while ((ret = syncop_readdirp (FIRST_CHILD (this), fd,
+                                       CRAWLER_READDIR_SIZE, offset,
+                                       &entries)) > 0) {
+                list_for_each_entry (entry, &entries.list, list) {
+                        offset = entry->d_off;
+                        if (!strcmp (entry->d_name, ".") ||
+                            !strcmp (entry->d_name, ".."))
+                                continue;
+
+                        crawler_entry (this, dir, entry->d_name, xattr_req);
+                }
+                gf_dirent_free (&entries);
+        }
+
+        if (ret < 0)
+                gf_log (this->name, GF_LOG_WARNING,
+                        "readdir on %s failed (%s)", dir->loc.path,
+                        strerror (errno));
+        goto out;
+gone:
+        gf_log (this->name, GF_LOG_DEBUG, "%s was removed since it was "
+                "queued", dir->loc.path);
+out:
+        gf_dirent_free (&entries);
+        if (fd)
+                fd_unref (fd);
+        if (xattr_req)
+                dict_unref (xattr_req);
+
+        return ret;
+}
+
+static void
+crawler_checkpoint_write (FILE *fp, struct list_head *head)
+{
+        crawler_dir_t *dir = NULL;
+
+        list_for_each_entry (dir, head, list)
+                fprintf (fp, "%s\n", dir->loc.path);
+}
+
+/* saves every directory that has not been finished: the ones being read
+ * now are read again in full by the next crawl.
+ */
+static int
+crawler_checkpoint (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+        char               tmpfile[PATH_MAX] = {0,};
+        FILE              *fp = NULL;
+        int                ret = -1;
+
+        priv = this->private;
+
+        if (!priv->checkpoint_file)
+                return 0;
+
+        snprintf (tmpfile, sizeof (tmpfile), "%s.tmp",
+                  priv->checkpoint_file);
+
+        fp = fopen (tmpfile, "w");
+        if (!fp) {
+                gf_log (this->name, GF_LOG_ERROR, "cannot open %s (%s)",
+                        tmpfile, strerror (errno));
+                goto out;
+        }
+
+        crawler_checkpoint_write (fp, &priv->active);
+        crawler_checkpoint_write (fp, &priv->pending);
+        crawler_checkpoint_write (fp, &priv->failed);
+
+        ret = fflush (fp);
+        if (!ret)
+                ret = fsync (fileno (fp));
+        if (fclose (fp) && !ret)
+                ret = -1;
+        if (!ret)
+                ret = rename (tmpfile, priv->checkpoint_file);
+        if (ret) {
+                gf_log (this->name, GF_LOG_ERROR, "cannot write %s (%s)",
+                        priv->checkpoint_file, strerror (errno));
+                unlink (tmpfile);
+                goto out;
+        }
+
+        LOCK (&priv->lock);
+        {
+                gf_log (this->name, GF_LOG_INFO, "crawled %"PRIu64
+                        " directories and %"PRIu64" files in %ld seconds, "
+                        "%"PRIu64" directories pending, %"PRIu64" errors",
+                        priv->dirs, priv->files,
+                        (long)(time (NULL) - priv->start_time),
+                        priv->queued + priv->inflight, priv->errors);
+        }
+        UNLOCK (&priv->lock);
+out:
+        return ret;
+}
+
+static void
+crawler_finish (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+
+        priv = this->private;
+
+        if (priv->complete)
+                return;
+        priv->complete = _gf_true;
+
+        if (list_empty (&priv->pending) && list_empty (&priv->failed)) {
+                if (priv->checkpoint_file)
+                        unlink (priv->checkpoint_file);
+                gf_log (this->name, GF_LOG_INFO, "crawl complete: %"PRIu64
+                        " directories and %"PRIu64" files in %ld seconds",
+                        priv->dirs, priv->files,
+                        (long)(time (NULL) - priv->start_time));
+        } else {
+                crawler_checkpoint (this);
+                gf_log (this->name, GF_LOG_WARNING, "crawl incomplete after "
+                        "%"PRIu64" errors, unfinished directories are saved "
+                        "in %s", priv->errors,
+                        priv->checkpoint_file ? priv->checkpoint_file :
+                        "(no checkpoint-file)");
+        }
+
+        if (priv->exit_on_completion)
+                kill (getpid (), SIGTERM);
+}
+
+static int
+crawler_dir_task_done (int ret, void *data)
+{
+        xlator_t          *this = NULL;
+        crawler_private_t *priv = NULL;
+        call_frame_t      *frame = NULL;
+        crawler_dir_t     *dir = NULL;
+        gf_boolean_t       checkpoint = _gf_false;
+
+        this = THIS;
+        priv = this->private;
+        frame = data;
+        dir = frame->local;
+
+        frame->local = NULL;
+        STACK_DESTROY (frame->root);
+
+        if (ret < 0) {
+                list_move_tail (&dir->list, &priv->failed);
+        } else {
+                list_del_init (&dir->list);
+                crawler_dir_free (dir);
+        }
+
+        LOCK (&priv->lock);
+        {
+                priv->inflight--;
+                if (ret < 0)
+                        priv->errors++;
+                else
+                        priv->dirs++;
+                if (++priv->since_checkpoint >= priv->checkpoint_interval) {
+                        priv->since_checkpoint = 0;
+                        checkpoint = _gf_true;
+                }
+        }
+        UNLOCK (&priv->lock);
+
+        if (checkpoint)
+                crawler_checkpoint (this);
+
+        crawler_dispatch (this);
+
+        return 0;
+}
+
+/* starts a task for each pending directory, up to 'concurrency' of them */
+static void
+crawler_dispatch (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+        crawler_dir_t     *dir = NULL;
+        call_frame_t      *frame = NULL;
+        int                ret = -1;
+
+        priv = this->private;
+
+        while ((priv->inflight < priv->concurrency) &&
+               !list_empty (&priv->pending)) {
+                frame = create_frame (this, this->ctx->pool);
+                if (!frame)
+                        break;
+
+                dir = list_entry (priv->pending.next, crawler_dir_t, list);
+                list_move_tail (&dir->list, &priv->active);
+                frame->local = dir;
+
+                LOCK (&priv->lock);
+                {
+                        priv->queued--;
+                        priv->inflight++;
+                }
+                UNLOCK (&priv->lock);
+
+                ret = synctask_new (priv->env, crawler_dir_task,
+                                    crawler_dir_task_done, frame);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "cannot start a task for %s", dir->loc.path);
+                        list_move (&dir->list, &priv->pending);
+                        LOCK (&priv->lock);
+                        {
+                                priv->queued++;
+                                priv->inflight--;
+                        }
+                        UNLOCK (&priv->lock);
+                        frame->local = NULL;
+                        STACK_DESTROY (frame->root);
+                        break;
+                }
+        }
+
+        if (!priv->inflight)
+                crawler_finish (this);
+}
+
+static int
+crawler_load_checkpoint (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+        FILE              *fp = NULL;
+        char               line[PATH_MAX + 1] = {0,};
+        size_t             len = 0;
+        int                ret = 0;
+
+        priv = this->private;
+
+        fp = fopen (priv->checkpoint_file, "r");
+        if (!fp) {
+                if (errno == ENOENT)
+                        return 0;
+                gf_log (this->name, GF_LOG_ERROR, "cannot open %s (%s)",
+                        priv->checkpoint_file, strerror (errno));
+                return -1;
+        }
+
+        while (fgets (line, sizeof (line), fp)) {
+                len = strlen (line);
+                if (len && line[len - 1] == '\n')
+                        line[--len] = '\0';
+                if (line[0] != '/')
+                        continue;
+
+                ret = crawler_queue_path (this, line);
+                if (ret)
+                        break;
+                priv->resumed++;
+        }
+
+        fclose (fp);
+
+        return ret;
+}
+
+static int
+crawler_start_task (void *data)
+{
+        xlator_t          *this = NULL;
+        crawler_private_t *priv = NULL;
+
+        this = THIS;
+        priv = this->private;
+
+        if (priv->checkpoint_file)
+                crawler_load_checkpoint (this);
+
+        if (priv->resumed)
+                gf_log (this->name, GF_LOG_INFO, "resuming crawl from %"
+                        PRIu64" directories saved in %s", priv->resumed,
+                        priv->checkpoint_file);
+        else if (crawler_queue_path (this, "/"))
+                gf_log (this->name, GF_LOG_ERROR, "out of memory");
+
+        crawler_dispatch (this);
+
+        return 0;
+}
+
+static int
+crawler_start_task_done (int ret, void *data)
+{
+        call_frame_t *frame = NULL;
+
+        frame = data;
+        STACK_DESTROY (frame->root);
+
+        return 0;
+}
+
+static int
+crawler_start (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+        call_frame_t      *frame = NULL;
+        int                ret = -1;
+
+        priv = this->private;
+
+        frame = create_frame (this, this->ctx->pool);
+        if (!frame)
+                goto out;
+
+        priv->start_time = time (NULL);
+
+        ret = synctask_new (priv->env, crawler_start_task,
+                            crawler_start_task_done, frame);
+        if (ret) {
+                STACK_DESTROY (frame->root);
+                goto out;
+        }
+out:
+        if (ret)
+                gf_log (this->name, GF_LOG_ERROR, "cannot start the crawl");
+        return ret;
+}
+
+int
+notify (xlator_t *this, int32_t event, void *data, ...)
+{
+        crawler_private_t *priv = NULL;
+        gf_boolean_t       start = _gf_false;
+
+        priv = this->private;
+
+        if (event == GF_EVENT_CHILD_UP) {
+                LOCK (&priv->lock);
+                {
+                        start = !priv->started;
+                        priv->started = _gf_true;
+                }
+                UNLOCK (&priv->lock);
+
+                if (start)
+                        crawler_start (this);
+        }
+
+        return default_notify (this, event, data);
+}
+
+int
+crawler_priv_dump (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+        char               key_prefix[GF_DUMP_MAX_BUF_LEN];
+        char               key[GF_DUMP_MAX_BUF_LEN];
+
+        if (!this || !this->private)
+                goto out;
+
+        priv = this->private;
+        gf_proc_dump_build_key (key_prefix, "xlator.features.crawler",
+                                "priv");
+        gf_proc_dump_add_section (key_prefix);
+
+        LOCK (&priv->lock);
+        {
+                gf_proc_dump_build_key (key, key_prefix, "directories");
+                gf_proc_dump_write (key, "%"PRIu64, priv->dirs);
+                gf_proc_dump_build_key (key, key_prefix, "files");
+                gf_proc_dump_write (key, "%"PRIu64, priv->files);
+                gf_proc_dump_build_key (key, key_prefix, "errors");
+                gf_proc_dump_write (key, "%"PRIu64, priv->errors);
+                gf_proc_dump_build_key (key, key_prefix, "pending");
+                gf_proc_dump_write (key, "%"PRIu64, priv->queued);
+                gf_proc_dump_build_key (key, key_prefix, "inflight");
+                gf_proc_dump_write (key, "%d", priv->inflight);
+                gf_proc_dump_build_key (key, key_prefix, "resumed");
+                gf_proc_dump_write (key, "%"PRIu64, priv->resumed);
+                gf_proc_dump_build_key (key, key_prefix, "elapsed");
+                gf_proc_dump_write (key, "%ld", priv->start_time ?
+                                    (long)(time (NULL) - priv->start_time) :
+                                    0L);
+                gf_proc_dump_build_key (key, key_prefix, "complete");
+                gf_proc_dump_write (key, "%d", priv->complete);
+        }
+        UNLOCK (&priv->lock);
+out:
+        return 0;
+}
+
+int32_t
+mem_acct_init (xlator_t *this)
+{
+        int     ret = -1;
+
+        ret = xlator_mem_acct_init (this, gf_crawler_mt_end + 1);
+
+        return ret;
+}
+
+int
+init (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+        char              *str = NULL;
+        int                ret = -1;
+
+        if (!this->children || this->children->next) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "'crawler' not configured with exactly one child");
+                goto out;
+        }
+
+        priv = GF_CALLOC (1, sizeof (*priv), gf_crawler_mt_priv_t);
+        if (!priv)
+                goto out;
+
+        LOCK_INIT (&priv->lock);
+        INIT_LIST_HEAD (&priv->pending);
+        INIT_LIST_HEAD (&priv->active);
+        INIT_LIST_HEAD (&priv->failed);
+
+        priv->concurrency = CRAWLER_DEFAULT_CONCURRENCY;
+        if (dict_get (this->options, "concurrency"))
+                priv->concurrency = data_to_int32 (dict_get (this->options,
+                                                             "concurrency"));
+        if (priv->concurrency < 1)
+                priv->concurrency = 1;
+        if (priv->concurrency > CRAWLER_MAX_CONCURRENCY)
+                priv->concurrency = CRAWLER_MAX_CONCURRENCY;
+
+        priv->checkpoint_interval = CRAWLER_DEFAULT_CHECKPOINT_INTERVAL;
+        if (dict_get (this->options, "checkpoint-interval"))
+                priv->checkpoint_interval =
+                        data_to_uint64 (dict_get (this->options,
+                                                  "checkpoint-interval"));
+        if (!priv->checkpoint_interval)
+                priv->checkpoint_interval = 1;
+
+        if (!dict_get_str (this->options, "checkpoint-file", &str)) {
+                priv->checkpoint_file = gf_strdup (str);
+                if (!priv->checkpoint_file)
+                        goto out;
+        }
+
+        if (!dict_get_str (this->options, "exit-on-completion", &str) &&
+            gf_string2boolean (str, &priv->exit_on_completion)) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "invalid value '%s' for exit-on-completion", str);
+                goto out;
+        }
+
+        priv->itable = inode_table_new (0, this);
+        if (!priv->itable)
+                goto out;
+
+        priv->env = syncenv_new (0);
+        if (!priv->env)
+                goto out;
+
+        this->private = priv;
+        ret = 0;
+out:
+        if (ret && priv) {
+                if (priv->checkpoint_file)
+                        GF_FREE (priv->checkpoint_file);
+                GF_FREE (priv);
+        }
+
+        return ret;
+}
+
+void
+fini (xlator_t *this)
+{
+        crawler_private_t *priv = NULL;
+
+        priv = this->private;
+        if (!priv)
+                goto out;
+
+        /* the syncenv and inode table have no teardown of their own and
+           go away with the process */
+        this->private = NULL;
+out:
+        return;
+}
+
+struct xlator_fops fops = {
+};
+
+struct xlator_cbks cbks = {
+};
+
+struct xlator_dumpops dumpops = {
+        .priv        = crawler_priv_dump,
+};
+
+struct volume_options options[] = {
+        { .key  = {"concurrency"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = CRAWLER_MAX_CONCURRENCY
+        },
+        { .key  = {"checkpoint-file"},
+          .type = GF_OPTION_TYPE_PATH
+        },
+        { .key  = {"checkpoint-interval"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = 0x7fffffff
+        },
+        { .key  = {"exit-on-completion"},
+          .type = GF_OPTION_TYPE_BOOL
+        },
+        { .key  = {NULL} },
+};
@@ -0,0 +1,72 @@
+/*
+   Copyright (c) 2011 Gluster, Inc. <http://www.gluster.com>
+   This file is part of GlusterFS.
+
+   GlusterFS is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as published
+   by the Free Software Foundation; either version 3 of the License,
+   or (at your option) any later version.
+
+   GlusterFS is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Affero General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program.  If not, see
+   <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __CRAWLER_H__
+#define __CRAWLER_H__
+
+#include "crawler-mem-types.h"
+#include "xlator.h"
+#include "syncop.h"
+
+#define CRAWLER_READDIR_SIZE                 131072
+#define CRAWLER_DEFAULT_CONCURRENCY          16
+#define CRAWLER_MAX_CONCURRENCY              256
+#define CRAWLER_DEFAULT_CHECKPOINT_INTERVAL  1000
+
+/* a directory waiting to be, or being, read. @resolved is set once @loc
+ * has been looked up through its parent and can be opened directly.
+ */
+typedef struct {
+        struct list_head  list;
+        loc_t             loc;
+        gf_boolean_t      resolved;
+} crawler_dir_t;
+
+/* The pending, active and failed lists are only touched from the syncenv
+ * thread, where every directory task and its completion runs; the lock
+ * guards the counters, which statedump reads from elsewhere.
+ */
+typedef struct {
+        gf_lock_t         lock;
+        struct syncenv   *env;
+        inode_table_t    *itable;
+
+        struct list_head  pending;
+        struct list_head  active;
+        struct list_head  failed;
+        int               inflight;
+        int               concurrency;
+
+        char             *checkpoint_file;
+        uint64_t          checkpoint_interval;
+        uint64_t          since_checkpoint;
+        gf_boolean_t      exit_on_completion;
+        gf_boolean_t      started;
+        gf_boolean_t      complete;
+
+        time_t            start_time;
+        uint64_t          resumed;
+        uint64_t          queued;
+        uint64_t          dirs;
+        uint64_t          files;
+        uint64_t          errors;
+} crawler_private_t;
+
+#endif
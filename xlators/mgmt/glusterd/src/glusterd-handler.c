@@ -404,19 +404,25 @@ glusterd_op_txn_begin ()
         int32_t                 ret = -1;
         glusterd_conf_t         *priv = NULL;
         int32_t                 locked = 0;
+        glusterd_op_info_t      *txn = NULL;
 
         priv = THIS->private;
         GF_ASSERT (priv);
 
-        ret = glusterd_lock (priv->uuid);
+        ret = glusterd_scoped_lock (glusterd_op_get_lock_volname (),
+                                    priv->uuid);
 
         if (ret) {
                 gf_log ("glusterd", GF_LOG_ERROR,
                         "Unable to acquire local lock, ret: %d", ret);
+                glusterd_op_clear_lock_volname ();
                 goto out;
         }
 
         locked = 1;
+        txn = glusterd_op_txn_get ();
+        txn->locked = _gf_true;
+        uuid_copy (txn->lock_owner, priv->uuid);
         gf_log ("glusterd", GF_LOG_INFO, "Acquired local lock");
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_START_LOCK, NULL);
@@ -424,41 +430,48 @@ glusterd_op_txn_begin ()
         gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
 
 out:
-        if (locked && ret)
-                glusterd_unlock (priv->uuid);
+        if (locked && ret) {
+                glusterd_scoped_unlock (glusterd_op_get_lock_volname (),
+                                        priv->uuid);
+                glusterd_op_clear_lock_volname ();
+                txn->locked = _gf_false;
+        }
         return ret;
 }
 
-int
-glusterd_handle_cluster_lock (rpcsvc_request_t *req)
+/* Queues the LOCK of txn_id on volname, the cluster if NULL or "". */
+static int
+__glusterd_handle_cluster_lock (rpcsvc_request_t *req, uuid_t uuid,
+                                uuid_t txn_id, char *volname)
 {
-        gd1_mgmt_cluster_lock_req       lock_req = {{0},};
         int32_t                         ret = -1;
         glusterd_op_lock_ctx_t          *ctx = NULL;
 
-        GF_ASSERT (req);
-
-        if (!gd_xdr_to_mgmt_cluster_lock_req (req->msg[0], &lock_req)) {
-                //failed to decode msg;
-                req->rpc_err = GARBAGE_ARGS;
-                goto out;
-        }
-
         gf_log ("glusterd", GF_LOG_INFO,
-                "Received LOCK from uuid: %s", uuid_utoa (lock_req.uuid));
-
+                "Received LOCK on %s from uuid: %s",
+                (volname && *volname) ? volname : "cluster",
+                uuid_utoa (uuid));
 
         ctx = GF_CALLOC (1, sizeof (*ctx), gf_gld_mt_op_lock_ctx_t);
 
         if (!ctx) {
                 //respond here
-                return -1;
+                ret = -1;
+                goto out;
         }
 
-        uuid_copy (ctx->uuid, lock_req.uuid);
+        uuid_copy (ctx->uuid, uuid);
         ctx->req = req;
+        if (volname && *volname) {
+                ctx->volname = gf_strdup (volname);
+                if (!ctx->volname) {
+                        GF_FREE (ctx);
+                        ret = -1;
+                        goto out;
+                }
+        }
 
-        ret = glusterd_op_sm_inject_event (GD_OP_EVENT_LOCK, ctx);
+        ret = glusterd_op_sm_inject_txn_event (GD_OP_EVENT_LOCK, txn_id, ctx);
 
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
@@ -469,6 +482,53 @@ out:
         return ret;
 }
 
+/* LOCK from a peer of mgmt version 1. It runs a single transaction at a
+ * time under the cluster lock, its uuid stands for the txn id.
+ */
+int
+glusterd_handle_cluster_lock (rpcsvc_request_t *req)
+{
+        gd1_mgmt_cluster_lock_req       lock_req = {{0},};
+        int32_t                         ret = -1;
+
+        GF_ASSERT (req);
+
+        if (!gd_xdr_to_mgmt_cluster_lock_req (req->msg[0], &lock_req)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        ret = __glusterd_handle_cluster_lock (req, lock_req.uuid,
+                                              lock_req.uuid, NULL);
+out:
+        return ret;
+}
+
+int
+glusterd_handle_cluster_lock_v2 (rpcsvc_request_t *req)
+{
+        gd1_mgmt_v2_cluster_lock_req    lock_req = {{0},};
+        int32_t                         ret = -1;
+
+        GF_ASSERT (req);
+
+        if (!gd_xdr_to_mgmt_v2_cluster_lock_req (req->msg[0], &lock_req)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        ret = __glusterd_handle_cluster_lock (req, lock_req.uuid,
+                                              lock_req.txn_id,
+                                              lock_req.volname);
+out:
+        if (lock_req.volname)
+                free (lock_req.volname); //malloced by xdr
+
+        return ret;
+}
+
 int
 glusterd_req_ctx_create (rpcsvc_request_t *rpc_req,
                          glusterd_op_t op, uuid_t uuid,
@@ -536,11 +596,57 @@ out:
         return ret;
 }
 
+/* Queues the STAGE_OP of txn_id, the payload is owned by the caller. */
+static int
+__glusterd_handle_stage_op (rpcsvc_request_t *req, uuid_t uuid,
+                            uuid_t txn_id, int op, char *buf_val,
+                            size_t buf_len)
+{
+        int32_t                         ret = -1;
+        glusterd_req_ctx_t              *req_ctx = NULL;
+
+        ret = glusterd_req_ctx_create (req, op, uuid, buf_val, buf_len,
+                                       gf_gld_mt_op_stage_ctx_t, &req_ctx);
+        if (ret)
+                goto out;
+
+        uuid_copy (req_ctx->txn_id, txn_id);
+        ret = glusterd_op_sm_inject_txn_event (GD_OP_EVENT_STAGE_OP,
+                                               txn_id, req_ctx);
+out:
+        glusterd_friend_sm ();
+        glusterd_op_sm ();
+        return ret;
+}
+
+/* Queues the COMMIT_OP of txn_id, the payload is owned by the caller. */
+static int
+__glusterd_handle_commit_op (rpcsvc_request_t *req, uuid_t uuid,
+                             uuid_t txn_id, int op, char *buf_val,
+                             size_t buf_len)
+{
+        int32_t                         ret = -1;
+        glusterd_req_ctx_t              *req_ctx = NULL;
+
+        ret = glusterd_req_ctx_create (req, op, uuid, buf_val, buf_len,
+                                       gf_gld_mt_op_commit_ctx_t, &req_ctx);
+        if (ret)
+                goto out;
+
+        uuid_copy (req_ctx->txn_id, txn_id);
+        ret = glusterd_op_sm_inject_txn_event (GD_OP_EVENT_COMMIT_OP,
+                                               txn_id, req_ctx);
+out:
+        glusterd_friend_sm ();
+        glusterd_op_sm ();
+        return ret;
+}
+
+/* STAGE_OP from a peer of mgmt version 1, of the txn its LOCK started. */
 int
 glusterd_handle_stage_op (rpcsvc_request_t *req)
 {
         int32_t                         ret = -1;
-        glusterd_req_ctx_t              *req_ctx = NULL;
         gd1_mgmt_stage_op_req           op_req = {{0},};
 
         GF_ASSERT (req);
@@ -550,27 +656,42 @@ glusterd_handle_stage_op (rpcsvc_request_t *req)
                 goto out;
         }
 
-        ret = glusterd_req_ctx_create (req, op_req.op, op_req.uuid,
-                                       op_req.buf.buf_val, op_req.buf.buf_len,
-                                       gf_gld_mt_op_stage_ctx_t, &req_ctx);
-        if (ret)
-                goto out;
+        ret = __glusterd_handle_stage_op (req, op_req.uuid, op_req.uuid,
+                                          op_req.op, op_req.buf.buf_val,
+                                          op_req.buf.buf_len);
+ out:
+        if (op_req.buf.buf_val)
+                free (op_req.buf.buf_val);//malloced by xdr
+        return ret;
+}
 
-        ret = glusterd_op_sm_inject_event (GD_OP_EVENT_STAGE_OP, req_ctx);
+int
+glusterd_handle_stage_op_v2 (rpcsvc_request_t *req)
+{
+        int32_t                         ret = -1;
+        gd1_mgmt_v2_stage_op_req        op_req = {{0},};
+
+        GF_ASSERT (req);
+        if (!gd_xdr_to_mgmt_v2_stage_op_req (req->msg[0], &op_req)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
 
+        ret = __glusterd_handle_stage_op (req, op_req.uuid, op_req.txn_id,
+                                          op_req.op, op_req.buf.buf_val,
+                                          op_req.buf.buf_len);
  out:
         if (op_req.buf.buf_val)
                 free (op_req.buf.buf_val);//malloced by xdr
-        glusterd_friend_sm ();
-        glusterd_op_sm ();
         return ret;
 }
 
+/* COMMIT_OP from a peer of mgmt version 1, of the txn its LOCK started. */
 int
 glusterd_handle_commit_op (rpcsvc_request_t *req)
 {
         int32_t                         ret = -1;
-        glusterd_req_ctx_t              *req_ctx = NULL;
         gd1_mgmt_commit_op_req          op_req = {{0},};
 
         GF_ASSERT (req);
@@ -583,24 +704,38 @@ glusterd_handle_commit_op (rpcsvc_request_t *req)
 
         //the structures should always be equal
         GF_ASSERT (sizeof (gd1_mgmt_commit_op_req) == sizeof (gd1_mgmt_stage_op_req));
-        ret = glusterd_req_ctx_create (req, op_req.op, op_req.uuid,
-                                       op_req.buf.buf_val, op_req.buf.buf_len,
-                                       gf_gld_mt_op_commit_ctx_t, &req_ctx);
-        if (ret)
-                goto out;
+        ret = __glusterd_handle_commit_op (req, op_req.uuid, op_req.uuid,
+                                           op_req.op, op_req.buf.buf_val,
+                                           op_req.buf.buf_len);
+out:
+        if (op_req.buf.buf_val)
+                free (op_req.buf.buf_val);//malloced by xdr
+        return ret;
+}
 
-        ret = glusterd_op_sm_inject_event (GD_OP_EVENT_COMMIT_OP, req_ctx);
-        if (ret)
+int
+glusterd_handle_commit_op_v2 (rpcsvc_request_t *req)
+{
+        int32_t                         ret = -1;
+        gd1_mgmt_v2_commit_op_req       op_req = {{0},};
+
+        GF_ASSERT (req);
+
+        if (!gd_xdr_to_mgmt_v2_commit_op_req (req->msg[0], &op_req)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
                 goto out;
-        ret = glusterd_op_init_ctx (op_req.op);
+        }
 
+        ret = __glusterd_handle_commit_op (req, op_req.uuid, op_req.txn_id,
+                                           op_req.op, op_req.buf.buf_val,
+                                           op_req.buf.buf_len);
 out:
         if (op_req.buf.buf_val)
                 free (op_req.buf.buf_val);//malloced by xdr
-        glusterd_friend_sm ();
-        glusterd_op_sm ();
         return ret;
 }
+
 int
 glusterd_handle_cli_probe (rpcsvc_request_t *req)
 {
@@ -838,8 +973,13 @@ glusterd_op_begin (rpcsvc_request_t *req, glusterd_op_t op, void *ctx,
         glusterd_op_set_ctx_free (op, is_ctx_free);
         glusterd_op_set_req (req);
 
+        ret = glusterd_op_set_lock_volname (op, ctx);
+        if (ret)
+                goto out;
+
         ret = glusterd_op_txn_begin ();
 
+out:
         return ret;
 }
 
@@ -1968,6 +2108,80 @@ out:
         return ret;
 }
 
+/* A batch of volume set, start and stop operations, see
+ * glusterd_op_stage_batch ().
+ */
+int
+glusterd_handle_batch_volume (rpcsvc_request_t *req)
+{
+        int32_t                         ret = -1;
+        gf1_cli_batch_vol_req           cli_req = {0,};
+        dict_t                          *dict = NULL;
+        int                             lock_fail = 0;
+        int32_t                         count = 0;
+        glusterd_op_t                   cli_op = GD_OP_BATCH;
+
+        GF_ASSERT (req);
+
+        ret = glusterd_op_set_cli_op (cli_op);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "Unable to set cli op: %d",
+                        ret);
+                lock_fail = 1;
+                goto out;
+        }
+
+        ret = -1;
+        if (!gf_xdr_to_cli_batch_vol_req (req->msg[0], &cli_req)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        dict = dict_new ();
+        if (!dict)
+                goto out;
+
+        ret = dict_unserialize (cli_req.dict.dict_val, cli_req.dict.dict_len,
+                                &dict);
+        if (ret < 0) {
+                gf_log ("glusterd", GF_LOG_ERROR, "failed to "
+                        "unserialize req-buffer to dictionary");
+                goto out;
+        }
+        dict->extra_stdfree = cli_req.dict.dict_val;
+
+        ret = dict_get_int32 (dict, "count", &count);
+        if (ret || (count <= 0) || (count > GLUSTERD_BATCH_MAX)) {
+                gf_log ("", GF_LOG_WARNING, "Invalid number of entries "
+                        "in volume batch: %d", count);
+                ret = -1;
+                goto out;
+        }
+
+        gf_log ("glusterd", GF_LOG_INFO, "Received volume batch req with "
+                "%d entries", count);
+
+        gf_cmd_log ("volume batch", "entries:%d", count);
+        ret = glusterd_op_begin (req, GD_OP_BATCH, dict, _gf_true);
+        gf_cmd_log ("volume batch", "entries:%d %s", count,
+                    (ret == 0) ? "SUCCEDED" : "FAILED");
+
+out:
+        glusterd_friend_sm ();
+        glusterd_op_sm ();
+
+        if (ret) {
+                if (dict)
+                        dict_unref (dict);
+                ret = glusterd_op_send_cli_response (cli_op, ret, 0, req,
+                                                     NULL, "operation failed");
+                if (!lock_fail)
+                        (void) glusterd_opinfo_unlock ();
+        }
+        return ret;
+}
+
 int
 glusterd_handle_remove_brick (rpcsvc_request_t *req)
 {
@@ -2684,6 +2898,64 @@ out:
         return 0;//send 0 to avoid double reply
 }
 
+int
+glusterd_handle_txn_stats (rpcsvc_request_t *req)
+{
+        int32_t                         ret = -1;
+        gf1_cli_txn_stats_req           cli_req = {0,};
+        gf1_cli_txn_stats_rsp           rsp = {0,};
+        dict_t                          *dict = NULL;
+        glusterd_conf_t                 *conf = NULL;
+        size_t                          len = 0;
+        char                            msg[2048] = {0};
+
+        GF_ASSERT (req);
+
+        conf = THIS->private;
+
+        if (!gf_xdr_to_cli_txn_stats_req (req->msg[0], &cli_req)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
+                snprintf (msg, sizeof (msg), "Garbage request");
+                goto out;
+        }
+
+        gf_log ("glusterd", GF_LOG_INFO, "Received txn-stats req%s",
+                (cli_req.flags & GF_CLI_TXN_STATS_RESET) ? " with reset" : "");
+
+        dict = dict_new ();
+        if (!dict)
+                goto out;
+
+        ret = glusterd_txn_stats_to_dict (conf, dict,
+                                          (cli_req.flags &
+                                           GF_CLI_TXN_STATS_RESET));
+        if (ret) {
+                snprintf (msg, sizeof (msg), "Unable to get the transaction "
+                          "stats");
+                goto out;
+        }
+
+        ret = dict_allocate_and_serialize (dict, &rsp.stats.stats_val, &len);
+        rsp.stats.stats_len = len;
+out:
+        rsp.op_ret = ret;
+        rsp.op_errstr = msg;
+        ret = glusterd_submit_reply (req, &rsp, NULL, 0, NULL,
+                                     gf_xdr_from_cli_txn_stats_rsp);
+        if (rsp.stats.stats_val)
+                GF_FREE (rsp.stats.stats_val);
+        if (dict)
+                dict_unref (dict);
+
+        gf_log ("glusterd", GF_LOG_DEBUG, "Responded, ret: %d", ret);
+
+        glusterd_friend_sm ();
+        glusterd_op_sm ();
+
+        return 0;//send 0 to avoid double reply
+}
+
 int
 glusterd_op_lock_send_resp (rpcsvc_request_t *req, int32_t status)
 {
@@ -2724,12 +2996,53 @@ glusterd_op_unlock_send_resp (rpcsvc_request_t *req, int32_t status)
         return ret;
 }
 
+/* Queues the UNLOCK of txn_id on volname, the cluster if NULL or "". */
+static int
+__glusterd_handle_cluster_unlock (rpcsvc_request_t *req, uuid_t uuid,
+                                  uuid_t txn_id, char *volname)
+{
+        int32_t                         ret = -1;
+        glusterd_op_lock_ctx_t          *ctx = NULL;
+
+        gf_log ("glusterd", GF_LOG_INFO,
+                "Received UNLOCK on %s from uuid: %s",
+                (volname && *volname) ? volname : "cluster",
+                uuid_utoa (uuid));
+
+        ctx = GF_CALLOC (1, sizeof (*ctx), gf_gld_mt_op_lock_ctx_t);
+
+        if (!ctx) {
+                //respond here
+                ret = -1;
+                goto out;
+        }
+        uuid_copy (ctx->uuid, uuid);
+        ctx->req = req;
+        if (volname && *volname) {
+                ctx->volname = gf_strdup (volname);
+                if (!ctx->volname) {
+                        GF_FREE (ctx);
+                        ret = -1;
+                        goto out;
+                }
+        }
+
+        ret = glusterd_op_sm_inject_txn_event (GD_OP_EVENT_UNLOCK, txn_id,
+                                               ctx);
+
+out:
+        glusterd_friend_sm ();
+        glusterd_op_sm ();
+
+        return ret;
+}
+
+/* UNLOCK from a peer of mgmt version 1, see glusterd_handle_cluster_lock */
 int
 glusterd_handle_cluster_unlock (rpcsvc_request_t *req)
 {
         gd1_mgmt_cluster_unlock_req     unlock_req = {{0}, };
         int32_t                         ret = -1;
-        glusterd_op_lock_ctx_t          *ctx = NULL;
 
         GF_ASSERT (req);
 
@@ -2739,24 +3052,33 @@ glusterd_handle_cluster_unlock (rpcsvc_request_t *req)
                 goto out;
         }
 
+        ret = __glusterd_handle_cluster_unlock (req, unlock_req.uuid,
+                                                unlock_req.uuid, NULL);
+out:
+        return ret;
+}
 
-        gf_log ("glusterd", GF_LOG_INFO,
-                "Received UNLOCK from uuid: %s", uuid_utoa (unlock_req.uuid));
+int
+glusterd_handle_cluster_unlock_v2 (rpcsvc_request_t *req)
+{
+        gd1_mgmt_v2_cluster_unlock_req  unlock_req = {{0}, };
+        int32_t                         ret = -1;
 
-        ctx = GF_CALLOC (1, sizeof (*ctx), gf_gld_mt_op_lock_ctx_t);
+        GF_ASSERT (req);
 
-        if (!ctx) {
-                //respond here
-                return -1;
+        if (!gd_xdr_to_mgmt_v2_cluster_unlock_req (req->msg[0],
+                                                   &unlock_req)) {
+                //failed to decode msg;
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
         }
-        uuid_copy (ctx->uuid, unlock_req.uuid);
-        ctx->req = req;
-
-        ret = glusterd_op_sm_inject_event (GD_OP_EVENT_UNLOCK, ctx);
 
+        ret = __glusterd_handle_cluster_unlock (req, unlock_req.uuid,
+                                                unlock_req.txn_id,
+                                                unlock_req.volname);
 out:
-        glusterd_friend_sm ();
-        glusterd_op_sm ();
+        if (unlock_req.volname)
+                free (unlock_req.volname); //malloced by xdr
 
         return ret;
 }
@@ -2936,6 +3258,30 @@ out:
         return ret;
 }
 
+int
+glusterd_handle_friend_update_vols_req (glusterd_peerinfo_t *peerinfo,
+                                        dict_t *dict)
+{
+        dict_t                  *vols = NULL;
+        int32_t                 ret = -1;
+
+        GF_ASSERT (peerinfo);
+        GF_ASSERT (dict);
+
+        ret = glusterd_build_wanted_volume_dict (dict, &vols);
+        if (ret)
+                goto out;
+
+        ret = glusterd_send_friend_volumes_update (peerinfo, vols,
+                                                   GD_FRIEND_UPDATE_VOLS);
+
+out:
+        if (vols)
+                dict_unref (vols);
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
 int
 glusterd_friend_hostname_update (glusterd_peerinfo_t *peerinfo,
                                 char *hostname,
@@ -2955,6 +3301,8 @@ glusterd_friend_hostname_update (glusterd_peerinfo_t *peerinfo,
 
         GF_FREE (peerinfo->hostname);
         peerinfo->hostname = new_hostname;
+        glusterd_peerinfo_hash (peerinfo);
+        glusterd_resolve_cache_flush (THIS->private);
         if (store_update)
                 ret = glusterd_store_peerinfo (peerinfo);
 out:
@@ -3034,6 +3382,16 @@ glusterd_handle_friend_update (rpcsvc_request_t *req)
                 goto out;
         }
 
+        if (GD_FRIEND_UPDATE_VOLS_REQ == op) {
+                ret = glusterd_handle_friend_update_vols_req (tmp, dict);
+                goto out;
+        }
+
+        if (GD_FRIEND_UPDATE_VOLS == op) {
+                ret = glusterd_import_friend_volumes_update_nfs (dict);
+                goto out;
+        }
+
         args.mode = GD_MODE_ON;
         while ( i <= count) {
                 snprintf (key, sizeof (key), "friend%d.uuid", i);
@@ -3443,6 +3801,7 @@ glusterd_friend_add (const char *hoststr, int port,
                 ret = glusterd_store_peerinfo (peerinfo);
 
         list_add_tail (&peerinfo->uuid_list, &conf->peers);
+        glusterd_peerinfo_hash (peerinfo);
 
 out:
         if (ret) {
@@ -3746,6 +4105,8 @@ glusterd_get_volumes (rpcsvc_request_t *req, dict_t *dict, int32_t flags)
         dict_t                  *volumes = NULL;
         gf1_cli_get_vol_rsp     rsp = {0,};
         char                    *volname = NULL;
+        int32_t                 max_count = 0;
+        int32_t                 more = 0;
 
         priv = THIS->private;
         GF_ASSERT (priv);
@@ -3773,26 +4134,30 @@ glusterd_get_volumes (rpcsvc_request_t *req, dict_t *dict, int32_t flags)
                 }
 
         } else if (flags == GF_CLI_GET_NEXT_VOLUME) {
-                ret = dict_get_str (dict, "volname", &volname);
-
-                if (ret) {
-                        if (priv->volumes.next) {
-                                entry = list_entry (priv->volumes.next,
-                                                    typeof (*entry),
-                                                    vol_list);
+                /* A page of up to max-count volumes following volname
+                 * (from the first one without it), in volname order.
+                 * "more" tells if there are volumes after the page.
+                 */
+                if (dict_get_int32 (dict, "max-count", &max_count) ||
+                    (max_count <= 0))
+                        max_count = 1;
+                if (max_count > GLUSTERD_VOLUME_PAGE_MAX)
+                        max_count = GLUSTERD_VOLUME_PAGE_MAX;
+
+                if (dict_get_str (dict, "volname", &volname))
+                        entry = list_entry (priv->volumes.next,
+                                            typeof (*entry), vol_list);
+                else
+                        entry = glusterd_volinfo_find_next (volname);
+
+                for (; entry && (&entry->vol_list != &priv->volumes);
+                     entry = list_entry (entry->vol_list.next,
+                                         typeof (*entry), vol_list)) {
+                        if (count == max_count) {
+                                more = 1;
+                                break;
                         }
-                } else {
-                        ret = glusterd_volinfo_find (volname, &entry);
-                        if (ret)
-                                goto respond;
-                        entry = list_entry (entry->vol_list.next,
-                                            typeof (*entry),
-                                            vol_list);
-                }
 
-                if (&entry->vol_list == &priv->volumes) {
-                       goto respond;
-                } else {
                         ret = glusterd_add_volume_detail_to_dict (entry,
                                                          volumes, count);
                         if (ret)
@@ -3800,6 +4165,10 @@ glusterd_get_volumes (rpcsvc_request_t *req, dict_t *dict, int32_t flags)
 
                         count++;
                 }
+
+                ret = dict_set_int32 (volumes, "more", more);
+                if (ret)
+                        goto out;
         } else if (flags == GF_CLI_GET_VOLUME) {
                 ret = dict_get_str (dict, "volname", &volname);
                 if (ret)
@@ -3963,6 +4332,27 @@ struct rpcsvc_program gd_svc_mgmt_prog = {
         .actors    = gd_svc_mgmt_actors,
 };
 
+/* version 2 only changes the requests of a transaction */
+rpcsvc_actor_t gd_svc_mgmt_v2_actors[] = {
+        [GLUSTERD_MGMT_NULL]           = { "NULL", GLUSTERD_MGMT_NULL, glusterd_null, NULL, NULL},
+        [GLUSTERD_MGMT_PROBE_QUERY]    = { "PROBE_QUERY", GLUSTERD_MGMT_PROBE_QUERY, glusterd_handle_probe_query, NULL, NULL},
+        [GLUSTERD_MGMT_FRIEND_ADD]     = { "FRIEND_ADD", GLUSTERD_MGMT_FRIEND_ADD, glusterd_handle_incoming_friend_req, NULL, NULL},
+        [GLUSTERD_MGMT_FRIEND_REMOVE]  = { "FRIEND_REMOVE", GLUSTERD_MGMT_FRIEND_REMOVE, glusterd_handle_incoming_unfriend_req, NULL, NULL},
+        [GLUSTERD_MGMT_FRIEND_UPDATE]  = { "FRIEND_UPDATE", GLUSTERD_MGMT_FRIEND_UPDATE, glusterd_handle_friend_update, NULL, NULL},
+        [GLUSTERD_MGMT_CLUSTER_LOCK]   = { "CLUSTER_LOCK", GLUSTERD_MGMT_CLUSTER_LOCK, glusterd_handle_cluster_lock_v2, NULL, NULL},
+        [GLUSTERD_MGMT_CLUSTER_UNLOCK] = { "CLUSTER_UNLOCK", GLUSTERD_MGMT_CLUSTER_UNLOCK, glusterd_handle_cluster_unlock_v2, NULL, NULL},
+        [GLUSTERD_MGMT_STAGE_OP]       = { "STAGE_OP", GLUSTERD_MGMT_STAGE_OP, glusterd_handle_stage_op_v2, NULL, NULL},
+        [GLUSTERD_MGMT_COMMIT_OP]      = { "COMMIT_OP", GLUSTERD_MGMT_COMMIT_OP, glusterd_handle_commit_op_v2, NULL, NULL},
+};
+
+struct rpcsvc_program gd_svc_mgmt_v2_prog = {
+        .progname  = "GlusterD svc mgmt v2",
+        .prognum   = GD_MGMT_PROGRAM,
+        .progver   = GD_MGMT_V2_VERSION,
+        .numactors = GD_MGMT_PROCCNT,
+        .actors    = gd_svc_mgmt_v2_actors,
+};
+
 rpcsvc_actor_t gd_svc_cli_actors[] = {
         [GLUSTER_CLI_PROBE]         = { "CLI_PROBE", GLUSTER_CLI_PROBE, glusterd_handle_cli_probe, NULL, NULL},
         [GLUSTER_CLI_CREATE_VOLUME] = { "CLI_CREATE_VOLUME", GLUSTER_CLI_CREATE_VOLUME, glusterd_handle_create_volume, NULL,NULL},
@@ -3988,6 +4378,8 @@ rpcsvc_actor_t gd_svc_cli_actors[] = {
         [GLUSTER_CLI_QUOTA]         = { "QUOTA", GLUSTER_CLI_QUOTA, glusterd_handle_quota, NULL, NULL},
         [GLUSTER_CLI_LOG_LEVEL]     = {"LOG_LEVEL", GLUSTER_CLI_LOG_LEVEL, glusterd_handle_log_level, NULL, NULL},
         [GLUSTER_CLI_GETWD]         = { "GETWD", GLUSTER_CLI_GETWD, glusterd_handle_getwd, NULL, NULL},
+        [GLUSTER_CLI_TXN_STATS]     = { "TXN_STATS", GLUSTER_CLI_TXN_STATS, glusterd_handle_txn_stats, NULL, NULL},
+        [GLUSTER_CLI_BATCH_VOLUME]  = { "BATCH_VOLUME", GLUSTER_CLI_BATCH_VOLUME, glusterd_handle_batch_volume, NULL, NULL},
 
 };
 
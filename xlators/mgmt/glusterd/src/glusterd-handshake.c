@@ -38,12 +38,13 @@
 
 extern struct rpc_clnt_program glusterd3_1_mgmt_prog;
 extern struct rpc_clnt_program gd_clnt_mgmt_prog;
+extern struct rpc_clnt_program gd_clnt_mgmt_v2_prog;
 
 typedef ssize_t (*gfs_serialize_t) (struct iovec outmsg, void *data);
 
 static size_t
 build_volfile_path (const char *volname, char *path,
-                    size_t path_len)
+                    size_t path_len, glusterd_volinfo_t **volinfop)
 {
         struct stat         stbuf       = {0,};
         int32_t             ret         = -1;
@@ -94,6 +95,7 @@ build_volfile_path (const char *volname, char *path,
                                 priv->workdir, volinfo->volname, volname);
         }
 
+        *volinfop = volinfo;
         ret = 1;
 out:
         if (free_ptr)
@@ -118,6 +120,30 @@ xdr_to_glusterfs_req (rpcsvc_request_t *req, void *arg, gfs_serialize_t sfunc)
 }
 
 
+/* The part of gf_getspec_rsp ahead of the spec string. A cached volfile
+ * goes out as the payload right behind it, already padded to XDR units.
+ */
+struct getspec_rsp_hdr {
+        int     op_ret;
+        int     op_errno;
+        u_int   spec_len;
+};
+
+static ssize_t
+glusterd_getspec_rsp_hdr_serialize (struct iovec outmsg, void *args)
+{
+        struct getspec_rsp_hdr *hdr = args;
+        XDR                     xdr;
+
+        xdrmem_create (&xdr, outmsg.iov_base, outmsg.iov_len, XDR_ENCODE);
+        if (!xdr_int (&xdr, &hdr->op_ret) ||
+            !xdr_int (&xdr, &hdr->op_errno) ||
+            !xdr_u_int (&xdr, &hdr->spec_len))
+                return -1;
+
+        return xdr_getpos (&xdr);
+}
+
 int
 server_getspec (rpcsvc_request_t *req)
 {
@@ -126,13 +152,24 @@ server_getspec (rpcsvc_request_t *req)
         int32_t               spec_fd = -1;
         size_t                file_len = 0;
         char                  filename[ZR_PATH_MAX] = {0,};
+        char                  volname[GLUSTERD_MAX_VOLUME_NAME] = {0,};
         struct stat           stbuf = {0,};
         char                 *volume = NULL;
         int                   cookie = 0;
+        uint64_t              gen = 0;
+        glusterd_volinfo_t   *volinfo = NULL;
+        glusterd_conf_t      *priv = NULL;
+        struct iobuf         *iob = NULL;
+        struct iobref        *iobref = NULL;
+        struct iovec          payload = {0,};
+        struct getspec_rsp_hdr hdr = {0,};
+        struct iobuf_pool    *iobuf_pool = NULL;
 
         gf_getspec_req    args = {0,};
         gf_getspec_rsp    rsp  = {0,};
 
+        priv = THIS->private;
+        iobuf_pool = THIS->ctx->iobuf_pool;
 
         if (xdr_to_glusterfs_req (req, &args, xdr_to_getspec_req)) {
                 //failed to decode msg;
@@ -142,7 +179,21 @@ server_getspec (rpcsvc_request_t *req)
 
         volume = args.key;
 
-        ret = build_volfile_path (volume, filename, sizeof (filename));
+        if (!glusterd_volfile_cache_get (volume, volname, &iob, &file_len)) {
+                if (glusterd_volinfo_find (volname, &volinfo)) {
+                        iobuf_unref (iob);
+                        iob = NULL;
+                }
+        }
+
+        if (iob) {
+                ret = file_len;
+                goto served;
+        }
+
+        gen = glusterd_volfile_cache_gen ();
+        ret = build_volfile_path (volume, filename, sizeof (filename),
+                                  &volinfo);
 
         if (ret > 0) {
                 /* to allocate the proper buffer to hold the file data */
@@ -166,7 +217,30 @@ server_getspec (rpcsvc_request_t *req)
                 op_errno = ENOENT;
         }
 
-        if (file_len) {
+        /* read into an iobuf when it fits in one, the reply payload and
+         * what the next fetches of this volfile-id are served from */
+        if (file_len && (GLUSTERD_XDR_ROUNDUP (file_len) <=
+                         iobpool_pagesize (iobuf_pool)))
+                iob = iobuf_get (iobuf_pool);
+
+        if (iob) {
+                ret = read (spec_fd, iobuf_ptr (iob), file_len);
+                close (spec_fd);
+
+                if (ret > 0) {
+                        memset ((char *)iobuf_ptr (iob) + ret, 0,
+                                GLUSTERD_XDR_ROUNDUP (ret) - ret);
+                        if ((size_t)ret == file_len)
+                                glusterd_volfile_cache_put (volume, filename,
+                                                            volinfo->volname,
+                                                            iob, file_len,
+                                                            gen);
+                        file_len = ret;
+                } else {
+                        iobuf_unref (iob);
+                        iob = NULL;
+                }
+        } else if (file_len) {
                 rsp.spec = CALLOC (file_len+1, sizeof (char));
                 if (!rsp.spec) {
                         ret = -1;
@@ -178,6 +252,46 @@ server_getspec (rpcsvc_request_t *req)
                 close (spec_fd);
         }
 
+served:
+        /* Only the fetchers of this volume get told when its volfiles
+         * change, along with the version carried back in the cookie.
+         */
+        if (ret > 0) {
+                glusterd_volfile_subscribe (req->trans, volinfo);
+                cookie = glusterd_volfile_version (volinfo);
+        }
+
+        /* a client already holding this version gets no spec back */
+        if (cookie && (args.flags == cookie)) {
+                if (rsp.spec) {
+                        free (rsp.spec);
+                        rsp.spec = NULL;
+                }
+                ret = 0;
+                priv->volfile_cache.not_modified++;
+                goto fail;
+        }
+
+        if (iob && (ret > 0)) {
+                iobref = iobref_new ();
+                if (!iobref) {
+                        ret = -1;
+                        op_errno = ENOMEM;
+                        goto fail;
+                }
+                iobref_add (iobref, iob);
+
+                hdr.op_ret = ret;
+                hdr.op_errno = cookie;
+                hdr.spec_len = file_len;
+                payload.iov_base = iobuf_ptr (iob);
+                payload.iov_len = GLUSTERD_XDR_ROUNDUP (file_len);
+
+                glusterd_submit_reply (req, &hdr, &payload, 1, iobref,
+                                       glusterd_getspec_rsp_hdr_serialize);
+                goto out;
+        }
+
         /* convert to XDR */
 fail:
         rsp.op_ret   = ret;
@@ -192,10 +306,15 @@ fail:
 
         glusterd_submit_reply (req, &rsp, NULL, 0, NULL,
                                (gd_serialize_t)xdr_serialize_getspec_rsp);
+out:
         if (args.key)
                 free (args.key);//malloced by xdr
         if (rsp.spec && (strcmp (rsp.spec, "")))
                 free (rsp.spec);
+        if (iobref)
+                iobref_unref (iobref);
+        if (iob)
+                iobuf_unref (iob);
 
         return 0;
 }
@@ -275,39 +394,39 @@ out:
         return ret;
 }
 
+/* mgmt programs a peer may offer, the one to use first */
+static struct rpc_clnt_program *glusterd_clnt_mgmt_progs[] = {
+        &gd_clnt_mgmt_v2_prog,
+        &gd_clnt_mgmt_prog,
+        &glusterd3_1_mgmt_prog,
+        NULL,
+};
+
 int
 glusterd_set_clnt_mgmt_program (glusterd_peerinfo_t *peerinfo,
                                 gf_prog_detail *prog)
 {
         gf_prog_detail *trav     = NULL;
         int             ret      = -1;
+        int             i        = 0;
 
         if (!peerinfo || !prog)
                 goto out;
 
-        trav = prog;
-
-        while (trav) {
-                /* Select 'programs' */
-                if ((gd_clnt_mgmt_prog.prognum == trav->prognum) &&
-                    (gd_clnt_mgmt_prog.progver == trav->progver)) {
-                        peerinfo->mgmt = &gd_clnt_mgmt_prog;
-                        ret = 0;
-                        /* Break here, as this gets higher priority */
-                        break;
+        /* Select 'programs' */
+        for (i = 0; glusterd_clnt_mgmt_progs[i]; i++) {
+                for (trav = prog; trav; trav = trav->next) {
+                        if ((glusterd_clnt_mgmt_progs[i]->prognum ==
+                             trav->prognum) &&
+                            (glusterd_clnt_mgmt_progs[i]->progver ==
+                             trav->progver))
+                                break;
                 }
-                if ((glusterd3_1_mgmt_prog.prognum == trav->prognum) &&
-                    (glusterd3_1_mgmt_prog.progver == trav->progver)) {
-                        peerinfo->mgmt = &glusterd3_1_mgmt_prog;
+                if (trav) {
+                        peerinfo->mgmt = glusterd_clnt_mgmt_progs[i];
                         ret = 0;
+                        break;
                 }
-                if (ret) {
-                        gf_log ("", GF_LOG_DEBUG,
-                                "%s (%"PRId64":%"PRId64") not supported",
-                                trav->progname, trav->prognum,
-                                trav->progver);
-                }
-                trav = trav->next;
         }
 
         if (!ret && peerinfo->mgmt) {
@@ -64,7 +64,20 @@ typedef enum gf_gld_mem_types_ {
         gf_gld_mt_brick_rsp_ctx_t               = gf_common_mt_end + 38,
         gf_gld_mt_mop_brick_req_t               = gf_common_mt_end + 39,
         gf_gld_mt_op_allack_ctx_t               = gf_common_mt_end + 40,
-        gf_gld_mt_end                           = gf_common_mt_end + 41
+        gf_gld_mt_volume_lock_t                 = gf_common_mt_end + 41,
+        gf_gld_mt_op_info_t                     = gf_common_mt_end + 42,
+        gf_gld_mt_store_buf_t                   = gf_common_mt_end + 43,
+        gf_gld_mt_resolve_entry_t               = gf_common_mt_end + 44,
+        gf_gld_mt_volfile_sub_t                 = gf_common_mt_end + 45,
+        gf_gld_mt_brick_spawn_t                 = gf_common_mt_end + 46,
+        gf_gld_mt_volfile_entry_t               = gf_common_mt_end + 47,
+        gf_gld_mt_op_peer_t                     = gf_common_mt_end + 48,
+        gf_gld_mt_op_batch_t                    = gf_common_mt_end + 49,
+        gf_gld_mt_defrag_dir_t                  = gf_common_mt_end + 50,
+        gf_gld_mt_defrag_buf                    = gf_common_mt_end + 51,
+        gf_gld_mt_deferred_t                    = gf_common_mt_end + 52,
+        gf_gld_mt_op_lost_t                     = gf_common_mt_end + 53,
+        gf_gld_mt_end                           = gf_common_mt_end + 54
 } gf_gld_mem_types_t;
 #endif
 
@@ -59,7 +59,27 @@
 
 static struct list_head gd_op_sm_queue;
 pthread_mutex_t       gd_op_sm_lock;
-glusterd_op_info_t    opinfo = {{0},};
+/* transactions in flight on this node, keyed by the originator's txn id */
+static struct list_head gd_op_txns;
+static pthread_mutex_t  gd_op_txn_lock;
+static int32_t          gd_op_cli_txns;
+/* tags for the stage/commit requests sent and for the deadlines armed */
+static uint32_t         gd_op_peer_seq;
+static uint32_t         gd_op_phase_seq;
+
+static int
+glusterd_op_peer_pending_add (glusterd_op_info_t *txn,
+                              glusterd_peerinfo_t *peerinfo, uint32_t *seqp);
+static glusterd_op_peer_t *
+glusterd_op_peer_pending_del (glusterd_op_info_t *txn, uint32_t seq);
+static int
+glusterd_op_peer_failed (glusterd_op_info_t *txn, const char *peer_str,
+                         const char *fmt);
+static void
+glusterd_op_phase_arm (glusterd_op_info_t *txn);
+
+/* the transaction the state machine is currently working on */
+glusterd_op_info_t    *opinfo = NULL;
 static int glusterfs_port = GLUSTERD_DEFAULT_PORT;
 static char *glusterd_op_sm_state_names[] = {
         "Default",
@@ -129,6 +149,8 @@ glusterd_destroy_lock_ctx (glusterd_op_lock_ctx_t *ctx)
 {
         if (!ctx)
                 return;
+        if (ctx->volname)
+                GF_FREE (ctx->volname);
         GF_FREE (ctx);
 }
 
@@ -1581,6 +1603,7 @@ glusterd_op_perform_replace_brick (glusterd_volinfo_t  *volinfo,
 
         list_add_tail (&new_brickinfo->brick_list,
                        &old_brickinfo->brick_list);
+        glusterd_brickinfo_hash (volinfo, new_brickinfo);
 
         volinfo->brick_count++;
 
@@ -1639,6 +1662,7 @@ glusterd_op_perform_add_bricks (glusterd_volinfo_t  *volinfo, int32_t count,
                 if (ret)
                         goto out;
                 list_add_tail (&brickinfo->brick_list, &volinfo->bricks);
+                glusterd_brickinfo_hash (volinfo, brickinfo);
                 brick = strtok_r (NULL, " \n", &saveptr);
                 i++;
                 volinfo->brick_count++;
@@ -2756,6 +2780,7 @@ glusterd_op_create_volume (dict_t *dict, char **op_errstr)
                 if (ret)
                         goto out;
                 list_add_tail (&brickinfo->brick_list, &volinfo->bricks);
+                glusterd_brickinfo_hash (volinfo, brickinfo);
                 brick = strtok_r (NULL, " \n", &saveptr);
                 i++;
         }
@@ -2773,14 +2798,8 @@ glusterd_op_create_volume (dict_t *dict, char **op_errstr)
                 goto out;
         }
 
-        ret = glusterd_volume_compute_cksum (volinfo);
-        if (ret) {
-                *op_errstr = gf_strdup ("Failed to compute checksum of volume");
-                goto out;
-        }
-
         volinfo->defrag_status = 0;
-        list_add_tail (&volinfo->vol_list, &priv->volumes);
+        glusterd_volinfo_list_add (volinfo);
         vol_added = _gf_true;
 out:
         if (free_ptr)
@@ -3948,7 +3967,7 @@ glusterd_op_replace_brick (dict_t *dict, dict_t *rsp_dict)
 		if (ret)
 			goto out;
 
-		ret = glusterd_fetchspec_notify (THIS);
+		ret = glusterd_fetchspec_notify_volume (volinfo);
                 glusterd_set_rb_status (volinfo, GF_RB_STATUS_NONE);
                 glusterd_brickinfo_delete (volinfo->dst_brick);
                 volinfo->src_brick = volinfo->dst_brick = NULL;
@@ -4838,74 +4857,101 @@ out:
         return ret;
 }
 
+/* Walks @volname so that marker accounts for what was on it before quota
+ * was enabled. The walk runs in a glusterfs process of its own, with
+ * features/crawler on top of the volume's client graph; it saves its
+ * progress in the volume directory and carries on from there when started
+ * again before it has finished.
+ */
 int32_t
 glusterd_quota_initiate_fs_crawl (glusterd_conf_t *priv, char *volname)
 {
-        int32_t   ret = 0;
-        pid_t     pid;
-        char      mountdir [] = "/tmp/mntXXXXXX";
-        runner_t  runner = {0,};
-        int       status = 0;
+        int32_t             ret = -1;
+        glusterd_volinfo_t *volinfo = NULL;
+        char                path[PATH_MAX] = {0,};
+        char                rundir[PATH_MAX] = {0,};
+        char                pidfile[PATH_MAX] = {0,};
+        char                volfile[PATH_MAX] = {0,};
+        char                logfile[PATH_MAX] = {0,};
+        char                checkpoint[PATH_MAX] = {0,};
+        runner_t            runner = {0,};
+        FILE               *file = NULL;
 
-        if (mkdtemp (mountdir) == NULL) {
-                gf_log ("glusterd", GF_LOG_DEBUG,
-                        "failed to create a temporary mount directory");
-                ret = -1;
+        ret = glusterd_volinfo_find (volname, &volinfo);
+        if (ret)
                 goto out;
-        }
 
-        runinit (&runner);
-        runner_add_args (&runner, GFS_PREFIX"/sbin/glusterfs", "-s",
-                         "localhost", "--volfile-id", volname, mountdir, NULL);
-        ret = runner_run_reuse (&runner);
-        if (ret == -1) {
-                runner_log (&runner, "glusterd", GF_LOG_DEBUG, "command failed");
-                runner_end (&runner);
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+        snprintf (rundir, PATH_MAX, "%s/run", path);
+        ret = mkdir (rundir, 0777);
+        if ((ret == -1) && (EEXIST != errno)) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to create rundir %s",
+                        rundir);
                 goto out;
         }
-        runner_end (&runner);
 
-        if ((pid = fork ()) < 0) {
-                gf_log ("glusterd", GF_LOG_WARNING, "fork from parent failed");
-                ret = -1;
-                goto out;
-        } else if (pid == 0) {//first child
-                ret = chdir (mountdir);
-                if (ret == -1) {
-                        gf_log ("glusterd", GF_LOG_WARNING, "chdir %s failed, "
-                                "reason: %s", mountdir, strerror (errno));
-                        exit (EXIT_FAILURE);
+        GLUSTERD_GET_QUOTA_CRAWL_PIDFILE (pidfile, path);
+        file = fopen (pidfile, "r+");
+        if (file) {
+                ret = lockf (fileno (file), F_TLOCK, 0);
+                if (ret && ((EAGAIN == errno) || (EACCES == errno))) {
+                        gf_log ("glusterd", GF_LOG_INFO, "quota crawl of %s "
+                                "is already running", volname);
+                        fclose (file);
+                        ret = 0;
+                        goto out;
                 }
+                fclose (file);
+        }
 
-#ifndef GF_LINUX_HOST_OS
-                /* fork one more to not hold back main process on
-                 * blocking call below
-                 */
-                pid = fork ();
-                if (pid)
-                        _exit (pid > 0 ? EXIT_SUCCESS : EXIT_FAILURE);
-#endif
-
-                runinit (&runner);
-                runner_add_args (&runner, "/usr/bin/find", "find", ".", NULL);
-                if (runner_start (&runner) == -1)
-                        _exit (EXIT_FAILURE);
-#ifndef GF_LINUX_HOST_OS
-                runner_end (&runner); /* blocks in waitpid */
-                runcmd ("umount", mountdir, NULL);
-#else
-                runcmd ("umount", "-l", mountdir, NULL);
-#endif
-                rmdir (mountdir);
-                _exit (EXIT_SUCCESS);
+        snprintf (volfile, PATH_MAX, "%s/%s-quota-crawl.vol", path, volname);
+        GLUSTERD_GET_QUOTA_CRAWL_CHECKPOINT (checkpoint, path);
+        ret = glusterd_create_quota_crawl_volfile (volinfo, volfile,
+                                                   checkpoint);
+        if (ret) {
+                gf_log ("glusterd", GF_LOG_ERROR, "failed to create the "
+                        "quota crawl volfile for %s", volname);
+                goto out;
         }
-        ret = (waitpid (pid, &status, 0) == pid &&
-               WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS) ? 0 : -1;
+
+        snprintf (logfile, PATH_MAX, "%s/quota-crawl-%s.log",
+                  DEFAULT_LOG_FILE_DIRECTORY, volname);
+
+        runinit (&runner);
+        runner_add_args (&runner, GFS_PREFIX"/sbin/glusterfs", "-f", volfile,
+                         "-p", pidfile, "-l", logfile, NULL);
+        ret = runner_run_reuse (&runner);
+        if (ret == -1)
+                runner_log (&runner, "glusterd", GF_LOG_DEBUG,
+                            "command failed");
+        runner_end (&runner);
 
 out:
         return ret;
 }
 
+/* stops a crawl of @volinfo that is still running and forgets where it
+ * got to */
+int32_t
+glusterd_quota_stop_fs_crawl (glusterd_conf_t *priv,
+                              glusterd_volinfo_t *volinfo)
+{
+        char path[PATH_MAX] = {0,};
+        char pidfile[PATH_MAX] = {0,};
+        char checkpoint[PATH_MAX] = {0,};
+
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+        GLUSTERD_GET_QUOTA_CRAWL_PIDFILE (pidfile, path);
+        GLUSTERD_GET_QUOTA_CRAWL_CHECKPOINT (checkpoint, path);
+
+        if (!access (pidfile, F_OK))
+                glusterd_service_stop ("quota crawl", pidfile, SIGTERM,
+                                       _gf_true);
+        unlink (checkpoint);
+
+        return 0;
+}
+
 char *
 glusterd_quota_get_limit_value (char *quota_limits, char *path)
 {
@@ -5304,6 +5350,8 @@ glusterd_op_quota (dict_t *dict, char **op_errstr)
                 if (ret < 0)
                         goto out;
 
+                glusterd_quota_stop_fs_crawl (priv, volinfo);
+
                 goto create_vol;
         }
 
@@ -5505,6 +5553,7 @@ glusterd_op_set_volume (dict_t *dict)
 	char					 str[50] = {0, };
         gf_boolean_t                             global_opt    = _gf_false;
         glusterd_volinfo_t                       *voliter = NULL;
+        int                                      graphs = 0;
 
         this = THIS;
         GF_ASSERT (this);
@@ -5571,6 +5620,9 @@ glusterd_op_set_volume (dict_t *dict)
                 if (key_fixed)
                         key = key_fixed;
 
+                /* only the volfiles the options go into are regenerated */
+                graphs |= glusterd_volopt_graphs (key);
+
                 if (global_opt) {
                        list_for_each_entry (voliter, &priv->volumes, vol_list) {
                                value = gf_strdup (value);
@@ -5600,7 +5652,7 @@ glusterd_op_set_volume (dict_t *dict)
         }
 
         if (!global_opt) {
-                ret = glusterd_create_volfiles_and_notify_services (volinfo);
+                ret = glusterd_regenerate_volfiles (volinfo, graphs);
                 if (ret) {
                         gf_log ("", GF_LOG_ERROR, "Unable to create volfile for"
                                 " 'volume set'");
@@ -5632,7 +5684,7 @@ glusterd_op_set_volume (dict_t *dict)
         else {
                 list_for_each_entry (voliter, &priv->volumes, vol_list) {
                         volinfo = voliter;
-                        ret = glusterd_create_volfiles_and_notify_services (volinfo);
+                        ret = glusterd_regenerate_volfiles (volinfo, graphs);
                         if (ret) {
                                 gf_log ("", GF_LOG_ERROR, "Unable to create volfile for"
                                         " 'volume set'");
@@ -6329,8 +6381,8 @@ glusterd_op_ac_send_lock (glusterd_op_sm_event_t *event, void *ctx)
                 }
         }
 
-        opinfo.pending_count = pending_count;
-        if (!opinfo.pending_count)
+        opinfo->pending_count = pending_count;
+        if (!opinfo->pending_count)
                 ret = glusterd_op_sm_inject_all_acc ();
 
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
@@ -6376,8 +6428,8 @@ glusterd_op_ac_send_unlock (glusterd_op_sm_event_t *event, void *ctx)
                 }
         }
 
-        opinfo.pending_count = pending_count;
-        if (!opinfo.pending_count)
+        opinfo->pending_count = pending_count;
+        if (!opinfo->pending_count)
                 ret = glusterd_op_sm_inject_all_acc ();
 
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
@@ -6399,10 +6451,19 @@ glusterd_op_ac_lock (glusterd_op_sm_event_t *event, void *ctx)
 
         lock_ctx = (glusterd_op_lock_ctx_t *)ctx;
 
-        status = glusterd_lock (lock_ctx->uuid);
+        status = glusterd_scoped_lock (lock_ctx->volname, lock_ctx->uuid);
 
         gf_log ("", GF_LOG_DEBUG, "Lock Returned %d", status);
 
+        if (!status) {
+                opinfo->locked = _gf_true;
+                uuid_copy (opinfo->lock_owner, lock_ctx->uuid);
+                if (lock_ctx->volname) {
+                        opinfo->lock_volname = lock_ctx->volname;
+                        lock_ctx->volname = NULL;
+                }
+        }
+
         ret = glusterd_op_lock_send_resp (lock_ctx->req, status);
 
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
@@ -6421,7 +6482,15 @@ glusterd_op_ac_unlock (glusterd_op_sm_event_t *event, void *ctx)
 
         lock_ctx = (glusterd_op_lock_ctx_t *)ctx;
 
-        ret = glusterd_unlock (lock_ctx->uuid);
+        /* Only release what this transaction acquired; the same
+         * originator may hold other locks for its other transactions.
+         */
+        if (opinfo->locked) {
+                ret = glusterd_scoped_unlock (opinfo->lock_volname,
+                                              opinfo->lock_owner);
+                if (!ret)
+                        opinfo->locked = _gf_false;
+        }
 
         gf_log ("", GF_LOG_DEBUG, "Unlock Returned %d", ret);
 
@@ -6439,10 +6508,10 @@ glusterd_op_ac_rcvd_lock_acc (glusterd_op_sm_event_t *event, void *ctx)
 
         GF_ASSERT (event);
 
-        if (opinfo.pending_count > 0)
-                opinfo.pending_count--;
+        if (opinfo->pending_count > 0)
+                opinfo->pending_count--;
 
-        if (opinfo.pending_count > 0)
+        if (opinfo->pending_count > 0)
                 goto out;
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_ALL_ACC, NULL);
@@ -6512,6 +6581,7 @@ glusterd_op_build_payload (glusterd_op_t op, dict_t **req)
                 case GD_OP_GSYNC_SET:
                 case GD_OP_PROFILE_VOLUME:
                 case GD_OP_LOG_LEVEL:
+                case GD_OP_BATCH:
                         {
                                 dict_t  *dict = ctx;
                                 dict_copy (dict, req_dict);
@@ -6529,6 +6599,60 @@ out:
         return ret;
 }
 
+void
+glusterd_op_fanout_release (glusterd_op_fanout_t *fanout)
+{
+        int     i = 0;
+
+        for (i = 0; i < GD_OP_FANOUT_MAX; i++) {
+                if (fanout->enc[i].iobref)
+                        iobref_unref (fanout->enc[i].iobref);
+                fanout->enc[i].iobref = NULL;
+        }
+}
+
+/* Sends the request of the current stage or commit phase to peerinfo and
+ * notes that the phase waits on it. A peer the request could not reach
+ * fails the phase right away, as if it had rejected it, so every peer
+ * sent to counts towards pending_count.
+ */
+static int
+glusterd_op_fanout_peer (xlator_t *this, rpc_clnt_procedure_t *proc,
+                         dict_t *dict, glusterd_peerinfo_t *peerinfo,
+                         glusterd_op_fanout_t *fanout)
+{
+        glusterd_op_peer_t      *peer = NULL;
+        int                     ret = -1;
+
+        ret = dict_set_static_ptr (dict, "peerinfo", peerinfo);
+        if (!ret)
+                ret = dict_set_static_ptr (dict, "fanout", fanout);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "failed to set peerinfo");
+                goto out;
+        }
+
+        ret = glusterd_op_peer_pending_add (opinfo, peerinfo, &fanout->seq);
+        if (ret)
+                goto out;
+
+        ret = proc->fn (NULL, this, dict);
+        if (ret) {
+                peer = glusterd_op_peer_pending_del (opinfo, fanout->seq);
+                if (peer) {
+                        GF_FREE (peer);
+                        ret = glusterd_op_peer_failed
+                                (opinfo, peerinfo->hostname,
+                                 "Unable to send the request to %s");
+                        goto out;
+                }
+        }
+
+        ret = 0;
+out:
+        return ret;
+}
+
 static int
 glusterd_op_ac_send_stage_op (glusterd_op_sm_event_t *event, void *ctx)
 {
@@ -6541,6 +6665,7 @@ glusterd_op_ac_send_stage_op (glusterd_op_sm_event_t *event, void *ctx)
         char                    *op_errstr  = NULL;
         int                      i = 0;
         uint32_t                pending_count = 0;
+        glusterd_op_fanout_t    fanout = {0,};
 
         this = THIS;
         GF_ASSERT (this);
@@ -6548,7 +6673,7 @@ glusterd_op_ac_send_stage_op (glusterd_op_sm_event_t *event, void *ctx)
         GF_ASSERT (priv);
 
         for ( i = GD_OP_NONE; i < GD_OP_MAX; i++) {
-                if (opinfo.pending_op[i])
+                if (opinfo->pending_op[i])
                         break;
         }
 
@@ -6570,7 +6695,7 @@ glusterd_op_ac_send_stage_op (glusterd_op_sm_event_t *event, void *ctx)
         ret = glusterd_op_stage_validate (i, dict, &op_errstr, NULL);
         if (ret) {
                 gf_log ("", GF_LOG_ERROR, "Staging failed");
-                opinfo.op_errstr = op_errstr;
+                opinfo->op_errstr = op_errstr;
                 goto out;
         }
 
@@ -6586,32 +6711,30 @@ glusterd_op_ac_send_stage_op (glusterd_op_sm_event_t *event, void *ctx)
                 proc = &peerinfo->mgmt->proctable[GLUSTERD_MGMT_STAGE_OP];
                 GF_ASSERT (proc);
                 if (proc->fn) {
-                        ret = dict_set_static_ptr (dict, "peerinfo", peerinfo);
-                        if (ret) {
-                                gf_log ("", GF_LOG_ERROR, "failed to set peerinfo");
-                                goto out;
-                        }
-
-                        ret = proc->fn (NULL, this, dict);
+                        ret = glusterd_op_fanout_peer (this, proc, dict,
+                                                       peerinfo, &fanout);
                         if (ret)
-                                continue;
+                                goto out;
                         pending_count++;
                 }
         }
 
-        opinfo.pending_count = pending_count;
+        opinfo->pending_count = pending_count;
+        if (pending_count)
+                glusterd_op_phase_arm (opinfo);
 out:
+        glusterd_op_fanout_release (&fanout);
         if (dict)
                 dict_unref (dict);
         if (ret) {
                 glusterd_op_sm_inject_event (GD_OP_EVENT_RCVD_RJT, NULL);
-                opinfo.op_ret = ret;
+                opinfo->op_ret = ret;
         }
 
         gf_log ("glusterd", GF_LOG_INFO, "Sent op req to %d peers",
-                opinfo.pending_count);
+                opinfo->pending_count);
 
-        if (!opinfo.pending_count)
+        if (!opinfo->pending_count)
                 ret = glusterd_op_sm_inject_all_acc ();
 
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
@@ -6646,6 +6769,14 @@ glusterd_op_start_rb_timer (dict_t *dict)
 
         timeout.tv_usec = 0;
 
+        /* the timer fires outside the state machine, tell it which
+         * transaction to resume */
+        ret = dict_set_dynstr (dict, "txn-id",
+                               gf_strdup (uuid_utoa (opinfo->txn_id)));
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "Unable to set txn-id");
+                goto out;
+        }
 
         priv->timer = gf_timer_call_after (THIS->ctx, timeout,
                                            glusterd_do_replace_brick,
@@ -6670,6 +6801,7 @@ glusterd_op_ac_send_commit_op (glusterd_op_sm_event_t *event, void *ctx)
         char                    *op_errstr  = NULL;
         int                      i = 0;
         uint32_t                 pending_count = 0;
+        glusterd_op_fanout_t     fanout = {0,};
 
         this = THIS;
         GF_ASSERT (this);
@@ -6677,7 +6809,7 @@ glusterd_op_ac_send_commit_op (glusterd_op_sm_event_t *event, void *ctx)
         GF_ASSERT (priv);
 
         for ( i = GD_OP_NONE; i < GD_OP_MAX; i++) {
-                if (opinfo.commit_op[i])
+                if (opinfo->commit_op[i])
                         break;
         }
 
@@ -6696,7 +6828,7 @@ glusterd_op_ac_send_commit_op (glusterd_op_sm_event_t *event, void *ctx)
         ret = glusterd_op_commit_perform (i, dict, &op_errstr, NULL); //rsp_dict invalid for source
         if (ret) {
                 gf_log ("", GF_LOG_ERROR, "Commit failed");
-                opinfo.op_errstr = op_errstr;
+                opinfo->op_errstr = op_errstr;
                 goto out;
         }
 
@@ -6712,30 +6844,29 @@ glusterd_op_ac_send_commit_op (glusterd_op_sm_event_t *event, void *ctx)
                 proc = &peerinfo->mgmt->proctable[GLUSTERD_MGMT_COMMIT_OP];
                 GF_ASSERT (proc);
                 if (proc->fn) {
-                        ret = dict_set_static_ptr (dict, "peerinfo", peerinfo);
-                        if (ret) {
-                                gf_log ("", GF_LOG_ERROR, "failed to set peerinfo");
-                                goto out;
-                        }
-                        ret = proc->fn (NULL, this, dict);
+                        ret = glusterd_op_fanout_peer (this, proc, dict,
+                                                       peerinfo, &fanout);
                         if (ret)
-                                continue;
+                                goto out;
                         pending_count++;
                 }
         }
 
-        opinfo.pending_count = pending_count;
+        opinfo->pending_count = pending_count;
+        if (pending_count)
+                glusterd_op_phase_arm (opinfo);
         gf_log ("glusterd", GF_LOG_INFO, "Sent op req to %d peers",
-                opinfo.pending_count);
+                opinfo->pending_count);
 out:
+        glusterd_op_fanout_release (&fanout);
         if (dict)
                 dict_unref (dict);
         if (ret) {
                 glusterd_op_sm_inject_event (GD_OP_EVENT_RCVD_RJT, NULL);
-                opinfo.op_ret = ret;
+                opinfo->op_ret = ret;
         }
 
-        if (!opinfo.pending_count) {
+        if (!opinfo->pending_count) {
                 op_dict = glusterd_op_get_ctx (GD_OP_REPLACE_BRICK);
                 if (!op_dict) {
                         ret = glusterd_op_sm_inject_all_acc ();
@@ -6760,10 +6891,10 @@ glusterd_op_ac_rcvd_stage_op_acc (glusterd_op_sm_event_t *event, void *ctx)
 
         GF_ASSERT (event);
 
-        if (opinfo.pending_count > 0)
-                opinfo.pending_count--;
+        if (opinfo->pending_count > 0)
+                opinfo->pending_count--;
 
-        if (opinfo.pending_count > 0)
+        if (opinfo->pending_count > 0)
                 goto out;
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_STAGE_ACC, NULL);
@@ -6781,10 +6912,10 @@ glusterd_op_ac_stage_op_failed (glusterd_op_sm_event_t *event, void *ctx)
 
         GF_ASSERT (event);
 
-        if (opinfo.pending_count > 0)
-                opinfo.pending_count--;
+        if (opinfo->pending_count > 0)
+                opinfo->pending_count--;
 
-        if (opinfo.pending_count > 0)
+        if (opinfo->pending_count > 0)
                 goto out;
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_ALL_ACK, NULL);
@@ -6802,10 +6933,10 @@ glusterd_op_ac_commit_op_failed (glusterd_op_sm_event_t *event, void *ctx)
 
         GF_ASSERT (event);
 
-        if (opinfo.pending_count > 0)
-                opinfo.pending_count--;
+        if (opinfo->pending_count > 0)
+                opinfo->pending_count--;
 
-        if (opinfo.pending_count > 0)
+        if (opinfo->pending_count > 0)
                 goto out;
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_ALL_ACK, NULL);
@@ -6830,7 +6961,7 @@ glusterd_op_ac_brick_op_failed (glusterd_op_sm_event_t *event, void *ctx)
         brickinfo = ev_ctx->brickinfo;
         GF_ASSERT (brickinfo);
 
-        ret = glusterd_remove_pending_entry (&opinfo.pending_bricks, brickinfo);
+        ret = glusterd_remove_pending_entry (&opinfo->pending_bricks, brickinfo);
         if (ret) {
                 gf_log ("glusterd", GF_LOG_ERROR, "unknown response received "
                         "from %s:%s", brickinfo->hostname, brickinfo->path);
@@ -6838,17 +6969,17 @@ glusterd_op_ac_brick_op_failed (glusterd_op_sm_event_t *event, void *ctx)
                 free_errstr = _gf_true;
                 goto out;
         }
-        if (opinfo.brick_pending_count > 0)
-                opinfo.brick_pending_count--;
-        if (opinfo.op_ret == 0)
-                opinfo.op_ret = ev_ctx->op_ret;
+        if (opinfo->brick_pending_count > 0)
+                opinfo->brick_pending_count--;
+        if (opinfo->op_ret == 0)
+                opinfo->op_ret = ev_ctx->op_ret;
 
-        if (opinfo.op_errstr == NULL)
-                opinfo.op_errstr = ev_ctx->op_errstr;
+        if (opinfo->op_errstr == NULL)
+                opinfo->op_errstr = ev_ctx->op_errstr;
         else
                 free_errstr = _gf_true;
 
-        if (opinfo.brick_pending_count > 0)
+        if (opinfo->brick_pending_count > 0)
                 goto out;
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_ALL_ACK, ev_ctx->commit_ctx);
@@ -6882,7 +7013,8 @@ glusterd_op_brick_disconnect (void *data)
                         "Cancelled timer thread");
 	}
 
-        glusterd_op_sm_inject_event (GD_OP_EVENT_RCVD_ACC, ev_ctx);
+        glusterd_op_sm_inject_txn_event (GD_OP_EVENT_RCVD_ACC,
+                                         ev_ctx->commit_ctx->txn_id, ev_ctx);
         glusterd_op_sm ();
 }
 
@@ -6900,6 +7032,8 @@ glusterd_do_replace_brick (void *data)
         glusterd_brickinfo_t   *src_brickinfo = NULL;
         glusterd_brickinfo_t   *dst_brickinfo = NULL;
 	glusterd_conf_t	       *priv = NULL;
+        char                   *txn_str = NULL;
+        uuid_t                  txn_id = {0,};
 
         int ret = 0;
 
@@ -6919,6 +7053,12 @@ glusterd_do_replace_brick (void *data)
         gf_log ("", GF_LOG_DEBUG,
                 "Replace brick operation detected");
 
+        if (dict_get_str (dict, "txn-id", &txn_str) ||
+            uuid_parse (txn_str, txn_id)) {
+                gf_log ("", GF_LOG_ERROR, "Unable to get txn-id");
+                return;
+        }
+
         ret = dict_get_int32 (dict, "operation", &op);
         if (ret) {
                 gf_log ("", GF_LOG_DEBUG,
@@ -7014,9 +7154,11 @@ glusterd_do_replace_brick (void *data)
 
 out:
         if (ret)
-                ret = glusterd_op_sm_inject_event (GD_OP_EVENT_RCVD_RJT, NULL);
+                ret = glusterd_op_sm_inject_txn_event (GD_OP_EVENT_RCVD_RJT,
+                                                       txn_id, NULL);
         else
-                ret = glusterd_op_sm_inject_event (GD_OP_EVENT_COMMIT_ACC, NULL);
+                ret = glusterd_op_sm_inject_txn_event (GD_OP_EVENT_COMMIT_ACC,
+                                                       txn_id, NULL);
 
 //        if (dict)
 //                dict_unref (dict);
@@ -7037,10 +7179,10 @@ glusterd_op_ac_rcvd_commit_op_acc (glusterd_op_sm_event_t *event, void *ctx)
         priv = THIS->private;
         GF_ASSERT (event);
 
-        if (opinfo.pending_count > 0)
-                opinfo.pending_count--;
+        if (opinfo->pending_count > 0)
+                opinfo->pending_count--;
 
-        if (opinfo.pending_count > 0)
+        if (opinfo->pending_count > 0)
                 goto out;
 
         dict = glusterd_op_get_ctx (GD_OP_REPLACE_BRICK);
@@ -7071,10 +7213,10 @@ glusterd_op_ac_rcvd_unlock_acc (glusterd_op_sm_event_t *event, void *ctx)
 
         GF_ASSERT (event);
 
-        if (opinfo.pending_count > 0)
-                opinfo.pending_count--;
+        if (opinfo->pending_count > 0)
+                opinfo->pending_count--;
 
-        if (opinfo.pending_count > 0)
+        if (opinfo->pending_count > 0)
                 goto out;
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_ALL_ACC, NULL);
@@ -7088,7 +7230,7 @@ out:
 
 int32_t
 glusterd_op_clear_errstr() {
-        opinfo.op_errstr = NULL;
+        opinfo->op_errstr = NULL;
         return 0;
 }
 
@@ -7099,7 +7241,7 @@ glusterd_op_set_ctx (glusterd_op_t op, void *ctx)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        opinfo.op_ctx[op] = ctx;
+        opinfo->op_ctx[op] = ctx;
 
         return 0;
 
@@ -7135,7 +7277,7 @@ glusterd_op_txn_complete ()
         priv = THIS->private;
         GF_ASSERT (priv);
 
-        ret = glusterd_unlock (priv->uuid);
+        ret = glusterd_scoped_unlock (opinfo->lock_volname, priv->uuid);
 
         if (ret) {
                 gf_log ("glusterd", GF_LOG_CRITICAL,
@@ -7143,18 +7285,21 @@ glusterd_op_txn_complete ()
                 goto out;
         }
 
+        glusterd_op_clear_lock_volname ();
+        opinfo->locked = _gf_false;
+
         gf_log ("glusterd", GF_LOG_INFO, "Cleared local lock");
 
-        op_ret = opinfo.op_ret;
-        op_errno = opinfo.op_errno;
-        cli_op = opinfo.cli_op;
-        req = opinfo.req;
-        if (opinfo.op_errstr)
-                op_errstr = opinfo.op_errstr;
+        op_ret = opinfo->op_ret;
+        op_errno = opinfo->op_errno;
+        cli_op = opinfo->cli_op;
+        req = opinfo->req;
+        if (opinfo->op_errstr)
+                op_errstr = opinfo->op_errstr;
 
 
-        opinfo.op_ret = 0;
-        opinfo.op_errno = 0;
+        opinfo->op_ret = 0;
+        opinfo->op_errno = 0;
 
         op = glusterd_op_get_op ();
 
@@ -7170,7 +7315,6 @@ glusterd_op_txn_complete ()
         }
 
 out:
-        pthread_mutex_unlock (&opinfo.lock);
         ret = glusterd_op_send_cli_response (cli_op, op_ret,
                                              op_errno, req, ctx, op_errstr);
 
@@ -7369,19 +7513,120 @@ glusterd_op_ac_send_commit_failed (glusterd_op_sm_event_t *event, void *ctx)
         op_ctx = glusterd_op_get_ctx (req_ctx->op);
 
         ret = glusterd_op_commit_send_resp (req_ctx->req, req_ctx->op,
-                                            opinfo.op_ret, opinfo.op_errstr,
+                                            opinfo->op_ret, opinfo->op_errstr,
                                             op_ctx);
 
         glusterd_op_fini_ctx (req_ctx->op);
-        if (opinfo.op_errstr && (strcmp (opinfo.op_errstr, ""))) {
-                GF_FREE (opinfo.op_errstr);
-                opinfo.op_errstr = NULL;
+        if (opinfo->op_errstr && (strcmp (opinfo->op_errstr, ""))) {
+                GF_FREE (opinfo->op_errstr);
+                opinfo->op_errstr = NULL;
         }
 
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
 
+/* The op txn runs, remembered as the op itself is cleared on unlock. */
+static glusterd_op_t
+glusterd_op_txn_stats_op (glusterd_op_info_t *txn)
+{
+        int     i = 0;
+
+        if (txn->stats_op)
+                return txn->stats_op;
+
+        for (i = GD_OP_NONE + 1; i < GD_OP_MAX; i++) {
+                if (txn->op[i]) {
+                        txn->stats_op = i;
+                        break;
+                }
+        }
+
+        return txn->stats_op;
+}
+
+/* Charges the time txn spent in its current state to the phase waiting
+ * in it stands for, as it moves on to next.
+ */
+static void
+glusterd_op_txn_time_state (glusterd_op_info_t *txn,
+                            glusterd_op_sm_state_t next)
+{
+        glusterd_conf_t         *priv = NULL;
+        glusterd_op_t           op = GD_OP_NONE;
+        uint64_t                now = 0;
+        int                     phase = -1;
+
+        if (next == txn->state.state)
+                return;
+
+        priv = THIS->private;
+        now = glusterd_monotonic_us ();
+        op = glusterd_op_txn_stats_op (txn);
+
+        switch (txn->state.state) {
+        case GD_OP_STATE_DEFAULT:
+                txn->started_us = now;
+                break;
+        case GD_OP_STATE_LOCK_SENT:
+                phase = GD_TXN_PHASE_LOCK;
+                break;
+        case GD_OP_STATE_STAGE_OP_SENT:
+                phase = GD_TXN_PHASE_STAGE;
+                break;
+        case GD_OP_STATE_BRICK_OP_SENT:
+                phase = GD_TXN_PHASE_BRICK_OP;
+                break;
+        case GD_OP_STATE_COMMIT_OP_SENT:
+                phase = GD_TXN_PHASE_COMMIT;
+                break;
+        case GD_OP_STATE_UNLOCK_SENT:
+                phase = GD_TXN_PHASE_UNLOCK;
+                break;
+        default:
+                break;
+        }
+
+        if (op != GD_OP_NONE) {
+                if (phase >= 0)
+                        glusterd_txn_stats_add (priv, op, phase,
+                                                now - txn->entered_us);
+                if ((next == GD_OP_STATE_DEFAULT) && txn->started_us)
+                        glusterd_txn_stats_add (priv, op, GD_TXN_PHASE_TOTAL,
+                                                now - txn->started_us);
+        }
+
+        txn->entered_us = now;
+}
+
+/* Charges the time the handler of event took on this node. */
+static void
+glusterd_op_txn_time_action (glusterd_op_info_t *txn,
+                             glusterd_op_sm_event_type_t event,
+                             uint64_t start_us)
+{
+        glusterd_op_t           op = GD_OP_NONE;
+        int                     phase = 0;
+
+        switch (event) {
+        case GD_OP_EVENT_STAGE_OP:
+                phase = GD_TXN_PHASE_STAGE_LOCAL;
+                break;
+        case GD_OP_EVENT_COMMIT_OP:
+                phase = GD_TXN_PHASE_COMMIT_LOCAL;
+                break;
+        default:
+                return;
+        }
+
+        op = glusterd_op_txn_stats_op (txn);
+        if (op == GD_OP_NONE)
+                return;
+
+        glusterd_txn_stats_add (THIS->private, op, phase,
+                                glusterd_monotonic_us () - start_us);
+}
+
 static int
 glusterd_op_sm_transition_state (glusterd_op_info_t *opinfo,
                                  glusterd_op_sm_t *state,
@@ -7400,10 +7645,212 @@ glusterd_op_sm_transition_state (glusterd_op_info_t *opinfo,
                                            state[event_type].next_state,
                                            event_type);
 
+        glusterd_op_txn_time_state (opinfo, state[event_type].next_state);
         opinfo->state.state = state[event_type].next_state;
         return 0;
 }
 
+/* A batch carries "count" entries, each a volume set, start or stop: entry
+ * i is its "op" ("set", "start" or "stop") and the keys that op takes,
+ * all prefixed with "batch<i>.". The
+ * whole batch is staged, then committed, in one transaction, so it costs
+ * one round to the peers and one store of each volume it changes.
+ */
+typedef struct glusterd_op_batch_ {
+        int32_t         count;
+        dict_t          **entries;
+        int             ret;
+} glusterd_op_batch_t;
+
+static void
+_glusterd_op_batch_split (dict_t *this, char *key, data_t *value, void *data)
+{
+        glusterd_op_batch_t     *batch = NULL;
+        char                    *end = NULL;
+        long                    i = 0;
+
+        batch = data;
+
+        if (batch->ret || strncmp (key, "batch", 5))
+                return;
+
+        i = strtol (key + 5, &end, 10);
+        if ((end == key + 5) || (*end != '.') || (i < 0) ||
+            (i >= batch->count))
+                return;
+
+        if (dict_set (batch->entries[i], end + 1, value))
+                batch->ret = -1;
+}
+
+static void
+glusterd_op_batch_free (glusterd_op_batch_t *batch)
+{
+        int     i = 0;
+
+        if (!batch->entries)
+                return;
+
+        for (i = 0; i < batch->count; i++) {
+                if (batch->entries[i])
+                        dict_unref (batch->entries[i]);
+        }
+        GF_FREE (batch->entries);
+        batch->entries = NULL;
+}
+
+static int
+glusterd_op_batch_split (dict_t *dict, glusterd_op_batch_t *batch)
+{
+        int     ret = -1;
+        int     i = 0;
+
+        ret = dict_get_int32 (dict, "count", &batch->count);
+        if (ret || (batch->count <= 0) ||
+            (batch->count > GLUSTERD_BATCH_MAX)) {
+                batch->count = 0;
+                ret = -1;
+                goto out;
+        }
+
+        ret = -1;
+        batch->entries = GF_CALLOC (batch->count, sizeof (dict_t *),
+                                    gf_gld_mt_op_batch_t);
+        if (!batch->entries)
+                goto out;
+
+        for (i = 0; i < batch->count; i++) {
+                batch->entries[i] = dict_new ();
+                if (!batch->entries[i])
+                        goto out;
+        }
+
+        batch->ret = 0;
+        dict_foreach (dict, _glusterd_op_batch_split, batch);
+        ret = batch->ret;
+out:
+        if (ret)
+                glusterd_op_batch_free (batch);
+        return ret;
+}
+
+/* Replaces *op_errstr by the error of entry i, naming the entry. */
+static void
+glusterd_op_batch_errstr (dict_t *entry, int i, char **op_errstr)
+{
+        char    msg[2048] = {0,};
+        char    *volname = NULL;
+
+        if (dict_get_str (entry, "volname", &volname))
+                volname = "-";
+
+        snprintf (msg, sizeof (msg), "batch entry %d (volume %s): %s", i,
+                  volname, (*op_errstr && strcmp (*op_errstr, "")) ?
+                  *op_errstr : "failed");
+
+        if (*op_errstr && strcmp (*op_errstr, ""))
+                GF_FREE (*op_errstr);
+        *op_errstr = gf_strdup (msg);
+}
+
+/* The op of a batch entry, GD_OP_NONE if it may not be batched. */
+static glusterd_op_t
+glusterd_op_batch_entry_op (dict_t *entry)
+{
+        char    *op = NULL;
+
+        if (dict_get_str (entry, "op", &op))
+                return GD_OP_NONE;
+
+        if (!strcmp (op, "set"))
+                return GD_OP_SET_VOLUME;
+        if (!strcmp (op, "start"))
+                return GD_OP_START_VOLUME;
+        if (!strcmp (op, "stop"))
+                return GD_OP_STOP_VOLUME;
+
+        return GD_OP_NONE;
+}
+
+/* Every entry is staged against the volumes as they are before the
+ * batch, and any of them failing fails the whole batch.
+ */
+static int
+glusterd_op_stage_batch (dict_t *dict, char **op_errstr, dict_t *rsp_dict)
+{
+        glusterd_op_batch_t     batch = {0,};
+        glusterd_op_t           op = GD_OP_NONE;
+        int                     ret = -1;
+        int                     i = 0;
+
+        ret = glusterd_op_batch_split (dict, &batch);
+        if (ret) {
+                *op_errstr = gf_strdup ("Invalid volume batch");
+                goto out;
+        }
+
+        for (i = 0; i < batch.count; i++) {
+                op = glusterd_op_batch_entry_op (batch.entries[i]);
+                if (op == GD_OP_NONE) {
+                        ret = -1;
+                        glusterd_op_batch_errstr (batch.entries[i], i,
+                                                  op_errstr);
+                        goto out;
+                }
+
+                ret = glusterd_op_stage_validate (op, batch.entries[i],
+                                                  op_errstr, rsp_dict);
+                if (ret) {
+                        glusterd_op_batch_errstr (batch.entries[i], i,
+                                                  op_errstr);
+                        goto out;
+                }
+        }
+
+out:
+        glusterd_op_batch_free (&batch);
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+/* Commits the entries in order, within the store batch of the whole op,
+ * and stops at the first one failing: the ones before it stay committed,
+ * as the steps of any other op would.
+ */
+static int
+glusterd_op_batch (dict_t *dict, char **op_errstr, dict_t *rsp_dict)
+{
+        glusterd_op_batch_t     batch = {0,};
+        glusterd_op_t           op = GD_OP_NONE;
+        int                     ret = -1;
+        int                     i = 0;
+
+        ret = glusterd_op_batch_split (dict, &batch);
+        if (ret)
+                goto out;
+
+        for (i = 0; i < batch.count; i++) {
+                op = glusterd_op_batch_entry_op (batch.entries[i]);
+                if (op == GD_OP_NONE) {
+                        ret = -1;
+                        goto out;
+                }
+
+                ret = glusterd_op_commit_perform (op, batch.entries[i],
+                                                  op_errstr, rsp_dict);
+                if (ret) {
+                        glusterd_op_batch_errstr (batch.entries[i], i,
+                                                  op_errstr);
+                        goto out;
+                }
+        }
+
+out:
+        glusterd_op_batch_free (&batch);
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
 int32_t
 glusterd_op_stage_validate (glusterd_op_t op, dict_t *dict, char **op_errstr,
                             dict_t *rsp_dict)
@@ -7476,6 +7923,11 @@ glusterd_op_stage_validate (glusterd_op_t op, dict_t *dict, char **op_errstr,
                         ret = glusterd_op_stage_log_level (dict, op_errstr);
                         break;
 
+                case GD_OP_BATCH:
+                        ret = glusterd_op_stage_batch (dict, op_errstr,
+                                                       rsp_dict);
+                        break;
+
                 default:
                         gf_log ("", GF_LOG_ERROR, "Unknown op %d",
                                 op);
@@ -7493,6 +7945,9 @@ glusterd_op_commit_perform (glusterd_op_t op, dict_t *dict, char **op_errstr,
 {
         int ret = -1;
 
+        /* every volume the op stores is written once, at the end */
+        glusterd_store_batch_begin ();
+
         switch (op) {
                 case GD_OP_CREATE_VOLUME:
                         ret = glusterd_op_create_volume (dict, op_errstr);
@@ -7559,12 +8014,19 @@ glusterd_op_commit_perform (glusterd_op_t op, dict_t *dict, char **op_errstr,
                        ret = glusterd_op_log_level (dict);
                        break;
 
+                case GD_OP_BATCH:
+                        ret = glusterd_op_batch (dict, op_errstr, rsp_dict);
+                        break;
+
                 default:
                         gf_log ("", GF_LOG_ERROR, "Unknown op %d",
                                 op);
                         break;
         }
 
+        if (glusterd_store_batch_commit () && !ret)
+                ret = -1;
+
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
 
         return ret;
@@ -7675,7 +8137,7 @@ glusterd_bricks_select_stop_volume (dict_t *dict, char **op_errstr)
                                 goto out;
                         } else {
                                 pending_node->node = brickinfo;
-                                list_add_tail (&pending_node->list, &opinfo.pending_bricks);
+                                list_add_tail (&pending_node->list, &opinfo->pending_bricks);
                                 pending_node = NULL;
                         }
                 }
@@ -7739,7 +8201,7 @@ glusterd_bricks_select_remove_brick (dict_t *dict, char **op_errstr)
                                 goto out;
                         } else {
                                 pending_node->node = brickinfo;
-                                list_add_tail (&pending_node->list, &opinfo.pending_bricks);
+                                list_add_tail (&pending_node->list, &opinfo->pending_bricks);
                                 pending_node = NULL;
                         }
                 }
@@ -7807,7 +8269,7 @@ glusterd_bricks_select_profile_volume (dict_t *dict, char **op_errstr)
                                 } else {
                                         pending_node->node = brickinfo;
                                         list_add_tail (&pending_node->list,
-                                                       &opinfo.pending_bricks);
+                                                       &opinfo->pending_bricks);
                                         pending_node = NULL;
                                 }
                         }
@@ -7830,7 +8292,7 @@ glusterd_bricks_select_profile_volume (dict_t *dict, char **op_errstr)
                         } else {
                                 pending_node->node = brickinfo;
                                 list_add_tail (&pending_node->list,
-                                               &opinfo.pending_bricks);
+                                               &opinfo->pending_bricks);
                                 pending_node = NULL;
                                 goto out;
                         }
@@ -7846,7 +8308,7 @@ glusterd_bricks_select_profile_volume (dict_t *dict, char **op_errstr)
                                 } else {
                                         pending_node->node = brickinfo;
                                         list_add_tail (&pending_node->list,
-                                                       &opinfo.pending_bricks);
+                                                       &opinfo->pending_bricks);
                                         pending_node = NULL;
                                 }
                         }
@@ -7884,6 +8346,9 @@ glusterd_op_ac_send_brick_op (glusterd_op_sm_event_t *event, void *ctx)
 
         if (ctx) {
                 req_ctx = ctx;
+                ret = glusterd_op_init_ctx (req_ctx->op);
+                if (ret)
+                        goto out;
         } else {
                 req_ctx = GF_CALLOC (1, sizeof (*req_ctx),
                                      gf_gld_mt_op_allack_ctx_t);
@@ -7894,6 +8359,7 @@ glusterd_op_ac_send_brick_op (glusterd_op_sm_event_t *event, void *ctx)
                 if (ret)//TODO:what to do??
                         goto out;
         }
+        uuid_copy (req_ctx->txn_id, opinfo->txn_id);
 
         proc = &priv->gfs_mgmt->proctable[GD_MGMT_BRICK_OP];
         if (proc->fn) {
@@ -7902,8 +8368,8 @@ glusterd_op_ac_send_brick_op (glusterd_op_sm_event_t *event, void *ctx)
                         goto out;
         }
 
-        if (!opinfo.pending_count && !opinfo.brick_pending_count) {
-                glusterd_clear_pending_nodes (&opinfo.pending_bricks);
+        if (!opinfo->pending_count && !opinfo->brick_pending_count) {
+                glusterd_clear_pending_nodes (&opinfo->pending_bricks);
                 ret = glusterd_op_sm_inject_event (GD_OP_EVENT_ALL_ACK, req_ctx);
         }
 
@@ -7936,7 +8402,7 @@ glusterd_op_ac_rcvd_brick_op_acc (glusterd_op_sm_event_t *event, void *ctx)
         brickinfo = ev_ctx->brickinfo;
         GF_ASSERT (brickinfo);
 
-        ret = glusterd_remove_pending_entry (&opinfo.pending_bricks, brickinfo);
+        ret = glusterd_remove_pending_entry (&opinfo->pending_bricks, brickinfo);
         if (ret) {
                 gf_log ("glusterd", GF_LOG_ERROR, "unknown response received "
                         "from %s:%s", brickinfo->hostname, brickinfo->path);
@@ -7945,14 +8411,14 @@ glusterd_op_ac_rcvd_brick_op_acc (glusterd_op_sm_event_t *event, void *ctx)
                 goto out;
         }
 
-        if (opinfo.brick_pending_count > 0)
-                opinfo.brick_pending_count--;
+        if (opinfo->brick_pending_count > 0)
+                opinfo->brick_pending_count--;
         op = req_ctx->op;
         op_ctx = glusterd_op_get_ctx (op);
 
         glusterd_handle_brick_rsp (brickinfo, op, ev_ctx->rsp_dict,
                                    op_ctx, &op_errstr);
-        if (opinfo.brick_pending_count > 0)
+        if (opinfo->brick_pending_count > 0)
                 goto out;
 
         ret = glusterd_op_sm_inject_event (GD_OP_EVENT_ALL_ACK, ev_ctx->commit_ctx);
@@ -8254,6 +8720,415 @@ glusterd_op_sm_t *glusterd_op_state_table [] = {
         glusterd_op_state_brick_commit_failed
 };
 
+static glusterd_op_info_t *
+glusterd_op_txn_new (uuid_t txn_id)
+{
+        glusterd_op_info_t      *txn = NULL;
+
+        txn = GF_CALLOC (1, sizeof (*txn), gf_gld_mt_op_info_t);
+        if (!txn)
+                return NULL;
+
+        uuid_copy (txn->txn_id, txn_id);
+        INIT_LIST_HEAD (&txn->txn_list);
+        INIT_LIST_HEAD (&txn->op_peers);
+        INIT_LIST_HEAD (&txn->pending_bricks);
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        list_add_tail (&txn->txn_list, &gd_op_txns);
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        gf_log ("glusterd", GF_LOG_DEBUG, "Created txn %s",
+                uuid_utoa (txn->txn_id));
+        return txn;
+}
+
+glusterd_op_info_t *
+glusterd_op_txn_find (uuid_t txn_id)
+{
+        glusterd_op_info_t      *txn = NULL;
+        glusterd_op_info_t      *found = NULL;
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        list_for_each_entry (txn, &gd_op_txns, txn_list) {
+                if (!uuid_compare (txn->txn_id, txn_id)) {
+                        found = txn;
+                        break;
+                }
+        }
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        return found;
+}
+
+glusterd_op_info_t *
+glusterd_op_txn_get ()
+{
+        return opinfo;
+}
+
+/* Notes that the current phase of txn waits on an answer from peerinfo. */
+static int
+glusterd_op_peer_pending_add (glusterd_op_info_t *txn,
+                              glusterd_peerinfo_t *peerinfo, uint32_t *seqp)
+{
+        glusterd_op_peer_t      *peer = NULL;
+
+        peer = GF_CALLOC (1, sizeof (*peer), gf_gld_mt_op_peer_t);
+        if (!peer)
+                return -1;
+
+        INIT_LIST_HEAD (&peer->list);
+        uuid_copy (peer->uuid, peerinfo->uuid);
+        peer->sent_us = glusterd_monotonic_us ();
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        {
+                /* 0 tags requests sent outside a fan-out */
+                if (!++gd_op_peer_seq)
+                        ++gd_op_peer_seq;
+                peer->seq = gd_op_peer_seq;
+                list_add_tail (&peer->list, &txn->op_peers);
+        }
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        *seqp = peer->seq;
+        return 0;
+}
+
+static glusterd_op_peer_t *
+glusterd_op_peer_pending_del (glusterd_op_info_t *txn, uint32_t seq)
+{
+        glusterd_op_peer_t      *peer = NULL;
+        glusterd_op_peer_t      *found = NULL;
+        gf_timer_t              *timer = NULL;
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        {
+                list_for_each_entry (peer, &txn->op_peers, list) {
+                        if (peer->seq == seq) {
+                                found = peer;
+                                list_del_init (&found->list);
+                                break;
+                        }
+                }
+                if (found && list_empty (&txn->op_peers)) {
+                        timer = txn->phase_timer;
+                        txn->phase_timer = NULL;
+                }
+        }
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        if (timer)
+                gf_timer_call_cancel (THIS->ctx, timer);
+
+        return found;
+}
+
+/* Fails the current phase of txn on behalf of a peer, the same way a
+ * rejection from it would.
+ */
+static int
+glusterd_op_peer_failed (glusterd_op_info_t *txn, const char *peer_str,
+                         const char *fmt)
+{
+        char    err_str[2048] = {0,};
+
+        txn->op_ret = -1;
+        if (!txn->op_errstr) {
+                snprintf (err_str, sizeof (err_str), fmt, peer_str);
+                txn->op_errstr = gf_strdup (err_str);
+        }
+
+        return glusterd_op_sm_inject_txn_event (GD_OP_EVENT_RCVD_RJT,
+                                                txn->txn_id, NULL);
+}
+
+/* Called with the answer tagged seq. Returns -1 if txn was not waiting
+ * on it any more, i.e. the answer came after the deadline of its phase
+ * and the peer has already been counted as failed.
+ */
+int
+glusterd_op_peer_rsp (glusterd_op_info_t *txn, uint32_t seq)
+{
+        glusterd_op_peer_t      *peer = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+        uint64_t                latency = 0;
+
+        if (!seq)
+                return 0;
+
+        peer = glusterd_op_peer_pending_del (txn, seq);
+        if (!peer) {
+                gf_log ("glusterd", GF_LOG_INFO, "Dropping late answer for "
+                        "txn %s", uuid_utoa (txn->txn_id));
+                return -1;
+        }
+
+        latency = glusterd_monotonic_us () - peer->sent_us;
+
+        if (!glusterd_friend_find (peer->uuid, NULL, &peerinfo)) {
+                peerinfo->op_rsp_count++;
+                peerinfo->op_latency_total += latency;
+                if (latency > peerinfo->op_latency_max)
+                        peerinfo->op_latency_max = latency;
+        }
+
+        gf_log ("glusterd", GF_LOG_DEBUG, "%s answered in %"PRIu64"us",
+                uuid_utoa (peer->uuid), latency);
+        GF_FREE (peer);
+
+        return 0;
+}
+
+/* a request of a txn that can not be answered any more */
+typedef struct glusterd_op_lost_ {
+        uuid_t          txn_id;
+        uint32_t        seq;
+} glusterd_op_lost_t;
+
+/* Runs on the event thread, see glusterd_op_peer_lost (). The txn is
+ * looked up again, it may have ended since.
+ */
+static void
+glusterd_op_peer_lost_handle (void *data)
+{
+        glusterd_op_lost_t      *lost = NULL;
+        glusterd_op_info_t      *txn = NULL;
+        glusterd_op_peer_t      *peer = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+        int                     ret = -1;
+
+        lost = data;
+
+        pthread_mutex_lock (&gd_op_sm_lock);
+
+        txn = glusterd_op_txn_find (lost->txn_id);
+        if (!txn)
+                goto unlock;
+
+        peer = glusterd_op_peer_pending_del (txn, lost->seq);
+        if (!peer)
+                goto unlock;
+
+        glusterd_friend_find (peer->uuid, NULL, &peerinfo);
+        gf_log ("glusterd", GF_LOG_ERROR, "Lost the request to %s for txn "
+                "%s", peerinfo ? peerinfo->hostname : uuid_utoa (peer->uuid),
+                uuid_utoa (txn->txn_id));
+
+        ret = glusterd_op_peer_failed (txn, peerinfo ? peerinfo->hostname :
+                                       uuid_utoa (peer->uuid),
+                                       "Request to %s failed");
+        GF_FREE (peer);
+unlock:
+        pthread_mutex_unlock (&gd_op_sm_lock);
+
+        GF_FREE (lost);
+        if (!ret)
+                glusterd_op_sm ();
+}
+
+/* Fails the phase of txn for the peer the request tagged seq went to, as
+ * soon as that request can not be answered any more: the connection went
+ * down or the peer refused it. The callback this comes from may run from
+ * a failed submit inside the state machine or from the timer thread when
+ * the call bails out, so all of it is done on the event thread.
+ */
+int
+glusterd_op_peer_lost (glusterd_op_info_t *txn, uint32_t seq)
+{
+        glusterd_op_lost_t      *lost = NULL;
+        int                     ret = -1;
+
+        if (!seq)
+                goto out;
+
+        lost = GF_CALLOC (1, sizeof (*lost), gf_gld_mt_op_lost_t);
+        if (!lost)
+                goto out;
+        uuid_copy (lost->txn_id, txn->txn_id);
+        lost->seq = seq;
+
+        ret = glusterd_defer (glusterd_op_peer_lost_handle, lost);
+        if (ret) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to hand the lost "
+                        "request of txn %s to the event thread",
+                        uuid_utoa (txn->txn_id));
+                GF_FREE (lost);
+        }
+out:
+        return ret;
+}
+
+/* Deadline of a stage or commit phase: every peer still not heard from
+ * fails the phase, and answers they send later are dropped. Runs on the
+ * event thread, see glusterd_op_phase_timeout ().
+ */
+static void
+glusterd_op_phase_expire (void *data)
+{
+        glusterd_conf_t         *priv = NULL;
+        glusterd_op_info_t      *txn = NULL;
+        glusterd_op_info_t      *found = NULL;
+        glusterd_op_peer_t      *peer = NULL;
+        glusterd_op_peer_t      *tmp = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+        gf_timer_t              *timer = NULL;
+        struct list_head        laggards;
+        uint32_t                phase = 0;
+        int                     count = 0;
+
+        priv = THIS->private;
+        phase = (uint32_t)(unsigned long) data;
+        INIT_LIST_HEAD (&laggards);
+
+        pthread_mutex_lock (&gd_op_sm_lock);
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        {
+                list_for_each_entry (txn, &gd_op_txns, txn_list) {
+                        if (txn->phase == phase) {
+                                found = txn;
+                                break;
+                        }
+                }
+                if (found) {
+                        /* fired, cancelling only frees it */
+                        timer = found->phase_timer;
+                        found->phase_timer = NULL;
+                        list_splice_init (&found->op_peers, &laggards);
+                }
+        }
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        if (timer)
+                gf_timer_call_cancel (THIS->ctx, timer);
+
+        list_for_each_entry_safe (peer, tmp, &laggards, list) {
+                peerinfo = NULL;
+                glusterd_friend_find (peer->uuid, NULL, &peerinfo);
+                if (peerinfo)
+                        peerinfo->op_timeouts++;
+
+                gf_log ("glusterd", GF_LOG_ERROR, "No answer from %s for "
+                        "txn %s in %us", peerinfo ? peerinfo->hostname :
+                        uuid_utoa (peer->uuid), uuid_utoa (found->txn_id),
+                        priv->op_timeout);
+
+                if (!glusterd_op_peer_failed (found, peerinfo ?
+                                              peerinfo->hostname :
+                                              uuid_utoa (peer->uuid),
+                                              "Operation timed out on %s"))
+                        count++;
+
+                list_del_init (&peer->list);
+                GF_FREE (peer);
+        }
+
+        pthread_mutex_unlock (&gd_op_sm_lock);
+
+        if (count)
+                glusterd_op_sm ();
+}
+
+/* Timer callback of the phase deadline, the state machine is only driven
+ * from the event thread. The phase number tells a stale deadline apart.
+ */
+static void
+glusterd_op_phase_timeout (void *data)
+{
+        if (glusterd_defer (glusterd_op_phase_expire, data))
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to hand the "
+                        "deadline of phase %lu to the event thread",
+                        (unsigned long) data);
+}
+
+/* Gives the peers sent to in this phase of txn op-timeout to answer. */
+static void
+glusterd_op_phase_arm (glusterd_op_info_t *txn)
+{
+        glusterd_conf_t         *priv = NULL;
+        struct timeval          timeout = {0,};
+        gf_timer_t              *timer = NULL;
+        uint32_t                phase = 0;
+
+        priv = THIS->private;
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        {
+                timer = txn->phase_timer;
+                txn->phase_timer = NULL;
+                if (!++gd_op_phase_seq)
+                        ++gd_op_phase_seq;
+                phase = txn->phase = gd_op_phase_seq;
+        }
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        if (timer)
+                gf_timer_call_cancel (THIS->ctx, timer);
+
+        timeout.tv_sec = priv->op_timeout;
+        timer = gf_timer_call_after (THIS->ctx, timeout,
+                                     glusterd_op_phase_timeout,
+                                     (void *)(unsigned long) phase);
+        if (!timer) {
+                gf_log ("glusterd", GF_LOG_WARNING, "Unable to arm the "
+                        "deadline of txn %s", uuid_utoa (txn->txn_id));
+                return;
+        }
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        {
+                if (txn->phase == phase) {
+                        txn->phase_timer = timer;
+                        timer = NULL;
+                }
+        }
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        if (timer)
+                gf_timer_call_cancel (THIS->ctx, timer);
+}
+
+static void
+glusterd_op_txn_destroy (glusterd_op_info_t *txn)
+{
+        glusterd_op_peer_t      *peer = NULL;
+        glusterd_op_peer_t      *tmp = NULL;
+
+        GF_ASSERT (txn);
+
+        pthread_mutex_lock (&gd_op_txn_lock);
+        list_del_init (&txn->txn_list);
+        if (txn->cli_op && (gd_op_cli_txns > 0))
+                gd_op_cli_txns--;
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        if (txn->locked) {
+                gf_log ("glusterd", GF_LOG_WARNING, "txn %s ended without "
+                        "releasing its lock", uuid_utoa (txn->txn_id));
+                (void) glusterd_scoped_unlock (txn->lock_volname,
+                                               txn->lock_owner);
+        }
+
+        glusterd_clear_pending_nodes (&txn->pending_bricks);
+        if (txn->lock_volname)
+                GF_FREE (txn->lock_volname);
+
+        if (txn->phase_timer)
+                gf_timer_call_cancel (THIS->ctx, txn->phase_timer);
+        list_for_each_entry_safe (peer, tmp, &txn->op_peers, list) {
+                list_del_init (&peer->list);
+                GF_FREE (peer);
+        }
+
+        gf_log ("glusterd", GF_LOG_DEBUG, "Destroyed txn %s",
+                uuid_utoa (txn->txn_id));
+        if (opinfo == txn)
+                opinfo = NULL;
+        GF_FREE (txn);
+}
+
 int
 glusterd_op_sm_new_event (glusterd_op_sm_event_type_t event_type,
                           glusterd_op_sm_event_t **new_event)
@@ -8277,8 +9152,8 @@ glusterd_op_sm_new_event (glusterd_op_sm_event_type_t event_type,
 }
 
 int
-glusterd_op_sm_inject_event (glusterd_op_sm_event_type_t event_type,
-                             void *ctx)
+glusterd_op_sm_inject_txn_event (glusterd_op_sm_event_type_t event_type,
+                                 uuid_t txn_id, void *ctx)
 {
         int32_t                 ret = -1;
         glusterd_op_sm_event_t  *event = NULL;
@@ -8292,15 +9167,35 @@ glusterd_op_sm_inject_event (glusterd_op_sm_event_type_t event_type,
                 goto out;
 
         event->ctx = ctx;
+        uuid_copy (event->txn_id, txn_id);
 
-        gf_log ("glusterd", GF_LOG_DEBUG, "Enqueuing event: '%s'",
-                glusterd_op_sm_event_name_get (event->event));
+        gf_log ("glusterd", GF_LOG_DEBUG, "Enqueuing event: '%s' for txn %s",
+                glusterd_op_sm_event_name_get (event->event),
+                uuid_utoa (event->txn_id));
         list_add_tail (&event->list, &gd_op_sm_queue);
 
 out:
         return ret;
 }
 
+/* Queue an event for the transaction currently being driven by the
+ * state machine, or for the one being set up by a cli handler.
+ */
+int
+glusterd_op_sm_inject_event (glusterd_op_sm_event_type_t event_type,
+                             void *ctx)
+{
+        if (!opinfo) {
+                gf_log ("glusterd", GF_LOG_ERROR, "No transaction to "
+                        "inject '%s' into",
+                        glusterd_op_sm_event_name_get (event_type));
+                return -1;
+        }
+
+        return glusterd_op_sm_inject_txn_event (event_type, opinfo->txn_id,
+                                                ctx);
+}
+
 void
 glusterd_destroy_req_ctx (glusterd_req_ctx_t *ctx)
 {
@@ -8340,9 +9235,14 @@ glusterd_op_sm ()
         glusterd_op_sm_ac_fn            handler = NULL;
         glusterd_op_sm_t                *state = NULL;
         glusterd_op_sm_event_type_t     event_type = GD_OP_EVENT_NONE;
+        glusterd_op_info_t              *saved = NULL;
+        glusterd_op_info_t              *txn = NULL;
+        uint64_t                        start_us = 0;
 
         (void ) pthread_mutex_lock (&gd_op_sm_lock);
 
+        saved = opinfo;
+
         while (!list_empty (&gd_op_sm_queue)) {
 
                 list_for_each_entry_safe (event, tmp, &gd_op_sm_queue, list) {
@@ -8352,41 +9252,71 @@ glusterd_op_sm ()
                         gf_log ("", GF_LOG_DEBUG, "Dequeued event of type: '%s'",
                                 glusterd_op_sm_event_name_get(event_type));
 
-                        state = glusterd_op_state_table[opinfo.state.state];
+                        txn = glusterd_op_txn_find (event->txn_id);
+                        if (!txn && ((event_type == GD_OP_EVENT_LOCK) ||
+                                     (event_type == GD_OP_EVENT_UNLOCK)))
+                                txn = glusterd_op_txn_new (event->txn_id);
+
+                        if (!txn) {
+                                gf_log ("glusterd", GF_LOG_DEBUG,
+                                        "Dropping '%s' for unknown txn %s",
+                                        glusterd_op_sm_event_name_get (event_type),
+                                        uuid_utoa (event->txn_id));
+                                glusterd_destroy_op_event_ctx (event);
+                                GF_FREE (event);
+                                continue;
+                        }
+
+                        opinfo = txn;
+                        state = glusterd_op_state_table[opinfo->state.state];
 
                         GF_ASSERT (state);
 
                         handler = state[event_type].handler;
                         GF_ASSERT (handler);
 
+                        start_us = glusterd_monotonic_us ();
                         ret = handler (event, event->ctx);
+                        glusterd_op_txn_time_action (txn, event_type,
+                                                     start_us);
 
                         if (ret) {
                                 gf_log ("glusterd", GF_LOG_ERROR,
                                         "handler returned: %d", ret);
                                 glusterd_destroy_op_event_ctx (event);
                                 GF_FREE (event);
-                                continue;
+                                goto reap;
                         }
 
-                        ret = glusterd_op_sm_transition_state (&opinfo, state,
+                        ret = glusterd_op_sm_transition_state (opinfo, state,
                                                                 event_type);
 
                         if (ret) {
                                 gf_log ("glusterd", GF_LOG_ERROR,
                                         "Unable to transition"
                                         "state from '%s' to '%s'",
-                         glusterd_op_sm_state_name_get(opinfo.state.state),
+                         glusterd_op_sm_state_name_get(opinfo->state.state),
                          glusterd_op_sm_state_name_get(state[event_type].next_state));
+                                opinfo = saved;
                                 (void ) pthread_mutex_unlock (&gd_op_sm_lock);
                                 return ret;
                         }
 
                         glusterd_destroy_op_event_ctx (event);
                         GF_FREE (event);
+reap:
+                        /* A transaction that is back in the default state
+                         * has nothing more to do on this node.
+                         */
+                        if (txn->state.state == GD_OP_STATE_DEFAULT) {
+                                if (txn == saved)
+                                        saved = NULL;
+                                glusterd_op_txn_destroy (txn);
+                        }
                 }
         }
 
+        opinfo = saved;
 
         (void ) pthread_mutex_unlock (&gd_op_sm_lock);
         ret = 0;
@@ -8401,9 +9331,9 @@ glusterd_op_set_op (glusterd_op_t op)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        opinfo.op[op] = 1;
-        opinfo.pending_op[op] = 1;
-        opinfo.commit_op[op] = 1;
+        opinfo->op[op] = 1;
+        opinfo->pending_op[op] = 1;
+        opinfo->commit_op[op] = 1;
 
         return 0;
 
@@ -8417,7 +9347,7 @@ glusterd_op_get_op ()
         int32_t ret = 0;
 
         for ( i = 0; i < GD_OP_MAX; i++) {
-                if (opinfo.op[i])
+                if (opinfo->op[i])
                         break;
         }
 
@@ -8435,14 +9365,38 @@ int32_t
 glusterd_op_set_cli_op (glusterd_op_t op)
 {
 
-        int32_t         ret = 0;
+        int32_t                 ret = -1;
+        glusterd_op_info_t      *txn = NULL;
+        uuid_t                  txn_id = {0,};
+        int32_t                 max_txns = GD_OP_MAX_CLI_TXNS;
 
-        ret = pthread_mutex_trylock (&opinfo.lock);
+        /* peers of mgmt version 1 tell transactions apart by the uuid
+         * of the originator, they can only follow one of ours at a time */
+        if (!glusterd_peers_support_txns ())
+                max_txns = 1;
 
-        if (ret)
+        pthread_mutex_lock (&gd_op_txn_lock);
+        if (gd_op_cli_txns >= max_txns) {
+                pthread_mutex_unlock (&gd_op_txn_lock);
+                gf_log ("glusterd", GF_LOG_ERROR, "%d transactions already "
+                        "in progress", gd_op_cli_txns);
+                goto out;
+        }
+        gd_op_cli_txns++;
+        pthread_mutex_unlock (&gd_op_txn_lock);
+
+        uuid_generate (txn_id);
+        txn = glusterd_op_txn_new (txn_id);
+        if (!txn) {
+                pthread_mutex_lock (&gd_op_txn_lock);
+                gd_op_cli_txns--;
+                pthread_mutex_unlock (&gd_op_txn_lock);
                 goto out;
+        }
 
-        opinfo.cli_op = op;
+        txn->cli_op = op;
+        opinfo = txn;
+        ret = 0;
 
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
@@ -8454,7 +9408,87 @@ glusterd_op_set_req (rpcsvc_request_t *req)
 {
 
         GF_ASSERT (req);
-        opinfo.req = req;
+        opinfo->req = req;
+        return 0;
+}
+
+/* Work out which lock a transaction for @op needs. Operations confined to
+ * a single volume only lock that volume, so that transactions on unrelated
+ * volumes do not serialize behind each other. Everything else, and any op
+ * while peers of mgmt version 1 are around, takes the cluster wide lock.
+ */
+int32_t
+glusterd_op_set_lock_volname (glusterd_op_t op, void *ctx)
+{
+        int32_t                 ret = 0;
+        char                    *volname = NULL;
+
+        GF_ASSERT (op < GD_OP_MAX);
+        GF_ASSERT (op > GD_OP_NONE);
+
+        glusterd_op_clear_lock_volname ();
+
+        switch (op) {
+        case GD_OP_DELETE_VOLUME:
+                if (ctx)
+                        volname = ((glusterd_op_delete_volume_ctx_t *)ctx)->volume_name;
+                break;
+
+        case GD_OP_CREATE_VOLUME:
+        case GD_OP_START_VOLUME:
+        case GD_OP_STOP_VOLUME:
+        case GD_OP_ADD_BRICK:
+        case GD_OP_REMOVE_BRICK:
+        case GD_OP_REPLACE_BRICK:
+        case GD_OP_SET_VOLUME:
+        case GD_OP_RESET_VOLUME:
+        case GD_OP_LOG_FILENAME:
+        case GD_OP_LOG_ROTATE:
+        case GD_OP_LOG_LEVEL:
+        case GD_OP_QUOTA:
+        case GD_OP_PROFILE_VOLUME:
+                ret = dict_get_str (ctx, "volname", &volname);
+                if (ret)
+                        volname = NULL;
+                break;
+
+        default:
+                /* sync, geo-replication, batch: cluster wide */
+                break;
+        }
+
+        /* older peers would take the cluster lock anyway */
+        if (volname && !glusterd_peers_support_txns ()) {
+                gf_log ("", GF_LOG_DEBUG, "Peers of mgmt version 1 in the "
+                        "cluster, locking it all");
+                volname = NULL;
+        }
+
+        if (volname) {
+                opinfo->lock_volname = gf_strdup (volname);
+                if (!opinfo->lock_volname)
+                        ret = -1;
+        }
+
+        gf_log ("", GF_LOG_DEBUG, "Lock scope for op %d: %s", op,
+                volname ? volname : "cluster");
+        return ret;
+}
+
+char *
+glusterd_op_get_lock_volname ()
+{
+        return opinfo->lock_volname;
+}
+
+int32_t
+glusterd_op_clear_lock_volname ()
+{
+        if (opinfo->lock_volname) {
+                GF_FREE (opinfo->lock_volname);
+                opinfo->lock_volname = NULL;
+        }
+
         return 0;
 }
 
@@ -8465,7 +9499,7 @@ glusterd_op_clear_pending_op (glusterd_op_t op)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        opinfo.pending_op[op] = 0;
+        opinfo->pending_op[op] = 0;
 
         return 0;
 
@@ -8478,7 +9512,7 @@ glusterd_op_clear_commit_op (glusterd_op_t op)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        opinfo.commit_op[op] = 0;
+        opinfo->commit_op[op] = 0;
 
         return 0;
 
@@ -8491,7 +9525,7 @@ glusterd_op_clear_op (glusterd_op_t op)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        opinfo.op[op] = 0;
+        opinfo->op[op] = 0;
 
         return 0;
 
@@ -8565,6 +9599,7 @@ glusterd_op_free_ctx (glusterd_op_t op, void *ctx, gf_boolean_t ctx_free)
                 case GD_OP_QUOTA:
                 case GD_OP_PROFILE_VOLUME:
                 case GD_OP_LOG_LEVEL:
+                case GD_OP_BATCH:
                         dict_unref (ctx);
                         break;
                 case GD_OP_DELETE_VOLUME:
@@ -8585,7 +9620,7 @@ glusterd_op_get_ctx (glusterd_op_t op)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        return opinfo.op_ctx[op];
+        return opinfo->op_ctx[op];
 
 }
 
@@ -8596,7 +9631,7 @@ glusterd_op_set_ctx_free (glusterd_op_t op, gf_boolean_t ctx_free)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        opinfo.ctx_free[op] = ctx_free;
+        opinfo->ctx_free[op] = ctx_free;
 
         return 0;
 
@@ -8609,7 +9644,7 @@ glusterd_op_clear_ctx_free (glusterd_op_t op)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        opinfo.ctx_free[op] = _gf_false;
+        opinfo->ctx_free[op] = _gf_false;
 
         return 0;
 
@@ -8621,7 +9656,7 @@ glusterd_op_get_ctx_free (glusterd_op_t op)
         GF_ASSERT (op < GD_OP_MAX);
         GF_ASSERT (op > GD_OP_NONE);
 
-        return opinfo.ctx_free[op];
+        return opinfo->ctx_free[op];
 
 }
 
@@ -8629,13 +9664,27 @@ int
 glusterd_op_sm_init ()
 {
         INIT_LIST_HEAD (&gd_op_sm_queue);
+        INIT_LIST_HEAD (&gd_op_txns);
         pthread_mutex_init (&gd_op_sm_lock, NULL);
+        pthread_mutex_init (&gd_op_txn_lock, NULL);
         return 0;
 }
 
+/* Drop the transaction set up by glusterd_op_set_cli_op () when the cli
+ * handler bails out before the transaction was started.
+ */
 int32_t
 glusterd_opinfo_unlock(){
-        return (pthread_mutex_unlock(&opinfo.lock));
+        glusterd_op_info_t *txn = opinfo;
+
+        if (!txn)
+                return 0;
+
+        opinfo = NULL;
+        if (txn->state.state == GD_OP_STATE_DEFAULT)
+                glusterd_op_txn_destroy (txn);
+
+        return 0;
 }
 int32_t
 glusterd_volume_stats_write_perf (char *brick_path, int32_t blk_size,
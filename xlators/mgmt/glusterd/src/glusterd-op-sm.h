@@ -42,6 +42,7 @@
 #include "protocol-common.h"
 
 #define GD_VOLUME_NAME_MAX 256
+#define GD_OP_MAX_CLI_TXNS 16
 
 typedef enum glusterd_op_sm_state_ {
         GD_OP_STATE_DEFAULT = 0,
@@ -83,6 +84,7 @@ struct glusterd_op_sm_event_ {
         struct list_head                list;
         void                            *ctx;
         glusterd_op_sm_event_type_t     event;
+        uuid_t                          txn_id;
 };
 
 typedef struct glusterd_op_sm_event_ glusterd_op_sm_event_t;
@@ -100,6 +102,8 @@ typedef struct glusterd_op_sm_state_info_ {
 } glusterd_op_sm_state_info_t;
 
 struct glusterd_op_info_ {
+        struct list_head                txn_list;
+        uuid_t                          txn_id;
         glusterd_op_sm_state_info_t     state;
         int32_t                         pending_count;
         int32_t                         brick_pending_count;
@@ -112,15 +116,51 @@ struct glusterd_op_info_ {
         rpcsvc_request_t                *req;
         int32_t                         op_ret;
         int32_t                         op_errno;
-        pthread_mutex_t                 lock;
         int32_t                         cli_op;
         gf_boolean_t                    ctx_free[GD_OP_MAX];
         char                            *op_errstr;
         struct  list_head               pending_bricks;
+        char                            *lock_volname; /* NULL: cluster */
+        gf_boolean_t                    locked;
+        uuid_t                          lock_owner;
+        uint32_t                        phase;  /* of the deadline armed */
+        gf_timer_t                      *phase_timer;
+        glusterd_op_t                   stats_op;       /* op timed */
+        uint64_t                        started_us;     /* left default */
+        uint64_t                        entered_us;     /* current state */
 };
 
 typedef struct glusterd_op_info_ glusterd_op_info_t;
 
+/* a peer the current stage or commit phase still waits on, in op_peers */
+typedef struct glusterd_op_peer_ {
+        struct list_head                list;
+        uint32_t                        seq;
+        uuid_t                          uuid;
+        uint64_t                        sent_us;
+} glusterd_op_peer_t;
+
+/* A stage or commit request on its way to all the peers. The request is
+ * the same for each peer of one mgmt version, so it is encoded once into
+ * the count vectors of that version (held by iobref) for the first such
+ * peer and sent as is to the rest: the XDR header, then its dict if it has
+ * one. seq tags the peer being sent to.
+ */
+typedef enum {
+        GD_OP_FANOUT_V1,
+        GD_OP_FANOUT_V2,
+        GD_OP_FANOUT_MAX,
+} glusterd_op_fanout_ver_t;
+
+typedef struct glusterd_op_fanout_ {
+        uint32_t                        seq;
+        struct {
+                struct iovec            iov[GLUSTERD_REQ_MAX_IOVS];
+                int                     count;
+                struct iobref           *iobref;
+        } enc[GD_OP_FANOUT_MAX];
+} glusterd_op_fanout_t;
+
 struct glusterd_op_delete_volume_ctx_ {
         char                    volume_name[GD_VOLUME_NAME_MAX];
 };
@@ -137,6 +177,7 @@ typedef struct glusterd_op_log_filename_ctx_ glusterd_op_log_filename_ctx_t;
 struct glusterd_op_lock_ctx_ {
         uuid_t                  uuid;
         rpcsvc_request_t        *req;
+        char                    *volname;
 };
 
 typedef struct glusterd_op_lock_ctx_ glusterd_op_lock_ctx_t;
@@ -144,6 +185,7 @@ typedef struct glusterd_op_lock_ctx_ glusterd_op_lock_ctx_t;
 struct glusterd_req_ctx_ {
         rpcsvc_request_t *req;
 	u_char            uuid[16];
+	u_char            txn_id[16];
 	int               op;
         dict_t           *dict;
 };
@@ -181,6 +223,25 @@ int
 glusterd_op_sm_inject_event (glusterd_op_sm_event_type_t event_type,
                              void *ctx);
 
+int
+glusterd_op_sm_inject_txn_event (glusterd_op_sm_event_type_t event_type,
+                                 uuid_t txn_id, void *ctx);
+
+glusterd_op_info_t *
+glusterd_op_txn_find (uuid_t txn_id);
+
+glusterd_op_info_t *
+glusterd_op_txn_get ();
+
+int
+glusterd_op_peer_rsp (glusterd_op_info_t *txn, uint32_t seq);
+
+int
+glusterd_op_peer_lost (glusterd_op_info_t *txn, uint32_t seq);
+
+void
+glusterd_op_fanout_release (glusterd_op_fanout_t *fanout);
+
 int
 glusterd_op_sm_init ();
 
@@ -216,6 +277,15 @@ glusterd_op_get_ctx (glusterd_op_t op);
 int32_t
 glusterd_op_set_req (rpcsvc_request_t *req);
 
+int32_t
+glusterd_op_set_lock_volname (glusterd_op_t op, void *ctx);
+
+char *
+glusterd_op_get_lock_volname ();
+
+int32_t
+glusterd_op_clear_lock_volname ();
+
 int32_t
 glusterd_op_set_cli_op (glusterd_op_t op);
 
@@ -302,6 +372,11 @@ glusterd_get_gsync_status_mst_slv( glusterd_volinfo_t *volinfo,
                                    char *slave, dict_t *rsp_dict);
 int
 gsync_status (char *master, char *slave, int *status);
+int32_t
+glusterd_quota_initiate_fs_crawl (glusterd_conf_t *priv, char *volname);
+int32_t
+glusterd_quota_stop_fs_crawl (glusterd_conf_t *priv,
+                              glusterd_volinfo_t *volinfo);
 
 int
 glusterd_gsync_get_param_file (char *prmfile, const char *ext, char *master,
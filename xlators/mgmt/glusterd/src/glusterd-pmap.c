@@ -26,6 +26,7 @@
 #include "xlator.h"
 #include "glusterfs.h"
 #include "compat-errno.h"
+#include "hashfn.h"
 
 #include "glusterd.h"
 #include "glusterd-utils.h"
@@ -61,6 +62,10 @@ pmap_port_isfree (int port)
 }
 
 
+/* Ports start out as GF_PMAP_PORT_FREE and are only probed when
+ * pmap_registry_alloc considers them, a port found busy is marked
+ * GF_PMAP_PORT_FOREIGN then.
+ */
 struct pmap_registry *
 pmap_registry_new (void)
 {
@@ -71,11 +76,9 @@ pmap_registry_new (void)
         if (!pmap)
                 return NULL;
 
-        for (i = 0; i < 65536; i++) {
-                if (pmap_port_isfree (i))
-                        pmap->ports[i].type = GF_PMAP_PORT_FREE;
-                else
-                        pmap->ports[i].type = GF_PMAP_PORT_FOREIGN;
+        for (i = 0; i < PMAP_HASH_SIZE; i++) {
+                INIT_LIST_HEAD (&pmap->brick_table[i]);
+                INIT_LIST_HEAD (&pmap->xprt_table[i]);
         }
 
         pmap->base_port = GF_DEFAULT_BASE_PORT + 2;
@@ -116,52 +119,174 @@ nextword (char *str)
         return str;
 }
 
+static size_t
+wordlen (const char *str)
+{
+        size_t len = 0;
+
+        while (str[len] && !isspace (str[len]))
+                len++;
+
+        return len;
+}
+
+static inline uint32_t
+pmap_brick_hash (const char *brickname, size_t len)
+{
+        return SuperFastHash (brickname, len) % PMAP_HASH_SIZE;
+}
+
+static inline uint32_t
+pmap_xprt_hash (void *xprt)
+{
+        return ((unsigned long) xprt >> 4) % PMAP_HASH_SIZE;
+}
+
+static int
+pmap_index_add (struct list_head *bucket, const char *brickname, size_t len,
+                void *xprt, int port)
+{
+        struct pmap_index_entry *entry = NULL;
+
+        entry = CALLOC (sizeof (*entry), 1);
+        if (!entry)
+                return -1;
+
+        if (brickname) {
+                entry->brickname = strndup (brickname, len);
+                if (!entry->brickname) {
+                        FREE (entry);
+                        return -1;
+                }
+        }
+        entry->xprt = xprt;
+        entry->port = port;
+        list_add_tail (&entry->hash, bucket);
+
+        return 0;
+}
+
+static void
+pmap_index_entry_destroy (struct pmap_index_entry *entry)
+{
+        list_del_init (&entry->hash);
+        if (entry->brickname)
+                FREE (entry->brickname);
+        FREE (entry);
+}
+
+/* Drops the index entries pointing at port @p. Has to be called before
+ * ports[p].brickname or ports[p].xprt is changed.
+ */
+static void
+pmap_registry_unindex (struct pmap_registry *pmap, int p)
+{
+        struct pmap_index_entry *entry = NULL;
+        struct pmap_index_entry *tmp = NULL;
+        char                    *brck = NULL;
+        size_t                   len = 0;
+
+        brck = pmap->ports[p].brickname;
+        while (brck && *brck) {
+                len = wordlen (brck);
+                list_for_each_entry_safe (entry, tmp,
+                                          &pmap->brick_table[pmap_brick_hash (brck, len)],
+                                          hash) {
+                        if (entry->port == p)
+                                pmap_index_entry_destroy (entry);
+                }
+                brck = nextword (brck);
+        }
+
+        if (pmap->ports[p].xprt) {
+                list_for_each_entry_safe (entry, tmp,
+                                          &pmap->xprt_table[pmap_xprt_hash (pmap->ports[p].xprt)],
+                                          hash) {
+                        if (entry->port == p)
+                                pmap_index_entry_destroy (entry);
+                }
+        }
+}
+
+/* Indexes every word of ports[p].brickname and ports[p].xprt */
+static int
+pmap_registry_index (struct pmap_registry *pmap, int p)
+{
+        char                    *brck = NULL;
+        size_t                   len = 0;
+        int                      ret = 0;
+
+        brck = pmap->ports[p].brickname;
+        while (brck && *brck) {
+                len = wordlen (brck);
+                ret = pmap_index_add (&pmap->brick_table[pmap_brick_hash (brck, len)],
+                                      brck, len, NULL, p);
+                if (ret)
+                        goto out;
+                brck = nextword (brck);
+        }
+
+        if (pmap->ports[p].xprt)
+                ret = pmap_index_add (&pmap->xprt_table[pmap_xprt_hash (pmap->ports[p].xprt)],
+                                      NULL, 0, pmap->ports[p].xprt, p);
+out:
+        if (ret)
+                gf_log ("pmap", GF_LOG_ERROR, "could not index port %d", p);
+        return ret;
+}
+
+/* Returns the lowest port between base_port and last_alloc of @type with
+ * @brickname as one of its words.
+ */
 int
 pmap_registry_search (xlator_t *this, const char *brickname,
                       gf_pmap_port_type_t type)
 {
-        struct pmap_registry *pmap = NULL;
-        int                   p = 0;
-        char                 *brck = NULL;
-        char                 *nbrck = NULL;
+        struct pmap_registry    *pmap = NULL;
+        struct pmap_index_entry *entry = NULL;
+        struct list_head        *bucket = NULL;
+        int                      p = 0;
+        int                      port = 0;
 
         pmap = pmap_registry_get (this);
 
-        for (p = pmap->base_port; p <= pmap->last_alloc; p++) {
-                if (!pmap->ports[p].brickname || pmap->ports[p].type != type)
+        bucket = &pmap->brick_table[pmap_brick_hash (brickname,
+                                                     strlen (brickname))];
+        list_for_each_entry (entry, bucket, hash) {
+                p = entry->port;
+                if (p < pmap->base_port || p > pmap->last_alloc)
                         continue;
-
-                for (brck = pmap->ports[p].brickname;;) {
-                        nbrck = strtail (brck, brickname);
-                        if (nbrck && (!*nbrck || isspace (*nbrck)))
-                                return p;
-                        brck = nextword (brck);
-                        if (!*brck)
-                                break;
-                }
+                if (pmap->ports[p].type != type ||
+                    strcmp (entry->brickname, brickname))
+                        continue;
+                if (!port || p < port)
+                        port = p;
         }
 
-        return 0;
+        return port;
 }
 
 int
 pmap_registry_search_by_xprt (xlator_t *this, void *xprt,
                               gf_pmap_port_type_t type)
 {
-        struct pmap_registry *pmap = NULL;
-        int                   p    = 0;
-        int                   port = 0;
+        struct pmap_registry    *pmap = NULL;
+        struct pmap_index_entry *entry = NULL;
+        struct list_head        *bucket = NULL;
+        int                      p    = 0;
+        int                      port = 0;
 
         pmap = pmap_registry_get (this);
 
-        for (p = pmap->base_port; p <= pmap->last_alloc; p++) {
-                if (!pmap->ports[p].xprt)
+        bucket = &pmap->xprt_table[pmap_xprt_hash (xprt)];
+        list_for_each_entry (entry, bucket, hash) {
+                p = entry->port;
+                if (p < pmap->base_port || p > pmap->last_alloc)
+                        continue;
+                if (entry->xprt != xprt || pmap->ports[p].type != type)
                         continue;
-                if (pmap->ports[p].xprt == xprt &&
-                    pmap->ports[p].type == type) {
+                if (!port || p < port)
                         port = p;
-                        break;
-                }
         }
 
         return port;
@@ -205,6 +330,8 @@ pmap_registry_alloc (xlator_t *this)
                         port = p;
                         break;
                 }
+
+                pmap->ports[p].type = GF_PMAP_PORT_FOREIGN;
         }
 
         if (port)
@@ -226,12 +353,14 @@ pmap_registry_bind (xlator_t *this, int port, const char *brickname,
                 goto out;
 
         p = port;
+        pmap_registry_unindex (pmap, p);
         pmap->ports[p].type = type;
         if (pmap->ports[p].brickname)
                 free (pmap->ports[p].brickname);
         pmap->ports[p].brickname = strdup (brickname);
         pmap->ports[p].type = type;
         pmap->ports[p].xprt = xprt;
+        pmap_registry_index (pmap, p);
 
         gf_log ("pmap", GF_LOG_INFO, "adding brick %s on port %d",
                 brickname, port);
@@ -280,6 +409,7 @@ remove:
         gf_log ("pmap", GF_LOG_INFO, "removing brick %s on port %d",
                 pmap->ports[p].brickname, p);
 
+        pmap_registry_unindex (pmap, p);
         if (pmap->ports[p].brickname)
                 free (pmap->ports[p].brickname);
 
@@ -415,6 +545,8 @@ gluster_pmap_signin (rpcsvc_request_t *req)
 
         rsp.op_ret = pmap_registry_bind (THIS, args.port, args.brick,
                                          GF_PMAP_PORT_BRICKSERVER, req->trans);
+        if (!rsp.op_ret)
+                glusterd_brick_spawn_signin (args.brick);
 
         ret = glusterd_get_brickinfo (THIS, args.brick, args.port, _gf_true,
                                       &brickinfo);
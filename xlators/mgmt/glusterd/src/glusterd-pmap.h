@@ -38,16 +38,29 @@
 #include "rpcsvc.h"
 
 
+#define PMAP_HASH_SIZE 1021
+
 struct pmap_port_status {
         gf_pmap_port_type_t type;
         char  *brickname;
         void  *xprt;
 };
 
+/* index entry for one word of ports[port].brickname, or for
+ * ports[port].xprt */
+struct pmap_index_entry {
+        struct list_head  hash;
+        char             *brickname;
+        void             *xprt;
+        int               port;
+};
+
 struct pmap_registry {
         int     base_port;
         int     last_alloc;
         struct  pmap_port_status ports[65536];
+        struct  list_head brick_table[PMAP_HASH_SIZE];
+        struct  list_head xprt_table[PMAP_HASH_SIZE];
 };
 
 int pmap_registry_alloc (xlator_t *this);
@@ -42,250 +42,653 @@
 
 #include "syscall.h"
 #include "cli1.h"
+#include "statedump.h"
 
-int
-gf_glusterd_rebalance_move_data (glusterd_volinfo_t *volinfo, const char *dir)
+/*
+ * Rebalance runs over a glusterfs mount of the volume in two phases: the
+ * layout of every directory is fixed, then the files distribute finds
+ * link files for are copied to where they hash to and renamed over the
+ * originals. In each phase the directories are served from a queue to
+ * rebalance-threads workers, which queue the subdirectories they come
+ * across. Every GLUSTERD_DEFRAG_CHECKPOINT_SECS the directories not yet
+ * finished are saved in the volume directory, so that a rebalance cut
+ * short by a restart of glusterd carries on from there.
+ */
+
+static gf_boolean_t
+glusterd_defrag_stopped (glusterd_volinfo_t *volinfo)
 {
-        int                     ret                    = -1;
-        int                     dst_fd                 = -1;
-        int                     src_fd                 = -1;
-        DIR                    *fd                     = NULL;
-        glusterd_defrag_info_t *defrag                 = NULL;
-        struct dirent          *entry                  = NULL;
-        struct stat             stbuf                  = {0,};
-        struct stat             new_stbuf              = {0,};
-        char                    full_path[PATH_MAX]    = {0,};
-        char                    tmp_filename[PATH_MAX] = {0,};
-        char                    value[16]              = {0,};
-        char                    linkinfo[PATH_MAX]     = {0,};
-        struct statfs           src_statfs = {0,};
-        struct statfs           dst_statfs = {0,};
+        return (volinfo->defrag_status == GF_DEFRAG_STATUS_STOPED);
+}
 
-        if (!volinfo->defrag)
+/* queues @path for the workers; called with queue_lock held */
+static int
+__glusterd_defrag_queue (glusterd_defrag_info_t *defrag, const char *path)
+{
+        glusterd_defrag_dir_t *dir = NULL;
+
+        dir = GF_CALLOC (1, sizeof (*dir), gf_gld_mt_defrag_dir_t);
+        if (!dir)
+                return -1;
+
+        dir->path = gf_strdup (path);
+        if (!dir->path) {
+                GF_FREE (dir);
+                return -1;
+        }
+
+        /* depth first, which keeps the queue (and the checkpoint) short */
+        list_add (&dir->list, &defrag->queue);
+        defrag->queued++;
+        pthread_cond_signal (&defrag->queue_cond);
+
+        return 0;
+}
+
+static void
+glusterd_defrag_dir_free (glusterd_defrag_dir_t *dir)
+{
+        GF_FREE (dir->path);
+        GF_FREE (dir);
+}
+
+static int
+glusterd_defrag_queue_child (glusterd_defrag_info_t *defrag,
+                             glusterd_defrag_dir_t *parent, const char *name)
+{
+        char path[PATH_MAX] = {0,};
+        int  ret = -1;
+
+        snprintf (path, PATH_MAX, "%s/%s",
+                  strcmp (parent->path, "/") ? parent->path : "", name);
+
+        pthread_mutex_lock (&defrag->queue_lock);
+        {
+                ret = __glusterd_defrag_queue (defrag, path);
+        }
+        pthread_mutex_unlock (&defrag->queue_lock);
+
+        return ret;
+}
+
+static void
+glusterd_defrag_rates (glusterd_defrag_info_t *defrag, double *files_sec,
+                       double *bytes_sec)
+{
+        double elapsed = 0;
+
+        elapsed = (glusterd_monotonic_us () - defrag->started_us) / 1e6;
+        if (elapsed <= 0) {
+                *files_sec = *bytes_sec = 0;
+                return;
+        }
+
+        *files_sec = defrag->total_files / elapsed;
+        *bytes_sec = defrag->total_data / elapsed;
+}
+
+/* writes the header (the command, phase, brick count, counters and time
+ * spent) and
+ * the unfinished directories of the phase; called with queue_lock held.
+ * Directories being worked on are saved too and done again in full.
+ */
+static int
+__glusterd_defrag_checkpoint (glusterd_volinfo_t *volinfo)
+{
+        glusterd_defrag_info_t *defrag = NULL;
+        glusterd_defrag_dir_t  *dir = NULL;
+        char                    tmpfile[PATH_MAX] = {0,};
+        FILE                   *fp = NULL;
+        double                  files_sec = 0;
+        double                  bytes_sec = 0;
+        int                     ret = -1;
+
+        defrag = volinfo->defrag;
+
+        ret = snprintf (tmpfile, sizeof (tmpfile), "%s.tmp",
+                        defrag->checkpoint);
+        if (ret >= sizeof (tmpfile)) {
+                gf_log ("rebalance", GF_LOG_ERROR, "checkpoint path %s is "
+                        "too long", defrag->checkpoint);
+                ret = -1;
+                goto out;
+        }
+        ret = -1;
+
+        fp = fopen (tmpfile, "w");
+        if (!fp) {
+                gf_log ("rebalance", GF_LOG_ERROR, "cannot open %s: %s",
+                        tmpfile, strerror (errno));
+                goto out;
+        }
+
+        LOCK (&defrag->lock);
+        {
+                fprintf (fp, "%d %d %d %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64
+                         " %"PRIu64"\n", defrag->cmd, defrag->phase,
+                         volinfo->brick_count, defrag->total_files,
+                         defrag->total_data, defrag->num_files_lookedup,
+                         defrag->num_files_skipped,
+                         glusterd_monotonic_us () - defrag->started_us);
+                glusterd_defrag_rates (defrag, &files_sec, &bytes_sec);
+        }
+        UNLOCK (&defrag->lock);
+
+        list_for_each_entry (dir, &defrag->active, list)
+                fprintf (fp, "%s\n", dir->path);
+        list_for_each_entry (dir, &defrag->queue, list)
+                fprintf (fp, "%s\n", dir->path);
+
+        ret = fflush (fp);
+        if (!ret)
+                ret = fsync (fileno (fp));
+        if (fclose (fp) && !ret)
+                ret = -1;
+        if (!ret)
+                ret = rename (tmpfile, defrag->checkpoint);
+        if (ret) {
+                gf_log ("rebalance", GF_LOG_ERROR, "cannot write %s: %s",
+                        defrag->checkpoint, strerror (errno));
+                unlink (tmpfile);
                 goto out;
+        }
+
+        gf_log ("rebalance", GF_LOG_DEBUG, "%s: %"PRIu64" directories "
+                "pending, %.1f files/s, %.1f bytes/s", volinfo->volname,
+                defrag->queued + defrag->busy, files_sec, bytes_sec);
+out:
+        return ret;
+}
+
+/* queues the directories saved by an earlier run of the same command on
+ * the same bricks and restores its counters and the time it ran for */
+static int
+glusterd_defrag_load_checkpoint (glusterd_volinfo_t *volinfo)
+{
+        glusterd_defrag_info_t *defrag = NULL;
+        FILE                   *fp = NULL;
+        char                    line[PATH_MAX + 1] = {0,};
+        size_t                  len = 0;
+        int                     cmd = 0;
+        int                     phase = 0;
+        int                     brick_count = 0;
+        uint64_t                counters[4] = {0,};
+        uint64_t                elapsed_us = 0;
+        int                     ret = -1;
 
         defrag = volinfo->defrag;
 
-        fd = opendir (dir);
-        if (!fd)
+        fp = fopen (defrag->checkpoint, "r");
+        if (!fp)
                 goto out;
-        while ((entry = readdir (fd))) {
-                if (!entry)
-                        break;
 
-                if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, ".."))
-                        continue;
+        if (!fgets (line, sizeof (line), fp) ||
+            (sscanf (line, "%d %d %d %"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64
+                     " %"SCNu64, &cmd, &phase, &brick_count, &counters[0],
+                     &counters[1], &counters[2], &counters[3],
+                     &elapsed_us) != 8))
+                goto out;
 
-                snprintf (full_path, PATH_MAX, "%s/%s", dir, entry->d_name);
+        if ((cmd != defrag->cmd) || (brick_count != volinfo->brick_count) ||
+            ((phase != GF_DEFRAG_STATUS_LAYOUT_FIX_STARTED) &&
+             (phase != GF_DEFRAG_STATUS_MIGRATE_DATA_STARTED))) {
+                gf_log ("rebalance", GF_LOG_INFO, "ignoring checkpoint %s "
+                        "of a different rebalance", defrag->checkpoint);
+                goto out;
+        }
 
-                ret = stat (full_path, &stbuf);
-                if (ret == -1)
-                        continue;
+        pthread_mutex_lock (&defrag->queue_lock);
+        {
+                while (fgets (line, sizeof (line), fp)) {
+                        len = strlen (line);
+                        if (len && line[len - 1] == '\n')
+                                line[--len] = '\0';
+                        if (line[0] != '/')
+                                continue;
+                        if (__glusterd_defrag_queue (defrag, line))
+                                break;
+                }
+                ret = list_empty (&defrag->queue) ? -1 : 0;
+        }
+        pthread_mutex_unlock (&defrag->queue_lock);
 
-                if (!S_ISREG (stbuf.st_mode))
-                        continue;
+        if (ret)
+                goto out;
 
-                defrag->num_files_lookedup += 1;
+        defrag->phase = phase;
+        defrag->total_files = counters[0];
+        defrag->total_data = counters[1];
+        defrag->num_files_lookedup = counters[2];
+        defrag->num_files_skipped = counters[3];
+        /* the rates go on from where the earlier run left them */
+        defrag->started_us -= elapsed_us;
+out:
+        if (fp)
+                fclose (fp);
 
-                if (stbuf.st_nlink > 1)
-                        continue;
+        return ret;
+}
 
-                /* if distribute is present, it will honor this key.
-                   -1 is returned if distribute is not present or file doesn't
-                   have a link-file. If file has link-file, the path of
-                   link-file will be the value  */
-                ret = sys_lgetxattr (full_path, GF_XATTR_LINKINFO_KEY,
-                                     &linkinfo, PATH_MAX);
-                if (ret <= 0)
-                        continue;
+/* keeps the copies of all the workers under 'rebalance-bandwidth'. A
+ * token bucket: credit builds up at the bandwidth while nothing is copied
+ * (during the layout fix, say) but only up to GLUSTERD_DEFRAG_BURST_US
+ * worth of it, a copy beyond the credit sleeps until it is paid for.
+ */
+static void
+glusterd_defrag_throttle (glusterd_defrag_info_t *defrag, size_t bytes)
+{
+        uint64_t now_us = 0;
+        double   credit = 0;
+        int64_t  burst = 0;
+        int64_t  owed = 0;
 
-                /* If the file is open, don't run rebalance on it */
-                ret = sys_lgetxattr (full_path, GLUSTERFS_OPEN_FD_COUNT,
-                                     &value, 16);
-                if ((ret < 0) || !strncmp (value, "1", 1))
-                        continue;
+        if (!defrag->bandwidth)
+                return;
 
-                /* If its a regular file, and sticky bit is set, we need to
-                   rebalance that */
-                snprintf (tmp_filename, PATH_MAX, "%s/.%s.gfs%llu", dir,
-                          entry->d_name,
-                          (unsigned long long)stbuf.st_size);
+        burst = defrag->bandwidth * GLUSTERD_DEFRAG_BURST_US / 1000000;
 
-                dst_fd = creat (tmp_filename, stbuf.st_mode);
-                if (dst_fd == -1)
-                        continue;
+        LOCK (&defrag->lock);
+        {
+                now_us = glusterd_monotonic_us ();
+                if (defrag->refilled_us)
+                        credit = (double) (now_us - defrag->refilled_us) *
+                                 defrag->bandwidth / 1000000;
+                else
+                        credit = burst;
+                if (defrag->tokens + credit > burst)
+                        defrag->tokens = burst;
+                else
+                        defrag->tokens += credit;
+                defrag->refilled_us = now_us;
+
+                defrag->tokens -= bytes;
+                if (defrag->tokens < 0)
+                        owed = -defrag->tokens;
+        }
+        UNLOCK (&defrag->lock);
 
-                /* Prevent data movement from a node which has higher
-                   disk-space to a node with lesser */
-                {
-                        ret = statfs (full_path, &src_statfs);
-                        if (ret)
-                                gf_log ("", GF_LOG_INFO, "statfs on %s failed",
-                                        full_path);
+        if (owed)
+                usleep (owed * 1000000 / defrag->bandwidth);
+}
 
-                        ret = statfs (tmp_filename, &dst_statfs);
-                        if (ret)
-                                gf_log ("", GF_LOG_INFO, "statfs on %s failed",
-                                        tmp_filename);
+static void
+glusterd_defrag_skipped (glusterd_defrag_info_t *defrag)
+{
+        LOCK (&defrag->lock);
+        {
+                defrag->num_files_skipped += 1;
+        }
+        UNLOCK (&defrag->lock);
+}
 
-                        if (dst_statfs.f_bavail < src_statfs.f_bavail) {
-                                gf_log ("", GF_LOG_INFO,
-                                        "data movement attempted from node with"
-                                        " higher disk space to a node with "
-                                        "lesser disk space (%s)", full_path);
+/* moves @full_path to the subvolume it hashes to, if it has a link file
+ * there */
+static void
+glusterd_defrag_migrate_file (glusterd_volinfo_t *volinfo, const char *dir,
+                              const char *name, const char *full_path,
+                              struct stat *stbuf, char *buf)
+{
+        glusterd_defrag_info_t *defrag                 = NULL;
+        int                     ret                    = -1;
+        int                     dst_fd                 = -1;
+        int                     src_fd                 = -1;
+        ssize_t                 len                    = 0;
+        struct stat             new_stbuf              = {0,};
+        char                    tmp_filename[PATH_MAX] = {0,};
+        char                    value[16]              = {0,};
+        char                    linkinfo[PATH_MAX]     = {0,};
+        struct statfs           src_statfs = {0,};
+        struct statfs           dst_statfs = {0,};
 
-                                close (dst_fd);
-                                unlink (tmp_filename);
-                                continue;
-                        }
-                }
+        defrag = volinfo->defrag;
 
-                src_fd = open (full_path, O_RDONLY);
-                if (src_fd == -1) {
-                        close (dst_fd);
-                        continue;
-                }
+        /* if distribute is present, it will honor this key.
+           -1 is returned if distribute is not present or file doesn't
+           have a link-file. If file has link-file, the path of
+           link-file will be the value  */
+        ret = sys_lgetxattr (full_path, GF_XATTR_LINKINFO_KEY,
+                             &linkinfo, PATH_MAX);
+        if (ret <= 0)
+                return;
+
+        if (stbuf->st_nlink > 1)
+                goto skip;
+
+        /* If the file is open, don't run rebalance on it */
+        ret = sys_lgetxattr (full_path, GLUSTERFS_OPEN_FD_COUNT,
+                             &value, 16);
+        if ((ret < 0) || !strncmp (value, "1", 1))
+                goto skip;
+
+        /* If its a regular file, and sticky bit is set, we need to
+           rebalance that */
+        snprintf (tmp_filename, PATH_MAX, "%s/.%s.gfs%llu", dir, name,
+                  (unsigned long long)stbuf->st_size);
+
+        dst_fd = creat (tmp_filename, stbuf->st_mode);
+        if (dst_fd == -1)
+                goto skip;
+
+        /* Prevent data movement from a node which has higher
+           disk-space to a node with lesser */
+        {
+                ret = statfs (full_path, &src_statfs);
+                if (ret)
+                        gf_log ("", GF_LOG_INFO, "statfs on %s failed",
+                                full_path);
 
-                while (1) {
-                        ret = read (src_fd, defrag->databuf, 131072);
-                        if (!ret || (ret < 0)) {
-                                break;
-                        }
-                        ret = write (dst_fd, defrag->databuf, ret);
-                        if (ret < 0) {
-                                break;
-                        }
+                ret = statfs (tmp_filename, &dst_statfs);
+                if (ret)
+                        gf_log ("", GF_LOG_INFO, "statfs on %s failed",
+                                tmp_filename);
+
+                if (dst_statfs.f_bavail < src_statfs.f_bavail) {
+                        gf_log ("", GF_LOG_INFO,
+                                "data movement attempted from node with"
+                                " higher disk space to a node with "
+                                "lesser disk space (%s)", full_path);
+                        goto unlink;
                 }
+        }
 
-                ret = stat (full_path, &new_stbuf);
-                if (ret < 0) {
-                        close (dst_fd);
-                        close (src_fd);
-                        continue;
-                }
-                /* No need to rebalance, if there is some
-                   activity on source file */
-                if (new_stbuf.st_mtime != stbuf.st_mtime) {
-                        close (dst_fd);
-                        close (src_fd);
-                        continue;
-                }
+        src_fd = open (full_path, O_RDONLY);
+        if (src_fd == -1)
+                goto unlink;
 
-                ret = fchown (dst_fd, stbuf.st_uid, stbuf.st_gid);
-                if (ret) {
-                        gf_log ("", GF_LOG_WARNING,
-                                "failed to set the uid/gid of file %s: %s",
-                                tmp_filename, strerror (errno));
+        while ((len = read (src_fd, buf, GLUSTERD_DEFRAG_COPY_SIZE)) > 0) {
+                if (write (dst_fd, buf, len) != len) {
+                        len = -1;
+                        break;
                 }
+                glusterd_defrag_throttle (defrag, len);
+        }
+        if (len < 0) {
+                gf_log ("", GF_LOG_WARNING, "failed to copy %s: %s",
+                        full_path, strerror (errno));
+                goto unlink;
+        }
 
-                ret = rename (tmp_filename, full_path);
-                if (ret != -1) {
-                        LOCK (&defrag->lock);
-                        {
-                                defrag->total_files += 1;
-                                defrag->total_data += stbuf.st_size;
-                        }
-                        UNLOCK (&defrag->lock);
-                }
+        /* No need to rebalance, if there is some
+           activity on source file */
+        ret = stat (full_path, &new_stbuf);
+        if ((ret < 0) || (new_stbuf.st_mtime != stbuf->st_mtime))
+                goto unlink;
+
+        ret = fchown (dst_fd, stbuf->st_uid, stbuf->st_gid);
+        if (ret) {
+                gf_log ("", GF_LOG_WARNING,
+                        "failed to set the uid/gid of file %s: %s",
+                        tmp_filename, strerror (errno));
+        }
+
+        ret = rename (tmp_filename, full_path);
+        if (ret == -1)
+                goto unlink;
+
+        LOCK (&defrag->lock);
+        {
+                defrag->total_files += 1;
+                defrag->total_data += stbuf->st_size;
+        }
+        UNLOCK (&defrag->lock);
+        goto out;
 
+unlink:
+        unlink (tmp_filename);
+skip:
+        glusterd_defrag_skipped (defrag);
+out:
+        if (dst_fd != -1)
                 close (dst_fd);
+        if (src_fd != -1)
                 close (src_fd);
+}
 
-                if (volinfo->defrag_status == GF_DEFRAG_STATUS_STOPED) {
-                        closedir (fd);
-                        ret = -1;
-                        goto out;
-                }
-        }
-        closedir (fd);
+/* one directory of either phase: fixes the layout of its subdirectories
+ * or moves its files, and queues its subdirectories */
+static int
+glusterd_defrag_crawl_dir (glusterd_volinfo_t *volinfo,
+                           glusterd_defrag_dir_t *dir, char *buf)
+{
+        glusterd_defrag_info_t *defrag              = NULL;
+        int                     ret                 = -1;
+        DIR                    *fd                  = NULL;
+        struct dirent          *entry               = NULL;
+        struct stat             stbuf               = {0,};
+        char                    dirpath[PATH_MAX]   = {0,};
+        char                    full_path[PATH_MAX] = {0,};
+        char                    value[128]          = {0,};
+
+        defrag = volinfo->defrag;
+
+        snprintf (dirpath, PATH_MAX, "%s%s", defrag->mount,
+                  strcmp (dir->path, "/") ? dir->path : "");
 
-        fd = opendir (dir);
-        if (!fd)
+        fd = opendir (dirpath);
+        if (!fd) {
+                gf_log ("rebalance", GF_LOG_WARNING, "opendir on %s failed: "
+                        "%s", dirpath, strerror (errno));
                 goto out;
+        }
+
         while ((entry = readdir (fd))) {
-                if (!entry)
+                if (glusterd_defrag_stopped (volinfo))
                         break;
 
-                if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, ".."))
+                if (!strcmp (entry->d_name, ".") ||
+                    !strcmp (entry->d_name, ".."))
                         continue;
 
-                snprintf (full_path, 1024, "%s/%s", dir, entry->d_name);
+                snprintf (full_path, PATH_MAX, "%s/%s", dirpath,
+                          entry->d_name);
 
                 ret = stat (full_path, &stbuf);
                 if (ret == -1)
                         continue;
 
-                if (!S_ISDIR (stbuf.st_mode))
+                if (S_ISDIR (stbuf.st_mode)) {
+                        if (defrag->phase ==
+                            GF_DEFRAG_STATUS_LAYOUT_FIX_STARTED) {
+                                /* Fix the layout of the directory */
+                                sys_lgetxattr (full_path,
+                                               "trusted.distribute.fix.layout",
+                                               &value, 128);
+                                LOCK (&defrag->lock);
+                                {
+                                        defrag->total_files += 1;
+                                }
+                                UNLOCK (&defrag->lock);
+                        }
+
+                        glusterd_defrag_queue_child (defrag, dir,
+                                                     entry->d_name);
                         continue;
+                }
 
-                ret = gf_glusterd_rebalance_move_data (volinfo, full_path);
-                if (ret)
-                        break;
+                if ((defrag->phase != GF_DEFRAG_STATUS_MIGRATE_DATA_STARTED) ||
+                    !S_ISREG (stbuf.st_mode))
+                        continue;
+
+                LOCK (&defrag->lock);
+                {
+                        defrag->num_files_lookedup += 1;
+                }
+                UNLOCK (&defrag->lock);
+
+                glusterd_defrag_migrate_file (volinfo, dirpath, entry->d_name,
+                                              full_path, &stbuf, buf);
         }
         closedir (fd);
 
-        if (!entry)
-                ret = 0;
+        ret = glusterd_defrag_stopped (volinfo) ? -1 : 0;
 out:
         return ret;
 }
 
-int
-gf_glusterd_rebalance_fix_layout (glusterd_volinfo_t *volinfo, const char *dir)
+/* hands out the next directory, waiting while the queue is empty but other
+ * workers may still add to it. NULL once the phase is done or stopped. */
+static glusterd_defrag_dir_t *
+glusterd_defrag_next_dir (glusterd_volinfo_t *volinfo)
 {
-        int            ret             = -1;
-        char           value[128]      = {0,};
-        char           full_path[1024] = {0,};
-        struct stat    stbuf           = {0,};
-        DIR           *fd              = NULL;
-        struct dirent *entry           = NULL;
+        glusterd_defrag_info_t *defrag = NULL;
+        glusterd_defrag_dir_t  *dir = NULL;
 
-        if (!volinfo->defrag)
-                goto out;
+        defrag = volinfo->defrag;
 
-        fd = opendir (dir);
-        if (!fd)
-                goto out;
+        pthread_mutex_lock (&defrag->queue_lock);
+        {
+                while (list_empty (&defrag->queue) && defrag->busy &&
+                       !glusterd_defrag_stopped (volinfo))
+                        pthread_cond_wait (&defrag->queue_cond,
+                                           &defrag->queue_lock);
+
+                if (!list_empty (&defrag->queue) &&
+                    !glusterd_defrag_stopped (volinfo)) {
+                        dir = list_entry (defrag->queue.next,
+                                          glusterd_defrag_dir_t, list);
+                        list_move_tail (&dir->list, &defrag->active);
+                        defrag->queued--;
+                        defrag->busy++;
+                }
+        }
+        pthread_mutex_unlock (&defrag->queue_lock);
 
-        while ((entry = readdir (fd))) {
-                if (!entry)
-                        break;
+        return dir;
+}
 
-                if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, ".."))
-                        continue;
+static void
+glusterd_defrag_dir_done (glusterd_volinfo_t *volinfo,
+                          glusterd_defrag_dir_t *dir, int ret)
+{
+        glusterd_defrag_info_t *defrag = NULL;
+        time_t                  now = 0;
 
-                snprintf (full_path, 1024, "%s/%s", dir, entry->d_name);
+        defrag = volinfo->defrag;
+        now = time (NULL);
 
-                ret = stat (full_path, &stbuf);
-                if (ret == -1)
-                        continue;
+        if (ret && !glusterd_defrag_stopped (volinfo)) {
+                LOCK (&defrag->lock);
+                {
+                        defrag->num_failures += 1;
+                }
+                UNLOCK (&defrag->lock);
+        }
 
-                if (S_ISDIR (stbuf.st_mode)) {
-                        /* Fix the layout of the directory */
-                        sys_lgetxattr (full_path, "trusted.distribute.fix.layout",
-                                       &value, 128);
+        pthread_mutex_lock (&defrag->queue_lock);
+        {
+                list_del_init (&dir->list);
+                defrag->busy--;
+                if (!defrag->busy && list_empty (&defrag->queue))
+                        pthread_cond_broadcast (&defrag->queue_cond);
+
+                if (!glusterd_defrag_stopped (volinfo) &&
+                    (now - defrag->checkpointed >=
+                     GLUSTERD_DEFRAG_CHECKPOINT_SECS)) {
+                        defrag->checkpointed = now;
+                        __glusterd_defrag_checkpoint (volinfo);
+                }
+        }
+        pthread_mutex_unlock (&defrag->queue_lock);
 
-                        volinfo->defrag->total_files += 1;
+        glusterd_defrag_dir_free (dir);
+}
 
-                        /* Traverse into subdirectory */
-                        ret = gf_glusterd_rebalance_fix_layout (volinfo,
-                                                                full_path);
-                        if (ret)
-                                break;
+static void *
+glusterd_defrag_worker (void *data)
+{
+        glusterd_volinfo_t     *volinfo = data;
+        glusterd_defrag_dir_t  *dir = NULL;
+        char                   *buf = NULL;
+        int                     ret = -1;
+
+        if (volinfo->defrag->phase == GF_DEFRAG_STATUS_MIGRATE_DATA_STARTED) {
+                buf = GF_MALLOC (GLUSTERD_DEFRAG_COPY_SIZE,
+                                 gf_gld_mt_defrag_buf);
+                if (!buf)
+                        goto out;
+        }
+
+        while ((dir = glusterd_defrag_next_dir (volinfo))) {
+                ret = glusterd_defrag_crawl_dir (volinfo, dir, buf);
+                glusterd_defrag_dir_done (volinfo, dir, ret);
+        }
+out:
+        if (buf)
+                GF_FREE (buf);
+
+        return NULL;
+}
+
+/* runs the queued directories of defrag->phase through the workers */
+static int
+glusterd_defrag_run (glusterd_volinfo_t *volinfo)
+{
+        glusterd_defrag_info_t *defrag = NULL;
+        glusterd_defrag_dir_t  *dir = NULL;
+        glusterd_defrag_dir_t  *tmp = NULL;
+        uint64_t                failures = 0;
+        uint32_t                started = 0;
+        int                     ret = -1;
+
+        defrag = volinfo->defrag;
+        volinfo->defrag_status = defrag->phase;
+        failures = defrag->num_failures;
+
+        pthread_mutex_lock (&defrag->queue_lock);
+        {
+                defrag->checkpointed = time (NULL);
+                __glusterd_defrag_checkpoint (volinfo);
+        }
+        pthread_mutex_unlock (&defrag->queue_lock);
+
+        for (started = 0; started < defrag->threads; started++) {
+                ret = pthread_create (&defrag->workers[started], NULL,
+                                      glusterd_defrag_worker, volinfo);
+                if (ret) {
+                        gf_log ("rebalance", GF_LOG_WARNING, "could only "
+                                "start %u of %u workers", started,
+                                defrag->threads);
+                        break;
                 }
+        }
+
+        while (started)
+                pthread_join (defrag->workers[--started], NULL);
 
-                if (volinfo->defrag_status == GF_DEFRAG_STATUS_STOPED) {
-                        closedir (fd);
+        ret = 0;
+        pthread_mutex_lock (&defrag->queue_lock);
+        {
+                if (!list_empty (&defrag->queue))
                         ret = -1;
-                        goto out;
+                list_for_each_entry_safe (dir, tmp, &defrag->queue, list) {
+                        list_del_init (&dir->list);
+                        glusterd_defrag_dir_free (dir);
                 }
+                defrag->queued = 0;
         }
-        closedir (fd);
+        pthread_mutex_unlock (&defrag->queue_lock);
 
-        if (!entry)
-                ret = 0;
+        if (glusterd_defrag_stopped (volinfo) ||
+            (defrag->num_failures != failures))
+                ret = -1;
+
+        return ret;
+}
+
+static int
+glusterd_defrag_queue_root (glusterd_defrag_info_t *defrag,
+                            gf_defrag_status_t phase)
+{
+        int ret = -1;
+
+        defrag->phase = phase;
+
+        pthread_mutex_lock (&defrag->queue_lock);
+        {
+                ret = __glusterd_defrag_queue (defrag, "/");
+        }
+        pthread_mutex_unlock (&defrag->queue_lock);
 
-out:
         return ret;
 }
 
@@ -295,61 +698,81 @@ glusterd_defrag_start (void *data)
         glusterd_volinfo_t     *volinfo = data;
         glusterd_defrag_info_t *defrag  = NULL;
         int                     ret     = -1;
+        int                     tries   = 0;
         struct stat             stbuf   = {0,};
         char                    value[128] = {0,};
+        double                  files_sec = 0;
+        double                  bytes_sec = 0;
 
         defrag = volinfo->defrag;
         if (!defrag)
                 goto out;
 
-        sleep (1);
-        ret = stat (defrag->mount, &stbuf);
-        if ((ret == -1) && (errno == ENOTCONN)) {
-                /* Wait for some more time before starting rebalance */
-                sleep (2);
+        /* Wait for the mount (and, after a restart, the bricks) to come
+           up before starting rebalance */
+        do {
+                sleep (tries ? 2 : 1);
                 ret = stat (defrag->mount, &stbuf);
-                if (ret == -1) {
-                        volinfo->defrag_status   = GF_DEFRAG_STATUS_FAILED;
-                        volinfo->rebalance_files = 0;
-                        volinfo->rebalance_data  = 0;
-                        volinfo->lookedup_files  = 0;
-                        goto out;
-                }
+        } while ((ret == -1) && (errno == ENOTCONN) && (++tries < 5));
+
+        if (ret == -1) {
+                volinfo->defrag_status   = GF_DEFRAG_STATUS_FAILED;
+                volinfo->rebalance_files = 0;
+                volinfo->rebalance_data  = 0;
+                volinfo->lookedup_files  = 0;
+                goto out;
         }
 
-        /* Fix the root ('/') first */
-        sys_lgetxattr (defrag->mount, "trusted.distribute.fix.layout",
-                       &value, 128);
+        defrag->started_us = glusterd_monotonic_us ();
+
+        if (!glusterd_defrag_load_checkpoint (volinfo)) {
+                gf_log ("rebalance", GF_LOG_INFO, "resuming rebalance of %s "
+                        "from %s", volinfo->volname, defrag->checkpoint);
+        } else if (defrag->cmd == GF_DEFRAG_CMD_START_MIGRATE_DATA) {
+                ret = glusterd_defrag_queue_root (defrag,
+                                        GF_DEFRAG_STATUS_MIGRATE_DATA_STARTED);
+                if (ret)
+                        goto fail;
+        } else {
+                /* Fix the root ('/') first */
+                sys_lgetxattr (defrag->mount, "trusted.distribute.fix.layout",
+                               &value, 128);
 
-        if ((defrag->cmd == GF_DEFRAG_CMD_START) ||
-            (defrag->cmd == GF_DEFRAG_CMD_START_LAYOUT_FIX)) {
                 /* root's layout got fixed */
                 defrag->total_files = 1;
 
+                ret = glusterd_defrag_queue_root (defrag,
+                                        GF_DEFRAG_STATUS_LAYOUT_FIX_STARTED);
+                if (ret)
+                        goto fail;
+        }
+
+        if (defrag->phase == GF_DEFRAG_STATUS_LAYOUT_FIX_STARTED) {
                 /* Step 1: Fix layout of all the directories */
-                ret = gf_glusterd_rebalance_fix_layout (volinfo, defrag->mount);
-                if (ret) {
-                        volinfo->defrag_status   = GF_DEFRAG_STATUS_FAILED;
-                        goto out;
-                }
+                ret = glusterd_defrag_run (volinfo);
+                if (ret)
+                        goto fail;
 
                 /* Completed first step */
                 volinfo->defrag_status = GF_DEFRAG_STATUS_LAYOUT_FIX_COMPLETE;
-        }
 
-        if ((defrag->cmd == GF_DEFRAG_CMD_START) ||
-            (defrag->cmd == GF_DEFRAG_CMD_START_MIGRATE_DATA)) {
-                /* It was used by number of layout fixes on directories */
-                defrag->total_files = 0;
+                if (defrag->cmd == GF_DEFRAG_CMD_START) {
+                        /* It was used by number of layout fixes on
+                           directories */
+                        defrag->total_files = 0;
 
-                volinfo->defrag_status = GF_DEFRAG_STATUS_MIGRATE_DATA_STARTED;
+                        ret = glusterd_defrag_queue_root (defrag,
+                                        GF_DEFRAG_STATUS_MIGRATE_DATA_STARTED);
+                        if (ret)
+                                goto fail;
+                }
+        }
 
+        if (defrag->phase == GF_DEFRAG_STATUS_MIGRATE_DATA_STARTED) {
                 /* Step 2: Iterate over directories to move data */
-                ret = gf_glusterd_rebalance_move_data (volinfo, defrag->mount);
-                if (ret) {
-                        volinfo->defrag_status   = GF_DEFRAG_STATUS_FAILED;
-                        goto out;
-                }
+                ret = glusterd_defrag_run (volinfo);
+                if (ret)
+                        goto fail;
 
                 /* Completed second step */
                 volinfo->defrag_status = GF_DEFRAG_STATUS_MIGRATE_DATA_COMPLETE;
@@ -358,10 +781,25 @@ glusterd_defrag_start (void *data)
         /* Completed whole process */
         if (defrag->cmd == GF_DEFRAG_CMD_START)
                 volinfo->defrag_status = GF_DEFRAG_STATUS_COMPLETE;
+        goto done;
 
+fail:
+        if (!glusterd_defrag_stopped (volinfo))
+                volinfo->defrag_status = GF_DEFRAG_STATUS_FAILED;
+done:
         volinfo->rebalance_files = defrag->total_files;
         volinfo->rebalance_data  = defrag->total_data;
         volinfo->lookedup_files  = defrag->num_files_lookedup;
+
+        glusterd_defrag_rates (defrag, &files_sec, &bytes_sec);
+        gf_log ("rebalance", GF_LOG_INFO, "%s: %"PRIu64" files (%"PRIu64
+                " bytes) moved, %"PRIu64" skipped, %"PRIu64" directories "
+                "failed, %.1f files/s, %.1f bytes/s", volinfo->volname,
+                defrag->total_files, defrag->total_data,
+                defrag->num_files_skipped, defrag->num_failures, files_sec,
+                bytes_sec);
+
+        unlink (defrag->checkpoint);
 out:
         volinfo->defrag = NULL;
         if (defrag) {
@@ -369,6 +807,8 @@ out:
                         defrag->mount);
 
                 ret = runcmd ("umount", "-l", defrag->mount, NULL);
+                pthread_mutex_destroy (&defrag->queue_lock);
+                pthread_cond_destroy (&defrag->queue_cond);
                 LOCK_DESTROY (&defrag->lock);
                 GF_FREE (defrag);
         }
@@ -376,6 +816,126 @@ out:
         return NULL;
 }
 
+/* restarts a rebalance of @volinfo that a restart of glusterd cut short */
+int
+glusterd_defrag_resume (glusterd_volinfo_t *volinfo)
+{
+        glusterd_conf_t *priv = NULL;
+        char             path[PATH_MAX] = {0,};
+        char             checkpoint[PATH_MAX] = {0,};
+        char             msg[2048] = {0,};
+        FILE            *fp = NULL;
+        int              cmd = 0;
+        int              ret = 0;
+
+        priv = THIS->private;
+
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+        GLUSTERD_GET_DEFRAG_CHECKPOINT (checkpoint, path);
+
+        fp = fopen (checkpoint, "r");
+        if (!fp)
+                goto out;
+        ret = fscanf (fp, "%d", &cmd);
+        fclose (fp);
+        if (ret != 1) {
+                unlink (checkpoint);
+                ret = -1;
+                goto out;
+        }
+
+        gf_log ("rebalance", GF_LOG_INFO, "resuming rebalance of %s",
+                volinfo->volname);
+
+        /* the mount of the earlier glusterd outlives it */
+        ret = snprintf (path, sizeof (path), "%s/mount/%s", priv->workdir,
+                        volinfo->volname);
+        if (ret >= sizeof (path)) {
+                ret = -1;
+                goto out;
+        }
+        runcmd ("umount", "-l", path, NULL);
+
+        ret = glusterd_handle_defrag_start (volinfo, msg, sizeof (msg), cmd);
+        if (ret)
+                gf_log ("rebalance", GF_LOG_ERROR, "could not resume "
+                        "rebalance of %s: %s", volinfo->volname, msg);
+out:
+        return ret;
+}
+
+void
+glusterd_defrag_dump (glusterd_conf_t *priv, char *prefix)
+{
+        glusterd_volinfo_t     *volinfo = NULL;
+        glusterd_defrag_info_t *defrag = NULL;
+        char                    key[GF_DUMP_MAX_BUF_LEN];
+        double                  files_sec = 0;
+        double                  bytes_sec = 0;
+
+        gf_proc_dump_build_key (key, prefix, "rebalance.threads");
+        gf_proc_dump_write (key, "%u", priv->rebalance_threads);
+        gf_proc_dump_build_key (key, prefix, "rebalance.bandwidth");
+        gf_proc_dump_write (key, "%"PRIu64, priv->rebalance_bandwidth);
+
+        list_for_each_entry (volinfo, &priv->volumes, vol_list) {
+                defrag = volinfo->defrag;
+                if (!defrag)
+                        continue;
+
+                LOCK (&defrag->lock);
+                {
+                        gf_proc_dump_build_key (key, prefix,
+                                                "rebalance.%s.files",
+                                                volinfo->volname);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            defrag->total_files);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "rebalance.%s.bytes",
+                                                volinfo->volname);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            defrag->total_data);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "rebalance.%s.lookedup",
+                                                volinfo->volname);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            defrag->num_files_lookedup);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "rebalance.%s.skipped",
+                                                volinfo->volname);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            defrag->num_files_skipped);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "rebalance.%s.failures",
+                                                volinfo->volname);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            defrag->num_failures);
+                        if (defrag->started_us)
+                                glusterd_defrag_rates (defrag, &files_sec,
+                                                       &bytes_sec);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "rebalance.%s.files_per_sec",
+                                                volinfo->volname);
+                        gf_proc_dump_write (key, "%.1f", files_sec);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "rebalance.%s.bytes_per_sec",
+                                                volinfo->volname);
+                        gf_proc_dump_write (key, "%.1f", bytes_sec);
+                }
+                UNLOCK (&defrag->lock);
+
+                gf_proc_dump_build_key (key, prefix, "rebalance.%s.status",
+                                        volinfo->volname);
+                gf_proc_dump_write (key, "%d", volinfo->defrag_status);
+                gf_proc_dump_build_key (key, prefix, "rebalance.%s.queued",
+                                        volinfo->volname);
+                gf_proc_dump_write (key, "%"PRIu64, defrag->queued);
+                gf_proc_dump_build_key (key, prefix, "rebalance.%s.busy",
+                                        volinfo->volname);
+                gf_proc_dump_write (key, "%u", defrag->busy);
+        }
+}
+
 int
 glusterd_defrag_stop_validate (glusterd_volinfo_t *volinfo,
                                char *op_errstr, size_t len)
@@ -420,6 +980,13 @@ glusterd_defrag_stop (glusterd_volinfo_t *volinfo, u_quad_t *files,
         }
         UNLOCK (&volinfo->defrag->lock);
 
+        /* wake the workers waiting for directories */
+        pthread_mutex_lock (&volinfo->defrag->queue_lock);
+        {
+                pthread_cond_broadcast (&volinfo->defrag->queue_cond);
+        }
+        pthread_mutex_unlock (&volinfo->defrag->queue_lock);
+
         ret = 0;
 out:
         gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
@@ -557,6 +1124,7 @@ glusterd_handle_defrag_start (glusterd_volinfo_t *volinfo, char *op_errstr,
         glusterd_defrag_info_t *defrag =  NULL;
         runner_t               runner = {0,};
         glusterd_conf_t        *priv = NULL;
+        char                   path[PATH_MAX] = {0,};
 
         priv    = THIS->private;
 
@@ -575,10 +1143,24 @@ glusterd_handle_defrag_start (glusterd_volinfo_t *volinfo, char *op_errstr,
         defrag = volinfo->defrag;
 
         defrag->cmd = cmd;
+        defrag->threads = priv->rebalance_threads;
+        defrag->bandwidth = priv->rebalance_bandwidth;
+        INIT_LIST_HEAD (&defrag->queue);
+        INIT_LIST_HEAD (&defrag->active);
 
         LOCK_INIT (&defrag->lock);
-        snprintf (defrag->mount, 1024, "%s/mount/%s",
-                  priv->workdir, volinfo->volname);
+        pthread_mutex_init (&defrag->queue_lock, NULL);
+        pthread_cond_init (&defrag->queue_cond, NULL);
+        ret = snprintf (defrag->mount, sizeof (defrag->mount), "%s/mount/%s",
+                        priv->workdir, volinfo->volname);
+        if (ret >= sizeof (defrag->mount)) {
+                snprintf (op_errstr, len, "Mount path of volume %s is too "
+                          "long", volinfo->volname);
+                ret = -1;
+                goto out;
+        }
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+        GLUSTERD_GET_DEFRAG_CHECKPOINT (defrag->checkpoint, path);
         /* Create a directory, mount glusterfs over it, start glusterfs-defrag */
         runinit (&runner);
         runner_add_args (&runner, "mkdir", "-p", defrag->mount, NULL);
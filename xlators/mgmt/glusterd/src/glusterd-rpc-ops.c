@@ -41,11 +41,121 @@
 #define SERVER_PATH_MAX  (16 * 1024)
 
 
-extern glusterd_op_info_t opinfo;
+extern struct rpc_clnt_program gd_clnt_mgmt_v2_prog;
 
 int32_t
 glusterd3_1_brick_op (call_frame_t *frame, xlator_t *this,
                       void *data);
+
+/* Peer requests are sent from inside the op state machine; remember which
+ * transaction they belong to so that the reply can be routed back to it.
+ */
+static int
+glusterd_frame_set_txn (call_frame_t *frame)
+{
+        unsigned char   *txn_id = NULL;
+
+        txn_id = GF_CALLOC (1, sizeof (uuid_t), gf_gld_mt_char);
+        if (!txn_id)
+                return -1;
+
+        uuid_copy (txn_id, glusterd_op_txn_get ()->txn_id);
+        frame->local = txn_id;
+
+        return 0;
+}
+
+static glusterd_op_info_t *
+glusterd_frame_get_txn (call_frame_t *frame)
+{
+        glusterd_op_info_t      *txn = NULL;
+
+        if (!frame->local)
+                return NULL;
+
+        txn = glusterd_op_txn_find (frame->local);
+        GF_FREE (frame->local);
+        frame->local = NULL;
+
+        return txn;
+}
+
+static char glusterd_xdr_pad[4];
+
+/* Encodes req, whose last member is an opaque left empty, with sfunc into
+ * vec[0] and serializes dict as that opaque into the vectors after it, so
+ * that a big dict is not flattened into one buffer first. The empty opaque
+ * encodes as its length alone, which is set to that of the dict. Both go
+ * into iobufs held by iobref. *count is in: slots of vec, out: used.
+ */
+static int
+glusterd_req_encode_dict (xlator_t *this, void *req, gd_serialize_t sfunc,
+                          dict_t *dict, struct iobref *iobref,
+                          struct iovec *vec, int *count)
+{
+        struct iobuf    *iob = NULL;
+        ssize_t         hdr_len = 0;
+        int32_t         len = 0;
+        uint32_t        netlen = 0;
+        size_t          pad = 0;
+        int             n = 0;
+        int             ret = -1;
+
+        iob = iobuf_get (this->ctx->iobuf_pool);
+        if (!iob)
+                goto out;
+        ret = iobref_add (iobref, iob);
+        if (ret)
+                goto out;
+
+        vec[0].iov_base = iobuf_ptr (iob);
+        vec[0].iov_len = iobuf_pagesize (iob);
+        hdr_len = sfunc (vec[0], req);
+        if (hdr_len < (ssize_t) sizeof (netlen)) {
+                ret = -1;
+                goto out;
+        }
+        vec[0].iov_len = hdr_len;
+
+        /* one slot is kept for the padding */
+        n = *count - 2;
+        len = dict_serialize_iobref (dict, this->ctx->iobuf_pool, iobref,
+                                     &vec[1], &n);
+        if (len < 0) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to serialize the "
+                        "dict of a request: %s", strerror (-len));
+                ret = -1;
+                goto out;
+        }
+
+        /* as much as fitted in one iobuf when the dict was flattened into
+         * the request, which is all a peer reads a request into */
+        if (hdr_len + GLUSTERD_XDR_ROUNDUP (len) > iobuf_pagesize (iob)) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Request with a dict of %d "
+                        "bytes is too big", len);
+                ret = -1;
+                goto out;
+        }
+
+        netlen = hton32 (len);
+        memcpy ((char *)vec[0].iov_base + hdr_len - sizeof (netlen), &netlen,
+                sizeof (netlen));
+
+        pad = GLUSTERD_XDR_ROUNDUP (len) - len;
+        if (pad) {
+                vec[1 + n].iov_base = glusterd_xdr_pad;
+                vec[1 + n].iov_len = pad;
+                n++;
+        }
+
+        *count = 1 + n;
+        ret = 0;
+out:
+        if (iob)
+                iobuf_unref (iob);
+        return ret;
+}
+
 int32_t
 glusterd_op_send_cli_response (glusterd_op_t op, int32_t op_ret,
                                int32_t op_errno, rpcsvc_request_t *req,
@@ -379,6 +489,20 @@ glusterd_op_send_cli_response (glusterd_op_t op, int32_t op_ret,
                 break;
         }
 
+        case GD_OP_BATCH:
+        {
+                gf1_cli_batch_vol_rsp rsp = {0,};
+                rsp.op_ret = op_ret;
+                rsp.op_errno = op_errno;
+                if (op_errstr)
+                        rsp.op_errstr = op_errstr;
+                else
+                        rsp.op_errstr = "";
+                cli_rsp = &rsp;
+                sfunc = gf_xdr_from_cli_batch_vol_rsp;
+                break;
+        }
+
         case GD_OP_NONE:
         case GD_OP_MAX:
         {
@@ -447,6 +571,7 @@ glusterd3_1_probe_cbk (struct rpc_req *req, struct iovec *iov,
         }
 
         uuid_copy (peerinfo->uuid, rsp.uuid);
+        glusterd_peerinfo_hash (peerinfo);
 
         ret = glusterd_friend_sm_new_event
                         (GD_FRIEND_EVENT_INIT_FRIEND_REQ, &event);
@@ -711,8 +836,10 @@ glusterd3_1_cluster_lock_cbk (struct rpc_req *req, struct iovec *iov,
         int32_t                       op_ret = -1;
         glusterd_op_sm_event_type_t   event_type = GD_OP_EVENT_NONE;
         glusterd_peerinfo_t           *peerinfo = NULL;
+        glusterd_op_info_t            *txn = NULL;
 
         GF_ASSERT (req);
+        txn = glusterd_frame_get_txn (myframe);
 
         if (-1 == req->rpc_status) {
                 rsp.op_ret   = -1;
@@ -741,14 +868,21 @@ glusterd3_1_cluster_lock_cbk (struct rpc_req *req, struct iovec *iov,
                         "unknown peer: %s", uuid_utoa (rsp.uuid));
         }
 
+        if (!txn) {
+                gf_log ("", GF_LOG_ERROR, "Lock response received for an "
+                        "unknown txn from %s", uuid_utoa (rsp.uuid));
+                ret = -1;
+                goto out;
+        }
+
         if (op_ret) {
                 event_type = GD_OP_EVENT_RCVD_RJT;
-                opinfo.op_ret = op_ret;
+                txn->op_ret = op_ret;
         } else {
                 event_type = GD_OP_EVENT_RCVD_ACC;
         }
 
-        ret = glusterd_op_sm_inject_event (event_type, NULL);
+        ret = glusterd_op_sm_inject_txn_event (event_type, txn->txn_id, NULL);
 
         if (!ret) {
                 glusterd_friend_sm ();
@@ -769,9 +903,11 @@ glusterd3_1_cluster_unlock_cbk (struct rpc_req *req, struct iovec *iov,
         int32_t                       op_ret = -1;
         glusterd_op_sm_event_type_t   event_type = GD_OP_EVENT_NONE;
         glusterd_peerinfo_t           *peerinfo = NULL;
+        glusterd_op_info_t            *txn = NULL;
 
 
         GF_ASSERT (req);
+        txn = glusterd_frame_get_txn (myframe);
 
         if (-1 == req->rpc_status) {
                 rsp.op_ret   = -1;
@@ -800,14 +936,21 @@ glusterd3_1_cluster_unlock_cbk (struct rpc_req *req, struct iovec *iov,
                         "unknown peer %s", uuid_utoa (rsp.uuid));
         }
 
+        if (!txn) {
+                gf_log ("", GF_LOG_ERROR, "Unlock response received for an "
+                        "unknown txn from %s", uuid_utoa (rsp.uuid));
+                ret = -1;
+                goto out;
+        }
+
         if (op_ret) {
                 event_type = GD_OP_EVENT_RCVD_RJT;
-                opinfo.op_ret = op_ret;
+                txn->op_ret = op_ret;
         } else {
                 event_type = GD_OP_EVENT_RCVD_ACC;
         }
 
-        ret = glusterd_op_sm_inject_event (event_type, NULL);
+        ret = glusterd_op_sm_inject_txn_event (event_type, txn->txn_id, NULL);
 
         if (!ret) {
                 glusterd_friend_sm ();
@@ -919,12 +1062,13 @@ glusterd_append_status_dicts (dict_t *dst, dict_t *src)
 }
 
 static int32_t
-glusterd_gsync_use_rsp_dict (dict_t *rsp_dict, char *op_errstr)
+glusterd_gsync_use_rsp_dict (glusterd_op_info_t *txn, dict_t *rsp_dict,
+                             char *op_errstr)
 {
         dict_t             *ctx = NULL;
         int                ret = 0;
 
-        ctx = glusterd_op_get_ctx (GD_OP_GSYNC_SET);
+        ctx = txn->op_ctx[GD_OP_GSYNC_SET];
         if (!ctx) {
                 gf_log ("", GF_LOG_ERROR,
                         "Operation Context is not present");
@@ -952,7 +1096,7 @@ glusterd_gsync_use_rsp_dict (dict_t *rsp_dict, char *op_errstr)
         return ret;
 }
 static int32_t
-glusterd_rb_use_rsp_dict (dict_t *rsp_dict)
+glusterd_rb_use_rsp_dict (glusterd_op_info_t *txn, dict_t *rsp_dict)
 {
         int32_t  src_port = 0;
         int32_t  dst_port = 0;
@@ -960,7 +1104,7 @@ glusterd_rb_use_rsp_dict (dict_t *rsp_dict)
         dict_t  *ctx      = NULL;
 
 
-        ctx = glusterd_op_get_ctx (GD_OP_REPLACE_BRICK);
+        ctx = txn->op_ctx[GD_OP_REPLACE_BRICK];
         if (!ctx) {
                 gf_log ("", GF_LOG_ERROR,
                         "Operation Context is not present");
@@ -1017,16 +1161,23 @@ glusterd3_1_stage_op_cbk (struct rpc_req *req, struct iovec *iov,
         int32_t                       op_ret = -1;
         glusterd_op_sm_event_type_t   event_type = GD_OP_EVENT_NONE;
         glusterd_peerinfo_t           *peerinfo = NULL;
+        glusterd_op_info_t            *txn = NULL;
         dict_t                        *dict   = NULL;
         char                          err_str[2048] = {0};
         char                          *peer_str = NULL;
+        uint32_t                      seq = 0;
 
         GF_ASSERT (req);
+        seq = (uint32_t)(unsigned long) ((call_frame_t *)myframe)->cookie;
+        txn = glusterd_frame_get_txn (myframe);
 
         if (-1 == req->rpc_status) {
                 rsp.op_ret   = -1;
                 rsp.op_errno = EINVAL;
                 rsp.op_errstr = "error";
+                /* no answer will come, the peer fails the phase now */
+                if (txn)
+                        glusterd_op_peer_lost (txn, seq);
                 goto out;
         }
 
@@ -1070,11 +1221,22 @@ glusterd3_1_stage_op_cbk (struct rpc_req *req, struct iovec *iov,
                         "unknown peer: %s", uuid_utoa (rsp.uuid));
         }
 
+        if (!txn) {
+                gf_log ("", GF_LOG_ERROR, "Stage response received for an "
+                        "unknown txn from %s", uuid_utoa (rsp.uuid));
+                ret = -1;
+                goto out;
+        }
+
+        ret = glusterd_op_peer_rsp (txn, seq);
+        if (ret)
+                goto out;
+
         if (op_ret) {
                 event_type = GD_OP_EVENT_RCVD_RJT;
-                opinfo.op_ret = op_ret;
+                txn->op_ret = op_ret;
                 if (strcmp ("", rsp.op_errstr)) {
-                        opinfo.op_errstr = gf_strdup (rsp.op_errstr);
+                        txn->op_errstr = gf_strdup (rsp.op_errstr);
                 } else {
                         if (peerinfo)
                                 peer_str = peerinfo->hostname;
@@ -1082,9 +1244,9 @@ glusterd3_1_stage_op_cbk (struct rpc_req *req, struct iovec *iov,
                                 peer_str = uuid_utoa (rsp.uuid);
                         snprintf (err_str, sizeof (err_str), "Operation failed "
                                   "on %s", peer_str);
-                        opinfo.op_errstr = gf_strdup (err_str);
+                        txn->op_errstr = gf_strdup (err_str);
                 }
-                if (!opinfo.op_errstr) {
+                if (!txn->op_errstr) {
                         gf_log ("", GF_LOG_ERROR, "memory allocation failed");
                         ret = -1;
                         goto out;
@@ -1095,11 +1257,11 @@ glusterd3_1_stage_op_cbk (struct rpc_req *req, struct iovec *iov,
 
         switch (rsp.op) {
         case GD_OP_REPLACE_BRICK:
-                glusterd_rb_use_rsp_dict (dict);
+                glusterd_rb_use_rsp_dict (txn, dict);
                 break;
         }
 
-        ret = glusterd_op_sm_inject_event (event_type, NULL);
+        ret = glusterd_op_sm_inject_txn_event (event_type, txn->txn_id, NULL);
 
         if (!ret) {
                 glusterd_friend_sm ();
@@ -1160,7 +1322,7 @@ _profile_volume_add_friend_rsp (dict_t *this, char *key, data_t *value,
 }
 
 int
-glusterd_profile_volume_use_rsp_dict (dict_t *rsp_dict)
+glusterd_profile_volume_use_rsp_dict (glusterd_op_info_t *txn, dict_t *rsp_dict)
 {
         int     ret = 0;
         glusterd_pr_brick_rsp_conv_t rsp_ctx = {0};
@@ -1177,9 +1339,9 @@ glusterd_profile_volume_use_rsp_dict (dict_t *rsp_dict)
                 goto out;
         }
 
-        op = glusterd_op_get_op ();
-        GF_ASSERT (GD_OP_PROFILE_VOLUME == op);
-        ctx_dict = glusterd_op_get_ctx (op);
+        op = GD_OP_PROFILE_VOLUME;
+        GF_ASSERT (txn->op[op]);
+        ctx_dict = txn->op_ctx[op];
 
         ret = dict_get_int32 (ctx_dict, "count", &count);
         rsp_ctx.count = count;
@@ -1200,18 +1362,26 @@ glusterd3_1_commit_op_cbk (struct rpc_req *req, struct iovec *iov,
         int32_t                       op_ret = -1;
         glusterd_op_sm_event_type_t   event_type = GD_OP_EVENT_NONE;
         glusterd_peerinfo_t           *peerinfo = NULL;
+        glusterd_op_info_t            *txn = NULL;
         dict_t                        *dict = NULL;
         char                          err_str[2048] = {0};
         char                          *peer_str = NULL;
+        uint32_t                      seq = 0;
 
 
         GF_ASSERT (req);
+        seq = (uint32_t)(unsigned long) ((call_frame_t *)myframe)->cookie;
+        txn = glusterd_frame_get_txn (myframe);
 
         if (-1 == req->rpc_status) {
                 rsp.op_ret   = -1;
                 rsp.op_errno = EINVAL;
                 rsp.op_errstr = "error";
 		event_type = GD_OP_EVENT_RCVD_RJT;
+                /* no answer will come, the peer fails the phase now */
+                if (txn)
+                        glusterd_op_peer_lost (txn, seq);
+                txn = NULL;
                 goto out;
         }
 
@@ -1256,11 +1426,18 @@ glusterd3_1_commit_op_cbk (struct rpc_req *req, struct iovec *iov,
                         "unknown peer: %s", uuid_utoa (rsp.uuid));
         }
 
+        if (!txn) {
+                gf_log ("", GF_LOG_ERROR, "Commit response received for an "
+                        "unknown txn from %s", uuid_utoa (rsp.uuid));
+                ret = -1;
+                goto out;
+        }
+
         if (op_ret) {
                 event_type = GD_OP_EVENT_RCVD_RJT;
-                opinfo.op_ret = op_ret;
+                txn->op_ret = op_ret;
                 if (strcmp ("", rsp.op_errstr)) {
-                        opinfo.op_errstr = gf_strdup(rsp.op_errstr);
+                        txn->op_errstr = gf_strdup(rsp.op_errstr);
                 } else {
                         if (peerinfo)
                                 peer_str = peerinfo->hostname;
@@ -1268,9 +1445,9 @@ glusterd3_1_commit_op_cbk (struct rpc_req *req, struct iovec *iov,
                                 peer_str = uuid_utoa (rsp.uuid);
                         snprintf (err_str, sizeof (err_str), "Operation failed "
                                   "on %s", peer_str);
-                        opinfo.op_errstr = gf_strdup (err_str);
+                        txn->op_errstr = gf_strdup (err_str);
                 }
-                if (!opinfo.op_errstr) {
+                if (!txn->op_errstr) {
                         gf_log ("", GF_LOG_ERROR, "memory allocation failed");
                         ret = -1;
                         goto out;
@@ -1279,7 +1456,7 @@ glusterd3_1_commit_op_cbk (struct rpc_req *req, struct iovec *iov,
                 event_type = GD_OP_EVENT_RCVD_ACC;
                 switch (rsp.op) {
                 case GD_OP_REPLACE_BRICK:
-                        ret = glusterd_rb_use_rsp_dict (dict);
+                        ret = glusterd_rb_use_rsp_dict (txn, dict);
                         if (ret)
                                 goto out;
                 break;
@@ -1291,13 +1468,14 @@ glusterd3_1_commit_op_cbk (struct rpc_req *req, struct iovec *iov,
                 break;
 
                 case GD_OP_PROFILE_VOLUME:
-                        ret = glusterd_profile_volume_use_rsp_dict (dict);
+                        ret = glusterd_profile_volume_use_rsp_dict (txn, dict);
                         if (ret)
                                 goto out;
                 break;
 
                 case GD_OP_GSYNC_SET:
-                        ret = glusterd_gsync_use_rsp_dict (dict, rsp.op_errstr);
+                        ret = glusterd_gsync_use_rsp_dict (txn, dict,
+                                                           rsp.op_errstr);
                         if (ret)
                                 goto out;
                 break;
@@ -1308,7 +1486,14 @@ glusterd3_1_commit_op_cbk (struct rpc_req *req, struct iovec *iov,
         }
 
 out:
-        ret = glusterd_op_sm_inject_event (event_type, NULL);
+        /* Answers after the deadline of the phase have already been
+         * counted.
+         */
+        if (txn && glusterd_op_peer_rsp (txn, seq))
+                txn = NULL;
+        if (txn)
+                ret = glusterd_op_sm_inject_txn_event (event_type,
+                                                       txn->txn_id, NULL);
 
         if (!ret) {
                 glusterd_friend_sm ();
@@ -1385,7 +1570,9 @@ glusterd3_1_friend_add (call_frame_t *frame, xlator_t *this,
         glusterd_friend_sm_event_t *event    = NULL;
         glusterd_friend_req_ctx_t  *ctx      = NULL;
         dict_t                     *vols     = NULL;
-
+        struct iobref              *iobref   = NULL;
+        struct iovec                vec[GLUSTERD_REQ_MAX_IOVS];
+        int                         count    = GLUSTERD_REQ_MAX_IOVS;
 
         if (!frame || !this || !data) {
                 ret = -1;
@@ -1401,7 +1588,12 @@ glusterd3_1_friend_add (call_frame_t *frame, xlator_t *this,
 
         peerinfo = event->peerinfo;
 
-        ret = glusterd_build_volume_dict (&vols);
+        /* only v2 peers take a summary and ask for the volumes they miss,
+         * a v1 peer compares what it gets with all of its volumes */
+        if (peerinfo->mgmt == &gd_clnt_mgmt_v2_prog)
+                ret = glusterd_build_volume_summary_dict (&vols);
+        else
+                ret = glusterd_build_volume_dict (&vols);
         if (ret)
                 goto out;
 
@@ -1409,20 +1601,26 @@ glusterd3_1_friend_add (call_frame_t *frame, xlator_t *this,
         req.hostname = peerinfo->hostname;
         req.port = peerinfo->port;
 
-        ret = dict_allocate_and_serialize (vols, &req.vols.vols_val,
-                                           (size_t *)&req.vols.vols_len);
-        if (ret)
+        iobref = iobref_new ();
+        if (!iobref) {
+                ret = -1;
                 goto out;
+        }
 
-        ret = glusterd_submit_request (peerinfo->rpc, &req, frame, peerinfo->mgmt,
-                                       GD_MGMT_FRIEND_ADD,
-                                       NULL, gd_xdr_from_mgmt_friend_req,
-                                       this, glusterd3_1_friend_add_cbk);
+        ret = glusterd_req_encode_dict (this, &req,
+                                        gd_xdr_from_mgmt_friend_req, vols,
+                                        iobref, vec, &count);
+        if (ret)
+                goto out;
 
+        ret = rpc_clnt_submit (peerinfo->rpc, peerinfo->mgmt,
+                               GD_MGMT_FRIEND_ADD, glusterd3_1_friend_add_cbk,
+                               vec, 1, &vec[1], count - 1, iobref, frame,
+                               NULL, 0, NULL, 0, NULL);
 
 out:
-        if (req.vols.vols_val)
-                GF_FREE (req.vols.vols_val);
+        if (iobref)
+                iobref_unref (iobref);
 
         if (vols)
                 dict_unref (vols);
@@ -1515,74 +1713,242 @@ out:
         return ret;
 }
 
+/* Sends a lock or unlock request of the current txn to peerinfo. */
+static int
+glusterd3_1_lock_submit (xlator_t *this, glusterd_peerinfo_t *peerinfo,
+                         void *req, int procnum, gd_serialize_t sfunc,
+                         fop_cbk_fn_t cbkfn)
+{
+        call_frame_t                    *dummy_frame = NULL;
+        int                             ret = -1;
+
+        dummy_frame = create_frame (this, this->ctx->pool);
+        if (!dummy_frame)
+                goto out;
+
+        ret = glusterd_frame_set_txn (dummy_frame);
+        if (ret) {
+                STACK_DESTROY (dummy_frame->root);
+                goto out;
+        }
+
+        ret = glusterd_submit_request (peerinfo->rpc, req, dummy_frame,
+                                       peerinfo->mgmt, procnum, NULL, sfunc,
+                                       this, cbkfn);
+out:
+        gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+/* Peers of mgmt version 1 only know the cluster lock and a single txn,
+ * see glusterd_peers_support_txns ().
+ */
 int32_t
 glusterd3_1_cluster_lock (call_frame_t *frame, xlator_t *this,
                           void *data)
 {
         gd1_mgmt_cluster_lock_req       req = {{0},};
-        int                             ret = -1;
         glusterd_peerinfo_t             *peerinfo = NULL;
-        glusterd_conf_t                 *priv = NULL;
-        call_frame_t                    *dummy_frame = NULL;
 
         if (!this)
-                goto out;
-
+                return -1;
         peerinfo = data;
 
-        priv = this->private;
-        GF_ASSERT (priv);
-
         glusterd_get_uuid (&req.uuid);
 
-        dummy_frame = create_frame (this, this->ctx->pool);
-        if (!dummy_frame)
-                goto out;
+        return glusterd3_1_lock_submit (this, peerinfo, &req,
+                                        GD_MGMT_CLUSTER_LOCK,
+                                        gd_xdr_from_mgmt_cluster_lock_req,
+                                        glusterd3_1_cluster_lock_cbk);
+}
 
-        ret = glusterd_submit_request (peerinfo->rpc, &req, dummy_frame,
-                                       peerinfo->mgmt, GD_MGMT_CLUSTER_LOCK,
-                                       NULL,
-                                       gd_xdr_from_mgmt_cluster_lock_req,
-                                       this, glusterd3_1_cluster_lock_cbk);
-out:
-        gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
-        return ret;
+int32_t
+glusterd_mgmt_v2_cluster_lock (call_frame_t *frame, xlator_t *this,
+                               void *data)
+{
+        gd1_mgmt_v2_cluster_lock_req    req = {{0},};
+        glusterd_peerinfo_t             *peerinfo = NULL;
+
+        if (!this)
+                return -1;
+        peerinfo = data;
+
+        glusterd_get_uuid (&req.uuid);
+        uuid_copy (req.txn_id, glusterd_op_txn_get ()->txn_id);
+        req.volname = glusterd_op_get_lock_volname ();
+        if (!req.volname)
+                req.volname = "";
+
+        return glusterd3_1_lock_submit (this, peerinfo, &req,
+                                        GD_MGMT_CLUSTER_LOCK,
+                                        gd_xdr_from_mgmt_v2_cluster_lock_req,
+                                        glusterd3_1_cluster_lock_cbk);
 }
 
 int32_t
 glusterd3_1_cluster_unlock (call_frame_t *frame, xlator_t *this,
                             void *data)
 {
-        gd1_mgmt_cluster_lock_req       req = {{0},};
-        int                             ret = -1;
+        gd1_mgmt_cluster_unlock_req     req = {{0},};
         glusterd_peerinfo_t             *peerinfo = NULL;
-        glusterd_conf_t                 *priv = NULL;
-        call_frame_t                    *dummy_frame = NULL;
 
-        if (!this ) {
-                ret = -1;
-                goto out;
-        }
+        if (!this)
+                return -1;
         peerinfo = data;
-        priv = this->private;
-        GF_ASSERT (priv);
 
         glusterd_get_uuid (&req.uuid);
 
+        return glusterd3_1_lock_submit (this, peerinfo, &req,
+                                        GD_MGMT_CLUSTER_UNLOCK,
+                                        gd_xdr_from_mgmt_cluster_unlock_req,
+                                        glusterd3_1_cluster_unlock_cbk);
+}
+
+int32_t
+glusterd_mgmt_v2_cluster_unlock (call_frame_t *frame, xlator_t *this,
+                                 void *data)
+{
+        gd1_mgmt_v2_cluster_unlock_req  req = {{0},};
+        glusterd_peerinfo_t             *peerinfo = NULL;
+
+        if (!this)
+                return -1;
+        peerinfo = data;
+
+        glusterd_get_uuid (&req.uuid);
+        uuid_copy (req.txn_id, glusterd_op_txn_get ()->txn_id);
+        req.volname = glusterd_op_get_lock_volname ();
+        if (!req.volname)
+                req.volname = "";
+
+        return glusterd3_1_lock_submit (this, peerinfo, &req,
+                                        GD_MGMT_CLUSTER_UNLOCK,
+                                        gd_xdr_from_mgmt_v2_cluster_unlock_req,
+                                        glusterd3_1_cluster_unlock_cbk);
+}
+
+/* Sends the request of a stage or commit fan-out to peerinfo, encoding
+ * req with sfunc, and dict as its payload if there is one, on the first
+ * call for its mgmt version only. The frame carries the tag the op state
+ * machine gave this peer.
+ */
+static int
+glusterd3_1_op_fanout_submit (xlator_t *this, glusterd_peerinfo_t *peerinfo,
+                              glusterd_op_fanout_t *fanout,
+                              glusterd_op_fanout_ver_t ver, void *req,
+                              dict_t *dict, gd_serialize_t sfunc,
+                              int procnum, fop_cbk_fn_t cbkfn)
+{
+        call_frame_t    *dummy_frame = NULL;
+        struct iobuf    *iob = NULL;
+        struct iovec    *iov = NULL;
+        ssize_t         len = 0;
+        int             ret = -1;
+
+        iov = fanout->enc[ver].iov;
+        if (!fanout->enc[ver].iobref) {
+                fanout->enc[ver].iobref = iobref_new ();
+                if (!fanout->enc[ver].iobref)
+                        goto out;
+
+                if (dict) {
+                        fanout->enc[ver].count = GLUSTERD_REQ_MAX_IOVS;
+                        ret = glusterd_req_encode_dict (this, req, sfunc,
+                                                        dict,
+                                                        fanout->enc[ver].iobref,
+                                                        iov,
+                                                        &fanout->enc[ver].count);
+                } else {
+                        ret = -1;
+                        iob = iobuf_get (this->ctx->iobuf_pool);
+                        if (iob)
+                                ret = iobref_add (fanout->enc[ver].iobref,
+                                                  iob);
+                        if (!ret) {
+                                iov->iov_base = iobuf_ptr (iob);
+                                iov->iov_len = iobuf_pagesize (iob);
+                                len = sfunc (*iov, req);
+                                if (len == -1)
+                                        ret = -1;
+                                iov->iov_len = len;
+                                fanout->enc[ver].count = 1;
+                        }
+                }
+                if (ret) {
+                        iobref_unref (fanout->enc[ver].iobref);
+                        fanout->enc[ver].iobref = NULL;
+                        goto out;
+                }
+                ret = -1;
+        }
+
         dummy_frame = create_frame (this, this->ctx->pool);
         if (!dummy_frame)
                 goto out;
 
-        ret = glusterd_submit_request (peerinfo->rpc, &req, dummy_frame,
-                                       peerinfo->mgmt, GD_MGMT_CLUSTER_UNLOCK,
-                                       NULL,
-                                       gd_xdr_from_mgmt_cluster_unlock_req,
-                                       this, glusterd3_1_cluster_unlock_cbk);
+        ret = glusterd_frame_set_txn (dummy_frame);
+        if (ret) {
+                STACK_DESTROY (dummy_frame->root);
+                goto out;
+        }
+        dummy_frame->cookie = (void *)(unsigned long) fanout->seq;
+
+        ret = rpc_clnt_submit (peerinfo->rpc, peerinfo->mgmt, procnum, cbkfn,
+                               iov, 1, &iov[1], fanout->enc[ver].count - 1,
+                               fanout->enc[ver].iobref, dummy_frame, NULL, 0,
+                               NULL, 0, NULL);
+out:
+        if (iob)
+                iobuf_unref (iob);
+        return ret;
+}
+
+/* Takes the peer and the fan-out a stage or commit request is for out of
+ * dict, a fan-out of its own for a request sent to a single peer.
+ */
+static int
+glusterd3_1_op_req_target (dict_t *dict, glusterd_peerinfo_t **peerinfo,
+                           glusterd_op_fanout_t **fanout,
+                           glusterd_op_fanout_t *single)
+{
+        int     ret = -1;
+
+        ret = dict_get_ptr (dict, "peerinfo", VOID (peerinfo));
+        if (ret)
+                goto out;
+        if (dict_get_ptr (dict, "fanout", VOID (fanout)))
+                *fanout = single;
+
+        //peerinfo and fanout should not be in payload
+        dict_del (dict, "peerinfo");
+        dict_del (dict, "fanout");
 out:
-        gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
+/* The payload of a stage or commit request of op: the volume name of a
+ * volume delete goes in *buf_val, anything else is dict, returned in
+ * *payload to be serialized behind the request.
+ */
+static int
+glusterd3_1_op_req_payload (dict_t *dict, int op, char **buf_val,
+                            u_int *buf_len, dict_t **payload)
+{
+        int     ret = 0;
+
+        if (GD_OP_DELETE_VOLUME == op) {
+                ret = dict_get_str (dict, "volname", buf_val);
+                if (ret)
+                        goto out;
+                *buf_len = strlen (*buf_val);
+        } else {
+                *payload = dict;
+        }
+out:
+        return ret;
+}
+
+/* STAGE_OP to a peer of mgmt version 1, which knows the txn by our uuid */
 int32_t
 glusterd3_1_stage_op (call_frame_t *frame, xlator_t *this,
                       void *data)
@@ -1590,62 +1956,89 @@ glusterd3_1_stage_op (call_frame_t *frame, xlator_t *this,
         gd1_mgmt_stage_op_req           req = {{0,},};
         int                             ret = -1;
         glusterd_peerinfo_t             *peerinfo = NULL;
-        glusterd_conf_t                 *priv = NULL;
-        call_frame_t                    *dummy_frame = NULL;
-        dict_t                          *dict = NULL;
-        gf_boolean_t                    is_alloc = _gf_true;
+        dict_t                          *payload = NULL;
+        glusterd_op_fanout_t            *fanout = NULL;
+        glusterd_op_fanout_t            single = {0,};
 
         if (!this) {
                 goto out;
         }
 
-        dict = data;
-
-        priv = this->private;
-        GF_ASSERT (priv);
-
-        ret = dict_get_ptr (dict, "peerinfo", VOID (&peerinfo));
+        ret = glusterd3_1_op_req_target (data, &peerinfo, &fanout, &single);
         if (ret)
                 goto out;
 
-        //peerinfo should not be in payload
-        dict_del (dict, "peerinfo");
+        /* already encoded for an earlier peer of this phase */
+        if (fanout->enc[GD_OP_FANOUT_V1].iobref)
+                goto submit;
 
         glusterd_get_uuid (&req.uuid);
         req.op = glusterd_op_get_op ();
+        ret = glusterd3_1_op_req_payload (data, req.op, &req.buf.buf_val,
+                                          &req.buf.buf_len, &payload);
+        if (ret)
+                goto out;
 
-        if (GD_OP_DELETE_VOLUME == req.op) {
-                ret = dict_get_str (dict, "volname", &req.buf.buf_val);
-                if (ret)
-                        goto out;
-                req.buf.buf_len = strlen (req.buf.buf_val);
-                is_alloc = _gf_false;
-        } else {
-                ret = dict_allocate_and_serialize (dict, &req.buf.buf_val,
-                                                   (size_t *)&req.buf.buf_len);
+submit:
+        ret = glusterd3_1_op_fanout_submit (this, peerinfo, fanout,
+                                            GD_OP_FANOUT_V1, &req, payload,
+                                            gd_xdr_from_mgmt_stage_op_req,
+                                            GD_MGMT_STAGE_OP,
+                                            glusterd3_1_stage_op_cbk);
 
-                if (ret)
-                        goto out;
+out:
+        glusterd_op_fanout_release (&single);
+
+        gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+int32_t
+glusterd_mgmt_v2_stage_op (call_frame_t *frame, xlator_t *this,
+                           void *data)
+{
+        gd1_mgmt_v2_stage_op_req        req = {{0,},};
+        int                             ret = -1;
+        glusterd_peerinfo_t             *peerinfo = NULL;
+        dict_t                          *payload = NULL;
+        glusterd_op_fanout_t            *fanout = NULL;
+        glusterd_op_fanout_t            single = {0,};
+
+        if (!this) {
+                goto out;
         }
 
-        dummy_frame = create_frame (this, this->ctx->pool);
-        if (!dummy_frame)
+        ret = glusterd3_1_op_req_target (data, &peerinfo, &fanout, &single);
+        if (ret)
                 goto out;
 
-        ret = glusterd_submit_request (peerinfo->rpc, &req, dummy_frame,
-                                       peerinfo->mgmt, GD_MGMT_STAGE_OP,
-                                       NULL,
-                                       gd_xdr_from_mgmt_stage_op_req,
-                                       this, glusterd3_1_stage_op_cbk);
+        /* already encoded for an earlier peer of this phase */
+        if (fanout->enc[GD_OP_FANOUT_V2].iobref)
+                goto submit;
+
+        glusterd_get_uuid (&req.uuid);
+        uuid_copy (req.txn_id, glusterd_op_txn_get ()->txn_id);
+        req.op = glusterd_op_get_op ();
+        ret = glusterd3_1_op_req_payload (data, req.op, &req.buf.buf_val,
+                                          &req.buf.buf_len, &payload);
+        if (ret)
+                goto out;
+
+submit:
+        ret = glusterd3_1_op_fanout_submit (this, peerinfo, fanout,
+                                            GD_OP_FANOUT_V2, &req, payload,
+                                            gd_xdr_from_mgmt_v2_stage_op_req,
+                                            GD_MGMT_STAGE_OP,
+                                            glusterd3_1_stage_op_cbk);
 
 out:
-        if ((_gf_true == is_alloc) && req.buf.buf_val)
-                GF_FREE (req.buf.buf_val);
+        glusterd_op_fanout_release (&single);
 
         gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
+/* COMMIT_OP to a peer of mgmt version 1, which knows the txn by our uuid */
 int32_t
 glusterd3_1_commit_op (call_frame_t *frame, xlator_t *this,
                       void *data)
@@ -1653,56 +2046,83 @@ glusterd3_1_commit_op (call_frame_t *frame, xlator_t *this,
         gd1_mgmt_commit_op_req  req         = {{0,},};
         int                     ret         = -1;
         glusterd_peerinfo_t    *peerinfo    = NULL;
-        glusterd_conf_t        *priv        = NULL;
-        call_frame_t           *dummy_frame = NULL;
-        dict_t                 *dict        = NULL;
-        gf_boolean_t            is_alloc    = _gf_true;
+        dict_t                 *payload     = NULL;
+        glusterd_op_fanout_t   *fanout      = NULL;
+        glusterd_op_fanout_t    single      = {0,};
 
         if (!this) {
                 goto out;
         }
 
-        dict = data;
-        priv = this->private;
-        GF_ASSERT (priv);
-
-        ret = dict_get_ptr (dict, "peerinfo", VOID (&peerinfo));
+        ret = glusterd3_1_op_req_target (data, &peerinfo, &fanout, &single);
         if (ret)
                 goto out;
 
-        //peerinfo should not be in payload
-        dict_del (dict, "peerinfo");
+        /* already encoded for an earlier peer of this phase */
+        if (fanout->enc[GD_OP_FANOUT_V1].iobref)
+                goto submit;
 
         glusterd_get_uuid (&req.uuid);
         req.op = glusterd_op_get_op ();
+        ret = glusterd3_1_op_req_payload (data, req.op, &req.buf.buf_val,
+                                          &req.buf.buf_len, &payload);
+        if (ret)
+                goto out;
 
-        if (GD_OP_DELETE_VOLUME == req.op) {
-                ret = dict_get_str (dict, "volname", &req.buf.buf_val);
-                if (ret)
-                        goto out;
-                req.buf.buf_len = strlen (req.buf.buf_val);
-                is_alloc = _gf_false;
-        } else {
-                ret = dict_allocate_and_serialize (dict, &req.buf.buf_val,
-                                                   (size_t *)&req.buf.buf_len);
+submit:
+        ret = glusterd3_1_op_fanout_submit (this, peerinfo, fanout,
+                                            GD_OP_FANOUT_V1, &req, payload,
+                                            gd_xdr_from_mgmt_commit_op_req,
+                                            GD_MGMT_COMMIT_OP,
+                                            glusterd3_1_commit_op_cbk);
 
-                if (ret)
-                        goto out;
+out:
+        glusterd_op_fanout_release (&single);
+
+        gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+int32_t
+glusterd_mgmt_v2_commit_op (call_frame_t *frame, xlator_t *this,
+                            void *data)
+{
+        gd1_mgmt_v2_commit_op_req  req      = {{0,},};
+        int                     ret         = -1;
+        glusterd_peerinfo_t    *peerinfo    = NULL;
+        dict_t                 *payload     = NULL;
+        glusterd_op_fanout_t   *fanout      = NULL;
+        glusterd_op_fanout_t    single      = {0,};
+
+        if (!this) {
+                goto out;
         }
 
-        dummy_frame = create_frame (this, this->ctx->pool);
-        if (!dummy_frame)
+        ret = glusterd3_1_op_req_target (data, &peerinfo, &fanout, &single);
+        if (ret)
                 goto out;
 
-        ret = glusterd_submit_request (peerinfo->rpc, &req, dummy_frame,
-                                       peerinfo->mgmt, GD_MGMT_COMMIT_OP,
-                                       NULL,
-                                       gd_xdr_from_mgmt_commit_op_req,
-                                       this, glusterd3_1_commit_op_cbk);
+        /* already encoded for an earlier peer of this phase */
+        if (fanout->enc[GD_OP_FANOUT_V2].iobref)
+                goto submit;
+
+        glusterd_get_uuid (&req.uuid);
+        uuid_copy (req.txn_id, glusterd_op_txn_get ()->txn_id);
+        req.op = glusterd_op_get_op ();
+        ret = glusterd3_1_op_req_payload (data, req.op, &req.buf.buf_val,
+                                          &req.buf.buf_len, &payload);
+        if (ret)
+                goto out;
+
+submit:
+        ret = glusterd3_1_op_fanout_submit (this, peerinfo, fanout,
+                                            GD_OP_FANOUT_V2, &req, payload,
+                                            gd_xdr_from_mgmt_v2_commit_op_req,
+                                            GD_MGMT_COMMIT_OP,
+                                            glusterd3_1_commit_op_cbk);
 
 out:
-        if ((_gf_true == is_alloc) && req.buf.buf_val)
-                GF_FREE (req.buf.buf_val);
+        glusterd_op_fanout_release (&single);
 
         gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
@@ -1799,12 +2219,14 @@ out:
         ev_ctx->brickinfo = frame->cookie;
         ev_ctx->rsp_dict  = dict;
         ev_ctx->commit_ctx = frame->local;
-        op = glusterd_op_get_op ();
+        op = ev_ctx->commit_ctx->op;
         if ((op == GD_OP_STOP_VOLUME) ||
            (op == GD_OP_REMOVE_BRICK)) {
                 ret = glusterd_start_brick_disconnect_timer (ev_ctx);
         } else {
-                ret = glusterd_op_sm_inject_event (event_type, ev_ctx);
+                ret = glusterd_op_sm_inject_txn_event (event_type,
+                                                       ev_ctx->commit_ctx->txn_id,
+                                                       ev_ctx);
                 if (!ret) {
                         glusterd_friend_sm ();
                         glusterd_op_sm ();
@@ -1865,6 +2287,26 @@ struct rpc_clnt_program gd_clnt_mgmt_prog = {
         .proctable = gd_clnt_mgmt_actors,
 };
 
+struct rpc_clnt_procedure gd_clnt_mgmt_v2_actors[GLUSTERD_MGMT_MAXVALUE] = {
+        [GLUSTERD_MGMT_NULL]           = {"NULL", NULL },
+        [GLUSTERD_MGMT_PROBE_QUERY]    = {"PROBE_QUERY", glusterd3_1_probe},
+        [GLUSTERD_MGMT_FRIEND_ADD]     = {"FRIEND_ADD", glusterd3_1_friend_add},
+        [GLUSTERD_MGMT_CLUSTER_LOCK]   = {"CLUSTER_LOCK", glusterd_mgmt_v2_cluster_lock},
+        [GLUSTERD_MGMT_CLUSTER_UNLOCK] = {"CLUSTER_UNLOCK", glusterd_mgmt_v2_cluster_unlock},
+        [GLUSTERD_MGMT_STAGE_OP]       = {"STAGE_OP", glusterd_mgmt_v2_stage_op},
+        [GLUSTERD_MGMT_COMMIT_OP]      = {"COMMIT_OP", glusterd_mgmt_v2_commit_op},
+        [GLUSTERD_MGMT_FRIEND_REMOVE]  = {"FRIEND_REMOVE", glusterd3_1_friend_remove},
+        [GLUSTERD_MGMT_FRIEND_UPDATE]  = {"FRIEND_UPDATE", glusterd3_1_friend_update},
+};
+
+struct rpc_clnt_program gd_clnt_mgmt_v2_prog = {
+        .progname  = "glusterd clnt mgmt v2",
+        .prognum   = GD_MGMT_PROGRAM,
+        .progver   = GD_MGMT_V2_VERSION,
+        .numproc   = GD_MGMT_PROCCNT,
+        .proctable = gd_clnt_mgmt_v2_actors,
+};
+
 struct rpc_clnt_program glusterd_glusterfs_3_1_mgmt_prog = {
         .progname  = "GlusterFS Mops",
         .prognum   = GLUSTERFS_PROGRAM,
@@ -1886,6 +2328,7 @@ glusterd3_1_brick_op (call_frame_t *frame, xlator_t *this,
         glusterd_pending_node_t         *pending_brick;
         glusterd_brickinfo_t            *brickinfo = NULL;
         glusterd_req_ctx_t               *req_ctx = NULL;
+        glusterd_op_info_t              *txn = NULL;
 
         if (!this) {
                 ret = -1;
@@ -1896,16 +2339,17 @@ glusterd3_1_brick_op (call_frame_t *frame, xlator_t *this,
 
         req_ctx = data;
         GF_ASSERT (req_ctx);
-        INIT_LIST_HEAD (&opinfo.pending_bricks);
+        txn = glusterd_op_txn_get ();
+        INIT_LIST_HEAD (&txn->pending_bricks);
         ret = glusterd_op_bricks_select (req_ctx->op, req_ctx->dict, &op_errstr);
 
         if (ret) {
                 gf_log ("", GF_LOG_ERROR, "Brick Op failed");
-                opinfo.op_errstr = op_errstr;
+                txn->op_errstr = op_errstr;
                 goto out;
         }
 
-        list_for_each_entry (pending_brick, &opinfo.pending_bricks, list) {
+        list_for_each_entry (pending_brick, &txn->pending_bricks, list) {
                 dummy_frame = create_frame (this, this->ctx->pool);
                 brickinfo = pending_brick->node;
 
@@ -1940,12 +2384,12 @@ glusterd3_1_brick_op (call_frame_t *frame, xlator_t *this,
 
         gf_log ("glusterd", GF_LOG_DEBUG, "Sent op req to %d bricks",
                                             pending_bricks);
-        opinfo.brick_pending_count = pending_bricks;
+        txn->brick_pending_count = pending_bricks;
 
 out:
-        if (ret) {
+        if (ret && txn) {
                 glusterd_op_sm_inject_event (GD_OP_EVENT_RCVD_RJT, data);
-                opinfo.op_ret = ret;
+                txn->op_ret = ret;
         }
         gf_log ("glusterd", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
@@ -192,6 +192,49 @@ out:
         return ret;
 }
 
+/* Sends @vols to @peerinfo as a friend update with @op, which is either
+ * GD_FRIEND_UPDATE_VOLS_REQ (names of the volumes we need) or
+ * GD_FRIEND_UPDATE_VOLS (the requested volumes).
+ */
+int
+glusterd_send_friend_volumes_update (glusterd_peerinfo_t *peerinfo,
+                                     dict_t *vols, int32_t op)
+{
+        int                             ret = -1;
+        rpc_clnt_procedure_t            *proc = NULL;
+        xlator_t                        *this = NULL;
+
+        GF_ASSERT (peerinfo);
+        GF_ASSERT (vols);
+
+        this = THIS;
+
+        if (!peerinfo->connected || !peerinfo->mgmt) {
+                gf_log ("", GF_LOG_WARNING, "Peer %s is not connected, "
+                        "volumes will be synced on reconnect",
+                        peerinfo->hostname);
+                goto out;
+        }
+
+        ret = dict_set_int32 (vols, "op", op);
+        if (ret)
+                goto out;
+
+        ret = dict_set_static_ptr (vols, "peerinfo", peerinfo);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "failed to set peerinfo");
+                goto out;
+        }
+
+        proc = &peerinfo->mgmt->proctable[GLUSTERD_MGMT_FRIEND_UPDATE];
+        if (proc->fn)
+                ret = proc->fn (NULL, this, vols);
+
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        return ret;
+}
+
 
 static int
 glusterd_ac_none (glusterd_friend_sm_event_t *event, void *ctx)
@@ -600,6 +643,7 @@ glusterd_ac_handle_friend_add_req (glusterd_friend_sm_event_t *event, void *ctx)
         int                             status = 0;
         int32_t                         op_ret = -1;
         int32_t                         op_errno = 0;
+        dict_t                          *wanted = NULL;
 
         GF_ASSERT (ctx);
         ev_ctx = ctx;
@@ -607,12 +651,22 @@ glusterd_ac_handle_friend_add_req (glusterd_friend_sm_event_t *event, void *ctx)
         peerinfo = event->peerinfo;
         GF_ASSERT (peerinfo);
         uuid_copy (peerinfo->uuid, ev_ctx->uuid);
+        glusterd_peerinfo_hash (peerinfo);
 
         //Build comparison logic here.
-        ret = glusterd_compare_friend_data (ev_ctx->vols, &status);
+        ret = glusterd_compare_friend_data (ev_ctx->vols, &status, &wanted);
         if (ret)
                 goto out;
 
+        /* Only the volume summary was received, pull the volumes which
+         * differ from the peer.
+         */
+        if (wanted) {
+                (void) glusterd_send_friend_volumes_update (peerinfo, wanted,
+                                                            GD_FRIEND_UPDATE_VOLS_REQ);
+                dict_unref (wanted);
+        }
+
         if (GLUSTERD_VOL_COMP_RJT != status) {
                 event_type = GD_FRIEND_EVENT_LOCAL_ACC;
                 op_ret = 0;
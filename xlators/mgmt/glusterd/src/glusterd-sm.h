@@ -42,6 +42,11 @@ struct glusterd_store_handle_ {
         char    *path;
         int     fd;
         FILE    *read;
+        /* contents of the file being written, flushed with a single
+         * write() by glusterd_store_rename_tmppath */
+        char    *wbuf;
+        size_t  wlen;
+        size_t  wsize;
 };
 
 typedef struct glusterd_store_handle_  glusterd_store_handle_t;
@@ -94,12 +99,18 @@ struct glusterd_peerinfo_ {
         char                            *hostname;
         int                             port;
         struct list_head                uuid_list;
+        struct list_head                uuid_hash;
+        struct list_head                hostname_hash;
         struct list_head                op_peers_list;
         struct rpc_clnt                 *rpc;
         rpc_clnt_prog_t                 *mgmt;
         int                             connected;
         glusterd_store_handle_t         *shandle;
         glusterd_sm_tr_log_t            sm_log;
+        uint64_t                        op_rsp_count;
+        uint64_t                        op_latency_total; /* usec */
+        uint64_t                        op_latency_max;
+        uint64_t                        op_timeouts;
 };
 
 typedef struct glusterd_peerinfo_ glusterd_peerinfo_t;
@@ -141,6 +152,8 @@ typedef enum glusterd_friend_update_op_ {
         GD_FRIEND_UPDATE_NONE = 0,
         GD_FRIEND_UPDATE_ADD,
         GD_FRIEND_UPDATE_DEL,
+        GD_FRIEND_UPDATE_VOLS_REQ,
+        GD_FRIEND_UPDATE_VOLS,
 } glusterd_friend_update_op_t;
 
 
@@ -205,6 +218,9 @@ glusterd_friend_sm_event_name_get (int event);
 
 int
 glusterd_broadcast_friend_delete (char *hostname, uuid_t uuid);
+int
+glusterd_send_friend_volumes_update (glusterd_peerinfo_t *peerinfo,
+                                     dict_t *vols, int32_t op);
 void
 glusterd_destroy_friend_update_ctx (glusterd_friend_update_ctx_t *ctx);
 #endif
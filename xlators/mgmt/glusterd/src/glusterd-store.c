@@ -48,8 +48,10 @@
 #include "cli1.h"
 #include "rpc-clnt.h"
 #include "common-utils.h"
+#include "checksum.h"
 
 #include <sys/resource.h>
+#include <sys/mman.h>
 #include <inttypes.h>
 #include <dirent.h>
 
@@ -88,6 +90,26 @@ glusterd_store_handle_create_on_absence (glusterd_store_handle_t **shandle,
         return ret;
 }
 
+static void
+glusterd_store_account (uint64_t bytes, uint64_t syscalls, uint64_t files)
+{
+        glusterd_conf_t         *priv = NULL;
+
+        priv = THIS->private;
+        if (!priv)
+                return;
+
+        priv->store_stats.bytes += bytes;
+        priv->store_stats.syscalls += syscalls;
+        priv->store_stats.files += files;
+        priv->store_txn_stats.bytes += bytes;
+        priv->store_txn_stats.syscalls += syscalls;
+        priv->store_txn_stats.files += files;
+}
+
+/* Opens <path>.tmp for writing. Values saved through the handle are
+ * buffered until glusterd_store_rename_tmppath () or
+ * glusterd_store_unlink_tmppath (), either of which closes the fd. */
 int32_t
 glusterd_store_mkstemp (glusterd_store_handle_t *shandle)
 {
@@ -99,22 +121,82 @@ glusterd_store_mkstemp (glusterd_store_handle_t *shandle)
 
         snprintf (tmppath, sizeof (tmppath), "%s.tmp", shandle->path);
         fd = open (tmppath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        glusterd_store_account (0, 1, 0);
         if (fd <= 0) {
                 gf_log ("glusterd", GF_LOG_ERROR, "Failed to open %s, "
                         "error: %s", tmppath, strerror (errno));
+                return fd;
         }
 
+        shandle->fd = fd;
+        shandle->wlen = 0;
+
         return fd;
 }
 
-int32_t
-glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
+static int32_t
+glusterd_store_flush (glusterd_store_handle_t *shandle, gf_boolean_t sync)
+{
+        int32_t         ret = 0;
+        size_t          done = 0;
+        uint64_t        syscalls = 0;
+
+        while (done < shandle->wlen) {
+                ret = write (shandle->fd, shandle->wbuf + done,
+                             shandle->wlen - done);
+                syscalls++;
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        gf_log ("glusterd", GF_LOG_ERROR, "Failed to write "
+                                "%s.tmp, error: %s", shandle->path,
+                                strerror (errno));
+                        goto out;
+                }
+                done += ret;
+        }
+
+        if (!sync)
+                goto out;
+
+        /* the new contents must be on disk before the rename makes
+         * them visible, or a crash can leave an empty file behind */
+        ret = fsync (shandle->fd);
+        syscalls++;
+        if (ret) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Failed to fsync %s.tmp, "
+                        "error: %s", shandle->path, strerror (errno));
+                goto out;
+        }
+out:
+        glusterd_store_account (done, syscalls, 0);
+        return (ret < 0) ? -1 : 0;
+}
+
+static void
+glusterd_store_close_tmpfd (glusterd_store_handle_t *shandle)
+{
+        if (shandle->fd > 0)
+                close (shandle->fd);
+        shandle->fd = 0;
+        shandle->wlen = 0;
+}
+
+static int32_t
+glusterd_store_commit_tmppath (glusterd_store_handle_t *shandle,
+                               gf_boolean_t sync)
 {
         int32_t         ret = -1;
         char            tmppath[PATH_MAX] = {0,};
 
         GF_ASSERT (shandle);
         GF_ASSERT (shandle->path);
+        GF_ASSERT (shandle->fd > 0);
+
+        ret = glusterd_store_flush (shandle, sync);
+        glusterd_store_close_tmpfd (shandle);
+        if (ret)
+                goto out;
 
         snprintf (tmppath, sizeof (tmppath), "%s.tmp", shandle->path);
         ret = rename (tmppath, shandle->path);
@@ -122,10 +204,17 @@ glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
                 gf_log ("glusterd", GF_LOG_ERROR, "Failed to mv %s to %s, "
                         "error: %s", tmppath, shandle->path, strerror (errno));
         }
-
+        glusterd_store_account (0, 1, ret ? 0 : 1);
+out:
         return ret;
 }
 
+int32_t
+glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
+{
+        return glusterd_store_commit_tmppath (shandle, _gf_true);
+}
+
 int32_t
 glusterd_store_unlink_tmppath (glusterd_store_handle_t *shandle)
 {
@@ -135,6 +224,7 @@ glusterd_store_unlink_tmppath (glusterd_store_handle_t *shandle)
         GF_ASSERT (shandle);
         GF_ASSERT (shandle->path);
 
+        glusterd_store_close_tmpfd (shandle);
         snprintf (tmppath, sizeof (tmppath), "%s.tmp", shandle->path);
         ret = unlink (tmppath);
         if (ret && (errno != ENOENT)) {
@@ -263,7 +353,7 @@ out:
 }
 
 int32_t
-glusterd_store_volinfo_brick_fname_write (int vol_fd,
+glusterd_store_volinfo_brick_fname_write (glusterd_store_handle_t *vol_sh,
                                          glusterd_brickinfo_t *brickinfo,
                                          int32_t brick_count)
 {
@@ -275,7 +365,7 @@ glusterd_store_volinfo_brick_fname_write (int vol_fd,
                   brick_count);
         glusterd_store_brickinfofname_set (brickinfo, brickfname,
                                         sizeof (brickfname));
-        ret = glusterd_store_save_value (vol_fd, key, brickfname);
+        ret = glusterd_store_save_value (vol_sh, key, brickfname);
         return ret;
 }
 
@@ -297,30 +387,31 @@ glusterd_store_create_brick_shandle_on_absence (glusterd_volinfo_t *volinfo,
 }
 
 int32_t
-glusterd_store_brickinfo_write (int fd, glusterd_brickinfo_t *brickinfo)
+glusterd_store_brickinfo_write (glusterd_store_handle_t *shandle,
+                                glusterd_brickinfo_t *brickinfo)
 {
         char                    value[256] = {0,};
         int32_t                 ret = 0;
 
         GF_ASSERT (brickinfo);
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_HOSTNAME,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_HOSTNAME,
                                          brickinfo->hostname);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_PATH,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_PATH,
                                          brickinfo->path);
         if (ret)
                 goto out;
 
         snprintf (value, sizeof(value), "%d", brickinfo->port);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_PORT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_PORT,
                                          value);
 
         snprintf (value, sizeof(value), "%d", brickinfo->rdma_port);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_BRICK_RDMA_PORT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_BRICK_RDMA_PORT,
                                          value);
 
 out:
@@ -341,7 +432,7 @@ glusterd_store_perform_brick_store (glusterd_brickinfo_t *brickinfo)
                 goto out;
         }
 
-        ret = glusterd_store_brickinfo_write (fd, brickinfo);
+        ret = glusterd_store_brickinfo_write (brickinfo->shandle, brickinfo);
         if (ret)
                 goto out;
 
@@ -349,23 +440,21 @@ glusterd_store_perform_brick_store (glusterd_brickinfo_t *brickinfo)
 out:
         if (ret && (fd > 0))
                 glusterd_store_unlink_tmppath (brickinfo->shandle);
-        if (fd > 0)
-                close (fd);
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
 int32_t
 glusterd_store_brickinfo (glusterd_volinfo_t *volinfo,
-                          glusterd_brickinfo_t *brickinfo, int32_t brick_count,
-                          int vol_fd)
+                          glusterd_brickinfo_t *brickinfo, int32_t brick_count)
 {
         int32_t                 ret = -1;
 
         GF_ASSERT (volinfo);
         GF_ASSERT (brickinfo);
 
-        ret = glusterd_store_volinfo_brick_fname_write (vol_fd, brickinfo,
+        ret = glusterd_store_volinfo_brick_fname_write (volinfo->shandle,
+                                                       brickinfo,
                                                        brick_count);
         if (ret)
                 goto out;
@@ -512,7 +601,7 @@ _storeslaves (dict_t *this, char *key, data_t *value, void *data)
         gf_log ("", GF_LOG_DEBUG, "Storing in volinfo:key= %s, val=%s",
                 key, value->data);
 
-        ret = glusterd_store_save_value (shandle->fd, key, (char*)value->data);
+        ret = glusterd_store_save_value (shandle, key, (char*)value->data);
         if (ret) {
                 gf_log ("", GF_LOG_ERROR, "Unable to write into store"
                                 " handle for path: %s", shandle->path);
@@ -553,7 +642,7 @@ void _storeopts (dict_t *this, char *key, data_t *value, void *data)
                 return;
         }
 
-        ret = glusterd_store_save_value (shandle->fd, key, (char*)value->data);
+        ret = glusterd_store_save_value (shandle, key, (char*)value->data);
         if (ret) {
                 gf_log ("", GF_LOG_ERROR, "Unable to write into store"
                                 " handle for path: %s", shandle->path);
@@ -562,48 +651,49 @@ void _storeopts (dict_t *this, char *key, data_t *value, void *data)
 }
 
 int32_t
-glusterd_volume_exclude_options_write (int fd, glusterd_volinfo_t *volinfo)
+glusterd_volume_exclude_options_write (glusterd_store_handle_t *shandle,
+                                       glusterd_volinfo_t *volinfo)
 {
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
         GF_ASSERT (volinfo);
 
         char                    buf[4096] = {0,};
         int32_t                 ret = -1;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->type);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_TYPE, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_TYPE, buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->brick_count);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_COUNT, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_COUNT, buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->status);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_STATUS, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_STATUS, buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->sub_count);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_SUB_COUNT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_SUB_COUNT,
                                          buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->version);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_VERSION,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_VERSION,
                                          buf);
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", volinfo->transport_type);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_TRANSPORT,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_TRANSPORT,
                                          buf);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_VOL_ID,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_VOL_ID,
                                          uuid_utoa (volinfo->volume_id));
         if (ret)
                 goto out;
@@ -645,24 +735,22 @@ glusterd_store_create_volume_dir (glusterd_volinfo_t *volinfo)
 }
 
 int32_t
-glusterd_store_volinfo_write (int fd, glusterd_volinfo_t *volinfo)
+glusterd_store_volinfo_write (glusterd_volinfo_t *volinfo)
 {
         int32_t                         ret = -1;
         glusterd_store_handle_t         *shandle = NULL;
-        GF_ASSERT (fd > 0);
         GF_ASSERT (volinfo);
         GF_ASSERT (volinfo->shandle);
 
         shandle = volinfo->shandle;
-        ret = glusterd_volume_exclude_options_write (fd, volinfo);
+        GF_ASSERT (shandle->fd > 0);
+        ret = glusterd_volume_exclude_options_write (shandle, volinfo);
         if (ret)
                 goto out;
 
-        shandle->fd = fd;
         dict_foreach (volinfo->dict, _storeopts, shandle);
 
         dict_foreach (volinfo->gsync_slaves, _storeslaves, shandle);
-        shandle->fd = 0;
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
@@ -697,7 +785,7 @@ glusterd_store_create_vol_shandle_on_absence (glusterd_volinfo_t *volinfo)
 }
 
 int32_t
-glusterd_store_brickinfos (glusterd_volinfo_t *volinfo, int vol_fd)
+glusterd_store_brickinfos (glusterd_volinfo_t *volinfo)
 {
         int32_t                 ret = 0;
         glusterd_brickinfo_t    *brickinfo = NULL;
@@ -707,7 +795,7 @@ glusterd_store_brickinfos (glusterd_volinfo_t *volinfo, int vol_fd)
 
         list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
                 ret = glusterd_store_brickinfo (volinfo, brickinfo,
-                                            brick_count, vol_fd);
+                                                brick_count);
                 if (ret)
                         goto out;
                 brick_count++;
@@ -730,11 +818,11 @@ glusterd_store_perform_volume_store (glusterd_volinfo_t *volinfo)
                 goto out;
         }
 
-        ret = glusterd_store_volinfo_write (fd, volinfo);
+        ret = glusterd_store_volinfo_write (volinfo);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_brickinfos (volinfo, fd);
+        ret = glusterd_store_brickinfos (volinfo);
         if (ret)
                 goto out;
 
@@ -742,8 +830,6 @@ glusterd_store_perform_volume_store (glusterd_volinfo_t *volinfo)
 out:
         if (ret && (fd > 0))
                 glusterd_store_unlink_tmppath (volinfo->shandle);
-        if (fd > 0)
-                close (fd);
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
@@ -763,14 +849,52 @@ glusterd_perform_volinfo_version_action (glusterd_volinfo_t *volinfo,
         }
 }
 
-int32_t
-glusterd_store_volinfo (glusterd_volinfo_t *volinfo, glusterd_volinfo_ver_ac_t ac)
+static int32_t
+glusterd_store_stamp_get (glusterd_volinfo_t *volinfo,
+                          glusterd_store_stamp_t *stamp)
+{
+        int32_t                 ret = -1;
+        char                    path[PATH_MAX] = {0,};
+        struct stat             stbuf = {0,};
+
+        glusterd_store_volfpath_set (volinfo, path, sizeof (path));
+        ret = stat (path, &stbuf);
+        if (ret)
+                goto out;
+
+        memset (stamp, 0, sizeof (*stamp));
+        stamp->ino = stbuf.st_ino;
+        stamp->size = stbuf.st_size;
+        stamp->mtime = stbuf.st_mtime;
+        stamp->mtime_nsec = ST_MTIM_NSEC (&stbuf);
+out:
+        return ret;
+}
+
+/* rewrites the store snapshot unless it is disabled, up to date, or
+ * deferred to the end of the current batch */
+static void
+glusterd_store_snapshot_sync (glusterd_conf_t *priv)
+{
+        if (!priv->store_snapshot || !priv->store_dirty || priv->store_batch)
+                return;
+
+        if (glusterd_store_snapshot_write ())
+                gf_log ("", GF_LOG_WARNING, "Unable to update the store "
+                        "snapshot, the next restore will read the text "
+                        "store");
+}
+
+static int32_t
+glusterd_store_volinfo_persist (glusterd_volinfo_t *volinfo)
 {
         int32_t                 ret = -1;
+        glusterd_conf_t         *priv = NULL;
 
         GF_ASSERT (volinfo);
 
-        glusterd_perform_volinfo_version_action (volinfo, ac);
+        priv = THIS->private;
+
         ret = glusterd_store_create_volume_dir (volinfo);
         if (ret)
                 goto out;
@@ -786,12 +910,132 @@ glusterd_store_volinfo (glusterd_volinfo_t *volinfo, glusterd_volinfo_ver_ac_t a
         ret = glusterd_volume_compute_cksum (volinfo);
         if (ret)
                 goto out;
+
+        priv->store_dirty = _gf_true;
+        if (priv->store_snapshot)
+                glusterd_store_stamp_get (volinfo, &volinfo->info_stamp);
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+
+        return ret;
+}
+
+/* Inside a store batch the version is bumped right away, but the volume
+ * is only queued: it is written once when the outermost batch commits,
+ * however many times the transaction stored it. */
+int32_t
+glusterd_store_volinfo (glusterd_volinfo_t *volinfo, glusterd_volinfo_ver_ac_t ac)
+{
+        int32_t                 ret = -1;
+        glusterd_conf_t         *priv = NULL;
+
+        GF_ASSERT (volinfo);
+
+        priv = THIS->private;
+        GF_ASSERT (priv);
+
+        glusterd_perform_volinfo_version_action (volinfo, ac);
+
+        if (priv->store_batch) {
+                /* volgen writes into the volume directory before the
+                 * batch commits */
+                ret = glusterd_store_create_volume_dir (volinfo);
+                if (ret)
+                        goto out;
+                if (list_empty (&volinfo->store_pending))
+                        list_add_tail (&volinfo->store_pending,
+                                       &priv->store_pending);
+                ret = 0;
+                goto out;
+        }
+
+        ret = glusterd_store_volinfo_persist (volinfo);
+        glusterd_store_snapshot_sync (priv);
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
 
         return ret;
 }
 
+void
+glusterd_store_batch_begin ()
+{
+        glusterd_conf_t         *priv = NULL;
+
+        priv = THIS->private;
+        GF_ASSERT (priv);
+
+        if (!priv->store_batch++)
+                memset (&priv->store_txn_stats, 0,
+                        sizeof (priv->store_txn_stats));
+}
+
+int32_t
+glusterd_store_batch_commit ()
+{
+        int32_t                 ret = 0;
+        int32_t                 count = 0;
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+
+        priv = THIS->private;
+        GF_ASSERT (priv);
+        GF_ASSERT (priv->store_batch > 0);
+
+        if (--priv->store_batch)
+                goto out;
+
+        while (!list_empty (&priv->store_pending)) {
+                volinfo = list_entry (priv->store_pending.next,
+                                      glusterd_volinfo_t, store_pending);
+                list_del_init (&volinfo->store_pending);
+
+                if (glusterd_store_volinfo_persist (volinfo)) {
+                        gf_log ("", GF_LOG_ERROR, "Unable to store volume "
+                                "%s", volinfo->volname);
+                        ret = -1;
+                }
+                count++;
+        }
+
+        glusterd_store_snapshot_sync (priv);
+
+        if (count)
+                gf_log ("", GF_LOG_INFO, "Stored %d volume(s): %"PRIu64
+                        " files, %"PRIu64" bytes, %"PRIu64" syscalls",
+                        count, priv->store_txn_stats.files,
+                        priv->store_txn_stats.bytes,
+                        priv->store_txn_stats.syscalls);
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+void
+glusterd_store_stats_dump (char *prefix)
+{
+        glusterd_conf_t         *priv = NULL;
+        char                    key[GF_DUMP_MAX_BUF_LEN];
+
+        priv = THIS->private;
+        if (!priv)
+                return;
+
+        gf_proc_dump_build_key (key, prefix, "store.files");
+        gf_proc_dump_write (key, "%"PRIu64, priv->store_stats.files);
+        gf_proc_dump_build_key (key, prefix, "store.bytes");
+        gf_proc_dump_write (key, "%"PRIu64, priv->store_stats.bytes);
+        gf_proc_dump_build_key (key, prefix, "store.syscalls");
+        gf_proc_dump_write (key, "%"PRIu64, priv->store_stats.syscalls);
+        gf_proc_dump_build_key (key, prefix, "store.last_txn.files");
+        gf_proc_dump_write (key, "%"PRIu64, priv->store_txn_stats.files);
+        gf_proc_dump_build_key (key, prefix, "store.last_txn.bytes");
+        gf_proc_dump_write (key, "%"PRIu64, priv->store_txn_stats.bytes);
+        gf_proc_dump_build_key (key, prefix, "store.last_txn.syscalls");
+        gf_proc_dump_write (key, "%"PRIu64,
+                            priv->store_txn_stats.syscalls);
+}
+
 
 int32_t
 glusterd_store_delete_volume (glusterd_volinfo_t *volinfo)
@@ -808,6 +1052,11 @@ glusterd_store_delete_volume (glusterd_volinfo_t *volinfo)
         priv = THIS->private;
 
         GF_ASSERT (priv);
+        list_del_init (&volinfo->store_pending);
+        glusterd_volfile_cache_purge (volinfo->volname);
+        /* the volume is still listed, the snapshot is rewritten by the
+         * next store */
+        priv->store_dirty = _gf_true;
         snprintf (pathname, sizeof (pathname), "%s/vols/%s", priv->workdir,
                   volinfo->volname);
 
@@ -939,27 +1188,52 @@ out:
         return ret;
 }
 
+/* makes room for len more bytes in the write buffer of shandle */
+static int32_t
+glusterd_store_reserve (glusterd_store_handle_t *shandle, size_t len)
+{
+        size_t          size = 0;
+        char            *buf = NULL;
+
+        if (shandle->wlen + len <= shandle->wsize)
+                return 0;
+
+        size = shandle->wsize ? shandle->wsize : GLUSTERD_STORE_BUF_SIZE;
+        while (shandle->wlen + len > size)
+                size *= 2;
+        buf = GF_REALLOC (shandle->wbuf, size);
+        if (!buf)
+                return -1;
+
+        shandle->wbuf = buf;
+        shandle->wsize = size;
+        return 0;
+}
+
 int32_t
-glusterd_store_save_value (int fd, char *key, char *value)
+glusterd_store_save_value (glusterd_store_handle_t *shandle, char *key,
+                           char *value)
 {
         int32_t         ret = -1;
-        char            buf[4096] = {0,};
+        size_t          len = 0;
 
-        GF_ASSERT (fd > 0);
+        GF_ASSERT (shandle);
+        GF_ASSERT (shandle->fd > 0);
         GF_ASSERT (key);
         GF_ASSERT (value);
 
-        snprintf (buf, sizeof (buf), "%s=%s\n", key, value);
-        ret = write (fd, buf, strlen (buf));
-
-        if (ret < 0) {
+        len = strlen (key) + strlen (value) + 2;
+        ret = glusterd_store_reserve (shandle, len + 1);
+        if (ret) {
                 gf_log ("", GF_LOG_CRITICAL, "Unable to store key: %s,"
-                        "value: %s, error: %s", key, value,
-                        strerror (errno));
-                ret = -1;
+                        "value: %s, error: out of memory", key, value);
                 goto out;
         }
 
+        snprintf (shandle->wbuf + shandle->wlen,
+                  shandle->wsize - shandle->wlen, "%s=%s\n", key, value);
+        shandle->wlen += len;
+
         ret = 0;
 
 out:
@@ -1042,6 +1316,8 @@ glusterd_store_handle_destroy (glusterd_store_handle_t *handle)
         }
 
         GF_FREE (handle->path);
+        if (handle->wbuf)
+                GF_FREE (handle->wbuf);
 
         GF_FREE (handle);
 
@@ -1059,6 +1335,7 @@ glusterd_store_uuid ()
         glusterd_conf_t *priv = NULL;
         char            path[PATH_MAX] = {0,};
         int32_t         ret = -1;
+        int             fd = -1;
         glusterd_store_handle_t *handle = NULL;
 
         priv = THIS->private;
@@ -1080,12 +1357,12 @@ glusterd_store_uuid ()
                 handle = priv->handle;
         }
 
-        handle->fd = open (handle->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
-        if (handle->fd <= 0) {
+        fd = glusterd_store_mkstemp (handle);
+        if (fd <= 0) {
                 ret = -1;
                 goto out;
         }
-        ret = glusterd_store_save_value (handle->fd, GLUSTERD_STORE_UUID_KEY,
+        ret = glusterd_store_save_value (handle, GLUSTERD_STORE_UUID_KEY,
                                          uuid_utoa (priv->uuid));
 
         if (ret) {
@@ -1094,12 +1371,10 @@ glusterd_store_uuid ()
                 goto out;
         }
 
-
+        ret = glusterd_store_rename_tmppath (handle);
 out:
-        if (handle->fd > 0) {
-                close (handle->fd);
-                handle->fd = 0;
-        }
+        if (ret && (fd > 0))
+                glusterd_store_unlink_tmppath (handle);
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
@@ -1482,6 +1757,7 @@ glusterd_store_retrieve_bricks (glusterd_volinfo_t *volinfo)
                         goto out;
 
                 list_add_tail (&brickinfo->brick_list, &volinfo->bricks);
+                glusterd_brickinfo_hash (volinfo, brickinfo);
                 brick_count++;
         }
 
@@ -1626,7 +1902,10 @@ glusterd_store_retrieve_volume (char    *volname)
         if (ret)
                 goto out;
 
-        list_add_tail (&volinfo->vol_list, &priv->volumes);
+        if (priv->store_snapshot)
+                glusterd_store_stamp_get (volinfo, &volinfo->info_stamp);
+
+        glusterd_volinfo_list_append (volinfo);
 
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
@@ -1852,22 +2131,23 @@ glusterd_store_create_peer_shandle (glusterd_peerinfo_t *peerinfo)
 }
 
 int32_t
-glusterd_store_peer_write (int fd, glusterd_peerinfo_t *peerinfo)
+glusterd_store_peer_write (glusterd_store_handle_t *shandle,
+                           glusterd_peerinfo_t *peerinfo)
 {
         char                    buf[50] = {0};
         int32_t                 ret = 0;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_PEER_UUID,
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_PEER_UUID,
                                          uuid_utoa (peerinfo->uuid));
         if (ret)
                 goto out;
 
         snprintf (buf, sizeof (buf), "%d", peerinfo->state.state);
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_PEER_STATE, buf);
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_PEER_STATE, buf);
         if (ret)
                 goto out;
 
-        ret = glusterd_store_save_value (fd, GLUSTERD_STORE_KEY_PEER_HOSTNAME "1",
+        ret = glusterd_store_save_value (shandle, GLUSTERD_STORE_KEY_PEER_HOSTNAME "1",
                                          peerinfo->hostname);
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
@@ -1888,7 +2168,7 @@ glusterd_store_perform_peer_store (glusterd_peerinfo_t *peerinfo)
                 goto out;
         }
 
-        ret = glusterd_store_peer_write (fd, peerinfo);
+        ret = glusterd_store_peer_write (peerinfo->shandle, peerinfo);
         if (ret)
                 goto out;
 
@@ -1896,8 +2176,6 @@ glusterd_store_perform_peer_store (glusterd_peerinfo_t *peerinfo)
 out:
         if (ret && (fd > 0))
                 glusterd_store_unlink_tmppath (peerinfo->shandle);
-        if (fd > 0)
-                close (fd);
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
@@ -2028,6 +2306,494 @@ out:
         return ret;
 }
 
+static int32_t
+glusterd_store_snap_put (glusterd_store_handle_t *shandle, void *data,
+                         size_t len)
+{
+        if (glusterd_store_reserve (shandle, len))
+                return -1;
+
+        memcpy (shandle->wbuf + shandle->wlen, data, len);
+        shandle->wlen += len;
+        return 0;
+}
+
+static int32_t
+glusterd_store_snap_put_u32 (glusterd_store_handle_t *shandle, uint32_t val)
+{
+        return glusterd_store_snap_put (shandle, &val, sizeof (val));
+}
+
+static int32_t
+glusterd_store_snap_put_str (glusterd_store_handle_t *shandle, char *str)
+{
+        uint32_t        len = strlen (str) + 1;
+
+        if (glusterd_store_snap_put_u32 (shandle, len))
+                return -1;
+        return glusterd_store_snap_put (shandle, str, len);
+}
+
+typedef struct glusterd_store_snap_opts_ {
+        glusterd_store_handle_t *shandle;
+        gf_boolean_t            filter;
+        uint32_t                count;
+        int32_t                 ret;
+} glusterd_store_snap_opts_t;
+
+static void
+_snapopts (dict_t *this, char *key, data_t *value, void *data)
+{
+        glusterd_store_snap_opts_t      *opts = data;
+
+        if (!key || !value || !value->data || opts->ret)
+                return;
+
+        /* same filter as _storeopts */
+        if (opts->filter && (1 != glusterd_check_option_exists (key, NULL)))
+                return;
+
+        opts->ret = glusterd_store_snap_put_str (opts->shandle, key);
+        if (!opts->ret)
+                opts->ret = glusterd_store_snap_put_str (opts->shandle,
+                                                         value->data);
+        opts->count++;
+}
+
+/* writes the count of the options of dict that _snapopts takes, followed
+ * by the key/value pairs */
+static int32_t
+glusterd_store_snap_put_dict (glusterd_store_handle_t *shandle, dict_t *dict,
+                              gf_boolean_t filter)
+{
+        glusterd_store_snap_opts_t      opts = {0,};
+        size_t                          offset = 0;
+
+        offset = shandle->wlen;
+        if (glusterd_store_snap_put_u32 (shandle, 0))
+                return -1;
+
+        opts.shandle = shandle;
+        opts.filter = filter;
+        if (dict)
+                dict_foreach (dict, _snapopts, &opts);
+        if (opts.ret)
+                return -1;
+
+        memcpy (shandle->wbuf + offset, &opts.count, sizeof (opts.count));
+        return 0;
+}
+
+static int32_t
+glusterd_store_snap_put_volume (glusterd_store_handle_t *shandle,
+                                glusterd_volinfo_t *volinfo)
+{
+        int32_t                 ret = -1;
+        uint32_t                count = 0;
+        glusterd_brickinfo_t    *brickinfo = NULL;
+
+        ret = glusterd_store_snap_put_str (shandle, volinfo->volname);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_snap_put (shandle, &volinfo->info_stamp,
+                                       sizeof (volinfo->info_stamp));
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_snap_put_u32 (shandle, volinfo->type);
+        ret |= glusterd_store_snap_put_u32 (shandle, volinfo->brick_count);
+        ret |= glusterd_store_snap_put_u32 (shandle, volinfo->status);
+        ret |= glusterd_store_snap_put_u32 (shandle, volinfo->version);
+        ret |= glusterd_store_snap_put_u32 (shandle, volinfo->port);
+        ret |= glusterd_store_snap_put_u32 (shandle, volinfo->sub_count);
+        ret |= glusterd_store_snap_put_u32 (shandle, volinfo->transport_type);
+        ret |= glusterd_store_snap_put (shandle, volinfo->volume_id,
+                                        sizeof (uuid_t));
+        ret |= glusterd_store_snap_put_u32 (shandle, volinfo->cksum);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_snap_put_dict (shandle, volinfo->dict, _gf_true);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_snap_put_dict (shandle, volinfo->gsync_slaves,
+                                            _gf_false);
+        if (ret)
+                goto out;
+
+        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list)
+                count++;
+        ret = glusterd_store_snap_put_u32 (shandle, count);
+        if (ret)
+                goto out;
+
+        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
+                ret = glusterd_store_snap_put_str (shandle,
+                                                   brickinfo->hostname);
+                ret |= glusterd_store_snap_put_str (shandle, brickinfo->path);
+                ret |= glusterd_store_snap_put_u32 (shandle, brickinfo->port);
+                ret |= glusterd_store_snap_put_u32 (shandle,
+                                                    brickinfo->rdma_port);
+                ret |= glusterd_store_snap_put (shandle, brickinfo->uuid,
+                                                sizeof (uuid_t));
+                if (ret)
+                        goto out;
+        }
+out:
+        return ret ? -1 : 0;
+}
+
+/* The snapshot only caches the text store for glusterd_restore (): it is
+ * not fsynced, since a torn or stale snapshot fails its checks and the
+ * text store is read instead. */
+int32_t
+glusterd_store_snapshot_write ()
+{
+        int32_t                         ret = -1;
+        int                             fd = -1;
+        char                            path[PATH_MAX] = {0,};
+        glusterd_conf_t                 *priv = NULL;
+        glusterd_store_handle_t         *shandle = NULL;
+        glusterd_volinfo_t              *volinfo = NULL;
+        glusterd_store_snap_hdr_t       hdr = {0,};
+
+        priv = THIS->private;
+        GF_ASSERT (priv);
+
+        snprintf (path, sizeof (path), "%s/%s", priv->workdir,
+                  GLUSTERD_STORE_SNAPSHOT_FILE);
+        ret = glusterd_store_handle_create_on_absence (&priv->snap_handle,
+                                                       path);
+        if (ret)
+                goto out;
+        shandle = priv->snap_handle;
+
+        fd = glusterd_store_mkstemp (shandle);
+        if (fd <= 0) {
+                ret = -1;
+                goto out;
+        }
+
+        ret = glusterd_store_snap_put (shandle, &hdr, sizeof (hdr));
+        if (ret)
+                goto out;
+
+        list_for_each_entry (volinfo, &priv->volumes, vol_list) {
+                ret = glusterd_store_snap_put_volume (shandle, volinfo);
+                if (ret)
+                        goto out;
+                hdr.count++;
+        }
+
+        hdr.magic = GLUSTERD_STORE_SNAPSHOT_MAGIC;
+        hdr.version = GLUSTERD_STORE_SNAPSHOT_VERSION;
+        hdr.size = shandle->wlen - sizeof (hdr);
+        hdr.cksum = gf_rsync_weak_checksum (shandle->wbuf + sizeof (hdr),
+                                            hdr.size);
+        memcpy (shandle->wbuf, &hdr, sizeof (hdr));
+
+        ret = glusterd_store_commit_tmppath (shandle, _gf_false);
+        if (!ret)
+                priv->store_dirty = _gf_false;
+out:
+        if (ret && (fd > 0))
+                glusterd_store_unlink_tmppath (shandle);
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+typedef struct glusterd_store_snap_cursor_ {
+        char    *cur;
+        char    *end;
+} glusterd_store_snap_cursor_t;
+
+static int32_t
+glusterd_store_snap_get (glusterd_store_snap_cursor_t *cursor, void *data,
+                         size_t len)
+{
+        if (cursor->end - cursor->cur < len)
+                return -1;
+
+        memcpy (data, cursor->cur, len);
+        cursor->cur += len;
+        return 0;
+}
+
+static int32_t
+glusterd_store_snap_get_int (glusterd_store_snap_cursor_t *cursor, int *val)
+{
+        uint32_t        u32 = 0;
+
+        if (glusterd_store_snap_get (cursor, &u32, sizeof (u32)))
+                return -1;
+
+        *val = u32;
+        return 0;
+}
+
+/* returns a string pointing into the mapped snapshot */
+static char *
+glusterd_store_snap_get_str (glusterd_store_snap_cursor_t *cursor)
+{
+        uint32_t        len = 0;
+        char            *str = NULL;
+
+        if (glusterd_store_snap_get (cursor, &len, sizeof (len)))
+                return NULL;
+        if (!len || (cursor->end - cursor->cur < len) ||
+            (cursor->cur[len - 1] != '\0'))
+                return NULL;
+
+        str = cursor->cur;
+        cursor->cur += len;
+        return str;
+}
+
+static int32_t
+glusterd_store_snap_get_dict (glusterd_store_snap_cursor_t *cursor,
+                              dict_t *dict)
+{
+        int32_t         ret = -1;
+        uint32_t        count = 0;
+        char            *key = NULL;
+        char            *value = NULL;
+
+        ret = glusterd_store_snap_get (cursor, &count, sizeof (count));
+        while (!ret && count--) {
+                key = glusterd_store_snap_get_str (cursor);
+                value = glusterd_store_snap_get_str (cursor);
+                if (!key || !value) {
+                        ret = -1;
+                        break;
+                }
+                ret = dict_set_dynstr (dict, key, gf_strdup (value));
+        }
+
+        return ret;
+}
+
+static int32_t
+glusterd_store_snap_get_volume (glusterd_store_snap_cursor_t *cursor,
+                                glusterd_volinfo_t **volinfop)
+{
+        int32_t                 ret = -1;
+        uint32_t                count = 0;
+        char                    *str = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+        glusterd_brickinfo_t    *brickinfo = NULL;
+        glusterd_store_stamp_t  stamp = {0,};
+
+        ret = glusterd_volinfo_new (&volinfo);
+        if (ret)
+                goto out;
+
+        ret = -1;
+        str = glusterd_store_snap_get_str (cursor);
+        if (!str || (strlen (str) >= GLUSTERD_MAX_VOLUME_NAME))
+                goto out;
+        strcpy (volinfo->volname, str);
+
+        if (glusterd_store_snap_get (cursor, &volinfo->info_stamp,
+                                     sizeof (volinfo->info_stamp)))
+                goto out;
+
+        /* an info file rewritten since the snapshot makes it stale */
+        if (glusterd_store_stamp_get (volinfo, &stamp) ||
+            memcmp (&stamp, &volinfo->info_stamp, sizeof (stamp))) {
+                gf_log ("", GF_LOG_INFO, "Store snapshot is stale for "
+                        "volume %s", volinfo->volname);
+                goto out;
+        }
+
+        if (glusterd_store_snap_get_int (cursor, &volinfo->type) ||
+            glusterd_store_snap_get_int (cursor, &volinfo->brick_count) ||
+            glusterd_store_snap_get_int (cursor, (int *)&volinfo->status) ||
+            glusterd_store_snap_get_int (cursor, &volinfo->version) ||
+            glusterd_store_snap_get_int (cursor, &volinfo->port) ||
+            glusterd_store_snap_get_int (cursor, &volinfo->sub_count) ||
+            glusterd_store_snap_get_int (cursor,
+                                         (int *)&volinfo->transport_type) ||
+            glusterd_store_snap_get (cursor, volinfo->volume_id,
+                                     sizeof (uuid_t)) ||
+            glusterd_store_snap_get (cursor, &volinfo->cksum,
+                                     sizeof (volinfo->cksum)))
+                goto out;
+
+        volinfo->nfs_transport_type = volinfo->transport_type;
+        if (volinfo->transport_type == GF_TRANSPORT_BOTH_TCP_RDMA)
+                volinfo->nfs_transport_type = GF_DEFAULT_NFS_TRANSPORT;
+
+        if (glusterd_store_snap_get_dict (cursor, volinfo->dict) ||
+            glusterd_store_snap_get_dict (cursor, volinfo->gsync_slaves))
+                goto out;
+
+        if (glusterd_store_snap_get (cursor, &count, sizeof (count)))
+                goto out;
+
+        while (count--) {
+                ret = glusterd_brickinfo_new (&brickinfo);
+                if (ret)
+                        goto out;
+                list_add_tail (&brickinfo->brick_list, &volinfo->bricks);
+
+                ret = -1;
+                str = glusterd_store_snap_get_str (cursor);
+                if (!str || (strlen (str) >= sizeof (brickinfo->hostname)))
+                        goto out;
+                strcpy (brickinfo->hostname, str);
+
+                str = glusterd_store_snap_get_str (cursor);
+                if (!str || (strlen (str) >= sizeof (brickinfo->path)))
+                        goto out;
+                strcpy (brickinfo->path, str);
+
+                if (glusterd_store_snap_get_int (cursor, &brickinfo->port) ||
+                    glusterd_store_snap_get_int (cursor,
+                                                 &brickinfo->rdma_port) ||
+                    glusterd_store_snap_get (cursor, brickinfo->uuid,
+                                             sizeof (uuid_t)))
+                        goto out;
+        }
+
+        ret = 0;
+out:
+        if (ret && volinfo) {
+                glusterd_volinfo_delete (volinfo);
+                volinfo = NULL;
+        }
+        *volinfop = volinfo;
+        return ret;
+}
+
+static int32_t
+glusterd_store_count_volumes (glusterd_conf_t *priv, uint32_t *count)
+{
+        char            path[PATH_MAX] = {0,};
+        DIR             *dir = NULL;
+        struct dirent   *entry = NULL;
+
+        snprintf (path, sizeof (path), "%s/%s", priv->workdir,
+                  GLUSTERD_VOLUME_DIR_PREFIX);
+        dir = opendir (path);
+        if (!dir)
+                return -1;
+
+        *count = 0;
+        glusterd_for_each_entry (entry, dir);
+        while (entry) {
+                (*count)++;
+                glusterd_for_each_entry (entry, dir);
+        }
+
+        closedir (dir);
+        return 0;
+}
+
+/* Restores the volumes from the store snapshot, which is mapped rather
+ * than read. Fails without touching priv->volumes if the snapshot is
+ * missing, torn, of another version, or older than any info file. */
+int32_t
+glusterd_store_snapshot_load (xlator_t *this)
+{
+        int32_t                         ret = -1;
+        int                             fd = -1;
+        uint32_t                        i = 0;
+        uint32_t                        count = 0;
+        char                            path[PATH_MAX] = {0,};
+        char                            *map = MAP_FAILED;
+        struct stat                     stbuf = {0,};
+        struct list_head                volumes;
+        glusterd_conf_t                 *priv = NULL;
+        glusterd_volinfo_t              *volinfo = NULL;
+        glusterd_volinfo_t              *tmp = NULL;
+        glusterd_brickinfo_t            *brickinfo = NULL;
+        glusterd_store_snap_hdr_t       hdr = {0,};
+        glusterd_store_snap_cursor_t    cursor = {0,};
+        struct pmap_registry            *pmap = NULL;
+
+        GF_ASSERT (this);
+        priv = this->private;
+        GF_ASSERT (priv);
+
+        INIT_LIST_HEAD (&volumes);
+
+        snprintf (path, sizeof (path), "%s/%s", priv->workdir,
+                  GLUSTERD_STORE_SNAPSHOT_FILE);
+        fd = open (path, O_RDONLY);
+        if (fd < 0) {
+                gf_log ("", GF_LOG_INFO, "No store snapshot at %s", path);
+                goto out;
+        }
+
+        if (fstat (fd, &stbuf) || (stbuf.st_size < sizeof (hdr)))
+                goto stale;
+
+        map = mmap (NULL, stbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+                gf_log ("", GF_LOG_ERROR, "Unable to map %s, error: %s",
+                        path, strerror (errno));
+                goto out;
+        }
+
+        memcpy (&hdr, map, sizeof (hdr));
+        if ((hdr.magic != GLUSTERD_STORE_SNAPSHOT_MAGIC) ||
+            (hdr.version != GLUSTERD_STORE_SNAPSHOT_VERSION) ||
+            (hdr.size != stbuf.st_size - sizeof (hdr)) ||
+            (hdr.cksum != gf_rsync_weak_checksum (map + sizeof (hdr),
+                                                  hdr.size)))
+                goto stale;
+
+        /* volumes created or deleted behind the snapshot */
+        if (glusterd_store_count_volumes (priv, &count) ||
+            (count != hdr.count))
+                goto stale;
+
+        cursor.cur = map + sizeof (hdr);
+        cursor.end = map + stbuf.st_size;
+        for (i = 0; i < hdr.count; i++) {
+                if (glusterd_store_snap_get_volume (&cursor, &volinfo))
+                        goto stale;
+                list_add_tail (&volinfo->vol_list, &volumes);
+        }
+        if (cursor.cur != cursor.end)
+                goto stale;
+
+        pmap = pmap_registry_get (this);
+        list_for_each_entry_safe (volinfo, tmp, &volumes, vol_list) {
+                list_del_init (&volinfo->vol_list);
+                glusterd_volinfo_list_append (volinfo);
+                list_for_each_entry (brickinfo, &volinfo->bricks,
+                                     brick_list) {
+                        glusterd_brickinfo_hash (volinfo, brickinfo);
+                        /* as glusterd_store_retrieve_bricks () does */
+                        if (pmap->last_alloc <= brickinfo->port)
+                                pmap->last_alloc = brickinfo->port + 1;
+                        if (pmap->last_alloc <= brickinfo->rdma_port)
+                                pmap->last_alloc = brickinfo->rdma_port + 1;
+                }
+        }
+
+        gf_log ("", GF_LOG_INFO, "Restored %u volumes from the store "
+                "snapshot", hdr.count);
+        ret = 0;
+        goto out;
+
+stale:
+        gf_log ("", GF_LOG_INFO, "Store snapshot %s is stale, reading the "
+                "text store", path);
+out:
+        list_for_each_entry_safe (volinfo, tmp, &volumes, vol_list)
+                glusterd_volinfo_delete (volinfo);
+        if (map != MAP_FAILED)
+                munmap (map, stbuf.st_size);
+        if (fd >= 0)
+                close (fd);
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
 int32_t
 glusterd_resolve_all_bricks (xlator_t  *this)
 {
@@ -2035,6 +2801,7 @@ glusterd_resolve_all_bricks (xlator_t  *this)
         glusterd_conf_t         *priv = NULL;
         glusterd_volinfo_t      *volinfo = NULL;
         glusterd_brickinfo_t    *brickinfo = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
 
         GF_ASSERT (this);
         priv = this->private;
@@ -2043,6 +2810,13 @@ glusterd_resolve_all_bricks (xlator_t  *this)
 
         list_for_each_entry (volinfo, &priv->volumes, vol_list) {
                 list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
+                        /* bricks from the snapshot keep the uuid they had
+                         * resolved to, as long as it is still known */
+                        if (!uuid_is_null (brickinfo->uuid) &&
+                            (!uuid_compare (brickinfo->uuid, priv->uuid) ||
+                             !glusterd_friend_find_by_uuid (brickinfo->uuid,
+                                                            &peerinfo)))
+                                continue;
                         ret = glusterd_resolve_brick (brickinfo);
                         if (ret) {
                                 gf_log ("glusterd", GF_LOG_ERROR,
@@ -2063,13 +2837,18 @@ glusterd_restore ()
 {
         int32_t         ret = -1;
         xlator_t        *this = NULL;
+        glusterd_conf_t *priv = NULL;
 
         this = THIS;
+        priv = this->private;
 
-        ret = glusterd_store_retrieve_volumes (this);
-
-        if (ret)
-                goto out;
+        if (!priv->store_snapshot || glusterd_store_snapshot_load (this)) {
+                ret = glusterd_store_retrieve_volumes (this);
+                if (ret)
+                        goto out;
+                priv->store_dirty = _gf_true;
+        }
+        glusterd_volinfo_list_sort ();
 
         ret = glusterd_store_retrieve_peers (this);
         if (ret)
@@ -2079,6 +2858,8 @@ glusterd_restore ()
         if (ret)
                 goto out;
 
+        glusterd_store_snapshot_sync (priv);
+
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
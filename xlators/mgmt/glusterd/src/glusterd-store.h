@@ -45,6 +45,12 @@ typedef enum glusterd_store_ver_ac_{
 
 #define GLUSTERD_STORE_UUID_KEY           "UUID"
 
+#define GLUSTERD_STORE_BUF_SIZE           4096
+
+#define GLUSTERD_STORE_SNAPSHOT_FILE      "store.snap"
+#define GLUSTERD_STORE_SNAPSHOT_MAGIC     0x47445350    /* "GDSP" */
+#define GLUSTERD_STORE_SNAPSHOT_VERSION   2
+
 #define GLUSTERD_STORE_KEY_VOL_TYPE       "type"
 #define GLUSTERD_STORE_KEY_VOL_COUNT      "count"
 #define GLUSTERD_STORE_KEY_VOL_STATUS     "status"
@@ -76,6 +82,16 @@ typedef enum glusterd_store_ver_ac_{
                 }\
         } while (0); \
 
+/* The snapshot is this header followed by one record per volume, in host
+ * byte order. cksum covers the size bytes after the header. */
+typedef struct glusterd_store_snap_hdr_ {
+        uint32_t        magic;
+        uint32_t        version;
+        uint32_t        count;          /* volumes */
+        uint32_t        cksum;
+        uint64_t        size;
+} glusterd_store_snap_hdr_t;
+
 typedef enum {
         GD_STORE_SUCCESS,
         GD_STORE_KEY_NULL,
@@ -91,6 +107,21 @@ glusterd_store_volinfo (glusterd_volinfo_t *volinfo, glusterd_volinfo_ver_ac_t a
 int32_t
 glusterd_store_delete_volume (glusterd_volinfo_t *volinfo);
 
+void
+glusterd_store_batch_begin ();
+
+int32_t
+glusterd_store_batch_commit ();
+
+void
+glusterd_store_stats_dump (char *prefix);
+
+int32_t
+glusterd_store_snapshot_write ();
+
+int32_t
+glusterd_store_snapshot_load (xlator_t *this);
+
 int32_t
 glusterd_store_uuid ();
 
@@ -98,7 +129,8 @@ int32_t
 glusterd_store_handle_new (char *path, glusterd_store_handle_t **handle);
 
 int32_t
-glusterd_store_save_value (int fd, char *key, char *value);
+glusterd_store_save_value (glusterd_store_handle_t *shandle, char *key,
+                           char *value);
 
 int32_t
 glusterd_store_retrieve_value (glusterd_store_handle_t *handle,
@@ -30,6 +30,7 @@
 #include "xlator.h"
 #include "logging.h"
 #include "timer.h"
+#include "event.h"
 #include "defaults.h"
 #include "compat.h"
 #include "md5.h"
@@ -37,6 +38,7 @@
 #include "compat-errno.h"
 #include "statedump.h"
 #include "syscall.h"
+#include "hashfn.h"
 #include "glusterd-mem-types.h"
 #include "glusterd.h"
 #include "glusterd-op-sm.h"
@@ -47,8 +49,11 @@
 #include "glusterd-pmap.h"
 
 #include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <signal.h>
+#include <locale.h>
 #include <sys/types.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
@@ -67,6 +72,9 @@
 
 char    *glusterd_sock_dir = "/tmp";
 static glusterd_lock_t lock;
+/* Volume scoped transaction locks, one entry per locked volume. Only
+ * volumes with an in-flight transaction are on this list. */
+static struct list_head volume_locks = {&volume_locks, &volume_locks};
 
 static int32_t
 glusterd_get_lock_owner (uuid_t *uuid)
@@ -79,7 +87,7 @@ static int32_t
 glusterd_set_lock_owner (uuid_t owner)
 {
         uuid_copy (lock.owner, owner);
-        //TODO: set timestamp
+        lock.timestamp = time (NULL);
         return 0;
 }
 
@@ -87,10 +95,23 @@ static int32_t
 glusterd_unset_lock_owner (uuid_t owner)
 {
         uuid_clear (lock.owner);
-        //TODO: set timestamp
+        lock.timestamp = 0;
         return 0;
 }
 
+static glusterd_volume_lock_t *
+glusterd_volume_lock_find (char *volname)
+{
+        glusterd_volume_lock_t  *vlock = NULL;
+
+        list_for_each_entry (vlock, &volume_locks, lock_list) {
+                if (!strcmp (vlock->volname, volname))
+                        return vlock;
+        }
+
+        return NULL;
+}
+
 gf_boolean_t
 glusterd_is_loopback_localhost (const struct sockaddr *sa, char *hostname)
 {
@@ -128,55 +149,172 @@ glusterd_is_loopback_localhost (const struct sockaddr *sa, char *hostname)
         return is_local;
 }
 
-int32_t
-glusterd_is_local_addr (char *hostname)
+/* Name resolution cache. getaddrinfo () results, and the reverse lookups
+ * glusterd_friend_find_by_hostname () makes on them, are kept by hostname
+ * for priv->resolve.ttl seconds. Failures are not cached, a name that does
+ * not resolve yet may well do on the next try. Expired entries are swept
+ * once every ttl, and the table is emptied should it still hold
+ * GLUSTERD_RESOLVE_CACHE_MAX hostnames.
+ */
+typedef struct glusterd_resolve_entry_ {
+        struct list_head        hash;
+        char                    *hostname;
+        time_t                  expires;
+        struct addrinfo         *addrs;
+        char                    **names;        /* getnameinfo () per addr */
+        int                     count;
+} glusterd_resolve_entry_t;
+
+static void
+glusterd_resolve_entry_destroy (glusterd_conf_t *priv,
+                                glusterd_resolve_entry_t *entry)
 {
-        int32_t         ret = -1;
-        struct          addrinfo *result = NULL;
-        struct          addrinfo *res = NULL;
-        int32_t         found = 0;
-        struct          ifconf buf = {0,};
+        int     i = 0;
+
+        list_del (&entry->hash);
+        priv->resolve.count--;
+        if (entry->addrs)
+                freeaddrinfo (entry->addrs);
+        if (entry->names) {
+                for (i = 0; i < entry->count; i++) {
+                        if (entry->names[i])
+                                GF_FREE (entry->names[i]);
+                }
+                GF_FREE (entry->names);
+        }
+        GF_FREE (entry->hostname);
+        GF_FREE (entry);
+}
+
+static void
+glusterd_resolve_cache_sweep (glusterd_conf_t *priv, time_t now)
+{
+        glusterd_resolve_entry_t        *entry = NULL;
+        glusterd_resolve_entry_t        *tmp = NULL;
+        int                             i = 0;
+
+        for (i = 0; i < GLUSTERD_HASH_SIZE; i++) {
+                list_for_each_entry_safe (entry, tmp, &priv->resolve.table[i],
+                                          hash) {
+                        if (entry->expires <= now)
+                                glusterd_resolve_entry_destroy (priv, entry);
+                }
+        }
+        priv->resolve.next_sweep = now + priv->resolve.ttl;
+}
+
+static glusterd_resolve_entry_t *
+glusterd_resolve (char *hostname)
+{
+        glusterd_conf_t                 *priv = NULL;
+        glusterd_resolve_entry_t        *entry = NULL;
+        struct list_head                *bucket = NULL;
+        struct addrinfo                 *res = NULL;
+        time_t                          now = 0;
+        int                             ret = 0;
+
+        priv = THIS->private;
+        GF_ASSERT (priv);
+
+        now = time (NULL);
+        bucket = &priv->resolve.table[SuperFastHash (hostname,
+                                                     strlen (hostname)) %
+                                      GLUSTERD_HASH_SIZE];
+        list_for_each_entry (entry, bucket, hash) {
+                if (strcmp (entry->hostname, hostname))
+                        continue;
+                if (entry->expires > now) {
+                        priv->resolve.hits++;
+                        goto out;
+                }
+                glusterd_resolve_entry_destroy (priv, entry);
+                break;
+        }
+
+        priv->resolve.misses++;
+        if ((now >= priv->resolve.next_sweep) ||
+            (priv->resolve.count >= GLUSTERD_RESOLVE_CACHE_MAX))
+                glusterd_resolve_cache_sweep (priv, now);
+        if (priv->resolve.count >= GLUSTERD_RESOLVE_CACHE_MAX)
+                glusterd_resolve_cache_flush (priv);
+
+        entry = GF_CALLOC (1, sizeof (*entry), gf_gld_mt_resolve_entry_t);
+        if (!entry)
+                goto out;
+        entry->hostname = gf_strdup (hostname);
+        if (!entry->hostname) {
+                GF_FREE (entry);
+                entry = NULL;
+                goto out;
+        }
+
+        ret = getaddrinfo (hostname, NULL, NULL, &entry->addrs);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "error in getaddrinfo: %s\n",
+                        gai_strerror (ret));
+                GF_FREE (entry->hostname);
+                GF_FREE (entry);
+                entry = NULL;
+                goto out;
+        }
+        for (res = entry->addrs; res != NULL; res = res->ai_next)
+                entry->count++;
+        if (entry->count)
+                entry->names = GF_CALLOC (entry->count, sizeof (char *),
+                                          gf_gld_mt_resolve_entry_t);
+
+        entry->expires = now + priv->resolve.ttl;
+        list_add (&entry->hash, bucket);
+        priv->resolve.count++;
+out:
+        return entry;
+}
+
+/* reverse lookup of the idx'th address of entry */
+static char *
+glusterd_resolve_name (glusterd_resolve_entry_t *entry, int idx,
+                       struct addrinfo *addr)
+{
+        char    hname[1024] = {0,};
+
+        if (!entry->names)
+                return NULL;
+        if (entry->names[idx])
+                return entry->names[idx];
+
+        if (getnameinfo (addr->ai_addr, addr->ai_addrlen, hname,
+                         sizeof (hname), NULL, 0, 0))
+                return NULL;
+
+        entry->names[idx] = gf_strdup (hname);
+        return entry->names[idx];
+}
+
+static int
+glusterd_local_ifaces_get (struct sockaddr_storage **addrs)
+{
+        glusterd_conf_t *priv = NULL;
+        struct ifconf   buf = {0,};
         int             sd = -1;
         struct ifreq    *ifr = NULL;
         struct ifreq    *ifr_end = NULL;
         int32_t         size = 0;
         char            buff[1024] = {0,};
         gf_boolean_t    need_free = _gf_false;
-#ifdef GD_SCALABILITY_TEST
-        dict_t          *options = NULL;
-        data_t          *listen_host_data = NULL;
-        char            *listen_host = NULL;
-#endif
+        int             count = -1;
+        int             ret = -1;
+        time_t          now = 0;
 
-        ret = getaddrinfo (hostname, NULL, NULL, &result);
+        priv = THIS->private;
+        GF_ASSERT (priv);
 
-        if (ret != 0) {
-                gf_log ("", GF_LOG_ERROR, "error in getaddrinfo: %s\n",
-                        gai_strerror(ret));
+        now = time (NULL);
+        if (priv->resolve.iface_addrs && (priv->resolve.iface_expires > now)) {
+                priv->resolve.iface_hits++;
+                count = priv->resolve.iface_count;
                 goto out;
         }
-
-        for (res = result; res != NULL; res = res->ai_next) {
-                found = glusterd_is_loopback_localhost (res->ai_addr, hostname);
-                if (found)
-                        goto out;
-        }
-
-#ifdef GD_SCALABILITY_TEST
-        options = THIS->options;
-        listen_host_data = dict_get (options, "transport.socket.bind-address");
-        if (listen_host_data) {
-                listen_host = data_to_str (listen_host_data);
-        } else {
-                listen_host = "zzzzzzz";
-        }
-        if (!strcmp(hostname, listen_host)) { 
-                found = 1;
-        } else {
-                found = 0;
-        }
-        goto out;
-#endif
+        priv->resolve.iface_misses++;
 
         sd = socket (AF_INET, SOCK_DGRAM, 0);
         if (sd == -1)
@@ -206,29 +344,129 @@ glusterd_is_local_addr (char *hostname)
 
         ifr_end = (struct ifreq *)&buf.ifc_buf[buf.ifc_len];
 
-        for (res = result; res != NULL; res = res->ai_next) {
-                ifr = buf.ifc_req;
-                while (ifr < ifr_end) {
-                        if ((ifr->ifr_addr.sa_family == res->ai_addr->sa_family)
-                            && (memcmp (&ifr->ifr_addr, res->ai_addr,
-                                        res->ai_addrlen) == 0)) {
-                                found = 1;
-                                goto out;
-                        }
-                        ifr++;
-                }
-        }
+        if (priv->resolve.iface_addrs)
+                GF_FREE (priv->resolve.iface_addrs);
+        priv->resolve.iface_count = ifr_end - buf.ifc_req;
+        priv->resolve.iface_addrs = GF_CALLOC (priv->resolve.iface_count + 1,
+                                               sizeof (struct sockaddr_storage),
+                                               gf_gld_mt_ifreq);
+        if (!priv->resolve.iface_addrs)
+                goto out;
 
+        count = 0;
+        for (ifr = buf.ifc_req; ifr < ifr_end; ifr++)
+                memcpy (&priv->resolve.iface_addrs[count++], &ifr->ifr_addr,
+                        sizeof (ifr->ifr_addr));
+        priv->resolve.iface_expires = now + priv->resolve.ttl;
 out:
         if (sd >= 0)
                 close (sd);
 
-        if (result)
-                freeaddrinfo (result);
-
         if (need_free)
                 GF_FREE (buf.ifc_req);
 
+        if (count >= 0)
+                *addrs = priv->resolve.iface_addrs;
+        return count;
+}
+
+/* to be called whenever a peer's hostname changes, since lookups by name
+ * may now match a different peer */
+void
+glusterd_resolve_cache_flush (glusterd_conf_t *priv)
+{
+        glusterd_resolve_entry_t        *entry = NULL;
+        glusterd_resolve_entry_t        *tmp = NULL;
+        int                             i = 0;
+
+        GF_ASSERT (priv);
+
+        if (!priv->resolve.table)
+                return;
+
+        for (i = 0; i < GLUSTERD_HASH_SIZE; i++) {
+                list_for_each_entry_safe (entry, tmp, &priv->resolve.table[i],
+                                          hash)
+                        glusterd_resolve_entry_destroy (priv, entry);
+        }
+}
+
+void
+glusterd_resolve_cache_dump (glusterd_conf_t *priv, char *prefix)
+{
+        char    key[GF_DUMP_MAX_BUF_LEN];
+
+        gf_proc_dump_build_key (key, prefix, "resolve.ttl");
+        gf_proc_dump_write (key, "%u", priv->resolve.ttl);
+        gf_proc_dump_build_key (key, prefix, "resolve.count");
+        gf_proc_dump_write (key, "%d", priv->resolve.count);
+        gf_proc_dump_build_key (key, prefix, "resolve.hits");
+        gf_proc_dump_write (key, "%"PRIu64, priv->resolve.hits);
+        gf_proc_dump_build_key (key, prefix, "resolve.misses");
+        gf_proc_dump_write (key, "%"PRIu64, priv->resolve.misses);
+        gf_proc_dump_build_key (key, prefix, "resolve.iface_hits");
+        gf_proc_dump_write (key, "%"PRIu64, priv->resolve.iface_hits);
+        gf_proc_dump_build_key (key, prefix, "resolve.iface_misses");
+        gf_proc_dump_write (key, "%"PRIu64, priv->resolve.iface_misses);
+}
+
+int32_t
+glusterd_is_local_addr (char *hostname)
+{
+        struct          addrinfo *res = NULL;
+        int32_t         found = 0;
+        glusterd_resolve_entry_t *entry = NULL;
+        struct sockaddr_storage *ifaces = NULL;
+        int             count = 0;
+        int             i = 0;
+#ifdef GD_SCALABILITY_TEST
+        dict_t          *options = NULL;
+        data_t          *listen_host_data = NULL;
+        char            *listen_host = NULL;
+#endif
+
+        entry = glusterd_resolve (hostname);
+        if (!entry)
+                goto out;
+
+        for (res = entry->addrs; res != NULL; res = res->ai_next) {
+                found = glusterd_is_loopback_localhost (res->ai_addr, hostname);
+                if (found)
+                        goto out;
+        }
+
+#ifdef GD_SCALABILITY_TEST
+        options = THIS->options;
+        listen_host_data = dict_get (options, "transport.socket.bind-address");
+        if (listen_host_data) {
+                listen_host = data_to_str (listen_host_data);
+        } else {
+                listen_host = "zzzzzzz";
+        }
+        if (!strcmp(hostname, listen_host)) { 
+                found = 1;
+        } else {
+                found = 0;
+        }
+        goto out;
+#endif
+
+        count = glusterd_local_ifaces_get (&ifaces);
+        if (count < 0)
+                goto out;
+
+        for (res = entry->addrs; res != NULL; res = res->ai_next) {
+                for (i = 0; i < count; i++) {
+                        if ((ifaces[i].ss_family == res->ai_addr->sa_family)
+                            && (memcmp (&ifaces[i], res->ai_addr,
+                                        res->ai_addrlen) == 0)) {
+                                found = 1;
+                                goto out;
+                        }
+                }
+        }
+
+out:
         if (found)
                 gf_log ("glusterd", GF_LOG_DEBUG, "%s is local", hostname);
         else
@@ -241,6 +479,7 @@ int32_t
 glusterd_lock (uuid_t   uuid)
 {
 
+        glusterd_volume_lock_t  *vlock = NULL;
         uuid_t  owner;
         char    new_owner_str[50];
         char    owner_str[50];
@@ -258,6 +497,16 @@ glusterd_lock (uuid_t   uuid)
                 goto out;
         }
 
+        if (!list_empty (&volume_locks)) {
+                vlock = list_entry (volume_locks.next, glusterd_volume_lock_t,
+                                    lock_list);
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to get cluster lock"
+                        " for uuid: %s, volume %s locked by: %s",
+                        uuid_utoa_r (uuid, new_owner_str), vlock->volname,
+                        uuid_utoa_r (vlock->owner, owner_str));
+                goto out;
+        }
+
         ret = glusterd_set_lock_owner (uuid);
 
         if (!ret) {
@@ -311,6 +560,106 @@ out:
 }
 
 
+int32_t
+glusterd_volume_lock (char *volname, uuid_t uuid)
+{
+        glusterd_volume_lock_t  *vlock = NULL;
+        uuid_t                  owner;
+        char                    new_owner_str[50];
+        char                    owner_str[50];
+        int32_t                 ret = -1;
+
+        GF_ASSERT (volname);
+        GF_ASSERT (uuid);
+
+        glusterd_get_lock_owner (&owner);
+
+        if (!uuid_is_null (owner)) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to get lock on "
+                        "volume %s for uuid: %s, cluster lock held by: %s",
+                        volname, uuid_utoa_r (uuid, new_owner_str),
+                        uuid_utoa_r (owner, owner_str));
+                goto out;
+        }
+
+        vlock = glusterd_volume_lock_find (volname);
+        if (vlock) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to get lock on "
+                        "volume %s for uuid: %s, lock held by: %s", volname,
+                        uuid_utoa_r (uuid, new_owner_str),
+                        uuid_utoa_r (vlock->owner, owner_str));
+                goto out;
+        }
+
+        vlock = GF_CALLOC (1, sizeof (*vlock), gf_gld_mt_volume_lock_t);
+        if (!vlock)
+                goto out;
+
+        strncpy (vlock->volname, volname, sizeof (vlock->volname) - 1);
+        uuid_copy (vlock->owner, uuid);
+        vlock->timestamp = time (NULL);
+        list_add_tail (&vlock->lock_list, &volume_locks);
+
+        gf_log ("glusterd", GF_LOG_INFO, "Lock on volume %s held by %s",
+                volname, uuid_utoa (uuid));
+        ret = 0;
+
+out:
+        return ret;
+}
+
+int32_t
+glusterd_volume_unlock (char *volname, uuid_t uuid)
+{
+        glusterd_volume_lock_t  *vlock = NULL;
+        char                    new_owner_str[50];
+        char                    owner_str[50];
+        int32_t                 ret = -1;
+
+        GF_ASSERT (volname);
+        GF_ASSERT (uuid);
+
+        vlock = glusterd_volume_lock_find (volname);
+        if (!vlock) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Lock on volume %s not "
+                        "held!", volname);
+                goto out;
+        }
+
+        if (uuid_compare (uuid, vlock->owner)) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Lock on volume %s held by"
+                        " %s, unlock req from %s!", volname,
+                        uuid_utoa_r (vlock->owner, owner_str),
+                        uuid_utoa_r (uuid, new_owner_str));
+                goto out;
+        }
+
+        list_del_init (&vlock->lock_list);
+        GF_FREE (vlock);
+        ret = 0;
+
+out:
+        return ret;
+}
+
+int32_t
+glusterd_scoped_lock (char *volname, uuid_t uuid)
+{
+        if (volname)
+                return glusterd_volume_lock (volname, uuid);
+
+        return glusterd_lock (uuid);
+}
+
+int32_t
+glusterd_scoped_unlock (char *volname, uuid_t uuid)
+{
+        if (volname)
+                return glusterd_volume_unlock (volname, uuid);
+
+        return glusterd_unlock (uuid);
+}
+
 int
 glusterd_get_uuid (uuid_t *uuid)
 {
@@ -534,6 +883,8 @@ glusterd_volinfo_new (glusterd_volinfo_t **volinfo)
                 goto out;
 
         INIT_LIST_HEAD (&new_volinfo->vol_list);
+        INIT_LIST_HEAD (&new_volinfo->vol_hash);
+        INIT_LIST_HEAD (&new_volinfo->store_pending);
         INIT_LIST_HEAD (&new_volinfo->bricks);
 
         new_volinfo->dict = dict_new ();
@@ -569,6 +920,8 @@ glusterd_brickinfo_delete (glusterd_brickinfo_t *brickinfo)
         GF_ASSERT (brickinfo);
 
         list_del_init (&brickinfo->brick_list);
+        list_del_init (&brickinfo->brick_hash);
+        list_del_init (&brickinfo->port_hash);
 
         if (brickinfo->logfile)
                 GF_FREE (brickinfo->logfile);
@@ -608,6 +961,8 @@ glusterd_volinfo_delete (glusterd_volinfo_t *volinfo)
         GF_ASSERT (volinfo);
 
         list_del_init (&volinfo->vol_list);
+        list_del_init (&volinfo->vol_hash);
+        list_del_init (&volinfo->store_pending);
 
         ret = glusterd_volume_brickinfos_delete (volinfo);
         if (ret)
@@ -643,6 +998,8 @@ glusterd_brickinfo_new (glusterd_brickinfo_t **brickinfo)
                 goto out;
 
         INIT_LIST_HEAD (&new_brickinfo->brick_list);
+        INIT_LIST_HEAD (&new_brickinfo->brick_hash);
+        INIT_LIST_HEAD (&new_brickinfo->port_hash);
 
         *brickinfo = new_brickinfo;
 
@@ -710,1727 +1067,3502 @@ out:
         return ret;
 }
 
-int32_t
-glusterd_volume_brickinfo_get (uuid_t uuid, char *hostname, char *path,
-                               glusterd_volinfo_t *volinfo,
-                               glusterd_brickinfo_t **brickinfo)
+static inline uint32_t
+glusterd_hash_str (const char *str)
 {
-        glusterd_brickinfo_t    *brickiter = NULL;
-        uuid_t                  peer_uuid = {0};
-        int32_t                 ret = -1;
-        int32_t                 brick_path_len = 0;
-        int32_t                 path_len = 0;
-        int32_t                 smaller_path = 0;
-        gf_boolean_t            is_path_smaller = _gf_true;
+        return SuperFastHash (str, strlen (str)) % GLUSTERD_HASH_SIZE;
+}
 
-        if (uuid) {
-                uuid_copy (peer_uuid, uuid);
-        } else {
-                ret = glusterd_hostname_to_uuid (hostname, peer_uuid);
-                if (ret)
-                        goto out;
-        }
-        ret = -1;
-        path_len = strlen (path);
-        list_for_each_entry (brickiter, &volinfo->bricks, brick_list) {
-
-                if (uuid_is_null (brickiter->uuid)) {
-                        ret = glusterd_resolve_brick (brickiter);
-                        if (ret)
-                                goto out;
-                }
-                brick_path_len = strlen (brickiter->path);
-                smaller_path = min (brick_path_len, path_len);
-                if (smaller_path != path_len)
-                        is_path_smaller = _gf_false;
-                if ((!uuid_compare (peer_uuid, brickiter->uuid)) &&
-                        !strcmp (brickiter->path, path)) {
-                        gf_log ("", GF_LOG_INFO, "Found brick");
-                        ret = 0;
-                        if (brickinfo)
-                                *brickinfo = brickiter;
-                        break;
-                } else {
-                        if ((!uuid_compare (peer_uuid, brickiter->uuid)) &&
-                            !strncmp (brickiter->path, path, smaller_path)) {
-                                if (is_path_smaller == _gf_true)  {
-                                        if (brickiter->path[smaller_path] == '/') {
-                                                ret = 0;
-                                                gf_log ("", GF_LOG_INFO,
-                                                        "given path %s lies"
-                                                        " within %s", path,
-                                                        brickiter->path);
-                                                *brickinfo = brickiter;
-                                                break;
-                                        }
-                                } else
-                                        if (path[smaller_path] == '/') {
-                                                gf_log ("", GF_LOG_INFO,
-                                                        "brick %s is a part of"
-                                                        " %s", brickiter->path,
-                                                        path);
-                                                ret = 0;
-                                                *brickinfo = brickiter;
-                                                break;
-                                        }
-                        }
-                        ret = -1;
-                }
+static inline uint32_t
+glusterd_hash_uuid (uuid_t uuid)
+{
+        return SuperFastHash ((char *)uuid, sizeof (uuid_t)) %
+                GLUSTERD_HASH_SIZE;
+}
+
+static inline uint32_t
+glusterd_hash_port (int port)
+{
+        return ((uint32_t) port) % GLUSTERD_HASH_SIZE;
+}
+
+static struct list_head *
+glusterd_hash_table_new (void)
+{
+        struct list_head        *table = NULL;
+        int                     i = 0;
+
+        table = GF_CALLOC (GLUSTERD_HASH_SIZE, sizeof (*table),
+                           gf_common_mt_list_head);
+        if (!table)
+                return NULL;
+
+        for (i = 0; i < GLUSTERD_HASH_SIZE; i++)
+                INIT_LIST_HEAD (&table[i]);
+
+        return table;
+}
+
+int
+glusterd_hash_tables_init (glusterd_conf_t *conf)
+{
+        int             ret = -1;
+
+        GF_ASSERT (conf);
+
+        conf->vol_table = glusterd_hash_table_new ();
+        conf->peer_uuid_table = glusterd_hash_table_new ();
+        conf->peer_host_table = glusterd_hash_table_new ();
+        conf->brick_table = glusterd_hash_table_new ();
+        conf->brick_port_table = glusterd_hash_table_new ();
+        conf->resolve.table = glusterd_hash_table_new ();
+        conf->resolve.ttl = GLUSTERD_RESOLVE_CACHE_TTL;
+        conf->volfile_sub_table = glusterd_hash_table_new ();
+        pthread_mutex_init (&conf->volfile_cache.lock, NULL);
+        INIT_LIST_HEAD (&conf->volfile_cache.lru);
+        conf->volfile_cache.key_table = glusterd_hash_table_new ();
+        conf->volfile_cache.path_table = glusterd_hash_table_new ();
+
+        if (!conf->vol_table || !conf->peer_uuid_table ||
+            !conf->peer_host_table || !conf->brick_table ||
+            !conf->brick_port_table || !conf->resolve.table ||
+            !conf->volfile_sub_table || !conf->volfile_cache.key_table ||
+            !conf->volfile_cache.path_table) {
+                glusterd_hash_tables_destroy (conf);
+                goto out;
         }
 
+        ret = 0;
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
-int32_t
-glusterd_volume_brickinfo_get_by_brick (char *brick,
-                                        glusterd_volinfo_t *volinfo,
-                                        glusterd_brickinfo_t **brickinfo)
+void
+glusterd_hash_tables_destroy (glusterd_conf_t *conf)
 {
-        int32_t                 ret = -1;
-        char                    *hostname = NULL;
-        char                    *path = NULL;
-        char                    *dup_brick = NULL;
-        char                    *free_ptr = NULL;
+        GF_ASSERT (conf);
 
-        GF_ASSERT (brick);
+        if (conf->vol_table)
+                GF_FREE (conf->vol_table);
+        if (conf->peer_uuid_table)
+                GF_FREE (conf->peer_uuid_table);
+        if (conf->peer_host_table)
+                GF_FREE (conf->peer_host_table);
+        if (conf->brick_table)
+                GF_FREE (conf->brick_table);
+        if (conf->brick_port_table)
+                GF_FREE (conf->brick_port_table);
+        if (conf->resolve.table) {
+                glusterd_resolve_cache_flush (conf);
+                GF_FREE (conf->resolve.table);
+        }
+        if (conf->resolve.iface_addrs)
+                GF_FREE (conf->resolve.iface_addrs);
+        if (conf->volfile_sub_table)
+                GF_FREE (conf->volfile_sub_table);
+        if (conf->volfile_cache.key_table && conf->volfile_cache.path_table)
+                glusterd_volfile_cache_flush (conf);
+        if (conf->volfile_cache.key_table)
+                GF_FREE (conf->volfile_cache.key_table);
+        if (conf->volfile_cache.path_table)
+                GF_FREE (conf->volfile_cache.path_table);
+
+        conf->vol_table = NULL;
+        conf->peer_uuid_table = NULL;
+        conf->peer_host_table = NULL;
+        conf->brick_table = NULL;
+        conf->brick_port_table = NULL;
+        conf->resolve.table = NULL;
+        conf->resolve.iface_addrs = NULL;
+        conf->volfile_sub_table = NULL;
+        conf->volfile_cache.key_table = NULL;
+        conf->volfile_cache.path_table = NULL;
+}
+
+/* Subscribers are kept by volname rather than on the volinfo, which is
+ * replaced when a volume is imported from a peer.
+ */
+struct list_head *
+glusterd_volfile_sub_bucket (glusterd_conf_t *priv, const char *volname)
+{
+        return &priv->volfile_sub_table[glusterd_hash_str (volname)];
+}
+
+/* Records that trans fetched a volfile of volinfo. A transport follows
+ * only the volume it fetched last, the sub is hung off trans->xl_private
+ * and dropped on disconnect.
+ */
+int
+glusterd_volfile_subscribe (rpc_transport_t *trans,
+                            glusterd_volinfo_t *volinfo)
+{
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volfile_sub_t  *sub = NULL;
+        int                     ret = -1;
+
+        GF_ASSERT (trans);
         GF_ASSERT (volinfo);
 
-        gf_log ("", GF_LOG_INFO, "brick: %s", brick);
+        priv = THIS->private;
 
-        dup_brick = gf_strdup (brick);
-        if (!dup_brick) {
-                gf_log ("", GF_LOG_ERROR,
-                        "Out of memory");
-                ret = -1;
+        sub = trans->xl_private;
+        if (sub && !strcmp (sub->volname, volinfo->volname)) {
+                ret = 0;
                 goto out;
-        } else {
-                free_ptr = dup_brick;
         }
 
-        hostname = strtok (dup_brick, ":");
-        path = strtok (NULL, ":");
-
-        if (!hostname || !path) {
-                gf_log ("", GF_LOG_ERROR,
-                        "brick %s is not of form <HOSTNAME>:<export-dir>",
-                        brick);
-                ret = -1;
-                goto out;
+        if (!sub) {
+                sub = GF_CALLOC (1, sizeof (*sub), gf_gld_mt_volfile_sub_t);
+                if (!sub)
+                        goto out;
+                INIT_LIST_HEAD (&sub->sub_hash);
+                sub->trans = trans;
+                trans->xl_private = sub;
         }
 
-        ret = glusterd_volume_brickinfo_get (NULL, hostname, path, volinfo,
-                                             brickinfo);
-out:
-        if (free_ptr)
-                GF_FREE (free_ptr);
+        list_del_init (&sub->sub_hash);
+        snprintf (sub->volname, sizeof (sub->volname), "%s",
+                  volinfo->volname);
+        list_add (&sub->sub_hash,
+                  glusterd_volfile_sub_bucket (priv, sub->volname));
 
-        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        gf_log ("", GF_LOG_DEBUG, "%s subscribed to volfile changes of %s",
+                trans->peerinfo.identifier, volinfo->volname);
+        ret = 0;
+out:
         return ret;
 }
 
-int32_t
-glusterd_friend_cleanup (glusterd_peerinfo_t *peerinfo)
+void
+glusterd_volfile_unsubscribe (rpc_transport_t *trans)
 {
-        GF_ASSERT (peerinfo);
-        glusterd_peerctx_t *peerctx = NULL;
+        glusterd_volfile_sub_t  *sub = NULL;
 
-        if (peerinfo->rpc) {
-                peerctx = peerinfo->rpc->mydata;
-                peerinfo->rpc->mydata = NULL;
-                peerinfo->rpc = rpc_clnt_unref (peerinfo->rpc);
-                peerinfo->rpc = NULL;
-                if (peerctx)
-                        GF_FREE (peerctx);
-        }
-        glusterd_peer_destroy (peerinfo);
+        GF_ASSERT (trans);
 
-        return 0;
+        sub = trans->xl_private;
+        if (!sub)
+                return;
+
+        list_del_init (&sub->sub_hash);
+        trans->xl_private = NULL;
+        GF_FREE (sub);
 }
 
-int32_t
-glusterd_volinfo_find (char *volname, glusterd_volinfo_t **volinfo)
+/* The version a client is told along with a volfile and in each change
+ * notification. It is unique across volumes for the life of this glusterd,
+ * a client re-fetches after reconnecting so it never compares versions
+ * from two different glusterd instances.
+ */
+uint32_t
+glusterd_volfile_version (glusterd_volinfo_t *volinfo)
 {
-        glusterd_volinfo_t      *tmp_volinfo = NULL;
-        int32_t                 ret = -1;
-        xlator_t                *this = NULL;
         glusterd_conf_t         *priv = NULL;
 
-        GF_ASSERT (volname);
+        GF_ASSERT (volinfo);
 
-        this = THIS;
-        GF_ASSERT (this);
+        priv = THIS->private;
 
-        priv = this->private;
+        if (!volinfo->volfile_version)
+                volinfo->volfile_version = ++priv->volfile_gen;
 
-        list_for_each_entry (tmp_volinfo, &priv->volumes, vol_list) {
-                if (!strcmp (tmp_volinfo->volname, volname)) {
-                        gf_log ("", GF_LOG_DEBUG, "Volume %s found", volname);
+        return volinfo->volfile_version;
+}
+
+static void
+glusterd_volfile_entry_free (glusterd_volfile_cache_t *cache,
+                             glusterd_volfile_entry_t *entry)
+{
+        if (!list_empty (&entry->lru))
+                cache->size -= iobuf_pagesize (entry->iob);
+        list_del_init (&entry->lru);
+        list_del_init (&entry->key_hash);
+        list_del_init (&entry->path_hash);
+        if (entry->iob)
+                iobuf_unref (entry->iob);
+        if (entry->key)
+                GF_FREE (entry->key);
+        if (entry->path)
+                GF_FREE (entry->path);
+        if (entry->volname)
+                GF_FREE (entry->volname);
+        GF_FREE (entry);
+}
+
+/* Looks up the volfile cached for key. On a hit the volume it belongs to
+ * is copied into volname (GLUSTERD_MAX_VOLUME_NAME) and *iobp gets a ref
+ * on the iobuf holding the *lenp bytes of volfile, not to be written to.
+ */
+int
+glusterd_volfile_cache_get (const char *key, char *volname,
+                            struct iobuf **iobp, size_t *lenp)
+{
+        glusterd_volfile_cache_t *cache = NULL;
+        glusterd_volfile_entry_t *entry = NULL;
+        int                      ret = -1;
+
+        cache = &((glusterd_conf_t *)THIS->private)->volfile_cache;
+
+        pthread_mutex_lock (&cache->lock);
+        {
+                list_for_each_entry (entry,
+                                     &cache->key_table[glusterd_hash_str (key)],
+                                     key_hash) {
+                        if (strcmp (entry->key, key))
+                                continue;
+                        strncpy (volname, entry->volname,
+                                 GLUSTERD_MAX_VOLUME_NAME - 1);
+                        *iobp = iobuf_ref (entry->iob);
+                        *lenp = entry->len;
+                        list_move_tail (&entry->lru, &cache->lru);
+                        cache->hits++;
                         ret = 0;
-                        *volinfo = tmp_volinfo;
-                        break;
+                        goto unlock;
                 }
+                cache->misses++;
         }
+unlock:
+        pthread_mutex_unlock (&cache->lock);
 
-
-        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
+uint64_t
+glusterd_volfile_cache_gen ()
+{
+        glusterd_volfile_cache_t *cache = NULL;
+        uint64_t                 gen = 0;
 
-int32_t
-glusterd_service_stop (const char *service, char *pidfile, int sig,
-                       gf_boolean_t force_kill)
+        cache = &((glusterd_conf_t *)THIS->private)->volfile_cache;
+
+        pthread_mutex_lock (&cache->lock);
+        {
+                gen = cache->gen;
+        }
+        pthread_mutex_unlock (&cache->lock);
+
+        return gen;
+}
+
+/* Caches the len bytes in iob, zero padded to the XDR unit, read from path
+ * as the volfile of key, unless a volfile was written since gen was read.
+ * The cache takes its own ref on iob, which must not be written to any
+ * more.
+ */
+int
+glusterd_volfile_cache_put (const char *key, const char *path,
+                            const char *volname, struct iobuf *iob,
+                            size_t len, uint64_t gen)
 {
-        int32_t  ret = -1;
-        pid_t    pid = -1;
-        FILE    *file = NULL;
-        gf_boolean_t is_locked = _gf_false;
+        glusterd_volfile_cache_t *cache = NULL;
+        glusterd_volfile_entry_t *entry = NULL;
+        glusterd_volfile_entry_t *tmp = NULL;
+        glusterd_volfile_entry_t *next = NULL;
+        struct list_head         *bucket = NULL;
+        int                      ret = -1;
 
-        file = fopen (pidfile, "r+");
+        cache = &((glusterd_conf_t *)THIS->private)->volfile_cache;
 
-        if (!file) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open pidfile: %s",
-                                pidfile);
-                if (errno == ENOENT) {
-                        gf_log ("",GF_LOG_TRACE, "%s may not be running",
-                                service);
-                        ret = 0;
-                        goto out;
-                }
-                ret = -1;
+        entry = GF_CALLOC (1, sizeof (*entry), gf_gld_mt_volfile_entry_t);
+        if (!entry)
                 goto out;
-        }
-        ret = lockf (fileno (file), F_TLOCK, 0);
-        if (!ret) {
-                is_locked = _gf_true;
-                ret = unlink (pidfile);
-                if (ret && (ENOENT != errno)) {
-                        gf_log ("", GF_LOG_ERROR, "Unable to "
-                                "unlink stale pidfile: %s", pidfile);
-                }
+        INIT_LIST_HEAD (&entry->key_hash);
+        INIT_LIST_HEAD (&entry->path_hash);
+        INIT_LIST_HEAD (&entry->lru);
+        entry->key = gf_strdup (key);
+        entry->path = gf_strdup (path);
+        entry->volname = gf_strdup (volname);
+        entry->iob = iobuf_ref (iob);
+        entry->len = len;
+        if (!entry->key || !entry->path || !entry->volname)
                 goto out;
-        }
 
+        pthread_mutex_lock (&cache->lock);
+        {
+                if (gen != cache->gen)
+                        goto unlock;
 
-        ret = fscanf (file, "%d", &pid);
-        if (ret <= 0) {
-                gf_log ("", GF_LOG_ERROR, "Unable to read pidfile: %s",
-                                pidfile);
-                ret = -1;
-                goto out;
-        }
-        fclose (file);
-        file = NULL;
+                /* another fetch may have cached it meanwhile */
+                bucket = &cache->key_table[glusterd_hash_str (key)];
+                list_for_each_entry_safe (tmp, next, bucket, key_hash) {
+                        if (!strcmp (tmp->key, key))
+                                glusterd_volfile_entry_free (cache, tmp);
+                }
 
-        gf_log ("", GF_LOG_INFO, "Stopping gluster %s running in pid: %d",
-                service, pid);
+                list_add (&entry->key_hash, bucket);
+                list_add (&entry->path_hash,
+                          &cache->path_table[glusterd_hash_str (path)]);
+                list_add_tail (&entry->lru, &cache->lru);
+                cache->size += iobuf_pagesize (iob);
+                entry = NULL;
+                ret = 0;
 
-        ret = kill (pid, sig);
+                while (cache->size > GLUSTERD_VOLFILE_CACHE_SIZE) {
+                        tmp = list_entry (cache->lru.next,
+                                          glusterd_volfile_entry_t, lru);
+                        glusterd_volfile_entry_free (cache, tmp);
+                        cache->evictions++;
+                }
+        }
+unlock:
+        pthread_mutex_unlock (&cache->lock);
+out:
+        if (entry)
+                glusterd_volfile_entry_free (cache, entry);
+        return ret;
+}
 
-        if (force_kill) {
-                sleep (1);
-                file = fopen (pidfile, "r+");
-                if (!file) {
-                        ret = 0;
-                        goto out;
+/* Called whenever the volfile at path is written or removed. */
+void
+glusterd_volfile_cache_drop (const char *path)
+{
+        glusterd_volfile_cache_t *cache = NULL;
+        glusterd_volfile_entry_t *entry = NULL;
+        glusterd_volfile_entry_t *tmp = NULL;
+        struct list_head         *bucket = NULL;
+
+        cache = &((glusterd_conf_t *)THIS->private)->volfile_cache;
+
+        pthread_mutex_lock (&cache->lock);
+        {
+                cache->gen++;
+                bucket = &cache->path_table[glusterd_hash_str (path)];
+                list_for_each_entry_safe (entry, tmp, bucket, path_hash) {
+                        if (!strcmp (entry->path, path))
+                                glusterd_volfile_entry_free (cache, entry);
                 }
-                ret = lockf (fileno (file), F_TLOCK, 0);
-                if (ret && ((EAGAIN == errno) || (EACCES == errno))) {
-                        ret = kill (pid, SIGKILL);
-                        if (ret) {
-                                gf_log ("", GF_LOG_ERROR, "Unable to "
-                                        "kill pid %d reason: %s", pid,
-                                        strerror(errno));
-                                goto out;
-                        }
+        }
+        pthread_mutex_unlock (&cache->lock);
+}
 
-                } else if (0 == ret){
-                        is_locked = _gf_true;
+/* Called when the volume goes away along with all its volfiles. */
+void
+glusterd_volfile_cache_purge (const char *volname)
+{
+        glusterd_volfile_cache_t *cache = NULL;
+        glusterd_volfile_entry_t *entry = NULL;
+        glusterd_volfile_entry_t *tmp = NULL;
+        int                      i = 0;
+
+        cache = &((glusterd_conf_t *)THIS->private)->volfile_cache;
+
+        pthread_mutex_lock (&cache->lock);
+        {
+                cache->gen++;
+                for (i = 0; i < GLUSTERD_HASH_SIZE; i++) {
+                        list_for_each_entry_safe (entry, tmp,
+                                                  &cache->key_table[i],
+                                                  key_hash) {
+                                if (!strcmp (entry->volname, volname))
+                                        glusterd_volfile_entry_free (cache, entry);
+                        }
                 }
-                ret = unlink (pidfile);
-                if (ret && (ENOENT != errno)) {
-                        gf_log ("", GF_LOG_ERROR, "Unable to "
-                                "unlink pidfile: %s", pidfile);
-                        goto out;
+        }
+        pthread_mutex_unlock (&cache->lock);
+}
+
+void
+glusterd_volfile_cache_flush (glusterd_conf_t *priv)
+{
+        glusterd_volfile_cache_t *cache = NULL;
+        glusterd_volfile_entry_t *entry = NULL;
+        glusterd_volfile_entry_t *tmp = NULL;
+        int                      i = 0;
+
+        cache = &priv->volfile_cache;
+
+        pthread_mutex_lock (&cache->lock);
+        {
+                cache->gen++;
+                for (i = 0; i < GLUSTERD_HASH_SIZE; i++) {
+                        list_for_each_entry_safe (entry, tmp,
+                                                  &cache->key_table[i],
+                                                  key_hash)
+                                glusterd_volfile_entry_free (cache, entry);
                 }
         }
+        pthread_mutex_unlock (&cache->lock);
+}
 
-        ret = 0;
-out:
-        if (is_locked && file)
-                if (lockf (fileno (file), F_ULOCK, 0) < 0)
-                        gf_log ("", GF_LOG_WARNING, "Cannot unlock pidfile: %s"
-                                " reason: %s", pidfile, strerror(errno));
-        if (file)
-                fclose (file);
-        return ret;
+void
+glusterd_volfile_cache_dump (glusterd_conf_t *priv, char *prefix)
+{
+        char    key[GF_DUMP_MAX_BUF_LEN];
+
+        gf_proc_dump_build_key (key, prefix, "volfile_cache.hits");
+        gf_proc_dump_write (key, "%"PRIu64, priv->volfile_cache.hits);
+        gf_proc_dump_build_key (key, prefix, "volfile_cache.misses");
+        gf_proc_dump_write (key, "%"PRIu64, priv->volfile_cache.misses);
+        gf_proc_dump_build_key (key, prefix, "volfile_cache.not_modified");
+        gf_proc_dump_write (key, "%"PRIu64, priv->volfile_cache.not_modified);
+        gf_proc_dump_build_key (key, prefix, "volfile_cache.evictions");
+        gf_proc_dump_write (key, "%"PRIu64, priv->volfile_cache.evictions);
+        gf_proc_dump_build_key (key, prefix, "volfile_cache.size");
+        gf_proc_dump_write (key, "%"GF_PRI_SIZET, priv->volfile_cache.size);
 }
 
+/* Called when a volinfo is added to priv->volumes, the volname never
+ * changes afterwards. glusterd_volinfo_delete unhashes it.
+ */
 void
-glusterd_set_brick_socket_filepath (glusterd_volinfo_t *volinfo,
-                                    glusterd_brickinfo_t *brickinfo,
-                                    char *sockpath, size_t len)
+glusterd_volinfo_hash (glusterd_volinfo_t *volinfo)
 {
-        char                    export_path[PATH_MAX] = {0,};
-        char                    sock_filepath[PATH_MAX] = {0,};
-        char                    md5_sum[MD5_DIGEST_LEN*2+1] = {0,};
-        char                    volume_dir[PATH_MAX] = {0,};
-        xlator_t                *this = NULL;
         glusterd_conf_t         *priv = NULL;
-        int                     expected_file_len = 0;
 
-        expected_file_len = strlen (glusterd_sock_dir) + strlen ("/") +
-                            MD5_DIGEST_LEN*2 + strlen (".socket") + 1;
-        GF_ASSERT (len >= expected_file_len);
-        this = THIS;
-        GF_ASSERT (this);
-
-        priv = this->private;
+        GF_ASSERT (volinfo);
 
-        GLUSTERD_GET_VOLUME_DIR (volume_dir, volinfo, priv);
-        GLUSTERD_REMOVE_SLASH_FROM_PATH (brickinfo->path, export_path);
-        snprintf (sock_filepath, PATH_MAX, "%s/run/%s-%s",
-                  volume_dir, brickinfo->hostname, export_path);
-        _get_md5_str (md5_sum, sizeof (md5_sum),
-                              (uint8_t*)sock_filepath, strlen (sock_filepath));
+        priv = THIS->private;
 
-        snprintf (sockpath, len, "%s/%s.socket", glusterd_sock_dir, md5_sum);
+        list_del_init (&volinfo->vol_hash);
+        list_add (&volinfo->vol_hash,
+                  &priv->vol_table[glusterd_hash_str (volinfo->volname)]);
 }
 
-/* connection happens only if it is not aleady connected,
- * reconnections are taken care by rpc-layer
+/* Adds volinfo to priv->volumes, which is kept in volname order so that
+ * it can be paged through by name, see glusterd_volinfo_find_next (), and
+ * hashes it. Volumes mostly come in order, hence the search from the tail.
  */
-int32_t
-glusterd_brick_connect (glusterd_volinfo_t  *volinfo,
-                        glusterd_brickinfo_t  *brickinfo)
+void
+glusterd_volinfo_list_add (glusterd_volinfo_t *volinfo)
 {
-        int                     ret = 0;
-        char                    socketpath[PATH_MAX] = {0};
-        dict_t                  *options = NULL;
-        struct rpc_clnt         *rpc = NULL;
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volinfo_t      *tmp = NULL;
 
         GF_ASSERT (volinfo);
-        GF_ASSERT (brickinfo);
 
-        if (brickinfo->rpc == NULL) {
-                glusterd_set_brick_socket_filepath (volinfo, brickinfo,
-                                                    socketpath,
-                                                    sizeof (socketpath));
-                ret = rpc_clnt_transport_unix_options_build (&options, socketpath);
-                if (ret)
-                        goto out;
-                ret = glusterd_rpc_create (&rpc, options,
-                                           glusterd_brick_rpc_notify,
-                                           brickinfo);
-                if (ret)
-                        goto out;
-                brickinfo->rpc = rpc;
+        priv = THIS->private;
+
+        for (tmp = list_entry (priv->volumes.prev, typeof (*tmp), vol_list);
+             &tmp->vol_list != &priv->volumes;
+             tmp = list_entry (tmp->vol_list.prev, typeof (*tmp), vol_list)) {
+                if (strcmp (tmp->volname, volinfo->volname) < 0)
+                        break;
         }
-out:
-        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
-        return ret;
+
+        list_add (&volinfo->vol_list, &tmp->vol_list);
+        glusterd_volinfo_hash (volinfo);
 }
 
-int32_t
-glusterd_volume_start_glusterfs (glusterd_volinfo_t  *volinfo,
-                                 glusterd_brickinfo_t  *brickinfo)
+/* Adds volinfo at the tail of priv->volumes and hashes it, for restore:
+ * the list is put in volname order once with glusterd_volinfo_list_sort ()
+ * after all volumes are read.
+ */
+void
+glusterd_volinfo_list_append (glusterd_volinfo_t *volinfo)
 {
-        int32_t                 ret = -1;
-        xlator_t                *this = NULL;
         glusterd_conf_t         *priv = NULL;
-        char                    pidfile[PATH_MAX] = {0,};
-        char                    volfile[PATH_MAX] = {0,};
-        char                    path[PATH_MAX] = {0,};
-        runner_t                runner = {0,};
-        char                    rundir[PATH_MAX] = {0,};
-        char                    exp_path[PATH_MAX] = {0,};
-        char                    logfile[PATH_MAX] = {0,};
-        int                     port = 0;
-        int                     rdma_port = 0;
-        FILE                    *file = NULL;
-        gf_boolean_t            is_locked = _gf_false;
-        char                    socketpath[PATH_MAX] = {0};
 
         GF_ASSERT (volinfo);
-        GF_ASSERT (brickinfo);
 
-        this = THIS;
-        GF_ASSERT (this);
+        priv = THIS->private;
 
-        priv = this->private;
+        list_add_tail (&volinfo->vol_list, &priv->volumes);
+        glusterd_volinfo_hash (volinfo);
+}
 
-        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
-        snprintf (rundir, PATH_MAX, "%s/run", path);
-        ret = mkdir (rundir, 0777);
+static int
+glusterd_volinfo_name_cmp (const void *a, const void *b)
+{
+        return strcmp ((*(glusterd_volinfo_t **)a)->volname,
+                       (*(glusterd_volinfo_t **)b)->volname);
+}
 
-        if ((ret == -1) && (EEXIST != errno)) {
-                gf_log ("", GF_LOG_ERROR, "Unable to create rundir %s",
-                        rundir);
-                goto out;
-        }
+void
+glusterd_volinfo_list_sort (void)
+{
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+        glusterd_volinfo_t      *tmp = NULL;
+        glusterd_volinfo_t      **vols = NULL;
+        struct list_head        unsorted;
+        int                     count = 0;
+        int                     i = 0;
 
-        glusterd_set_brick_socket_filepath (volinfo, brickinfo, socketpath,
-                                            sizeof (socketpath));
-        GLUSTERD_GET_BRICK_PIDFILE (pidfile, path, brickinfo->hostname,
-                                    brickinfo->path);
+        priv = THIS->private;
+        INIT_LIST_HEAD (&unsorted);
 
-        file = fopen (pidfile, "r+");
-        if (file) {
-                ret = lockf (fileno (file), F_TLOCK, 0);
-                if (ret && ((EAGAIN == errno) || (EACCES == errno))) {
-                        ret = 0;
-                        gf_log ("", GF_LOG_INFO, "brick %s:%s "
-                                "already started", brickinfo->hostname,
-                                brickinfo->path);
-                        goto connect;
-                }
-        }
+        list_for_each_entry (volinfo, &priv->volumes, vol_list)
+                count++;
+        if (count < 2)
+                return;
 
-        ret = pmap_registry_search (this, brickinfo->path,
-                                    GF_PMAP_PORT_BRICKSERVER);
-        if (ret) {
-                ret = 0;
-                file = fopen (pidfile, "r+");
-                if (file) {
-                        ret = lockf (fileno (file), F_TLOCK, 0);
-                        if (ret && ((EAGAIN == errno) || (EACCES == errno))) {
-                                ret = 0;
-                                gf_log ("", GF_LOG_INFO, "brick %s:%s "
-                                        "already started", brickinfo->hostname,
-                                        brickinfo->path);
-                                goto connect;
-                        } else if (0 == ret) {
-                                is_locked = _gf_true;
-                        }
+        vols = GF_CALLOC (count, sizeof (*vols), gf_gld_mt_char);
+        if (!vols) {
+                /* insert them one by one then */
+                list_splice_init (&priv->volumes, &unsorted);
+                list_for_each_entry_safe (volinfo, tmp, &unsorted,
+                                          vol_list) {
+                        list_del_init (&volinfo->vol_list);
+                        glusterd_volinfo_list_add (volinfo);
                 }
-                /* This means, pmap has the entry, remove it */
-                ret = pmap_registry_remove (this, 0, brickinfo->path,
-                                            GF_PMAP_PORT_BRICKSERVER, NULL);
+                return;
         }
-        unlink (pidfile);
 
-        gf_log ("", GF_LOG_INFO, "About to start glusterfs"
-                " for brick %s:%s", brickinfo->hostname,
-                brickinfo->path);
-        GLUSTERD_REMOVE_SLASH_FROM_PATH (brickinfo->path, exp_path);
-        snprintf (volfile, PATH_MAX, "%s.%s.%s", volinfo->volname,
-                  brickinfo->hostname, exp_path);
+        list_for_each_entry (volinfo, &priv->volumes, vol_list)
+                vols[i++] = volinfo;
+        qsort (vols, count, sizeof (*vols), glusterd_volinfo_name_cmp);
 
-        if (!brickinfo->logfile && volinfo->logdir) {
-                snprintf (logfile, PATH_MAX, "%s/%s.log", volinfo->logdir,
-                                                          exp_path);
-                brickinfo->logfile = gf_strdup (logfile);
-        } else if (!brickinfo->logfile) {
-                snprintf (logfile, PATH_MAX, "%s/bricks/%s.log",
-                          DEFAULT_LOG_FILE_DIRECTORY, exp_path);
-                brickinfo->logfile = gf_strdup (logfile);
-        }
+        INIT_LIST_HEAD (&priv->volumes);
+        for (i = 0; i < count; i++)
+                list_add_tail (&vols[i]->vol_list, &priv->volumes);
 
-        port = brickinfo->port;
-        if (!port)
-                port = pmap_registry_alloc (THIS);
+        GF_FREE (vols);
+}
 
-        runinit (&runner);
-        runner_add_args (&runner, GFS_PREFIX"/sbin/glusterfsd",
-                         "-s", "localhost", "--volfile-id", volfile,
-                         "-p", pidfile, "-S", socketpath,
-                         "--brick-name", brickinfo->path,
-                         "-l", brickinfo->logfile, "--brick-port",  NULL);
+/* The first volume after volname in priv->volumes, whether or not volname
+ * itself (still) exists. NULL if there is none.
+ */
+glusterd_volinfo_t *
+glusterd_volinfo_find_next (char *volname)
+{
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+        struct list_head        *next = NULL;
 
-        if (volinfo->transport_type != GF_TRANSPORT_BOTH_TCP_RDMA) {
-                runner_argprintf (&runner, "%d", port);
+        priv = THIS->private;
+
+        if (!glusterd_volinfo_find (volname, &volinfo)) {
+                next = volinfo->vol_list.next;
         } else {
-                rdma_port = brickinfo->rdma_port;
-                if (!rdma_port)
-                        rdma_port = pmap_registry_alloc (THIS);
-                runner_argprintf (&runner, "%d,%d", port, rdma_port);
-                runner_add_arg (&runner, "--xlator-option");
-                runner_argprintf (&runner, "%s-server.transport.rdma.listen-port=%d",
-                                  volinfo->volname, rdma_port);
+                list_for_each_entry (volinfo, &priv->volumes, vol_list) {
+                        if (strcmp (volinfo->volname, volname) > 0)
+                                break;
+                }
+                next = &volinfo->vol_list;
         }
 
-        runner_add_arg (&runner, "--xlator-option");
-        runner_argprintf (&runner, "%s-server.listen-port=%d",
-                          volinfo->volname, port);
-
-        runner_log (&runner, "", GF_LOG_DEBUG, "Starting GlusterFS");
-        ret = runner_run (&runner);
-
-        if (ret == 0) {
-                //pmap_registry_bind (THIS, port, brickinfo->path);
-                brickinfo->port = port;
-                brickinfo->rdma_port = rdma_port;
-        }
+        if (next == &priv->volumes)
+                return NULL;
 
-connect:
-        ret = glusterd_brick_connect (volinfo, brickinfo);
-        if (ret)
-                goto out;
-out:
-        if (is_locked && file)
-                if (lockf (fileno (file), F_ULOCK, 0) < 0)
-                        gf_log ("", GF_LOG_WARNING, "Cannot unlock pidfile: %s"
-                                " reason: %s", pidfile, strerror(errno));
-        if (file)
-                fclose (file);
-        return ret;
+        return list_entry (next, glusterd_volinfo_t, vol_list);
 }
 
-int32_t
-glusterd_brick_unlink_socket_file (glusterd_volinfo_t *volinfo,
-                                   glusterd_brickinfo_t *brickinfo)
+/* Must be called when a peer is added to priv->peers and whenever its uuid
+ * or hostname changes.
+ */
+void
+glusterd_peerinfo_hash (glusterd_peerinfo_t *peerinfo)
 {
-        char                    path[PATH_MAX] = {0,};
-        char                    socketpath[PATH_MAX] = {0};
-        xlator_t                *this = NULL;
         glusterd_conf_t         *priv = NULL;
-        int                     ret = 0;
-
-        GF_ASSERT (volinfo);
-        GF_ASSERT (brickinfo);
-
-        this = THIS;
-        GF_ASSERT (this);
 
-        priv = this->private;
-        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
-        glusterd_set_brick_socket_filepath (volinfo, brickinfo, socketpath,
-                                            sizeof (socketpath));
-        ret = unlink (socketpath);
-        if (ret && (ENOENT == errno)) {
-                ret = 0;
-        } else {
-                gf_log ("glusterd", GF_LOG_ERROR, "Failed to remove %s"
-                        " error: %s", socketpath, strerror (errno));
-        }
+        GF_ASSERT (peerinfo);
 
-        return ret;
-}
+        priv = THIS->private;
 
-int32_t
-glusterd_brick_disconnect (glusterd_brickinfo_t *brickinfo)
-{
-        GF_ASSERT (brickinfo);
+        list_del_init (&peerinfo->uuid_hash);
+        list_add (&peerinfo->uuid_hash,
+                  &priv->peer_uuid_table[glusterd_hash_uuid (peerinfo->uuid)]);
 
-        if (brickinfo->rpc) {
-                rpc_clnt_unref (brickinfo->rpc);
-                brickinfo->rpc = NULL;
-        }
-        return 0;
+        list_del_init (&peerinfo->hostname_hash);
+        if (peerinfo->hostname)
+                list_add (&peerinfo->hostname_hash,
+                          &priv->peer_host_table[glusterd_hash_str (peerinfo->hostname)]);
 }
 
-int32_t
-glusterd_volume_stop_glusterfs (glusterd_volinfo_t  *volinfo,
-                                glusterd_brickinfo_t   *brickinfo)
+/* Indexes @brickinfo under @volinfo by path and by port. Bricks which are
+ * not indexed (or whose port changed since) are still found by the
+ * lookups, which fall back to a scan and index what they find.
+ */
+void
+glusterd_brickinfo_hash (glusterd_volinfo_t *volinfo,
+                         glusterd_brickinfo_t *brickinfo)
 {
-        xlator_t                *this = NULL;
         glusterd_conf_t         *priv = NULL;
-        char                    pidfile[PATH_MAX] = {0,};
-        char                    path[PATH_MAX] = {0,};
-        int                     ret = 0;
 
         GF_ASSERT (volinfo);
         GF_ASSERT (brickinfo);
 
-        this = THIS;
-        GF_ASSERT (this);
+        priv = THIS->private;
 
-        priv = this->private;
-        (void) glusterd_brick_disconnect (brickinfo);
+        brickinfo->volinfo = volinfo;
 
-        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
-        GLUSTERD_GET_BRICK_PIDFILE (pidfile, path, brickinfo->hostname,
-                                    brickinfo->path);
+        list_del_init (&brickinfo->brick_hash);
+        list_add (&brickinfo->brick_hash,
+                  &priv->brick_table[glusterd_hash_str (brickinfo->path)]);
 
-        ret = glusterd_service_stop ("brick", pidfile, SIGTERM, _gf_false);
-        if (ret == 0) {
-                glusterd_set_brick_status (brickinfo, GF_BRICK_STOPPED);
-                ret = glusterd_brick_unlink_socket_file (volinfo, brickinfo);
-        }
-        return ret;
+        list_del_init (&brickinfo->port_hash);
+        list_add (&brickinfo->port_hash,
+                  &priv->brick_port_table[glusterd_hash_port (brickinfo->port)]);
 }
 
 int32_t
-glusterd_peer_hostname_new (char *hostname, glusterd_peer_hostname_t **name)
+glusterd_volume_brickinfo_get (uuid_t uuid, char *hostname, char *path,
+                               glusterd_volinfo_t *volinfo,
+                               glusterd_brickinfo_t **brickinfo)
 {
-        glusterd_peer_hostname_t        *peer_hostname = NULL;
-        int32_t                         ret = -1;
-
-        GF_ASSERT (hostname);
-        GF_ASSERT (name);
+        glusterd_brickinfo_t    *brickiter = NULL;
+        uuid_t                  peer_uuid = {0};
+        int32_t                 ret = -1;
+        int32_t                 brick_path_len = 0;
+        int32_t                 path_len = 0;
+        int32_t                 smaller_path = 0;
+        gf_boolean_t            is_path_smaller = _gf_true;
+        glusterd_conf_t         *priv = NULL;
+        struct list_head        *bucket = NULL;
 
-        peer_hostname = GF_CALLOC (1, sizeof (*peer_hostname),
-                                   gf_gld_mt_peer_hostname_t);
+        if (uuid) {
+                uuid_copy (peer_uuid, uuid);
+        } else {
+                ret = glusterd_hostname_to_uuid (hostname, peer_uuid);
+                if (ret)
+                        goto out;
+        }
 
-        if (!peer_hostname)
-                goto out;
+        priv = THIS->private;
+        bucket = &priv->brick_table[glusterd_hash_str (path)];
+        list_for_each_entry (brickiter, bucket, brick_hash) {
+                if ((brickiter->volinfo == volinfo) &&
+                    !uuid_compare (peer_uuid, brickiter->uuid) &&
+                    !strcmp (brickiter->path, path)) {
+                        gf_log ("", GF_LOG_INFO, "Found brick");
+                        ret = 0;
+                        if (brickinfo)
+                                *brickinfo = brickiter;
+                        goto out;
+                }
+        }
 
-        peer_hostname->hostname = gf_strdup (hostname);
-        INIT_LIST_HEAD (&peer_hostname->hostname_list);
+        ret = -1;
+        path_len = strlen (path);
+        list_for_each_entry (brickiter, &volinfo->bricks, brick_list) {
 
-        *name = peer_hostname;
-        ret = 0;
+                if (uuid_is_null (brickiter->uuid)) {
+                        ret = glusterd_resolve_brick (brickiter);
+                        if (ret)
+                                goto out;
+                }
+                brick_path_len = strlen (brickiter->path);
+                smaller_path = min (brick_path_len, path_len);
+                if (smaller_path != path_len)
+                        is_path_smaller = _gf_false;
+                if ((!uuid_compare (peer_uuid, brickiter->uuid)) &&
+                        !strcmp (brickiter->path, path)) {
+                        gf_log ("", GF_LOG_INFO, "Found brick");
+                        ret = 0;
+                        glusterd_brickinfo_hash (volinfo, brickiter);
+                        if (brickinfo)
+                                *brickinfo = brickiter;
+                        break;
+                } else {
+                        if ((!uuid_compare (peer_uuid, brickiter->uuid)) &&
+                            !strncmp (brickiter->path, path, smaller_path)) {
+                                if (is_path_smaller == _gf_true)  {
+                                        if (brickiter->path[smaller_path] == '/') {
+                                                ret = 0;
+                                                gf_log ("", GF_LOG_INFO,
+                                                        "given path %s lies"
+                                                        " within %s", path,
+                                                        brickiter->path);
+                                                *brickinfo = brickiter;
+                                                break;
+                                        }
+                                } else
+                                        if (path[smaller_path] == '/') {
+                                                gf_log ("", GF_LOG_INFO,
+                                                        "brick %s is a part of"
+                                                        " %s", brickiter->path,
+                                                        path);
+                                                ret = 0;
+                                                *brickinfo = brickiter;
+                                                break;
+                                        }
+                        }
+                        ret = -1;
+                }
+        }
 
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
-int
-glusterd_volume_compute_cksum (glusterd_volinfo_t  *volinfo)
+int32_t
+glusterd_volume_brickinfo_get_by_brick (char *brick,
+                                        glusterd_volinfo_t *volinfo,
+                                        glusterd_brickinfo_t **brickinfo)
 {
         int32_t                 ret = -1;
-        glusterd_conf_t         *priv = NULL;
-        char                    path[PATH_MAX] = {0,};
-        char                    cksum_path[PATH_MAX] = {0,};
-        char                    filepath[PATH_MAX] = {0,};
-        int                     fd = -1;
-        uint32_t                cksum = 0;
-        char                    buf[4096] = {0,};
-        char                    sort_filepath[PATH_MAX] = {0};
-        gf_boolean_t            unlink_sortfile = _gf_false;
-        int                     sort_fd = 0;
+        char                    *hostname = NULL;
+        char                    *path = NULL;
+        char                    *dup_brick = NULL;
+        char                    *free_ptr = NULL;
 
+        GF_ASSERT (brick);
         GF_ASSERT (volinfo);
 
-        priv = THIS->private;
-        GF_ASSERT (priv);
-
-        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
-
-        snprintf (cksum_path, sizeof (cksum_path), "%s/%s",
-                  path, GLUSTERD_CKSUM_FILE);
-
-        fd = open (cksum_path, O_RDWR | O_APPEND | O_CREAT| O_TRUNC, 0644);
+        gf_log ("", GF_LOG_INFO, "brick: %s", brick);
 
-        if (-1 == fd) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open %s, errno: %d",
-                        cksum_path, errno);
+        dup_brick = gf_strdup (brick);
+        if (!dup_brick) {
+                gf_log ("", GF_LOG_ERROR,
+                        "Out of memory");
                 ret = -1;
                 goto out;
-        }
-
-        snprintf (filepath, sizeof (filepath), "%s/%s", path,
-                  GLUSTERD_VOLUME_INFO_FILE);
-        snprintf (sort_filepath, sizeof (sort_filepath), "/tmp/%s.XXXXXX",
-                  volinfo->volname);
-        sort_fd = mkstemp (sort_filepath);
-        if (sort_fd < 0) {
-                gf_log ("", GF_LOG_ERROR, "Could not generate temp file, "
-                        "reason: %s for volume: %s", strerror (errno),
-                        volinfo->volname);
-                goto out;
         } else {
-                unlink_sortfile = _gf_true;
-        }
-
-        ret = runcmd ("sort", filepath, "-o", sort_filepath, NULL);
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR, "failed to sort file %s to %s",
-                        filepath, sort_filepath);
-                goto out;
-        }
-        ret = get_checksum_for_path (sort_filepath, &cksum);
-
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR, "Unable to get checksum"
-                        " for path: %s", sort_filepath);
-                goto out;
+                free_ptr = dup_brick;
         }
 
-        snprintf (buf, sizeof (buf), "%s=%u\n", "info", cksum);
-        ret = write (fd, buf, strlen (buf));
+        hostname = strtok (dup_brick, ":");
+        path = strtok (NULL, ":");
 
-        if (ret <= 0) {
+        if (!hostname || !path) {
+                gf_log ("", GF_LOG_ERROR,
+                        "brick %s is not of form <HOSTNAME>:<export-dir>",
+                        brick);
                 ret = -1;
                 goto out;
         }
 
-        ret = get_checksum_for_file (fd, &cksum);
-
-        if (ret)
-                goto out;
-
-        volinfo->cksum = cksum;
-
+        ret = glusterd_volume_brickinfo_get (NULL, hostname, path, volinfo,
+                                             brickinfo);
 out:
-        if (fd > 0)
-               close (fd);
-        if (sort_fd > 0)
-               close (sort_fd);
-        if (unlink_sortfile)
-               unlink (sort_filepath);
-        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        if (free_ptr)
+                GF_FREE (free_ptr);
 
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
-void
-_add_volinfo_dict_to_prdict (dict_t *this, char *key, data_t *value, void *data)
+int32_t
+glusterd_friend_cleanup (glusterd_peerinfo_t *peerinfo)
 {
-        glusterd_voldict_ctx_t   *ctx = NULL;
-        char                    optkey[512] = {0,};
-        int                     ret = -1;
+        GF_ASSERT (peerinfo);
+        glusterd_peerctx_t *peerctx = NULL;
 
-        ctx = data;
-        snprintf (optkey, sizeof (optkey), "volume%d.%s%d", ctx->count,
-                  ctx->key_name, ctx->opt_count);
-        ret = dict_set_str (ctx->dict, optkey, key);
-        if (ret)
-                gf_log ("", GF_LOG_ERROR, "option add for %s%d %s",
-                        ctx->key_name, ctx->count, key);
-        snprintf (optkey, sizeof (optkey), "volume%d.%s%d", ctx->count,
-                  ctx->val_name, ctx->opt_count);
-        ret = dict_set_str (ctx->dict, optkey, value->data);
-        if (ret)
-                gf_log ("", GF_LOG_ERROR, "option add for %s%d %s",
-                        ctx->val_name, ctx->count, value->data);
-        ctx->opt_count++;
+        if (peerinfo->rpc) {
+                peerctx = peerinfo->rpc->mydata;
+                peerinfo->rpc->mydata = NULL;
+                peerinfo->rpc = rpc_clnt_unref (peerinfo->rpc);
+                peerinfo->rpc = NULL;
+                if (peerctx)
+                        GF_FREE (peerctx);
+        }
+        glusterd_peer_destroy (peerinfo);
 
-        return;
+        return 0;
 }
 
 int32_t
-glusterd_add_volume_to_dict (glusterd_volinfo_t *volinfo,
-                             dict_t  *dict, int32_t count)
+glusterd_volinfo_find (char *volname, glusterd_volinfo_t **volinfo)
 {
+        glusterd_volinfo_t      *tmp_volinfo = NULL;
         int32_t                 ret = -1;
-        char                    key[512] = {0,};
-        glusterd_brickinfo_t    *brickinfo = NULL;
-        int32_t                 i = 1;
-        char                    *volume_id_str = NULL;
-        glusterd_voldict_ctx_t   ctx = {0};
-
-        GF_ASSERT (dict);
-        GF_ASSERT (volinfo);
-
-        snprintf (key, sizeof (key), "volume%d.name", count);
-        ret = dict_set_str (dict, key, volinfo->volname);
-        if (ret)
-                goto out;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        struct list_head        *bucket = NULL;
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.type", count);
-        ret = dict_set_int32 (dict, key, volinfo->type);
-        if (ret)
-                goto out;
+        GF_ASSERT (volname);
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.brick_count", count);
-        ret = dict_set_int32 (dict, key, volinfo->brick_count);
-        if (ret)
-                goto out;
+        this = THIS;
+        GF_ASSERT (this);
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.version", count);
-        ret = dict_set_int32 (dict, key, volinfo->version);
-        if (ret)
-                goto out;
+        priv = this->private;
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.status", count);
-        ret = dict_set_int32 (dict, key, volinfo->status);
-        if (ret)
-                goto out;
+        bucket = &priv->vol_table[glusterd_hash_str (volname)];
+        list_for_each_entry (tmp_volinfo, bucket, vol_hash) {
+                if (!strcmp (tmp_volinfo->volname, volname)) {
+                        gf_log ("", GF_LOG_DEBUG, "Volume %s found", volname);
+                        ret = 0;
+                        *volinfo = tmp_volinfo;
+                        break;
+                }
+        }
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.sub_count", count);
-        ret = dict_set_int32 (dict, key, volinfo->sub_count);
-        if (ret)
-                goto out;
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.ckusm", count);
-        ret = dict_set_int64 (dict, key, volinfo->cksum);
-        if (ret)
-                goto out;
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.transport_type", count);
-        ret = dict_set_uint32 (dict, key, volinfo->transport_type);
-        if (ret)
-                goto out;
+
+int32_t
+glusterd_service_stop (const char *service, char *pidfile, int sig,
+                       gf_boolean_t force_kill)
+{
+        int32_t  ret = -1;
+        pid_t    pid = -1;
+        FILE    *file = NULL;
+        gf_boolean_t is_locked = _gf_false;
+
+        file = fopen (pidfile, "r+");
+
+        if (!file) {
+                gf_log ("", GF_LOG_ERROR, "Unable to open pidfile: %s",
+                                pidfile);
+                if (errno == ENOENT) {
+                        gf_log ("",GF_LOG_TRACE, "%s may not be running",
+                                service);
+                        ret = 0;
+                        goto out;
+                }
+                ret = -1;
+                goto out;
+        }
+        ret = lockf (fileno (file), F_TLOCK, 0);
+        if (!ret) {
+                is_locked = _gf_true;
+                ret = unlink (pidfile);
+                if (ret && (ENOENT != errno)) {
+                        gf_log ("", GF_LOG_ERROR, "Unable to "
+                                "unlink stale pidfile: %s", pidfile);
+                }
+                goto out;
+        }
+
+
+        ret = fscanf (file, "%d", &pid);
+        if (ret <= 0) {
+                gf_log ("", GF_LOG_ERROR, "Unable to read pidfile: %s",
+                                pidfile);
+                ret = -1;
+                goto out;
+        }
+        fclose (file);
+        file = NULL;
+
+        gf_log ("", GF_LOG_INFO, "Stopping gluster %s running in pid: %d",
+                service, pid);
+
+        ret = kill (pid, sig);
+
+        if (force_kill) {
+                sleep (1);
+                file = fopen (pidfile, "r+");
+                if (!file) {
+                        ret = 0;
+                        goto out;
+                }
+                ret = lockf (fileno (file), F_TLOCK, 0);
+                if (ret && ((EAGAIN == errno) || (EACCES == errno))) {
+                        ret = kill (pid, SIGKILL);
+                        if (ret) {
+                                gf_log ("", GF_LOG_ERROR, "Unable to "
+                                        "kill pid %d reason: %s", pid,
+                                        strerror(errno));
+                                goto out;
+                        }
+
+                } else if (0 == ret){
+                        is_locked = _gf_true;
+                }
+                ret = unlink (pidfile);
+                if (ret && (ENOENT != errno)) {
+                        gf_log ("", GF_LOG_ERROR, "Unable to "
+                                "unlink pidfile: %s", pidfile);
+                        goto out;
+                }
+        }
+
+        ret = 0;
+out:
+        if (is_locked && file)
+                if (lockf (fileno (file), F_ULOCK, 0) < 0)
+                        gf_log ("", GF_LOG_WARNING, "Cannot unlock pidfile: %s"
+                                " reason: %s", pidfile, strerror(errno));
+        if (file)
+                fclose (file);
+        return ret;
+}
+
+void
+glusterd_set_brick_socket_filepath (glusterd_volinfo_t *volinfo,
+                                    glusterd_brickinfo_t *brickinfo,
+                                    char *sockpath, size_t len)
+{
+        char                    export_path[PATH_MAX] = {0,};
+        char                    sock_filepath[PATH_MAX] = {0,};
+        char                    md5_sum[MD5_DIGEST_LEN*2+1] = {0,};
+        char                    volume_dir[PATH_MAX] = {0,};
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        int                     expected_file_len = 0;
+
+        expected_file_len = strlen (glusterd_sock_dir) + strlen ("/") +
+                            MD5_DIGEST_LEN*2 + strlen (".socket") + 1;
+        GF_ASSERT (len >= expected_file_len);
+        this = THIS;
+        GF_ASSERT (this);
+
+        priv = this->private;
+
+        GLUSTERD_GET_VOLUME_DIR (volume_dir, volinfo, priv);
+        GLUSTERD_REMOVE_SLASH_FROM_PATH (brickinfo->path, export_path);
+        snprintf (sock_filepath, PATH_MAX, "%s/run/%s-%s",
+                  volume_dir, brickinfo->hostname, export_path);
+        _get_md5_str (md5_sum, sizeof (md5_sum),
+                              (uint8_t*)sock_filepath, strlen (sock_filepath));
+
+        snprintf (sockpath, len, "%s/%s.socket", glusterd_sock_dir, md5_sum);
+}
+
+/* connection happens only if it is not aleady connected,
+ * reconnections are taken care by rpc-layer
+ */
+int32_t
+glusterd_brick_connect (glusterd_volinfo_t  *volinfo,
+                        glusterd_brickinfo_t  *brickinfo)
+{
+        int                     ret = 0;
+        char                    socketpath[PATH_MAX] = {0};
+        dict_t                  *options = NULL;
+        struct rpc_clnt         *rpc = NULL;
+
+        GF_ASSERT (volinfo);
+        GF_ASSERT (brickinfo);
+
+        if (brickinfo->rpc == NULL) {
+                glusterd_set_brick_socket_filepath (volinfo, brickinfo,
+                                                    socketpath,
+                                                    sizeof (socketpath));
+                ret = rpc_clnt_transport_unix_options_build (&options, socketpath);
+                if (ret)
+                        goto out;
+                ret = glusterd_rpc_create (&rpc, options,
+                                           glusterd_brick_rpc_notify,
+                                           brickinfo);
+                if (ret)
+                        goto out;
+                brickinfo->rpc = rpc;
+        }
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+/* Starts glusterfsd for brickinfo unless it is running already. With pidp
+ * the launcher is not waited for, its pid is returned in *pidp (left 0 if
+ * nothing was spawned) and the caller reaps it.
+ */
+static int32_t
+glusterd_brick_launch (glusterd_volinfo_t  *volinfo,
+                       glusterd_brickinfo_t  *brickinfo, pid_t *pidp)
+{
+        int32_t                 ret = -1;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        char                    pidfile[PATH_MAX] = {0,};
+        char                    volfile[PATH_MAX] = {0,};
+        char                    path[PATH_MAX] = {0,};
+        runner_t                runner = {0,};
+        char                    rundir[PATH_MAX] = {0,};
+        char                    exp_path[PATH_MAX] = {0,};
+        char                    logfile[PATH_MAX] = {0,};
+        int                     port = 0;
+        int                     rdma_port = 0;
+        FILE                    *file = NULL;
+        gf_boolean_t            is_locked = _gf_false;
+        char                    socketpath[PATH_MAX] = {0};
+
+        GF_ASSERT (volinfo);
+        GF_ASSERT (brickinfo);
+
+        this = THIS;
+        GF_ASSERT (this);
+
+        priv = this->private;
+
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+        snprintf (rundir, PATH_MAX, "%s/run", path);
+        ret = mkdir (rundir, 0777);
+
+        if ((ret == -1) && (EEXIST != errno)) {
+                gf_log ("", GF_LOG_ERROR, "Unable to create rundir %s",
+                        rundir);
+                goto out;
+        }
+
+        glusterd_set_brick_socket_filepath (volinfo, brickinfo, socketpath,
+                                            sizeof (socketpath));
+        GLUSTERD_GET_BRICK_PIDFILE (pidfile, path, brickinfo->hostname,
+                                    brickinfo->path);
+
+        file = fopen (pidfile, "r+");
+        if (file) {
+                ret = lockf (fileno (file), F_TLOCK, 0);
+                if (ret && ((EAGAIN == errno) || (EACCES == errno))) {
+                        ret = 0;
+                        gf_log ("", GF_LOG_INFO, "brick %s:%s "
+                                "already started", brickinfo->hostname,
+                                brickinfo->path);
+                        goto connect;
+                }
+        }
+
+        ret = pmap_registry_search (this, brickinfo->path,
+                                    GF_PMAP_PORT_BRICKSERVER);
+        if (ret) {
+                ret = 0;
+                file = fopen (pidfile, "r+");
+                if (file) {
+                        ret = lockf (fileno (file), F_TLOCK, 0);
+                        if (ret && ((EAGAIN == errno) || (EACCES == errno))) {
+                                ret = 0;
+                                gf_log ("", GF_LOG_INFO, "brick %s:%s "
+                                        "already started", brickinfo->hostname,
+                                        brickinfo->path);
+                                goto connect;
+                        } else if (0 == ret) {
+                                is_locked = _gf_true;
+                        }
+                }
+                /* This means, pmap has the entry, remove it */
+                ret = pmap_registry_remove (this, 0, brickinfo->path,
+                                            GF_PMAP_PORT_BRICKSERVER, NULL);
+        }
+        unlink (pidfile);
+
+        gf_log ("", GF_LOG_INFO, "About to start glusterfs"
+                " for brick %s:%s", brickinfo->hostname,
+                brickinfo->path);
+        GLUSTERD_REMOVE_SLASH_FROM_PATH (brickinfo->path, exp_path);
+        snprintf (volfile, PATH_MAX, "%s.%s.%s", volinfo->volname,
+                  brickinfo->hostname, exp_path);
+
+        if (!brickinfo->logfile && volinfo->logdir) {
+                snprintf (logfile, PATH_MAX, "%s/%s.log", volinfo->logdir,
+                                                          exp_path);
+                brickinfo->logfile = gf_strdup (logfile);
+        } else if (!brickinfo->logfile) {
+                snprintf (logfile, PATH_MAX, "%s/bricks/%s.log",
+                          DEFAULT_LOG_FILE_DIRECTORY, exp_path);
+                brickinfo->logfile = gf_strdup (logfile);
+        }
+
+        port = brickinfo->port;
+        if (!port)
+                port = pmap_registry_alloc (THIS);
+
+        runinit (&runner);
+        runner_add_args (&runner, GFS_PREFIX"/sbin/glusterfsd",
+                         "-s", "localhost", "--volfile-id", volfile,
+                         "-p", pidfile, "-S", socketpath,
+                         "--brick-name", brickinfo->path,
+                         "-l", brickinfo->logfile, "--brick-port",  NULL);
+
+        if (volinfo->transport_type != GF_TRANSPORT_BOTH_TCP_RDMA) {
+                runner_argprintf (&runner, "%d", port);
+        } else {
+                rdma_port = brickinfo->rdma_port;
+                if (!rdma_port)
+                        rdma_port = pmap_registry_alloc (THIS);
+                runner_argprintf (&runner, "%d,%d", port, rdma_port);
+                runner_add_arg (&runner, "--xlator-option");
+                runner_argprintf (&runner, "%s-server.transport.rdma.listen-port=%d",
+                                  volinfo->volname, rdma_port);
+        }
+
+        runner_add_arg (&runner, "--xlator-option");
+        runner_argprintf (&runner, "%s-server.listen-port=%d",
+                          volinfo->volname, port);
+
+        runner_log (&runner, "", GF_LOG_DEBUG, "Starting GlusterFS");
+        if (pidp) {
+                ret = runner_start (&runner);
+                if (ret == 0)
+                        *pidp = runner_detach (&runner);
+                else
+                        runner_end (&runner);
+        } else {
+                ret = runner_run (&runner);
+        }
+
+        if (ret == 0) {
+                //pmap_registry_bind (THIS, port, brickinfo->path);
+                brickinfo->port = port;
+                brickinfo->rdma_port = rdma_port;
+                glusterd_brickinfo_hash (volinfo, brickinfo);
+        }
+
+connect:
+        ret = glusterd_brick_connect (volinfo, brickinfo);
+        if (ret)
+                goto out;
+out:
+        if (is_locked && file)
+                if (lockf (fileno (file), F_ULOCK, 0) < 0)
+                        gf_log ("", GF_LOG_WARNING, "Cannot unlock pidfile: %s"
+                                " reason: %s", pidfile, strerror(errno));
+        if (file)
+                fclose (file);
+        return ret;
+}
+
+int32_t
+glusterd_volume_start_glusterfs (glusterd_volinfo_t  *volinfo,
+                                 glusterd_brickinfo_t  *brickinfo)
+{
+        return glusterd_brick_launch (volinfo, brickinfo, NULL);
+}
+
+int32_t
+glusterd_brick_unlink_socket_file (glusterd_volinfo_t *volinfo,
+                                   glusterd_brickinfo_t *brickinfo)
+{
+        char                    path[PATH_MAX] = {0,};
+        char                    socketpath[PATH_MAX] = {0};
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        int                     ret = 0;
+
+        GF_ASSERT (volinfo);
+        GF_ASSERT (brickinfo);
+
+        this = THIS;
+        GF_ASSERT (this);
+
+        priv = this->private;
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+        glusterd_set_brick_socket_filepath (volinfo, brickinfo, socketpath,
+                                            sizeof (socketpath));
+        ret = unlink (socketpath);
+        if (ret && (ENOENT == errno)) {
+                ret = 0;
+        } else {
+                gf_log ("glusterd", GF_LOG_ERROR, "Failed to remove %s"
+                        " error: %s", socketpath, strerror (errno));
+        }
+
+        return ret;
+}
+
+int32_t
+glusterd_brick_disconnect (glusterd_brickinfo_t *brickinfo)
+{
+        GF_ASSERT (brickinfo);
+
+        if (brickinfo->rpc) {
+                rpc_clnt_unref (brickinfo->rpc);
+                brickinfo->rpc = NULL;
+        }
+        return 0;
+}
+
+int32_t
+glusterd_volume_stop_glusterfs (glusterd_volinfo_t  *volinfo,
+                                glusterd_brickinfo_t   *brickinfo)
+{
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        char                    pidfile[PATH_MAX] = {0,};
+        char                    path[PATH_MAX] = {0,};
+        int                     ret = 0;
+
+        GF_ASSERT (volinfo);
+        GF_ASSERT (brickinfo);
+
+        this = THIS;
+        GF_ASSERT (this);
+
+        priv = this->private;
+        (void) glusterd_brick_disconnect (brickinfo);
+
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+        GLUSTERD_GET_BRICK_PIDFILE (pidfile, path, brickinfo->hostname,
+                                    brickinfo->path);
+
+        ret = glusterd_service_stop ("brick", pidfile, SIGTERM, _gf_false);
+        if (ret == 0) {
+                glusterd_set_brick_status (brickinfo, GF_BRICK_STOPPED);
+                ret = glusterd_brick_unlink_socket_file (volinfo, brickinfo);
+        }
+        return ret;
+}
+
+int32_t
+glusterd_peer_hostname_new (char *hostname, glusterd_peer_hostname_t **name)
+{
+        glusterd_peer_hostname_t        *peer_hostname = NULL;
+        int32_t                         ret = -1;
+
+        GF_ASSERT (hostname);
+        GF_ASSERT (name);
+
+        peer_hostname = GF_CALLOC (1, sizeof (*peer_hostname),
+                                   gf_gld_mt_peer_hostname_t);
+
+        if (!peer_hostname)
+                goto out;
+
+        peer_hostname->hostname = gf_strdup (hostname);
+        INIT_LIST_HEAD (&peer_hostname->hostname_list);
+
+        *name = peer_hostname;
+        ret = 0;
+
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
+        return ret;
+}
+
+static locale_t         glusterd_collate_locale;
+static pthread_once_t   glusterd_collate_once = PTHREAD_ONCE_INIT;
+
+static void
+glusterd_collate_init (void)
+{
+        /* the collation a sort(1) started by us would pick up, LC_ALL,
+         * LC_COLLATE or LANG, byte order if that cannot be had */
+        glusterd_collate_locale = newlocale (LC_COLLATE_MASK, "",
+                                             (locale_t) 0);
+}
+
+static int
+glusterd_sort_line_cmp (const void *a, const void *b)
+{
+        const char      *l1 = *(const char **)a;
+        const char      *l2 = *(const char **)b;
+        int             ret = 0;
+
+        if (glusterd_collate_locale)
+                ret = strcoll_l (l1, l2, glusterd_collate_locale);
+        /* sort(1) breaks ties by comparing the bytes */
+        if (!ret)
+                ret = strcmp (l1, l2);
+
+        return ret;
+}
+
+/* Reads the file at path and returns its lines in the order sort(1) would
+ * give them, each ending in a newline, in *sortedp (*lenp bytes).
+ */
+static int
+glusterd_sort_file (char *path, char **sortedp, size_t *lenp)
+{
+        int             ret = -1;
+        int             fd = -1;
+        struct stat     stbuf = {0,};
+        char            *data = NULL;
+        char            *sorted = NULL;
+        char            **lines = NULL;
+        size_t          len = 0;
+        size_t          count = 0;
+        size_t          i = 0;
+        ssize_t         n = 0;
+        char            *pos = NULL;
+        char            *eol = NULL;
+
+        pthread_once (&glusterd_collate_once, glusterd_collate_init);
+
+        fd = open (path, O_RDONLY);
+        if (fd == -1) {
+                gf_log ("", GF_LOG_ERROR, "Unable to open %s (%s)", path,
+                        strerror (errno));
+                goto out;
+        }
+        if (fstat (fd, &stbuf))
+                goto out;
+
+        data = GF_MALLOC (stbuf.st_size + 1, gf_gld_mt_char);
+        if (!data)
+                goto out;
+        while (len < stbuf.st_size) {
+                n = read (fd, data + len, stbuf.st_size - len);
+                if (n <= 0)
+                        break;
+                len += n;
+        }
+        if (n < 0) {
+                gf_log ("", GF_LOG_ERROR, "Unable to read %s (%s)", path,
+                        strerror (errno));
+                goto out;
+        }
+        data[len] = '\0';
+
+        for (pos = data; pos < data + len; pos = eol + 1) {
+                eol = memchr (pos, '\n', data + len - pos);
+                if (!eol)
+                        break;
+                count++;
+        }
+        if (pos < data + len)
+                count++;
+
+        lines = GF_CALLOC (count + 1, sizeof (*lines), gf_gld_mt_char);
+        /* a last line without a newline gets one, as sort adds it */
+        sorted = GF_MALLOC (len + 2, gf_gld_mt_char);
+        if (!lines || !sorted)
+                goto out;
+
+        for (i = 0, pos = data; i < count; i++, pos = eol + 1) {
+                lines[i] = pos;
+                eol = memchr (pos, '\n', data + len - pos);
+                if (!eol)
+                        eol = data + len;
+                *eol = '\0';
+        }
+
+        qsort (lines, count, sizeof (*lines), glusterd_sort_line_cmp);
+
+        for (i = 0, pos = sorted; i < count; i++) {
+                n = strlen (lines[i]);
+                memcpy (pos, lines[i], n);
+                pos += n;
+                *pos++ = '\n';
+        }
+
+        *sortedp = sorted;
+        *lenp = pos - sorted;
+        sorted = NULL;
+        ret = 0;
+out:
+        if (fd != -1)
+                close (fd);
+        if (data)
+                GF_FREE (data);
+        if (lines)
+                GF_FREE (lines);
+        if (sorted)
+                GF_FREE (sorted);
+        return ret;
+}
+
+/* The checksum peers compare a volume by. It is what forking sort(1) on
+ * the info file gave: the checksum of the sorted info file, written into
+ * the cksum file, and the checksum of the cksum file taken over it.
+ */
+int
+glusterd_volume_compute_cksum (glusterd_volinfo_t  *volinfo)
+{
+        int32_t                 ret = -1;
+        glusterd_conf_t         *priv = NULL;
+        char                    path[PATH_MAX] = {0,};
+        char                    cksum_path[PATH_MAX] = {0,};
+        char                    filepath[PATH_MAX] = {0,};
+        int                     fd = -1;
+        uint32_t                cksum = 0;
+        char                    buf[4096] = {0,};
+        char                    *sorted = NULL;
+        size_t                  len = 0;
+
+        GF_ASSERT (volinfo);
+
+        priv = THIS->private;
+        GF_ASSERT (priv);
+
+        GLUSTERD_GET_VOLUME_DIR (path, volinfo, priv);
+
+        snprintf (filepath, sizeof (filepath), "%s/%s", path,
+                  GLUSTERD_VOLUME_INFO_FILE);
+        ret = glusterd_sort_file (filepath, &sorted, &len);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "failed to sort file %s",
+                        filepath);
+                goto out;
+        }
+        get_checksum_for_buf (sorted, len, &cksum);
+
+        snprintf (cksum_path, sizeof (cksum_path), "%s/%s",
+                  path, GLUSTERD_CKSUM_FILE);
+
+        fd = open (cksum_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (-1 == fd) {
+                gf_log ("", GF_LOG_ERROR, "Unable to open %s, errno: %d",
+                        cksum_path, errno);
+                ret = -1;
+                goto out;
+        }
+
+        snprintf (buf, sizeof (buf), "%s=%u\n", "info", cksum);
+        ret = write (fd, buf, strlen (buf));
+
+        if (ret <= 0) {
+                ret = -1;
+                goto out;
+        }
+
+        /* over what was just written into the cksum file */
+        get_checksum_for_buf (buf, strlen (buf), &cksum);
+
+        volinfo->cksum = cksum;
+        ret = 0;
+
+out:
+        if (fd > 0)
+               close (fd);
+        if (sorted)
+                GF_FREE (sorted);
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+
+        return ret;
+}
+
+void
+_add_volinfo_dict_to_prdict (dict_t *this, char *key, data_t *value, void *data)
+{
+        glusterd_voldict_ctx_t   *ctx = NULL;
+        char                    optkey[512] = {0,};
+        int                     ret = -1;
+
+        ctx = data;
+        snprintf (optkey, sizeof (optkey), "volume%d.%s%d", ctx->count,
+                  ctx->key_name, ctx->opt_count);
+        ret = dict_set_str (ctx->dict, optkey, key);
+        if (ret)
+                gf_log ("", GF_LOG_ERROR, "option add for %s%d %s",
+                        ctx->key_name, ctx->count, key);
+        snprintf (optkey, sizeof (optkey), "volume%d.%s%d", ctx->count,
+                  ctx->val_name, ctx->opt_count);
+        ret = dict_set_str (ctx->dict, optkey, value->data);
+        if (ret)
+                gf_log ("", GF_LOG_ERROR, "option add for %s%d %s",
+                        ctx->val_name, ctx->count, value->data);
+        ctx->opt_count++;
+
+        return;
+}
+
+int32_t
+glusterd_add_volume_to_dict (glusterd_volinfo_t *volinfo,
+                             dict_t  *dict, int32_t count)
+{
+        int32_t                 ret = -1;
+        char                    key[512] = {0,};
+        glusterd_brickinfo_t    *brickinfo = NULL;
+        int32_t                 i = 1;
+        char                    *volume_id_str = NULL;
+        glusterd_voldict_ctx_t   ctx = {0};
+
+        GF_ASSERT (dict);
+        GF_ASSERT (volinfo);
+
+        snprintf (key, sizeof (key), "volume%d.name", count);
+        ret = dict_set_str (dict, key, volinfo->volname);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.type", count);
+        ret = dict_set_int32 (dict, key, volinfo->type);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.brick_count", count);
+        ret = dict_set_int32 (dict, key, volinfo->brick_count);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.version", count);
+        ret = dict_set_int32 (dict, key, volinfo->version);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.status", count);
+        ret = dict_set_int32 (dict, key, volinfo->status);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.sub_count", count);
+        ret = dict_set_int32 (dict, key, volinfo->sub_count);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.ckusm", count);
+        ret = dict_set_int64 (dict, key, volinfo->cksum);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.transport_type", count);
+        ret = dict_set_uint32 (dict, key, volinfo->transport_type);
+        if (ret)
+                goto out;
 
         volume_id_str = gf_strdup (uuid_utoa (volinfo->volume_id));
         if (!volume_id_str)
                 goto out;
 
         memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.volume_id", count);
-        ret = dict_set_dynstr (dict, key, volume_id_str);
+        snprintf (key, sizeof (key), "volume%d.volume_id", count);
+        ret = dict_set_dynstr (dict, key, volume_id_str);
+        if (ret)
+                goto out;
+
+        ctx.dict = dict;
+        ctx.count = count;
+        ctx.opt_count = 1;
+        ctx.key_name = "key";
+        ctx.val_name = "value";
+        GF_ASSERT (volinfo->dict);
+
+        dict_foreach (volinfo->dict, _add_volinfo_dict_to_prdict, &ctx);
+        ctx.opt_count--;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.opt-count", count);
+        ret = dict_set_int32 (dict, key, ctx.opt_count);
+        if (ret)
+                goto out;
+
+        ctx.dict = dict;
+        ctx.count = count;
+        ctx.opt_count = 1;
+        ctx.key_name = "slave-num";
+        ctx.val_name = "slave-val";
+        GF_ASSERT (volinfo->gsync_slaves);
+
+        dict_foreach (volinfo->gsync_slaves, _add_volinfo_dict_to_prdict, &ctx);
+        ctx.opt_count--;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.gsync-count", count);
+        ret = dict_set_int32 (dict, key, ctx.opt_count);
+        if (ret)
+                goto out;
+
+        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "volume%d.brick%d.hostname",
+                          count, i);
+                ret = dict_set_str (dict, key, brickinfo->hostname);
+                if (ret)
+                        goto out;
+
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "volume%d.brick%d.path",
+                          count, i);
+                ret = dict_set_str (dict, key, brickinfo->path);
+                if (ret)
+                        goto out;
+
+                i++;
+        }
+
+
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+
+        return ret;
+}
+
+int32_t
+glusterd_build_volume_dict (dict_t **vols)
+{
+        int32_t                 ret = -1;
+        dict_t                  *dict = NULL;
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+        int32_t                 count = 0;
+
+        priv = THIS->private;
+
+        dict = dict_new ();
+
+        if (!dict)
+                goto out;
+
+        list_for_each_entry (volinfo, &priv->volumes, vol_list) {
+                count++;
+                ret = glusterd_add_volume_to_dict (volinfo, dict, count);
+                if (ret)
+                        goto out;
+        }
+
+
+        ret = dict_set_int32 (dict, "count", count);
+        if (ret)
+                goto out;
+
+        *vols = dict;
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        if (ret)
+                dict_unref (dict);
+
+        return ret;
+}
+
+/* Only the keys looked at by glusterd_compare_friend_volume are added, the
+ * peer asks for the volumes which differ with GD_FRIEND_UPDATE_VOLS_REQ.
+ */
+static int32_t
+glusterd_add_volume_summary_to_dict (glusterd_volinfo_t *volinfo,
+                                     dict_t *dict, int32_t count)
+{
+        int32_t                 ret = -1;
+        char                    key[512] = {0,};
+
+        GF_ASSERT (dict);
+        GF_ASSERT (volinfo);
+
+        snprintf (key, sizeof (key), "volume%d.name", count);
+        ret = dict_set_str (dict, key, volinfo->volname);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.version", count);
+        ret = dict_set_int32 (dict, key, volinfo->version);
+        if (ret)
+                goto out;
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.ckusm", count);
+        ret = dict_set_int64 (dict, key, volinfo->cksum);
+        if (ret)
+                goto out;
+
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+
+        return ret;
+}
+
+int32_t
+glusterd_build_volume_summary_dict (dict_t **vols)
+{
+        int32_t                 ret = -1;
+        dict_t                  *dict = NULL;
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+        int32_t                 count = 0;
+
+        priv = THIS->private;
+
+        dict = dict_new ();
+
+        if (!dict)
+                goto out;
+
+        list_for_each_entry (volinfo, &priv->volumes, vol_list) {
+                count++;
+                ret = glusterd_add_volume_summary_to_dict (volinfo, dict,
+                                                           count);
+                if (ret)
+                        goto out;
+        }
+
+        ret = dict_set_int32 (dict, "count", count);
+        if (ret)
+                goto out;
+
+        ret = dict_set_int32 (dict, "summary", 1);
+        if (ret)
+                goto out;
+
+        *vols = dict;
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        if (ret && dict)
+                dict_unref (dict);
+
+        return ret;
+}
+
+/* Builds the full volume dict for the volumes named in @wanted, in the
+ * format understood by glusterd_import_friend_volumes. Volumes which were
+ * deleted meanwhile are skipped.
+ */
+int32_t
+glusterd_build_wanted_volume_dict (dict_t *wanted, dict_t **vols)
+{
+        int32_t                 ret = -1;
+        dict_t                  *dict = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+        char                    key[512] = {0,};
+        char                    *volname = NULL;
+        int32_t                 wanted_count = 0;
+        int32_t                 count = 0;
+        int                     i = 1;
+
+        GF_ASSERT (wanted);
+        GF_ASSERT (vols);
+
+        ret = dict_get_int32 (wanted, "count", &wanted_count);
+        if (ret)
+                goto out;
+
+        dict = dict_new ();
+        if (!dict) {
+                ret = -1;
+                goto out;
+        }
+
+        for (i = 1; i <= wanted_count; i++) {
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "volume%d.name", i);
+                ret = dict_get_str (wanted, key, &volname);
+                if (ret)
+                        goto out;
+
+                ret = glusterd_volinfo_find (volname, &volinfo);
+                if (ret) {
+                        gf_log ("", GF_LOG_INFO, "Volume %s requested by peer"
+                                " does not exist", volname);
+                        continue;
+                }
+
+                count++;
+                ret = glusterd_add_volume_to_dict (volinfo, dict, count);
+                if (ret)
+                        goto out;
+        }
+
+        ret = dict_set_int32 (dict, "count", count);
+        if (ret)
+                goto out;
+
+        *vols = dict;
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        if (ret && dict)
+                dict_unref (dict);
+
+        return ret;
+}
+
+int32_t
+glusterd_compare_friend_volume (dict_t *vols, int32_t count, int32_t *status)
+{
+
+        int32_t                 ret = -1;
+        char                    key[512] = {0,};
+        glusterd_volinfo_t      *volinfo = NULL;
+        char                    *volname = NULL;
+        uint32_t                cksum = 0;
+        int32_t                 version = 0;
+
+        GF_ASSERT (vols);
+        GF_ASSERT (status);
+
+        snprintf (key, sizeof (key), "volume%d.name", count);
+        ret = dict_get_str (vols, key, &volname);
+        if (ret)
+                goto out;
+
+        ret = glusterd_volinfo_find (volname, &volinfo);
+
+        if (ret) {
+                *status = GLUSTERD_VOL_COMP_UPDATE_REQ;
+                ret = 0;
+                goto out;
+        }
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.version", count);
+        ret = dict_get_int32 (vols, key, &version);
+        if (ret)
+                goto out;
+
+        if (version > volinfo->version) {
+                //Mismatch detected
+                ret = 0;
+                gf_log ("", GF_LOG_ERROR, "Version of volume %s differ."
+                        "local version = %d, remote version = %d",
+                        volinfo->volname, volinfo->version, version);
+                *status = GLUSTERD_VOL_COMP_UPDATE_REQ;
+                goto out;
+        } else if (version < volinfo->version) {
+		*status = GLUSTERD_VOL_COMP_SCS;
+		goto out;
+	}
+
+        //Now, versions are same, compare cksums.
+        //
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.ckusm", count);
+        ret = dict_get_uint32 (vols, key, &cksum);
+        if (ret)
+                goto out;
+
+        if (cksum != volinfo->cksum) {
+                ret = 0;
+                gf_log ("", GF_LOG_ERROR, "Cksums of volume %s differ."
+                        " local cksum = %d, remote cksum = %d",
+                        volinfo->volname, volinfo->cksum, cksum);
+                *status = GLUSTERD_VOL_COMP_RJT;
+                goto out;
+        }
+
+        *status = GLUSTERD_VOL_COMP_SCS;
+
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with ret: %d, status: %d",
+                ret, *status);
+        return ret;
+}
+
+static int32_t
+import_prdict_volinfo_dict (dict_t *vols, dict_t  *dst_dict, char *key_prefix,
+                            char *value_prefix, int opt_count, int count)
+{
+        char                    key[512] = {0,};
+        int32_t                 ret = 0;
+        int                     i = 1;
+        char                    *opt_key = NULL;
+        char                    *opt_val = NULL;
+        char                    *dup_opt_val = NULL;
+        char                    msg[2048] = {0};
+
+        while (i <= opt_count) {
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "volume%d.%s%d",
+                          count, key_prefix, i);
+                ret = dict_get_str (vols, key, &opt_key);
+                if (ret) {
+                        snprintf (msg, sizeof (msg), "Volume dict key not "
+                                  "specified");
+                        goto out;
+                }
+
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "volume%d.%s%d",
+                          count, value_prefix, i);
+                ret = dict_get_str (vols, key, &opt_val);
+                if (ret) {
+                        snprintf (msg, sizeof (msg), "Volume dict value not "
+                                  "specified");
+                        goto out;
+                }
+                dup_opt_val = gf_strdup (opt_val);
+                if (!dup_opt_val) {
+                        ret = -1;
+                        goto out;
+                }
+                ret = dict_set_dynstr (dst_dict, opt_key, dup_opt_val);
+                if (ret) {
+                        snprintf (msg, sizeof (msg), "Volume set %s %s "
+                                  "unsuccessful", opt_key, dup_opt_val);
+                        goto out;
+                }
+                i++;
+        }
+
+out:
+        if (msg[0])
+                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        return ret;
+
+}
+
+int32_t
+glusterd_import_friend_volume_opts (dict_t *vols, int count,
+                                    glusterd_volinfo_t *volinfo)
+{
+        char                    key[512] = {0,};
+        int32_t                 ret = -1;
+        int                     opt_count = 0;
+        char                    msg[2048] = {0};
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.opt-count", count);
+        ret = dict_get_int32 (vols, key, &opt_count);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "Volume option count not "
+                          "specified for %s", volinfo->volname);
+                goto out;
+        }
+
+        ret = import_prdict_volinfo_dict (vols, volinfo->dict, "key",
+                                          "value", opt_count, count);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "Unable to import options dict "
+                          "specified for %s", volinfo->volname);
+                goto out;
+        }
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.gsync-count", count);
+        ret = dict_get_int32 (vols, key, &opt_count);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "Gsync count not "
+                          "specified for %s", volinfo->volname);
+                goto out;
+        }
+
+        ret = import_prdict_volinfo_dict (vols, volinfo->gsync_slaves,
+                                          "slave-num", "slave-val", opt_count,
+                                          count);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "Unable to import gsync sessions "
+                          "specified for %s", volinfo->volname);
+                goto out;
+        }
+
+out:
+        if (msg[0])
+                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        return ret;
+}
+
+int32_t
+glusterd_import_new_brick (dict_t *vols, int32_t vol_count,
+                           int32_t brick_count,
+                           glusterd_brickinfo_t **brickinfo)
+{
+        char                    key[512] = {0,};
+        int                     ret = -1;
+        char                    *hostname = NULL;
+        char                    *path = NULL;
+        glusterd_brickinfo_t    *new_brickinfo = NULL;
+        char                    msg[2048] = {0};
+
+        GF_ASSERT (vols);
+        GF_ASSERT (vol_count >= 0);
+        GF_ASSERT (brickinfo);
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.brick%d.hostname",
+                  vol_count, brick_count);
+        ret = dict_get_str (vols, key, &hostname);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload", key);
+                goto out;
+        }
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.brick%d.path",
+                  vol_count, brick_count);
+        ret = dict_get_str (vols, key, &path);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload", key);
+                goto out;
+        }
+
+        ret = glusterd_brickinfo_new (&new_brickinfo);
         if (ret)
                 goto out;
 
-        ctx.dict = dict;
-        ctx.count = count;
-        ctx.opt_count = 1;
-        ctx.key_name = "key";
-        ctx.val_name = "value";
-        GF_ASSERT (volinfo->dict);
+        strcpy (new_brickinfo->path, path);
+        strcpy (new_brickinfo->hostname, hostname);
+        //peerinfo might not be added yet
+        (void) glusterd_resolve_brick (new_brickinfo);
+        ret = 0;
+        *brickinfo = new_brickinfo;
+out:
+        if (msg[0])
+                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        return ret;
+}
 
-        dict_foreach (volinfo->dict, _add_volinfo_dict_to_prdict, &ctx);
-        ctx.opt_count--;
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.opt-count", count);
-        ret = dict_set_int32 (dict, key, ctx.opt_count);
+int32_t
+glusterd_import_bricks (dict_t *vols, int32_t vol_count,
+                        glusterd_volinfo_t *new_volinfo)
+{
+        int                     ret = -1;
+        int                     brick_count = 1;
+        glusterd_brickinfo_t     *new_brickinfo = NULL;
+
+        GF_ASSERT (vols);
+        GF_ASSERT (vol_count >= 0);
+        GF_ASSERT (new_volinfo);
+        while (brick_count <= new_volinfo->brick_count) {
+
+                ret = glusterd_import_new_brick (vols, vol_count, brick_count,
+                                                 &new_brickinfo);
+                if (ret)
+                        goto out;
+                list_add_tail (&new_brickinfo->brick_list, &new_volinfo->bricks);
+                brick_count++;
+        }
+        ret = 0;
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        return ret;
+}
+
+int32_t
+glusterd_import_volinfo (dict_t *vols, int count,
+                         glusterd_volinfo_t **volinfo)
+{
+        int                ret = -1;
+        char               key[256] = {0};
+        char               *volname = NULL;
+        glusterd_volinfo_t *new_volinfo = NULL;
+        char               *volume_id_str = NULL;
+        char                    msg[2048] = {0};
+
+        GF_ASSERT (vols);
+        GF_ASSERT (volinfo);
+
+        snprintf (key, sizeof (key), "volume%d.name", count);
+        ret = dict_get_str (vols, key, &volname);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload", key);
+                goto out;
+        }
+
+        ret = glusterd_volinfo_new (&new_volinfo);
         if (ret)
                 goto out;
+        strncpy (new_volinfo->volname, volname, sizeof (new_volinfo->volname));
 
-        ctx.dict = dict;
-        ctx.count = count;
-        ctx.opt_count = 1;
-        ctx.key_name = "slave-num";
-        ctx.val_name = "slave-val";
-        GF_ASSERT (volinfo->gsync_slaves);
 
-        dict_foreach (volinfo->gsync_slaves, _add_volinfo_dict_to_prdict, &ctx);
-        ctx.opt_count--;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.type", count);
+        ret = dict_get_int32 (vols, key, &new_volinfo->type);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
+                goto out;
+        }
 
         memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.gsync-count", count);
-        ret = dict_set_int32 (dict, key, ctx.opt_count);
-        if (ret)
+        snprintf (key, sizeof (key), "volume%d.brick_count", count);
+        ret = dict_get_int32 (vols, key, &new_volinfo->brick_count);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
                 goto out;
+        }
 
-        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
-                memset (key, 0, sizeof (key));
-                snprintf (key, sizeof (key), "volume%d.brick%d.hostname",
-                          count, i);
-                ret = dict_set_str (dict, key, brickinfo->hostname);
-                if (ret)
-                        goto out;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.version", count);
+        ret = dict_get_int32 (vols, key, &new_volinfo->version);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
+                goto out;
+        }
 
-                memset (key, 0, sizeof (key));
-                snprintf (key, sizeof (key), "volume%d.brick%d.path",
-                          count, i);
-                ret = dict_set_str (dict, key, brickinfo->path);
-                if (ret)
-                        goto out;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.status", count);
+        ret = dict_get_int32 (vols, key, (int32_t *)&new_volinfo->status);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
+                goto out;
+        }
 
-                i++;
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.sub_count", count);
+        ret = dict_get_int32 (vols, key, &new_volinfo->sub_count);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
+                goto out;
+        }
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.ckusm", count);
+        ret = dict_get_uint32 (vols, key, &new_volinfo->cksum);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
+                goto out;
+        }
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.volume_id", count);
+        ret = dict_get_str (vols, key, &volume_id_str);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
+                goto out;
+        }
+
+        memset (key, 0, sizeof (key));
+        snprintf (key, sizeof (key), "volume%d.transport_type", count);
+        ret = dict_get_uint32 (vols, key, &new_volinfo->transport_type);
+        if (ret) {
+                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
+                          key, volname);
+                goto out;
         }
 
+        uuid_parse (volume_id_str, new_volinfo->volume_id);
 
+        ret = glusterd_import_friend_volume_opts (vols, count, new_volinfo);
+        if (ret)
+                goto out;
+        ret = glusterd_import_bricks (vols, count, new_volinfo);
+        if (ret)
+                goto out;
+        *volinfo = new_volinfo;
 out:
+        if (msg[0])
+                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        return ret;
+}
+
+int32_t
+glusterd_volinfo_stop_stale_bricks (glusterd_volinfo_t *new_volinfo,
+                                    glusterd_volinfo_t *old_volinfo)
+{
+        glusterd_brickinfo_t *new_brickinfo = NULL;
+        glusterd_brickinfo_t *old_brickinfo = NULL;
 
+        int             ret = 0;
+        GF_ASSERT (new_volinfo);
+        GF_ASSERT (old_volinfo);
+        if (_gf_false == glusterd_is_volume_started (old_volinfo))
+                goto out;
+        list_for_each_entry (old_brickinfo, &old_volinfo->bricks, brick_list) {
+                ret = glusterd_volume_brickinfo_get (old_brickinfo->uuid,
+                                                     old_brickinfo->hostname,
+                                                     old_brickinfo->path,
+                                                     new_volinfo, &new_brickinfo);
+                if (ret) {
+                        ret = glusterd_brick_stop (old_volinfo, old_brickinfo);
+                        if (ret)
+                                gf_log ("glusterd", GF_LOG_ERROR, "Failed to "
+                                        "stop brick %s:%s", old_brickinfo->hostname,
+                                        old_brickinfo->path);
+                }
+        }
+        ret = 0;
+out:
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
 
+/* Updates @volinfo with the configuration imported in @new_volinfo without
+ * replacing it, so that bricks present in both keep their port, rpc and
+ * running process. Bricks which are no longer part of the volume are stopped
+ * and deleted. @new_volinfo is consumed.
+ */
 int32_t
-glusterd_build_volume_dict (dict_t **vols)
+glusterd_volinfo_update_in_place (glusterd_volinfo_t *volinfo,
+                                  glusterd_volinfo_t *new_volinfo)
 {
-        int32_t                 ret = -1;
-        dict_t                  *dict = NULL;
-        glusterd_conf_t         *priv = NULL;
-        glusterd_volinfo_t      *volinfo = NULL;
-        int32_t                 count = 0;
+        int32_t                 ret = 0;
+        glusterd_brickinfo_t    *brickinfo = NULL;
+        glusterd_brickinfo_t    *new_brickinfo = NULL;
+        glusterd_brickinfo_t    *tmp = NULL;
+        dict_t                  *dict = NULL;
+        struct list_head        bricks;
 
-        priv = THIS->private;
+        GF_ASSERT (volinfo);
+        GF_ASSERT (new_volinfo);
 
-        dict = dict_new ();
+        if (glusterd_is_volume_started (volinfo)) {
+                if (glusterd_is_volume_started (new_volinfo))
+                        (void) glusterd_volinfo_stop_stale_bricks (new_volinfo,
+                                                                   volinfo);
+                else
+                        (void) glusterd_stop_bricks (volinfo);
+        }
 
-        if (!dict)
-                goto out;
+        /* Rebuild the brick list in the order of the imported volume,
+         * reusing the bricks we already know about.
+         */
+        INIT_LIST_HEAD (&bricks);
+        list_for_each_entry_safe (new_brickinfo, tmp, &new_volinfo->bricks,
+                                  brick_list) {
+                ret = glusterd_volume_brickinfo_get (new_brickinfo->uuid,
+                                                     new_brickinfo->hostname,
+                                                     new_brickinfo->path,
+                                                     volinfo, &brickinfo);
+                if (0 == ret) {
+                        list_move_tail (&brickinfo->brick_list, &bricks);
+                        glusterd_brickinfo_delete (new_brickinfo);
+                } else {
+                        list_move_tail (&new_brickinfo->brick_list, &bricks);
+                }
+        }
 
-        list_for_each_entry (volinfo, &priv->volumes, vol_list) {
-                count++;
-                ret = glusterd_add_volume_to_dict (volinfo, dict, count);
-                if (ret)
-                        goto out;
+        list_for_each_entry_safe (brickinfo, tmp, &volinfo->bricks,
+                                  brick_list) {
+                (void) glusterd_brick_disconnect (brickinfo);
+                (void) glusterd_delete_brick (volinfo, brickinfo);
         }
+        list_splice_init (&bricks, &volinfo->bricks);
+        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list)
+                glusterd_brickinfo_hash (volinfo, brickinfo);
 
+        volinfo->type = new_volinfo->type;
+        volinfo->brick_count = new_volinfo->brick_count;
+        volinfo->version = new_volinfo->version;
+        volinfo->status = new_volinfo->status;
+        volinfo->sub_count = new_volinfo->sub_count;
+        volinfo->cksum = new_volinfo->cksum;
+        volinfo->transport_type = new_volinfo->transport_type;
+        uuid_copy (volinfo->volume_id, new_volinfo->volume_id);
 
-        ret = dict_set_int32 (dict, "count", count);
-        if (ret)
-                goto out;
+        dict = volinfo->dict;
+        volinfo->dict = new_volinfo->dict;
+        new_volinfo->dict = dict;
 
-        *vols = dict;
-out:
-        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
-        if (ret)
-                dict_unref (dict);
+        dict = volinfo->gsync_slaves;
+        volinfo->gsync_slaves = new_volinfo->gsync_slaves;
+        new_volinfo->gsync_slaves = dict;
 
+        ret = glusterd_volinfo_delete (new_volinfo);
+
+        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
 
 int32_t
-glusterd_compare_friend_volume (dict_t *vols, int32_t count, int32_t *status)
+glusterd_import_friend_volume (dict_t *vols, size_t count)
 {
 
         int32_t                 ret = -1;
-        char                    key[512] = {0,};
+        glusterd_conf_t         *priv = NULL;
+        xlator_t                *this = NULL;
+        glusterd_volinfo_t      *old_volinfo = NULL;
+        glusterd_volinfo_t      *new_volinfo = NULL;
         glusterd_volinfo_t      *volinfo = NULL;
-        char                    *volname = NULL;
-        uint32_t                cksum = 0;
-        int32_t                 version = 0;
 
         GF_ASSERT (vols);
-        GF_ASSERT (status);
 
-        snprintf (key, sizeof (key), "volume%d.name", count);
-        ret = dict_get_str (vols, key, &volname);
+        this = THIS;
+        GF_ASSERT (this);
+        priv = this->private;
+        GF_ASSERT (priv);
+        ret = glusterd_import_volinfo (vols, count, &new_volinfo);
         if (ret)
                 goto out;
 
-        ret = glusterd_volinfo_find (volname, &volinfo);
-
-        if (ret) {
-                *status = GLUSTERD_VOL_COMP_UPDATE_REQ;
-                ret = 0;
-                goto out;
+        ret = glusterd_volinfo_find (new_volinfo->volname, &old_volinfo);
+        if (0 == ret) {
+                (void) glusterd_volinfo_update_in_place (old_volinfo,
+                                                         new_volinfo);
+                volinfo = old_volinfo;
+        } else {
+                volinfo = new_volinfo;
         }
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.version", count);
-        ret = dict_get_int32 (vols, key, &version);
-        if (ret)
-                goto out;
-
-        if (version > volinfo->version) {
-                //Mismatch detected
-                ret = 0;
-                gf_log ("", GF_LOG_ERROR, "Version of volume %s differ."
-                        "local version = %d, remote version = %d",
-                        volinfo->volname, volinfo->version, version);
-                *status = GLUSTERD_VOL_COMP_UPDATE_REQ;
-                goto out;
-        } else if (version < volinfo->version) {
-		*status = GLUSTERD_VOL_COMP_SCS;
-		goto out;
-	}
+        if (glusterd_is_volume_started (volinfo)) {
+                (void) glusterd_start_bricks (volinfo);
+        }
 
-        //Now, versions are same, compare cksums.
-        //
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.ckusm", count);
-        ret = dict_get_uint32 (vols, key, &cksum);
+        ret = glusterd_store_volinfo (volinfo, GLUSTERD_VOLINFO_VER_AC_NONE);
+        ret = glusterd_create_volfiles_and_notify_services (volinfo);
         if (ret)
                 goto out;
 
-        if (cksum != volinfo->cksum) {
-                ret = 0;
-                gf_log ("", GF_LOG_ERROR, "Cksums of volume %s differ."
-                        " local cksum = %d, remote cksum = %d",
-                        volinfo->volname, volinfo->cksum, cksum);
-                *status = GLUSTERD_VOL_COMP_RJT;
-                goto out;
+        if (volinfo == new_volinfo) {
+                glusterd_volinfo_list_add (new_volinfo);
         }
-
-        *status = GLUSTERD_VOL_COMP_SCS;
-
 out:
-        gf_log ("", GF_LOG_DEBUG, "Returning with ret: %d, status: %d",
-                ret, *status);
+        gf_log ("", GF_LOG_DEBUG, "Returning with ret: %d", ret);
         return ret;
 }
 
-static int32_t
-import_prdict_volinfo_dict (dict_t *vols, dict_t  *dst_dict, char *key_prefix,
-                            char *value_prefix, int opt_count, int count)
+int32_t
+glusterd_import_friend_volumes (dict_t  *vols)
 {
-        char                    key[512] = {0,};
-        int32_t                 ret = 0;
+        int32_t                 ret = -1;
+        int32_t                 count = 0;
         int                     i = 1;
-        char                    *opt_key = NULL;
-        char                    *opt_val = NULL;
-        char                    *dup_opt_val = NULL;
-        char                    msg[2048] = {0};
 
-        while (i <= opt_count) {
-                memset (key, 0, sizeof (key));
-                snprintf (key, sizeof (key), "volume%d.%s%d",
-                          count, key_prefix, i);
-                ret = dict_get_str (vols, key, &opt_key);
-                if (ret) {
-                        snprintf (msg, sizeof (msg), "Volume dict key not "
-                                  "specified");
-                        goto out;
-                }
+        GF_ASSERT (vols);
 
-                memset (key, 0, sizeof (key));
-                snprintf (key, sizeof (key), "volume%d.%s%d",
-                          count, value_prefix, i);
-                ret = dict_get_str (vols, key, &opt_val);
-                if (ret) {
-                        snprintf (msg, sizeof (msg), "Volume dict value not "
-                                  "specified");
-                        goto out;
-                }
-                dup_opt_val = gf_strdup (opt_val);
-                if (!dup_opt_val) {
-                        ret = -1;
-                        goto out;
-                }
-                ret = dict_set_dynstr (dst_dict, opt_key, dup_opt_val);
-                if (ret) {
-                        snprintf (msg, sizeof (msg), "Volume set %s %s "
-                                  "unsuccessful", opt_key, dup_opt_val);
-                        goto out;
-                }
+        ret = dict_get_int32 (vols, "count", &count);
+        if (ret)
+                goto out;
+
+        glusterd_store_batch_begin ();
+        while (i <= count) {
+                ret = glusterd_import_friend_volume (vols, i);
+                if (ret)
+                        break;
                 i++;
         }
+        if (glusterd_store_batch_commit () && !ret)
+                ret = -1;
 
 out:
-        if (msg[0])
-                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
-
 }
 
 int32_t
-glusterd_import_friend_volume_opts (dict_t *vols, int count,
-                                    glusterd_volinfo_t *volinfo)
+glusterd_import_friend_volumes_update_nfs (dict_t *vols)
 {
-        char                    key[512] = {0,};
         int32_t                 ret = -1;
-        int                     opt_count = 0;
-        char                    msg[2048] = {0};
-
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.opt-count", count);
-        ret = dict_get_int32 (vols, key, &opt_count);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "Volume option count not "
-                          "specified for %s", volinfo->volname);
-                goto out;
-        }
-
-        ret = import_prdict_volinfo_dict (vols, volinfo->dict, "key",
-                                          "value", opt_count, count);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "Unable to import options dict "
-                          "specified for %s", volinfo->volname);
-                goto out;
-        }
+        gf_boolean_t            stale_nfs = _gf_false;
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.gsync-count", count);
-        ret = dict_get_int32 (vols, key, &opt_count);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "Gsync count not "
-                          "specified for %s", volinfo->volname);
-                goto out;
-        }
+        GF_ASSERT (vols);
 
-        ret = import_prdict_volinfo_dict (vols, volinfo->gsync_slaves,
-                                          "slave-num", "slave-val", opt_count,
-                                          count);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "Unable to import gsync sessions "
-                          "specified for %s", volinfo->volname);
+        if (glusterd_is_nfs_started ())
+                stale_nfs = _gf_true;
+        ret = glusterd_import_friend_volumes (vols);
+        if (ret)
                 goto out;
+        if (_gf_false == glusterd_are_all_volumes_stopped ()) {
+                ret = glusterd_check_generate_start_nfs ();
+        } else {
+                if (stale_nfs)
+                        glusterd_nfs_server_stop ();
         }
 
 out:
-        if (msg[0])
-                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
 
-int32_t
-glusterd_import_new_brick (dict_t *vols, int32_t vol_count,
-                           int32_t brick_count,
-                           glusterd_brickinfo_t **brickinfo)
+static int32_t
+glusterd_add_wanted_volume (dict_t *vols, int32_t count, dict_t *wanted,
+                            int32_t wanted_count)
 {
+        int32_t                 ret = -1;
         char                    key[512] = {0,};
-        int                     ret = -1;
-        char                    *hostname = NULL;
-        char                    *path = NULL;
-        glusterd_brickinfo_t    *new_brickinfo = NULL;
-        char                    msg[2048] = {0};
-
-        GF_ASSERT (vols);
-        GF_ASSERT (vol_count >= 0);
-        GF_ASSERT (brickinfo);
+        char                    *volname = NULL;
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.brick%d.hostname",
-                  vol_count, brick_count);
-        ret = dict_get_str (vols, key, &hostname);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload", key);
+        snprintf (key, sizeof (key), "volume%d.name", count);
+        ret = dict_get_str (vols, key, &volname);
+        if (ret)
                 goto out;
-        }
 
         memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.brick%d.path",
-                  vol_count, brick_count);
-        ret = dict_get_str (vols, key, &path);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload", key);
-                goto out;
-        }
-
-        ret = glusterd_brickinfo_new (&new_brickinfo);
+        snprintf (key, sizeof (key), "volume%d.name", wanted_count);
+        ret = dict_set_dynstr (wanted, key, gf_strdup (volname));
         if (ret)
                 goto out;
 
-        strcpy (new_brickinfo->path, path);
-        strcpy (new_brickinfo->hostname, hostname);
-        //peerinfo might not be added yet
-        (void) glusterd_resolve_brick (new_brickinfo);
-        ret = 0;
-        *brickinfo = new_brickinfo;
+        ret = dict_set_int32 (wanted, "count", wanted_count);
 out:
-        if (msg[0])
-                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
-        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
 
+/* If @vols is a summary (see glusterd_build_volume_summary_dict), the volumes
+ * needing an update are not imported here, their names are returned in
+ * @wanted instead so that they can be requested from the peer.
+ */
 int32_t
-glusterd_import_bricks (dict_t *vols, int32_t vol_count,
-                        glusterd_volinfo_t *new_volinfo)
+glusterd_compare_friend_data (dict_t  *vols, int32_t *status,
+                              dict_t **wanted)
 {
-        int                     ret = -1;
-        int                     brick_count = 1;
-        glusterd_brickinfo_t     *new_brickinfo = NULL;
+        int32_t                 ret = -1;
+        int32_t                 count = 0;
+        int32_t                 wanted_count = 0;
+        int                     i = 1;
+        gf_boolean_t            update = _gf_false;
+        gf_boolean_t            summary = _gf_false;
+        dict_t                  *wanted_dict = NULL;
 
         GF_ASSERT (vols);
-        GF_ASSERT (vol_count >= 0);
-        GF_ASSERT (new_volinfo);
-        while (brick_count <= new_volinfo->brick_count) {
+        GF_ASSERT (status);
+        GF_ASSERT (wanted);
+
+        ret = dict_get_int32 (vols, "count", &count);
+        if (ret)
+                goto out;
 
-                ret = glusterd_import_new_brick (vols, vol_count, brick_count,
-                                                 &new_brickinfo);
+        if (dict_get (vols, "summary"))
+                summary = _gf_true;
+
+        while (i <= count) {
+                ret = glusterd_compare_friend_volume (vols, i, status);
                 if (ret)
                         goto out;
-                list_add_tail (&new_brickinfo->brick_list, &new_volinfo->bricks);
-                brick_count++;
+
+                if (GLUSTERD_VOL_COMP_RJT == *status) {
+                        ret = 0;
+                        goto out;
+                }
+                if (GLUSTERD_VOL_COMP_UPDATE_REQ == *status) {
+                        update = _gf_true;
+                        if (summary) {
+                                if (!wanted_dict)
+                                        wanted_dict = dict_new ();
+                                if (!wanted_dict) {
+                                        ret = -1;
+                                        goto out;
+                                }
+                                ret = glusterd_add_wanted_volume (vols, i,
+                                                                  wanted_dict,
+                                                                  ++wanted_count);
+                                if (ret)
+                                        goto out;
+                        }
+                }
+
+                i++;
         }
-        ret = 0;
+
+        if (update && !summary)
+                ret = glusterd_import_friend_volumes_update_nfs (vols);
+
+        if (!ret && wanted_dict) {
+                gf_log ("", GF_LOG_INFO, "%d of %d volumes differ from peer",
+                        wanted_count, count);
+                *wanted = wanted_dict;
+                wanted_dict = NULL;
+        }
+
 out:
-        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
+        if (wanted_dict)
+                dict_unref (wanted_dict);
+        gf_log ("", GF_LOG_DEBUG, "Returning with ret: %d, status: %d",
+                ret, *status);
+
         return ret;
 }
 
-int32_t
-glusterd_import_volinfo (dict_t *vols, int count,
-                         glusterd_volinfo_t **volinfo)
+gf_boolean_t
+glusterd_is_nfs_started ()
 {
-        int                ret = -1;
-        char               key[256] = {0};
-        char               *volname = NULL;
-        glusterd_volinfo_t *new_volinfo = NULL;
-        char               *volume_id_str = NULL;
-        char                    msg[2048] = {0};
+        int32_t                 ret = -1;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        char                    pidfile[PATH_MAX] = {0,};
 
-        GF_ASSERT (vols);
-        GF_ASSERT (volinfo);
+        this = THIS;
+        GF_ASSERT(this);
 
-        snprintf (key, sizeof (key), "volume%d.name", count);
-        ret = dict_get_str (vols, key, &volname);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload", key);
-                goto out;
-        }
+        priv = this->private;
 
-        ret = glusterd_volinfo_new (&new_volinfo);
-        if (ret)
-                goto out;
-        strncpy (new_volinfo->volname, volname, sizeof (new_volinfo->volname));
+        GLUSTERD_GET_NFS_PIDFILE(pidfile);
+        ret = access (pidfile, F_OK);
 
+        if (ret == 0)
+                return _gf_true;
+        else
+                return _gf_false;
+}
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.type", count);
-        ret = dict_get_int32 (vols, key, &new_volinfo->type);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
-                goto out;
-        }
+int32_t
+glusterd_nfs_server_start ()
+{
+        int32_t                 ret = -1;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        char                    pidfile[PATH_MAX] = {0,};
+        char                    logfile[PATH_MAX] = {0,};
+        char                    volfile[PATH_MAX] = {0,};
+        char                    path[PATH_MAX] = {0,};
+        char                    rundir[PATH_MAX] = {0,};
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.brick_count", count);
-        ret = dict_get_int32 (vols, key, &new_volinfo->brick_count);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
-                goto out;
-        }
+        this = THIS;
+        GF_ASSERT(this);
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.version", count);
-        ret = dict_get_int32 (vols, key, &new_volinfo->version);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
-                goto out;
-        }
+        priv = this->private;
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.status", count);
-        ret = dict_get_int32 (vols, key, (int32_t *)&new_volinfo->status);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
-                goto out;
-        }
+        GLUSTERD_GET_NFS_DIR(path, priv);
+        snprintf (rundir, PATH_MAX, "%s/run", path);
+        ret = mkdir (rundir, 0777);
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.sub_count", count);
-        ret = dict_get_int32 (vols, key, &new_volinfo->sub_count);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
+        if ((ret == -1) && (EEXIST != errno)) {
+                gf_log ("", GF_LOG_ERROR, "Unable to create rundir %s",
+                        rundir);
                 goto out;
         }
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.ckusm", count);
-        ret = dict_get_uint32 (vols, key, &new_volinfo->cksum);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
-                goto out;
-        }
+        GLUSTERD_GET_NFS_PIDFILE(pidfile);
+        glusterd_get_nfs_filepath (volfile);
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.volume_id", count);
-        ret = dict_get_str (vols, key, &volume_id_str);
+        ret = access (volfile, F_OK);
         if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
+                gf_log ("", GF_LOG_ERROR, "Nfs Volfile %s is not present",
+                        volfile);
                 goto out;
         }
 
-        memset (key, 0, sizeof (key));
-        snprintf (key, sizeof (key), "volume%d.transport_type", count);
-        ret = dict_get_uint32 (vols, key, &new_volinfo->transport_type);
-        if (ret) {
-                snprintf (msg, sizeof (msg), "%s missing in payload for %s",
-                          key, volname);
-                goto out;
-        }
+        snprintf (logfile, PATH_MAX, "%s/nfs.log", DEFAULT_LOG_FILE_DIRECTORY);
 
-        uuid_parse (volume_id_str, new_volinfo->volume_id);
+        ret = runcmd (GFS_PREFIX"/sbin/glusterfs", "-f", volfile,
+                      "-p", pidfile, "-l", logfile, NULL);
 
-        ret = glusterd_import_friend_volume_opts (vols, count, new_volinfo);
-        if (ret)
-                goto out;
-        ret = glusterd_import_bricks (vols, count, new_volinfo);
-        if (ret)
-                goto out;
-        *volinfo = new_volinfo;
 out:
-        if (msg[0])
-                gf_log ("glusterd", GF_LOG_ERROR, "%s", msg);
-        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
 
-int32_t
-glusterd_volume_disconnect_all_bricks (glusterd_volinfo_t *volinfo)
+void
+glusterd_nfs_pmap_deregister ()
 {
-        int                  ret = 0;
-        glusterd_brickinfo_t *brickinfo = NULL;
-        GF_ASSERT (volinfo);
+        if (pmap_unset (MOUNT_PROGRAM, MOUNTV3_VERSION))
+                gf_log ("", GF_LOG_INFO, "De-registered MOUNTV3 successfully");
+        else
+                gf_log ("", GF_LOG_ERROR, "De-register MOUNTV3 is unsuccessful");
 
-        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
-                if (glusterd_is_brick_started (brickinfo)) {
-                        ret = glusterd_brick_disconnect (brickinfo);
-                        if (ret) {
-                                gf_log ("glusterd", GF_LOG_ERROR, "Failed to "
-                                        "disconnect %s:%s", brickinfo->hostname,
-                                        brickinfo->path);
-                                break;
-                        }
-                }
-        }
+        if (pmap_unset (MOUNT_PROGRAM, MOUNTV1_VERSION))
+                gf_log ("", GF_LOG_INFO, "De-registered MOUNTV1 successfully");
+        else
+                gf_log ("", GF_LOG_ERROR, "De-register MOUNTV1 is unsuccessful");
+
+        if (pmap_unset (NFS_PROGRAM, NFSV3_VERSION))
+                gf_log ("", GF_LOG_INFO, "De-registered NFSV3 successfully");
+        else
+                gf_log ("", GF_LOG_ERROR, "De-register NFSV3 is unsuccessful");
 
-        return ret;
 }
 
 int32_t
-glusterd_volinfo_copy_brick_portinfo (glusterd_volinfo_t *new_volinfo,
-                                      glusterd_volinfo_t *old_volinfo)
+glusterd_nfs_server_stop ()
 {
-        glusterd_brickinfo_t *new_brickinfo = NULL;
-        glusterd_brickinfo_t *old_brickinfo = NULL;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        char                    pidfile[PATH_MAX] = {0,};
+        char                    path[PATH_MAX] = {0,};
 
-        int             ret = 0;
-        GF_ASSERT (new_volinfo);
-        GF_ASSERT (old_volinfo);
-        if (_gf_false == glusterd_is_volume_started (new_volinfo))
-                goto out;
-        list_for_each_entry (new_brickinfo, &new_volinfo->bricks, brick_list) {
-                ret = glusterd_volume_brickinfo_get (new_brickinfo->uuid,
-                                                     new_brickinfo->hostname,
-                                                     new_brickinfo->path,
-                                                     old_volinfo, &old_brickinfo);
-                if ((0 == ret) && glusterd_is_brick_started (old_brickinfo)) {
-                        new_brickinfo->port = old_brickinfo->port;
-                }
-        }
-out:
-        ret = 0;
-        return ret;
+        this = THIS;
+        GF_ASSERT(this);
+
+        priv = this->private;
+
+        GLUSTERD_GET_NFS_DIR(path, priv);
+        GLUSTERD_GET_NFS_PIDFILE(pidfile);
+
+        glusterd_service_stop ("nfsd", pidfile, SIGKILL, _gf_true);
+        glusterd_nfs_pmap_deregister ();
+
+        return 0;
 }
 
-int32_t
-glusterd_volinfo_stop_stale_bricks (glusterd_volinfo_t *new_volinfo,
-                                    glusterd_volinfo_t *old_volinfo)
+int
+glusterd_remote_hostname_get (rpcsvc_request_t *req, char *remote_host, int len)
 {
-        glusterd_brickinfo_t *new_brickinfo = NULL;
-        glusterd_brickinfo_t *old_brickinfo = NULL;
+        GF_ASSERT (req);
+        GF_ASSERT (remote_host);
+        GF_ASSERT (req->trans);
 
-        int             ret = 0;
-        GF_ASSERT (new_volinfo);
-        GF_ASSERT (old_volinfo);
-        if (_gf_false == glusterd_is_volume_started (old_volinfo))
-                goto out;
-        list_for_each_entry (old_brickinfo, &old_volinfo->bricks, brick_list) {
-                ret = glusterd_volume_brickinfo_get (old_brickinfo->uuid,
-                                                     old_brickinfo->hostname,
-                                                     old_brickinfo->path,
-                                                     new_volinfo, &new_brickinfo);
-                if (ret) {
-                        ret = glusterd_brick_stop (old_volinfo, old_brickinfo);
-                        if (ret)
-                                gf_log ("glusterd", GF_LOG_ERROR, "Failed to "
-                                        "stop brick %s:%s", old_brickinfo->hostname,
-                                        old_brickinfo->path);
-                }
-        }
-        ret = 0;
-out:
-        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
-        return ret;
-}
+        char *name = NULL;
+        char *delimiter = NULL;
+
+        name = req->trans->peerinfo.identifier;
+        strncpy (remote_host, name, len);
+        delimiter = strchr (remote_host, ':');
 
-int32_t
-glusterd_delete_stale_volume (glusterd_volinfo_t *stale_volinfo,
-                              glusterd_volinfo_t *valid_volinfo)
-{
-        GF_ASSERT (stale_volinfo);
-        GF_ASSERT (valid_volinfo);
-
-        /* If stale volume is in started state, copy the port numbers of the
-         * local bricks if they exist in the valid volume information.
-         * stop stale bricks. Stale volume information is going to be deleted.
-         * Which deletes the valid brick information inside stale volinfo.
-         * We dont want brick_rpc_notify to access already deleted brickinfo.
-         * Disconnect valid bricks.
-         */
-        if (glusterd_is_volume_started (stale_volinfo)) {
-                if (glusterd_is_volume_started (valid_volinfo)) {
-                        (void) glusterd_volinfo_stop_stale_bricks (valid_volinfo,
-                                                                   stale_volinfo);
-                        //Only valid bricks will be running now.
-                        (void) glusterd_volinfo_copy_brick_portinfo (valid_volinfo,
-                                                                     stale_volinfo);
-                        (void) glusterd_volume_disconnect_all_bricks (stale_volinfo);
-                } else {
-                        (void) glusterd_stop_bricks (stale_volinfo);
-                }
-        }
-        /* Delete all the bricks and stores and vol files. They will be created
-         * again by the valid_volinfo. Volume store delete should not be
-         * performed because some of the bricks could still be running,
-         * keeping pid files under run directory
-         */
-        (void) glusterd_delete_all_bricks (stale_volinfo);
-        if (stale_volinfo->shandle) {
-                unlink (stale_volinfo->shandle->path);
-                (void) glusterd_store_handle_destroy (stale_volinfo->shandle);
-                stale_volinfo->shandle = NULL;
+        GF_ASSERT (delimiter);
+        if (!delimiter) {
+                memset (remote_host, 0, len);
+                return -1;
         }
-        (void) glusterd_volinfo_delete (stale_volinfo);
+
+        *delimiter = '\0';
+
         return 0;
 }
 
-int32_t
-glusterd_import_friend_volume (dict_t *vols, size_t count)
+int
+glusterd_check_generate_start_nfs ()
 {
+        int ret = -1;
 
-        int32_t                 ret = -1;
-        glusterd_conf_t         *priv = NULL;
-        xlator_t                *this = NULL;
-        glusterd_volinfo_t      *old_volinfo = NULL;
-        glusterd_volinfo_t      *new_volinfo = NULL;
+        ret = glusterd_create_nfs_volfile ();
+        if (ret)
+                goto out;
 
-        GF_ASSERT (vols);
+        if (glusterd_is_nfs_started ()) {
+                ret = glusterd_nfs_server_stop ();
+                if (ret)
+                        goto out;
+        }
+
+        ret = glusterd_nfs_server_start ();
+out:
+        return ret;
+}
+
+int
+glusterd_volume_count_get (void)
+{
+        glusterd_volinfo_t      *tmp_volinfo = NULL;
+        int32_t                 ret = 0;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
 
         this = THIS;
         GF_ASSERT (this);
-        priv = this->private;
-        GF_ASSERT (priv);
-        ret = glusterd_import_volinfo (vols, count, &new_volinfo);
-        if (ret)
-                goto out;
 
-        ret = glusterd_volinfo_find (new_volinfo->volname, &old_volinfo);
-        if (0 == ret) {
-                (void) glusterd_delete_stale_volume (old_volinfo, new_volinfo);
-        }
+        priv = this->private;
 
-        if (glusterd_is_volume_started (new_volinfo)) {
-                (void) glusterd_start_bricks (new_volinfo);
+        list_for_each_entry (tmp_volinfo, &priv->volumes, vol_list) {
+                ret++;
         }
 
-        ret = glusterd_store_volinfo (new_volinfo, GLUSTERD_VOLINFO_VER_AC_NONE);
-        ret = glusterd_create_volfiles_and_notify_services (new_volinfo);
-        if (ret)
-                goto out;
 
-        list_add_tail (&new_volinfo->vol_list, &priv->volumes);
-out:
-        gf_log ("", GF_LOG_DEBUG, "Returning with ret: %d", ret);
+        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
+
 }
 
-int32_t
-glusterd_import_friend_volumes (dict_t  *vols)
+int
+glusterd_brickinfo_get (uuid_t uuid, char *hostname, char *path,
+                        glusterd_brickinfo_t **brickinfo)
 {
-        int32_t                 ret = -1;
-        int32_t                 count = 0;
-        int                     i = 1;
+        glusterd_volinfo_t              *volinfo     = NULL;
+        glusterd_conf_t                 *priv = NULL;
+        xlator_t                        *this = NULL;
+        int                             ret = -1;
 
-        GF_ASSERT (vols);
+        GF_ASSERT (path);
 
-        ret = dict_get_int32 (vols, "count", &count);
-        if (ret)
-                goto out;
+        this = THIS;
+        GF_ASSERT (this);
 
-        while (i <= count) {
-                ret = glusterd_import_friend_volume (vols, i);
-                if (ret)
+        priv = this->private;
+
+        list_for_each_entry (volinfo, &priv->volumes, vol_list) {
+
+                ret = glusterd_volume_brickinfo_get (uuid, hostname, path,
+                                                     volinfo,
+                                                     brickinfo);
+                if (!ret)
                         goto out;
-                i++;
         }
-
 out:
-        gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
 
-int32_t
-glusterd_compare_friend_data (dict_t  *vols, int32_t *status)
+int
+glusterd_brick_start (glusterd_volinfo_t *volinfo,
+                      glusterd_brickinfo_t *brickinfo)
 {
-        int32_t                 ret = -1;
-        int32_t                 count = 0;
-        int                     i = 1;
-        gf_boolean_t            update = _gf_false;
-        gf_boolean_t            stale_nfs = _gf_false;
-
-        GF_ASSERT (vols);
-        GF_ASSERT (status);
+        int                                     ret   = -1;
+        xlator_t                                *this = NULL;
+        glusterd_conf_t                         *conf = NULL;
 
-        ret = dict_get_int32 (vols, "count", &count);
-        if (ret)
+        if ((!brickinfo) || (!volinfo))
                 goto out;
 
-        while (i <= count) {
-                ret = glusterd_compare_friend_volume (vols, i, status);
-                if (ret)
-                        goto out;
+        this = THIS;
+        GF_ASSERT (this);
+        conf = this->private;
+        GF_ASSERT (conf);
 
-                if (GLUSTERD_VOL_COMP_RJT == *status) {
-                        ret = 0;
+        if (uuid_is_null (brickinfo->uuid)) {
+                ret = glusterd_resolve_brick (brickinfo);
+                if (ret) {
+                        gf_log ("glusterd", GF_LOG_ERROR,
+                                "cannot resolve brick: %s:%s",
+                                brickinfo->hostname, brickinfo->path);
                         goto out;
                 }
-                if (GLUSTERD_VOL_COMP_UPDATE_REQ == *status)
-                        update = _gf_true;
-
-                i++;
         }
 
-        if (update) {
-                if (glusterd_is_nfs_started ())
-                        stale_nfs = _gf_true;
-                ret = glusterd_import_friend_volumes (vols);
-                if (ret)
-                        goto out;
-                if (_gf_false == glusterd_are_all_volumes_stopped ()) {
-                        ret = glusterd_check_generate_start_nfs ();
-                } else {
-                        if (stale_nfs)
-                                glusterd_nfs_server_stop ();
-                }
+        if (uuid_compare (brickinfo->uuid, conf->uuid)) {
+                ret = 0;
+                goto out;
+        }
+        ret = glusterd_volume_start_glusterfs (volinfo, brickinfo);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "Unable to start "
+                        "glusterfs, ret: %d", ret);
+                goto out;
         }
 
 out:
-        gf_log ("", GF_LOG_DEBUG, "Returning with ret: %d, status: %d",
-                ret, *status);
-
+        gf_log ("", GF_LOG_DEBUG, "returning %d ", ret);
         return ret;
 }
 
-gf_boolean_t
-glusterd_is_nfs_started ()
+/* Runs on the event thread whatever other threads have deferred to it. */
+static int
+glusterd_defer_handler (int fd, int idx, void *data, int poll_in,
+                        int poll_out, int poll_err)
 {
-        int32_t                 ret = -1;
         xlator_t                *this = NULL;
         glusterd_conf_t         *priv = NULL;
-        char                    pidfile[PATH_MAX] = {0,};
-
-        this = THIS;
-        GF_ASSERT(this);
+        glusterd_deferred_t     *deferred = NULL;
+        glusterd_deferred_t     *tmp = NULL;
+        struct list_head        work;
+        char                    buf[64];
 
+        this = data;
+        THIS = this;
         priv = this->private;
+        INIT_LIST_HEAD (&work);
 
-        GLUSTERD_GET_NFS_PIDFILE(pidfile);
-        ret = access (pidfile, F_OK);
+        /* drain first, anything queued after the splice wakes us again */
+        while (read (fd, buf, sizeof (buf)) > 0)
+                ;
 
-        if (ret == 0)
-                return _gf_true;
-        else
-                return _gf_false;
+        pthread_mutex_lock (&priv->deferred.lock);
+        {
+                list_splice_init (&priv->deferred.list, &work);
+        }
+        pthread_mutex_unlock (&priv->deferred.lock);
+
+        list_for_each_entry_safe (deferred, tmp, &work, list) {
+                list_del_init (&deferred->list);
+                deferred->fn (deferred->data);
+                GF_FREE (deferred);
+        }
+
+        return 0;
 }
 
-int32_t
-glusterd_nfs_server_start ()
+int
+glusterd_defer_init (xlator_t *this, glusterd_conf_t *conf)
 {
-        int32_t                 ret = -1;
-        xlator_t                *this = NULL;
-        glusterd_conf_t         *priv = NULL;
-        char                    pidfile[PATH_MAX] = {0,};
-        char                    logfile[PATH_MAX] = {0,};
-        char                    volfile[PATH_MAX] = {0,};
-        char                    path[PATH_MAX] = {0,};
-        char                    rundir[PATH_MAX] = {0,};
+        glusterd_defer_queue_t  *queue = NULL;
+        int                     ret = -1;
 
-        this = THIS;
-        GF_ASSERT(this);
+        queue = &conf->deferred;
+        pthread_mutex_init (&queue->lock, NULL);
+        INIT_LIST_HEAD (&queue->list);
+        queue->pipe[0] = queue->pipe[1] = -1;
+        queue->idx = -1;
 
-        priv = this->private;
+        ret = pipe (queue->pipe);
+        if (ret == -1) {
+                gf_log (this->name, GF_LOG_ERROR, "pipe creation failed "
+                        "(%s)", strerror (errno));
+                goto out;
+        }
 
-        GLUSTERD_GET_NFS_DIR(path, priv);
-        snprintf (rundir, PATH_MAX, "%s/run", path);
-        ret = mkdir (rundir, 0777);
+        if ((fcntl (queue->pipe[0], F_SETFL, O_NONBLOCK) == -1) ||
+            (fcntl (queue->pipe[1], F_SETFL, O_NONBLOCK) == -1)) {
+                gf_log (this->name, GF_LOG_ERROR, "could not set pipe to "
+                        "non blocking mode (%s)", strerror (errno));
+                ret = -1;
+                goto out;
+        }
 
-        if ((ret == -1) && (EEXIST != errno)) {
-                gf_log ("", GF_LOG_ERROR, "Unable to create rundir %s",
-                        rundir);
+        queue->idx = event_register (this->ctx->event_pool, queue->pipe[0],
+                                     glusterd_defer_handler, this, 1, 0);
+        if (queue->idx == -1) {
+                gf_log (this->name, GF_LOG_ERROR, "could not register pipe "
+                        "fd with the event loop");
+                ret = -1;
                 goto out;
         }
 
-        GLUSTERD_GET_NFS_PIDFILE(pidfile);
-        glusterd_get_nfs_filepath (volfile);
+        ret = 0;
+out:
+        if (ret)
+                glusterd_defer_fini (this, conf);
+        return ret;
+}
 
-        ret = access (volfile, F_OK);
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR, "Nfs Volfile %s is not present",
-                        volfile);
+void
+glusterd_defer_fini (xlator_t *this, glusterd_conf_t *conf)
+{
+        glusterd_defer_queue_t  *queue = NULL;
+        glusterd_deferred_t     *deferred = NULL;
+        glusterd_deferred_t     *tmp = NULL;
+
+        queue = &conf->deferred;
+
+        if (queue->idx != -1)
+                event_unregister (this->ctx->event_pool, queue->pipe[0],
+                                  queue->idx);
+        queue->idx = -1;
+        if (queue->pipe[0] != -1)
+                close (queue->pipe[0]);
+        if (queue->pipe[1] != -1)
+                close (queue->pipe[1]);
+        queue->pipe[0] = queue->pipe[1] = -1;
+
+        list_for_each_entry_safe (deferred, tmp, &queue->list, list) {
+                list_del_init (&deferred->list);
+                GF_FREE (deferred);
+        }
+}
+
+/* Has fn (data) run on the event thread, where the volumes, peers and
+ * the op state machine may be touched. For callbacks of other threads,
+ * timers in particular.
+ */
+int
+glusterd_defer (glusterd_deferred_fn_t fn, void *data)
+{
+        glusterd_conf_t         *priv = NULL;
+        glusterd_deferred_t     *deferred = NULL;
+        gf_boolean_t            wake = _gf_false;
+        int                     ret = -1;
+
+        priv = THIS->private;
+        GF_ASSERT (priv);
+
+        deferred = GF_CALLOC (1, sizeof (*deferred), gf_gld_mt_deferred_t);
+        if (!deferred)
+                goto out;
+        INIT_LIST_HEAD (&deferred->list);
+        deferred->fn = fn;
+        deferred->data = data;
+
+        pthread_mutex_lock (&priv->deferred.lock);
+        {
+                wake = list_empty (&priv->deferred.list);
+                list_add_tail (&deferred->list, &priv->deferred.list);
+        }
+        pthread_mutex_unlock (&priv->deferred.lock);
+
+        /* a full pipe has a wake up pending already */
+        if (wake && (write (priv->deferred.pipe[1], "x", 1) == -1) &&
+            (errno != EAGAIN)) {
+                gf_log ("glusterd", GF_LOG_ERROR, "Unable to wake the event "
+                        "thread (%s)", strerror (errno));
                 goto out;
         }
 
-        snprintf (logfile, PATH_MAX, "%s/nfs.log", DEFAULT_LOG_FILE_DIRECTORY);
+        ret = 0;
+out:
+        return ret;
+}
+
+static void
+glusterd_brick_spawn_free (glusterd_brick_spawn_t *spawn)
+{
+        list_del_init (&spawn->list);
+        if (spawn->volname)
+                GF_FREE (spawn->volname);
+        if (spawn->path)
+                GF_FREE (spawn->path);
+        GF_FREE (spawn);
+}
+
+static uint64_t
+glusterd_brick_spawn_elapsed (glusterd_brick_spawn_t *spawn)
+{
+        struct timeval  now = {0,};
+
+        gettimeofday (&now, NULL);
+
+        return (now.tv_sec - spawn->start.tv_sec) * 1000 +
+                (now.tv_usec - spawn->start.tv_usec) / 1000;
+}
+
+/* Releases the slot of spawn, the entry itself goes once its launcher is
+ * reaped. Called with the spawner lock held.
+ */
+static void
+__glusterd_brick_spawn_done (glusterd_brick_spawner_t *spawner,
+                             glusterd_brick_spawn_t *spawn)
+{
+        if (!spawn->done) {
+                spawn->done = _gf_true;
+                spawner->inflight--;
+        }
+
+        if (!spawn->pid)
+                glusterd_brick_spawn_free (spawn);
+}
+
+/* Spawns queued bricks while there are free slots. Called with the spawner
+ * lock held.
+ */
+static void
+__glusterd_brick_spawn_run (glusterd_conf_t *priv)
+{
+        glusterd_brick_spawner_t *spawner = NULL;
+        glusterd_brick_spawn_t  *spawn = NULL;
+        glusterd_volinfo_t      *volinfo = NULL;
+        glusterd_brickinfo_t    *brickinfo = NULL;
+        int                     ret = -1;
+
+        spawner = &priv->spawner;
+
+        while (!list_empty (&spawner->queue) &&
+               (spawner->inflight < spawner->parallel)) {
+                spawn = list_entry (spawner->queue.next,
+                                    glusterd_brick_spawn_t, list);
+                list_del_init (&spawn->list);
+
+                /* the volume may have been stopped or deleted meanwhile */
+                ret = glusterd_volinfo_find (spawn->volname, &volinfo);
+                if (!ret && (volinfo->status == GLUSTERD_STATUS_STARTED))
+                        ret = glusterd_volume_brickinfo_get (priv->uuid, NULL,
+                                                             spawn->path,
+                                                             volinfo,
+                                                             &brickinfo);
+                else
+                        ret = -1;
+                if (ret) {
+                        glusterd_brick_spawn_free (spawn);
+                        continue;
+                }
+
+                gettimeofday (&spawn->start, NULL);
+                ret = glusterd_brick_launch (volinfo, brickinfo, &spawn->pid);
+                if (ret) {
+                        gf_log ("", GF_LOG_ERROR, "Unable to start brick "
+                                "%s:%s", brickinfo->hostname, brickinfo->path);
+                        spawner->failed++;
+                        glusterd_brick_spawn_free (spawn);
+                        continue;
+                }
 
-        ret = runcmd (GFS_PREFIX"/sbin/glusterfs", "-f", volfile,
-                      "-p", pidfile, "-l", logfile, NULL);
+                if (!spawn->pid) {
+                        /* already running, nothing to wait for */
+                        glusterd_brick_spawn_free (spawn);
+                        continue;
+                }
 
-out:
-        return ret;
+                spawner->spawned++;
+                spawner->inflight++;
+                list_add_tail (&spawn->list, &spawner->running);
+        }
 }
 
-void
-glusterd_nfs_pmap_deregister ()
-{
-        if (pmap_unset (MOUNT_PROGRAM, MOUNTV3_VERSION))
-                gf_log ("", GF_LOG_INFO, "De-registered MOUNTV3 successfully");
-        else
-                gf_log ("", GF_LOG_ERROR, "De-register MOUNTV3 is unsuccessful");
+static void
+glusterd_brick_spawn_tick (void *data);
 
-        if (pmap_unset (MOUNT_PROGRAM, MOUNTV1_VERSION))
-                gf_log ("", GF_LOG_INFO, "De-registered MOUNTV1 successfully");
-        else
-                gf_log ("", GF_LOG_ERROR, "De-register MOUNTV1 is unsuccessful");
+static void
+glusterd_brick_spawn_resume (void *data);
 
-        if (pmap_unset (NFS_PROGRAM, NFSV3_VERSION))
-                gf_log ("", GF_LOG_INFO, "De-registered NFSV3 successfully");
-        else
-                gf_log ("", GF_LOG_ERROR, "De-register NFSV3 is unsuccessful");
+/* Keeps the tick armed while there are spawns to reap, wait for or
+ * start. Called with the spawner lock held.
+ */
+static void
+__glusterd_brick_spawn_arm (xlator_t *this, glusterd_conf_t *priv)
+{
+        struct timeval          timeout = {1, 0};
+
+        if (priv->spawner.timer || (list_empty (&priv->spawner.running) &&
+                                    list_empty (&priv->spawner.queue)))
+                return;
 
+        priv->spawner.timer = gf_timer_call_after (this->ctx, timeout,
+                                                   glusterd_brick_spawn_tick,
+                                                   this);
 }
 
-int32_t
-glusterd_nfs_server_stop ()
+/* Reaps launchers, which exit as soon as glusterfsd daemonises, and gives
+ * up on bricks that have not signed in within the spawn timeout. Runs on
+ * the timer thread, so freed slots are refilled from the event thread.
+ */
+static void
+glusterd_brick_spawn_tick (void *data)
 {
         xlator_t                *this = NULL;
         glusterd_conf_t         *priv = NULL;
-        char                    pidfile[PATH_MAX] = {0,};
-        char                    path[PATH_MAX] = {0,};
-
-        this = THIS;
-        GF_ASSERT(this);
-
+        glusterd_brick_spawner_t *spawner = NULL;
+        glusterd_brick_spawn_t  *spawn = NULL;
+        glusterd_brick_spawn_t  *tmp = NULL;
+        int                     status = 0;
+        pid_t                   pid = 0;
+
+        this = data;
+        THIS = this;
         priv = this->private;
+        spawner = &priv->spawner;
+
+        pthread_mutex_lock (&spawner->lock);
+        {
+                spawner->timer = NULL;
+
+                list_for_each_entry_safe (spawn, tmp, &spawner->running,
+                                          list) {
+                        pid = 0;
+                        if (spawn->pid)
+                                pid = waitpid (spawn->pid, &status, WNOHANG);
+                        if (pid && ((pid == spawn->pid) || (pid == -1))) {
+                                spawn->pid = 0;
+                                if ((pid != -1) && !spawn->done &&
+                                    (!WIFEXITED (status) ||
+                                     WEXITSTATUS (status))) {
+                                        gf_log ("", GF_LOG_ERROR, "glusterfsd"
+                                                " for brick %s failed to "
+                                                "start", spawn->path);
+                                        spawner->failed++;
+                                        __glusterd_brick_spawn_done (spawner,
+                                                                     spawn);
+                                        continue;
+                                }
+                        }
 
-        GLUSTERD_GET_NFS_DIR(path, priv);
-        GLUSTERD_GET_NFS_PIDFILE(pidfile);
+                        if (!spawn->done &&
+                            (glusterd_brick_spawn_elapsed (spawn) >=
+                             spawner->timeout * 1000ULL)) {
+                                gf_log ("", GF_LOG_WARNING, "brick %s did "
+                                        "not sign in within %us, starting "
+                                        "the next one", spawn->path,
+                                        spawner->timeout);
+                                spawner->timed_out++;
+                                __glusterd_brick_spawn_done (spawner, spawn);
+                                continue;
+                        }
 
-        glusterd_service_stop ("nfsd", pidfile, SIGKILL, _gf_true);
-        glusterd_nfs_pmap_deregister ();
+                        if (spawn->done && !spawn->pid)
+                                glusterd_brick_spawn_free (spawn);
+                }
 
-        return 0;
+                /* launching looks up volumes and allocates ports, which
+                 * only the event thread may do */
+                if (!list_empty (&spawner->queue) &&
+                    (spawner->inflight < spawner->parallel) &&
+                    !spawner->resume_posted) {
+                        if (!glusterd_defer (glusterd_brick_spawn_resume,
+                                             this))
+                                spawner->resume_posted = _gf_true;
+                }
+                __glusterd_brick_spawn_arm (this, priv);
+        }
+        pthread_mutex_unlock (&spawner->lock);
 }
 
-int
-glusterd_remote_hostname_get (rpcsvc_request_t *req, char *remote_host, int len)
+/* Fills the slots the tick found free. Runs on the event thread. */
+static void
+glusterd_brick_spawn_resume (void *data)
 {
-        GF_ASSERT (req);
-        GF_ASSERT (remote_host);
-        GF_ASSERT (req->trans);
-
-        char *name = NULL;
-        char *delimiter = NULL;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
 
-        name = req->trans->peerinfo.identifier;
-        strncpy (remote_host, name, len);
-        delimiter = strchr (remote_host, ':');
+        this = data;
+        priv = this->private;
 
-        GF_ASSERT (delimiter);
-        if (!delimiter) {
-                memset (remote_host, 0, len);
-                return -1;
+        pthread_mutex_lock (&priv->spawner.lock);
+        {
+                priv->spawner.resume_posted = _gf_false;
+                __glusterd_brick_spawn_run (priv);
+                __glusterd_brick_spawn_arm (this, priv);
         }
-
-        *delimiter = '\0';
-
-        return 0;
+        pthread_mutex_unlock (&priv->spawner.lock);
 }
 
-int
-glusterd_check_generate_start_nfs ()
+/* Called on pmap signin of brickname: the brick is serving, its slot goes
+ * to the next queued brick.
+ */
+void
+glusterd_brick_spawn_signin (const char *brickname)
 {
-        int ret = -1;
+        xlator_t                *this = NULL;
+        glusterd_conf_t         *priv = NULL;
+        glusterd_brick_spawner_t *spawner = NULL;
+        glusterd_brick_spawn_t  *spawn = NULL;
+        uint64_t                latency = 0;
 
-        ret = glusterd_create_nfs_volfile ();
-        if (ret)
-                goto out;
+        this = THIS;
+        priv = this->private;
+        spawner = &priv->spawner;
 
-        if (glusterd_is_nfs_started ()) {
-                ret = glusterd_nfs_server_stop ();
-                if (ret)
-                        goto out;
-        }
+        pthread_mutex_lock (&spawner->lock);
+        {
+                list_for_each_entry (spawn, &spawner->running, list) {
+                        if (!spawn->done && !strcmp (spawn->path, brickname))
+                                break;
+                }
+                if (&spawn->list == &spawner->running)
+                        goto unlock;
+
+                latency = glusterd_brick_spawn_elapsed (spawn);
+                gf_log ("", GF_LOG_INFO, "brick %s of %s signed in %"PRIu64
+                        "ms after spawn", spawn->path, spawn->volname,
+                        latency);
+                spawner->signed_in++;
+                spawner->latency_total += latency;
+                if (latency > spawner->latency_max)
+                        spawner->latency_max = latency;
+
+                __glusterd_brick_spawn_done (spawner, spawn);
+                __glusterd_brick_spawn_run (priv);
+                __glusterd_brick_spawn_arm (this, priv);
+        }
+unlock:
+        pthread_mutex_unlock (&spawner->lock);
+}
 
-        ret = glusterd_nfs_server_start ();
-out:
-        return ret;
+void
+glusterd_brick_spawn_dump (glusterd_conf_t *priv, char *prefix)
+{
+        glusterd_brick_spawner_t *spawner = NULL;
+        char                    key[GF_DUMP_MAX_BUF_LEN];
+
+        spawner = &priv->spawner;
+
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.parallel");
+        gf_proc_dump_write (key, "%u", spawner->parallel);
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.inflight");
+        gf_proc_dump_write (key, "%u", spawner->inflight);
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.spawned");
+        gf_proc_dump_write (key, "%"PRIu64, spawner->spawned);
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.signed_in");
+        gf_proc_dump_write (key, "%"PRIu64, spawner->signed_in);
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.failed");
+        gf_proc_dump_write (key, "%"PRIu64, spawner->failed);
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.timed_out");
+        gf_proc_dump_write (key, "%"PRIu64, spawner->timed_out);
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.latency_avg_ms");
+        gf_proc_dump_write (key, "%"PRIu64, spawner->signed_in ?
+                            spawner->latency_total / spawner->signed_in : 0);
+        gf_proc_dump_build_key (key, prefix, "brick_spawn.latency_max_ms");
+        gf_proc_dump_write (key, "%"PRIu64, spawner->latency_max);
 }
 
-int
-glusterd_volume_count_get (void)
+void
+glusterd_peer_op_stats_dump (glusterd_conf_t *priv, char *prefix)
 {
-        glusterd_volinfo_t      *tmp_volinfo = NULL;
-        int32_t                 ret = 0;
-        xlator_t                *this = NULL;
-        glusterd_conf_t         *priv = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+        char                    key[GF_DUMP_MAX_BUF_LEN];
+        int                     i = 0;
+
+        gf_proc_dump_build_key (key, prefix, "op_timeout");
+        gf_proc_dump_write (key, "%u", priv->op_timeout);
+
+        list_for_each_entry (peerinfo, &priv->peers, uuid_list) {
+                gf_proc_dump_build_key (key, prefix, "peer[%d].hostname", i);
+                gf_proc_dump_write (key, "%s", peerinfo->hostname);
+                gf_proc_dump_build_key (key, prefix, "peer[%d].op_answers", i);
+                gf_proc_dump_write (key, "%"PRIu64, peerinfo->op_rsp_count);
+                gf_proc_dump_build_key (key, prefix,
+                                        "peer[%d].op_latency_avg_us", i);
+                gf_proc_dump_write (key, "%"PRIu64, peerinfo->op_rsp_count ?
+                                    peerinfo->op_latency_total /
+                                    peerinfo->op_rsp_count : 0);
+                gf_proc_dump_build_key (key, prefix,
+                                        "peer[%d].op_latency_max_us", i);
+                gf_proc_dump_write (key, "%"PRIu64, peerinfo->op_latency_max);
+                gf_proc_dump_build_key (key, prefix, "peer[%d].op_timeouts",
+                                        i);
+                gf_proc_dump_write (key, "%"PRIu64, peerinfo->op_timeouts);
+                i++;
+        }
+}
 
-        this = THIS;
-        GF_ASSERT (this);
+/* microseconds on a clock that does not jump with the time of day */
+uint64_t
+glusterd_monotonic_us ()
+{
+        struct timespec ts = {0,};
 
-        priv = this->private;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
-        list_for_each_entry (tmp_volinfo, &priv->volumes, vol_list) {
-                ret++;
-        }
+static char *glusterd_op_names[GD_OP_MAX] = {
+        [GD_OP_NONE]                    = "none",
+        [GD_OP_CREATE_VOLUME]           = "create",
+        [GD_OP_START_BRICK]             = "start-brick",
+        [GD_OP_STOP_BRICK]              = "stop-brick",
+        [GD_OP_DELETE_VOLUME]           = "delete",
+        [GD_OP_START_VOLUME]            = "start",
+        [GD_OP_STOP_VOLUME]             = "stop",
+        [GD_OP_RENAME_VOLUME]           = "rename",
+        [GD_OP_DEFRAG_VOLUME]           = "rebalance",
+        [GD_OP_ADD_BRICK]               = "add-brick",
+        [GD_OP_REMOVE_BRICK]            = "remove-brick",
+        [GD_OP_REPLACE_BRICK]           = "replace-brick",
+        [GD_OP_SET_VOLUME]              = "set",
+        [GD_OP_RESET_VOLUME]            = "reset",
+        [GD_OP_SYNC_VOLUME]             = "sync",
+        [GD_OP_LOG_FILENAME]            = "log-filename",
+        [GD_OP_LOG_LOCATE]              = "log-locate",
+        [GD_OP_LOG_ROTATE]              = "log-rotate",
+        [GD_OP_GSYNC_SET]               = "geo-replication",
+        [GD_OP_PROFILE_VOLUME]          = "profile",
+        [GD_OP_QUOTA]                   = "quota",
+        [GD_OP_LOG_LEVEL]               = "log-level",
+        [GD_OP_BATCH]                   = "batch",
+};
+
+static char *glusterd_txn_phase_names[GD_TXN_PHASE_MAX] = {
+        [GD_TXN_PHASE_LOCK]             = "lock",
+        [GD_TXN_PHASE_STAGE_LOCAL]      = "stage-local",
+        [GD_TXN_PHASE_STAGE]            = "stage",
+        [GD_TXN_PHASE_BRICK_OP]         = "brick-op",
+        [GD_TXN_PHASE_COMMIT_LOCAL]     = "commit-local",
+        [GD_TXN_PHASE_COMMIT]           = "commit",
+        [GD_TXN_PHASE_UNLOCK]           = "unlock",
+        [GD_TXN_PHASE_TOTAL]            = "total",
+};
 
+void
+glusterd_txn_stats_add (glusterd_conf_t *priv, glusterd_op_t op,
+                        glusterd_txn_phase_t phase, uint64_t usec)
+{
+        glusterd_txn_hist_t     *hist = NULL;
+        uint64_t                msec = 0;
+        int                     bucket = 0;
 
-        gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
-        return ret;
+        if ((op <= GD_OP_NONE) || (op >= GD_OP_MAX))
+                return;
 
+        for (msec = usec / 1000; msec; msec >>= 1)
+                bucket++;
+        if (bucket >= GLUSTERD_TXN_HIST_BUCKETS)
+                bucket = GLUSTERD_TXN_HIST_BUCKETS - 1;
+
+        pthread_mutex_lock (&priv->txn_stats.lock);
+        {
+                hist = &priv->txn_stats.hist[op][phase];
+                hist->count++;
+                hist->total_us += usec;
+                if (usec > hist->max_us)
+                        hist->max_us = usec;
+                hist->buckets[bucket]++;
+        }
+        pthread_mutex_unlock (&priv->txn_stats.lock);
 }
 
-int
-glusterd_brickinfo_get (uuid_t uuid, char *hostname, char *path,
-                        glusterd_brickinfo_t **brickinfo)
+/* Must be called with txn_stats.lock held. */
+static void
+__glusterd_txn_stats_reset (glusterd_conf_t *priv)
 {
-        glusterd_volinfo_t              *volinfo     = NULL;
-        glusterd_conf_t                 *priv = NULL;
-        xlator_t                        *this = NULL;
-        int                             ret = -1;
+        glusterd_peerinfo_t     *peerinfo = NULL;
 
-        GF_ASSERT (path);
+        memset (priv->txn_stats.hist, 0, sizeof (priv->txn_stats.hist));
+        priv->txn_stats.since = time (NULL);
 
-        this = THIS;
-        GF_ASSERT (this);
+        list_for_each_entry (peerinfo, &priv->peers, uuid_list) {
+                peerinfo->op_rsp_count = 0;
+                peerinfo->op_latency_total = 0;
+                peerinfo->op_latency_max = 0;
+                peerinfo->op_timeouts = 0;
+        }
+}
 
-        priv = this->private;
+void
+glusterd_txn_stats_reset (glusterd_conf_t *priv)
+{
+        pthread_mutex_lock (&priv->txn_stats.lock);
+        {
+                __glusterd_txn_stats_reset (priv);
+        }
+        pthread_mutex_unlock (&priv->txn_stats.lock);
+}
 
-        list_for_each_entry (volinfo, &priv->volumes, vol_list) {
+/* bucket counts as a comma separated list, up to the last non-empty one */
+static void
+glusterd_txn_hist_str (glusterd_txn_hist_t *hist, char *buf, size_t size)
+{
+        int     last = 0;
+        int     i = 0;
+        int     len = 0;
 
-                ret = glusterd_volume_brickinfo_get (uuid, hostname, path,
-                                                     volinfo,
-                                                     brickinfo);
-                if (!ret)
-                        goto out;
+        for (i = 0; i < GLUSTERD_TXN_HIST_BUCKETS; i++) {
+                if (hist->buckets[i])
+                        last = i;
         }
-out:
-        return ret;
+
+        buf[0] = '\0';
+        for (i = 0; (i <= last) && (len < size); i++)
+                len += snprintf (buf + len, size - len, "%s%"PRIu64,
+                                 i ? "," : "", hist->buckets[i]);
+}
+
+void
+glusterd_txn_stats_dump (glusterd_conf_t *priv, char *prefix)
+{
+        glusterd_txn_hist_t     *hist = NULL;
+        char                    key[GF_DUMP_MAX_BUF_LEN];
+        char                    buckets[GLUSTERD_TXN_HIST_BUCKETS * 21];
+        int                     op = 0;
+        int                     phase = 0;
+
+        pthread_mutex_lock (&priv->txn_stats.lock);
+        {
+                gf_proc_dump_build_key (key, prefix, "txn.since");
+                gf_proc_dump_write (key, "%ld", (long) priv->txn_stats.since);
+
+                for (op = GD_OP_NONE + 1; op < GD_OP_MAX; op++) {
+                        for (phase = 0; phase < GD_TXN_PHASE_MAX; phase++) {
+                                hist = &priv->txn_stats.hist[op][phase];
+                                if (!hist->count)
+                                        continue;
+
+                                gf_proc_dump_build_key (key, prefix,
+                                                        "txn.%s.%s",
+                                                        glusterd_op_names[op],
+                                        glusterd_txn_phase_names[phase]);
+                                glusterd_txn_hist_str (hist, buckets,
+                                                       sizeof (buckets));
+                                gf_proc_dump_write (key, "count=%"PRIu64
+                                                    " avg_us=%"PRIu64
+                                                    " max_us=%"PRIu64
+                                                    " buckets_ms=%s",
+                                                    hist->count,
+                                                    hist->total_us /
+                                                    hist->count,
+                                                    hist->max_us, buckets);
+                        }
+                }
+        }
+        pthread_mutex_unlock (&priv->txn_stats.lock);
 }
 
+/* Fills dict with the histograms of the ops that ran and the answer
+ * times of the peers, for the txn-stats command, and resets both first
+ * if asked to.
+ */
 int
-glusterd_brick_start (glusterd_volinfo_t *volinfo,
-                      glusterd_brickinfo_t *brickinfo)
+glusterd_txn_stats_to_dict (glusterd_conf_t *priv, dict_t *dict,
+                            gf_boolean_t reset)
 {
-        int                                     ret   = -1;
-        xlator_t                                *this = NULL;
-        glusterd_conf_t                         *conf = NULL;
+        glusterd_txn_hist_t     *hist = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+        char                    key[256] = {0,};
+        char                    buckets[GLUSTERD_TXN_HIST_BUCKETS * 21];
+        int                     op = 0;
+        int                     phase = 0;
+        int                     count = 0;
+        int                     ret = 0;
 
-        if ((!brickinfo) || (!volinfo))
-                goto out;
+        pthread_mutex_lock (&priv->txn_stats.lock);
+        {
+                ret = dict_set_int64 (dict, "since", priv->txn_stats.since);
+                if (ret)
+                        goto unlock;
 
-        this = THIS;
-        GF_ASSERT (this);
-        conf = this->private;
-        GF_ASSERT (conf);
+                for (op = GD_OP_NONE + 1; op < GD_OP_MAX; op++) {
+                        if (!priv->txn_stats.hist[op][GD_TXN_PHASE_TOTAL].count)
+                                continue;
 
-        if (uuid_is_null (brickinfo->uuid)) {
-                ret = glusterd_resolve_brick (brickinfo);
-                if (ret) {
-                        gf_log ("glusterd", GF_LOG_ERROR,
-                                "cannot resolve brick: %s:%s",
-                                brickinfo->hostname, brickinfo->path);
-                        goto out;
+                        snprintf (key, sizeof (key), "op%d.name", count);
+                        ret = dict_set_str (dict, key, glusterd_op_names[op]);
+                        if (ret)
+                                goto unlock;
+
+                        for (phase = 0; phase < GD_TXN_PHASE_MAX; phase++) {
+                                hist = &priv->txn_stats.hist[op][phase];
+
+                                snprintf (key, sizeof (key), "op%d.%s.count",
+                                          count,
+                                          glusterd_txn_phase_names[phase]);
+                                ret = dict_set_uint64 (dict, key, hist->count);
+                                if (ret)
+                                        goto unlock;
+                                if (!hist->count)
+                                        continue;
+
+                                snprintf (key, sizeof (key), "op%d.%s.avg_us",
+                                          count,
+                                          glusterd_txn_phase_names[phase]);
+                                ret = dict_set_uint64 (dict, key,
+                                                       hist->total_us /
+                                                       hist->count);
+                                if (ret)
+                                        goto unlock;
+
+                                snprintf (key, sizeof (key), "op%d.%s.max_us",
+                                          count,
+                                          glusterd_txn_phase_names[phase]);
+                                ret = dict_set_uint64 (dict, key,
+                                                       hist->max_us);
+                                if (ret)
+                                        goto unlock;
+
+                                snprintf (key, sizeof (key),
+                                          "op%d.%s.buckets", count,
+                                          glusterd_txn_phase_names[phase]);
+                                glusterd_txn_hist_str (hist, buckets,
+                                                       sizeof (buckets));
+                                ret = dict_set_dynstr (dict, key,
+                                                       gf_strdup (buckets));
+                                if (ret)
+                                        goto unlock;
+                        }
+                        count++;
                 }
-        }
 
-        if (uuid_compare (brickinfo->uuid, conf->uuid)) {
-                ret = 0;
-                goto out;
-        }
-        ret = glusterd_volume_start_glusterfs (volinfo, brickinfo);
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR, "Unable to start "
-                        "glusterfs, ret: %d", ret);
-                goto out;
+                ret = dict_set_int32 (dict, "count", count);
+                if (ret)
+                        goto unlock;
+
+                count = 0;
+                list_for_each_entry (peerinfo, &priv->peers, uuid_list) {
+                        snprintf (key, sizeof (key), "peer%d.hostname", count);
+                        ret = dict_set_dynstr (dict, key,
+                                               gf_strdup (peerinfo->hostname));
+                        if (ret)
+                                goto unlock;
+                        snprintf (key, sizeof (key), "peer%d.answers", count);
+                        ret = dict_set_uint64 (dict, key,
+                                               peerinfo->op_rsp_count);
+                        if (ret)
+                                goto unlock;
+                        snprintf (key, sizeof (key), "peer%d.avg_us", count);
+                        ret = dict_set_uint64 (dict, key,
+                                               peerinfo->op_rsp_count ?
+                                               peerinfo->op_latency_total /
+                                               peerinfo->op_rsp_count : 0);
+                        if (ret)
+                                goto unlock;
+                        snprintf (key, sizeof (key), "peer%d.max_us", count);
+                        ret = dict_set_uint64 (dict, key,
+                                               peerinfo->op_latency_max);
+                        if (ret)
+                                goto unlock;
+                        snprintf (key, sizeof (key), "peer%d.timeouts", count);
+                        ret = dict_set_uint64 (dict, key,
+                                               peerinfo->op_timeouts);
+                        if (ret)
+                                goto unlock;
+                        count++;
+                }
+
+                ret = dict_set_int32 (dict, "peer-count", count);
+                if (ret)
+                        goto unlock;
+
+                if (reset)
+                        __glusterd_txn_stats_reset (priv);
         }
+unlock:
+        pthread_mutex_unlock (&priv->txn_stats.lock);
 
-out:
-        gf_log ("", GF_LOG_DEBUG, "returning %d ", ret);
         return ret;
 }
 
+/* Starts the local bricks of all started volumes, at most
+ * brick-spawn-parallel at a time. A brick's slot is released when it signs
+ * in with pmap rather than when its launcher returns, so this does not
+ * block on any of them.
+ */
 int
 glusterd_restart_bricks (glusterd_conf_t *conf)
 {
         glusterd_volinfo_t       *volinfo = NULL;
         glusterd_brickinfo_t     *brickinfo = NULL;
+        glusterd_brick_spawn_t   *spawn = NULL;
         int                      ret = 0;
+        int                      queued = 0;
         gf_boolean_t             start_nfs = _gf_false;
+        char                     path[PATH_MAX] = {0,};
+        char                     checkpoint[PATH_MAX] = {0,};
 
         GF_ASSERT (conf);
 
-        list_for_each_entry (volinfo, &conf->volumes, vol_list) {
-                //If volume status is not started, do not proceed
-                if (volinfo->status == GLUSTERD_STATUS_STARTED) {
+        pthread_mutex_lock (&conf->spawner.lock);
+        {
+                list_for_each_entry (volinfo, &conf->volumes, vol_list) {
+                        //If volume status is not started, do not proceed
+                        if (volinfo->status != GLUSTERD_STATUS_STARTED)
+                                continue;
+                        start_nfs = _gf_true;
+
                         list_for_each_entry (brickinfo, &volinfo->bricks,
                                              brick_list) {
-                                glusterd_brick_start (volinfo, brickinfo);
+                                if (uuid_is_null (brickinfo->uuid) &&
+                                    glusterd_resolve_brick (brickinfo)) {
+                                        gf_log ("glusterd", GF_LOG_ERROR,
+                                                "cannot resolve brick: %s:%s",
+                                                brickinfo->hostname,
+                                                brickinfo->path);
+                                        continue;
+                                }
+                                if (uuid_compare (brickinfo->uuid, conf->uuid))
+                                        continue;
+
+                                spawn = GF_CALLOC (1, sizeof (*spawn),
+                                                   gf_gld_mt_brick_spawn_t);
+                                if (!spawn)
+                                        continue;
+                                INIT_LIST_HEAD (&spawn->list);
+                                spawn->volname = gf_strdup (volinfo->volname);
+                                spawn->path = gf_strdup (brickinfo->path);
+                                if (!spawn->volname || !spawn->path) {
+                                        glusterd_brick_spawn_free (spawn);
+                                        continue;
+                                }
+                                list_add_tail (&spawn->list,
+                                               &conf->spawner.queue);
+                                queued++;
                         }
-                        start_nfs = _gf_true;
                 }
+
+                gf_log ("", GF_LOG_INFO, "starting %d bricks, %u at a time",
+                        queued, conf->spawner.parallel);
+
+                __glusterd_brick_spawn_run (conf);
+                __glusterd_brick_spawn_arm (THIS, conf);
         }
+        pthread_mutex_unlock (&conf->spawner.lock);
+
         if (start_nfs)
                 glusterd_check_generate_start_nfs ();
+
+        /* pick up quota crawls that were cut short */
+        list_for_each_entry (volinfo, &conf->volumes, vol_list) {
+                if (volinfo->status != GLUSTERD_STATUS_STARTED)
+                        continue;
+                GLUSTERD_GET_VOLUME_DIR (path, volinfo, conf);
+                GLUSTERD_GET_QUOTA_CRAWL_CHECKPOINT (checkpoint, path);
+                if (access (checkpoint, F_OK))
+                        continue;
+                glusterd_quota_initiate_fs_crawl (conf, volinfo->volname);
+        }
+
+        /* and rebalances */
+        list_for_each_entry (volinfo, &conf->volumes, vol_list) {
+                if (volinfo->status != GLUSTERD_STATUS_STARTED)
+                        continue;
+                glusterd_defrag_resume (volinfo);
+        }
+
         return ret;
 }
 
@@ -2485,11 +4617,23 @@ glusterd_get_brickinfo (xlator_t *this, const char *brickname, int port,
         glusterd_volinfo_t      *volinfo = NULL;
         glusterd_brickinfo_t    *tmpbrkinfo = NULL;
         int                     ret = -1;
+        struct list_head        *bucket = NULL;
 
         GF_ASSERT (brickname);
         GF_ASSERT (this);
 
         priv = this->private;
+        bucket = &priv->brick_port_table[glusterd_hash_port (port)];
+        list_for_each_entry (tmpbrkinfo, bucket, port_hash) {
+                if (localhost && glusterd_is_local_addr (tmpbrkinfo->hostname))
+                        continue;
+                if (!strcmp(tmpbrkinfo->path, brickname) &&
+                    (tmpbrkinfo->port == port)) {
+                        *brickinfo = tmpbrkinfo;
+                        return 0;
+                }
+        }
+
         list_for_each_entry (volinfo, &priv->volumes, vol_list) {
                 list_for_each_entry (tmpbrkinfo, &volinfo->bricks,
                                      brick_list) {
@@ -2497,6 +4641,7 @@ glusterd_get_brickinfo (xlator_t *this, const char *brickname, int port,
                                 continue;
                         if (!strcmp(tmpbrkinfo->path, brickname) &&
                             (tmpbrkinfo->port == port)) {
+                                glusterd_brickinfo_hash (volinfo, tmpbrkinfo);
                                 *brickinfo = tmpbrkinfo;
                                 return 0;
                         }
@@ -2579,6 +4724,29 @@ out:
         return ret;
 }
 
+extern struct rpc_clnt_program gd_clnt_mgmt_v2_prog;
+
+/* Whether all the connected peers speak mgmt version 2: volume scoped
+ * locks and several transactions at a time. A peer of an older version
+ * only knows the cluster lock, held by a single transaction.
+ */
+gf_boolean_t
+glusterd_peers_support_txns ()
+{
+        glusterd_conf_t         *priv = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+
+        priv = THIS->private;
+
+        list_for_each_entry (peerinfo, &priv->peers, uuid_list) {
+                if (peerinfo->connected && peerinfo->mgmt &&
+                    (peerinfo->mgmt != &gd_clnt_mgmt_v2_prog))
+                        return _gf_false;
+        }
+
+        return _gf_true;
+}
+
 int
 glusterd_friend_find_by_uuid (uuid_t uuid,
                               glusterd_peerinfo_t  **peerinfo)
@@ -2586,6 +4754,7 @@ glusterd_friend_find_by_uuid (uuid_t uuid,
         int                     ret = -1;
         glusterd_conf_t         *priv = NULL;
         glusterd_peerinfo_t     *entry = NULL;
+        struct list_head        *bucket = NULL;
 
         GF_ASSERT (peerinfo);
 
@@ -2597,7 +4766,8 @@ glusterd_friend_find_by_uuid (uuid_t uuid,
         if (uuid_is_null (uuid))
                 return -1;
 
-        list_for_each_entry (entry, &priv->peers, uuid_list) {
+        bucket = &priv->peer_uuid_table[glusterd_hash_uuid (uuid)];
+        list_for_each_entry (entry, bucket, uuid_hash) {
                 if (!uuid_compare (entry->uuid, uuid)) {
 
                         gf_log ("glusterd", GF_LOG_DEBUG,
@@ -2613,21 +4783,35 @@ glusterd_friend_find_by_uuid (uuid_t uuid,
         return ret;
 }
 
+static glusterd_peerinfo_t *
+glusterd_peer_hostname_lookup (glusterd_conf_t *priv, const char *hostname)
+{
+        glusterd_peerinfo_t     *entry = NULL;
+        struct list_head        *bucket = NULL;
+
+        bucket = &priv->peer_host_table[glusterd_hash_str (hostname)];
+        list_for_each_entry (entry, bucket, hostname_hash) {
+                if (!strncmp (entry->hostname, hostname, 1024))
+                        return entry;
+        }
+
+        return NULL;
+}
 
 int
 glusterd_friend_find_by_hostname (const char *hoststr,
                                   glusterd_peerinfo_t  **peerinfo)
 {
-        int                     ret = -1;
         glusterd_conf_t         *priv = NULL;
         glusterd_peerinfo_t     *entry = NULL;
-        struct addrinfo         *addr = NULL;
+        glusterd_resolve_entry_t *resolved = NULL;
         struct addrinfo         *p = NULL;
         char                    *host = NULL;
+        char                    *hname = NULL;
         struct sockaddr_in6     *s6 = NULL;
         struct sockaddr_in      *s4 = NULL;
         struct in_addr          *in_addr = NULL;
-        char                    hname[1024] = {0,};
+        int                     i = 0;
 
         GF_ASSERT (hoststr);
         GF_ASSERT (peerinfo);
@@ -2637,26 +4821,20 @@ glusterd_friend_find_by_hostname (const char *hoststr,
 
         GF_ASSERT (priv);
 
-        list_for_each_entry (entry, &priv->peers, uuid_list) {
-                if (!strncmp (entry->hostname, hoststr,
-                              1024)) {
-
-                        gf_log ("glusterd", GF_LOG_DEBUG,
-                                 "Friend %s found.. state: %d", hoststr,
-                                  entry->state.state);
-                        *peerinfo = entry;
-                        return 0;
-                }
+        entry = glusterd_peer_hostname_lookup (priv, hoststr);
+        if (entry) {
+                gf_log ("glusterd", GF_LOG_DEBUG,
+                         "Friend %s found.. state: %d", hoststr,
+                          entry->state.state);
+                *peerinfo = entry;
+                return 0;
         }
 
-        ret = getaddrinfo(hoststr, NULL, NULL, &addr);
-        if (ret != 0) {
-                gf_log ("", GF_LOG_ERROR, "error in getaddrinfo: %s\n",
-                        gai_strerror(ret));
+        resolved = glusterd_resolve ((char *)hoststr);
+        if (!resolved)
                 goto out;
-        }
 
-        for (p = addr; p != NULL; p = p->ai_next) {
+        for (p = resolved->addrs; p != NULL; p = p->ai_next, i++) {
                 switch (p->ai_family) {
                         case AF_INET:
                                 s4 = (struct sockaddr_in *) p->ai_addr;
@@ -2666,34 +4844,29 @@ glusterd_friend_find_by_hostname (const char *hoststr,
                                 s6 = (struct sockaddr_in6 *) p->ai_addr;
                                 in_addr =(struct in_addr *) &s6->sin6_addr;
                                 break;
-                       default: ret = -1;
+                       default:
                                 goto out;
                 }
                 host = inet_ntoa(*in_addr);
 
-                ret = getnameinfo (p->ai_addr, p->ai_addrlen, hname,
-                                   1024, NULL, 0, 0);
-                if (ret)
+                hname = glusterd_resolve_name (resolved, i, p);
+                if (!hname)
                         goto out;
 
-                list_for_each_entry (entry, &priv->peers, uuid_list) {
-                        if (!strncmp (entry->hostname, host,
-                            1024) || !strncmp (entry->hostname,hname,
-                            1024)) {
-                                gf_log ("glusterd", GF_LOG_DEBUG,
-                                        "Friend %s found.. state: %d",
-                                        hoststr, entry->state.state);
-                                *peerinfo = entry;
-                                freeaddrinfo (addr);
-                                return 0;
-                        }
+                entry = glusterd_peer_hostname_lookup (priv, host);
+                if (!entry)
+                        entry = glusterd_peer_hostname_lookup (priv, hname);
+                if (entry) {
+                        gf_log ("glusterd", GF_LOG_DEBUG,
+                                "Friend %s found.. state: %d",
+                                hoststr, entry->state.state);
+                        *peerinfo = entry;
+                        return 0;
                 }
         }
 
 out:
         gf_log ("glusterd", GF_LOG_DEBUG, "Unable to find friend: %s", hoststr);
-        if (addr)
-                freeaddrinfo (addr);
         return -1;
 }
 
@@ -3188,6 +5361,8 @@ glusterd_peerinfo_new (glusterd_peerinfo_t **peerinfo,
                 new_peer->hostname = gf_strdup (hostname);
 
         INIT_LIST_HEAD (&new_peer->uuid_list);
+        INIT_LIST_HEAD (&new_peer->uuid_hash);
+        INIT_LIST_HEAD (&new_peer->hostname_hash);
 
         if (uuid) {
                 uuid_copy (new_peer->uuid, *uuid);
@@ -3223,6 +5398,8 @@ glusterd_peer_destroy (glusterd_peerinfo_t *peerinfo)
         }
 
         list_del_init (&peerinfo->uuid_list);
+        list_del_init (&peerinfo->uuid_hash);
+        list_del_init (&peerinfo->hostname_hash);
         if (peerinfo->hostname)
                 GF_FREE (peerinfo->hostname);
         glusterd_sm_tr_log_delete (&peerinfo->sm_log);
@@ -43,6 +43,13 @@ struct glusterd_lock_ {
         time_t  timestamp;
 };
 
+struct glusterd_volume_lock_ {
+        char              volname[GLUSTERD_MAX_VOLUME_NAME];
+        uuid_t            owner;
+        time_t            timestamp;
+        struct list_head  lock_list;
+};
+
 typedef struct glusterd_voldict_ctx_ {
         dict_t  *dict;
         int     count;
@@ -56,6 +63,7 @@ typedef int (*glusterd_condition_func) (glusterd_volinfo_t *volinfo,
                                         void *ctx);
 
 typedef struct glusterd_lock_ glusterd_lock_t;
+typedef struct glusterd_volume_lock_ glusterd_volume_lock_t;
 
 int32_t
 glusterd_lock (uuid_t new_owner);
@@ -63,6 +71,18 @@ glusterd_lock (uuid_t new_owner);
 int32_t
 glusterd_unlock (uuid_t owner);
 
+int32_t
+glusterd_volume_lock (char *volname, uuid_t new_owner);
+
+int32_t
+glusterd_volume_unlock (char *volname, uuid_t owner);
+
+int32_t
+glusterd_scoped_lock (char *volname, uuid_t new_owner);
+
+int32_t
+glusterd_scoped_unlock (char *volname, uuid_t owner);
+
 int32_t
 glusterd_get_uuid (uuid_t *uuid);
 
@@ -101,6 +121,115 @@ glusterd_peer_hostname_new (char *hostname, glusterd_peer_hostname_t **name);
 int32_t
 glusterd_volinfo_find (char *volname, glusterd_volinfo_t **volinfo);
 
+int
+glusterd_hash_tables_init (glusterd_conf_t *conf);
+
+void
+glusterd_resolve_cache_flush (glusterd_conf_t *priv);
+
+void
+glusterd_resolve_cache_dump (glusterd_conf_t *priv, char *prefix);
+
+struct list_head *
+glusterd_volfile_sub_bucket (glusterd_conf_t *priv, const char *volname);
+
+int
+glusterd_volfile_subscribe (rpc_transport_t *trans,
+                            glusterd_volinfo_t *volinfo);
+
+void
+glusterd_volfile_unsubscribe (rpc_transport_t *trans);
+
+uint32_t
+glusterd_volfile_version (glusterd_volinfo_t *volinfo);
+
+void
+glusterd_peer_op_stats_dump (glusterd_conf_t *priv, char *prefix);
+
+uint64_t
+glusterd_monotonic_us ();
+
+void
+glusterd_txn_stats_add (glusterd_conf_t *priv, glusterd_op_t op,
+                        glusterd_txn_phase_t phase, uint64_t usec);
+
+void
+glusterd_txn_stats_reset (glusterd_conf_t *priv);
+
+void
+glusterd_txn_stats_dump (glusterd_conf_t *priv, char *prefix);
+
+int
+glusterd_txn_stats_to_dict (glusterd_conf_t *priv, dict_t *dict,
+                            gf_boolean_t reset);
+
+int
+glusterd_volfile_cache_get (const char *key, char *volname,
+                            struct iobuf **iobp, size_t *lenp);
+
+uint64_t
+glusterd_volfile_cache_gen ();
+
+int
+glusterd_volfile_cache_put (const char *key, const char *path,
+                            const char *volname, struct iobuf *iob,
+                            size_t len, uint64_t gen);
+
+void
+glusterd_volfile_cache_drop (const char *path);
+
+void
+glusterd_volfile_cache_purge (const char *volname);
+
+void
+glusterd_volfile_cache_flush (glusterd_conf_t *priv);
+
+void
+glusterd_volfile_cache_dump (glusterd_conf_t *priv, char *prefix);
+
+int
+glusterd_defer_init (xlator_t *this, glusterd_conf_t *conf);
+
+void
+glusterd_defer_fini (xlator_t *this, glusterd_conf_t *conf);
+
+int
+glusterd_defer (glusterd_deferred_fn_t fn, void *data);
+
+void
+glusterd_brick_spawn_signin (const char *brickname);
+
+void
+glusterd_brick_spawn_dump (glusterd_conf_t *priv, char *prefix);
+
+void
+glusterd_defrag_dump (glusterd_conf_t *priv, char *prefix);
+
+void
+glusterd_hash_tables_destroy (glusterd_conf_t *conf);
+
+void
+glusterd_volinfo_hash (glusterd_volinfo_t *volinfo);
+
+void
+glusterd_volinfo_list_add (glusterd_volinfo_t *volinfo);
+
+void
+glusterd_volinfo_list_append (glusterd_volinfo_t *volinfo);
+
+void
+glusterd_volinfo_list_sort (void);
+
+glusterd_volinfo_t *
+glusterd_volinfo_find_next (char *volname);
+
+void
+glusterd_peerinfo_hash (glusterd_peerinfo_t *peerinfo);
+
+void
+glusterd_brickinfo_hash (glusterd_volinfo_t *volinfo,
+                         glusterd_brickinfo_t *brickinfo);
+
 int32_t
 glusterd_service_stop(const char *service, char *pidfile, int sig,
                       gf_boolean_t force_kill);
@@ -136,7 +265,14 @@ int32_t
 glusterd_build_volume_dict (dict_t **vols);
 
 int32_t
-glusterd_compare_friend_data (dict_t  *vols, int32_t *status);
+glusterd_build_volume_summary_dict (dict_t **vols);
+
+int32_t
+glusterd_build_wanted_volume_dict (dict_t *wanted, dict_t **vols);
+
+int32_t
+glusterd_compare_friend_data (dict_t  *vols, int32_t *status,
+                              dict_t **wanted);
 
 int
 glusterd_volume_compute_cksum (glusterd_volinfo_t  *volinfo);
@@ -155,6 +291,11 @@ glusterd_remote_hostname_get (rpcsvc_request_t *req,
                               char *remote_host, int len);
 int32_t
 glusterd_import_friend_volumes (dict_t  *vols);
+int32_t
+glusterd_import_friend_volumes_update_nfs (dict_t *vols);
+int32_t
+glusterd_volinfo_update_in_place (glusterd_volinfo_t *volinfo,
+                                  glusterd_volinfo_t *new_volinfo);
 void
 glusterd_set_volume_status (glusterd_volinfo_t  *volinfo,
                             glusterd_volume_status status);
@@ -204,6 +345,8 @@ glusterd_volinfo_bricks_delete (glusterd_volinfo_t *volinfo);
 int
 glusterd_friend_find_by_uuid (uuid_t uuid,
                               glusterd_peerinfo_t  **peerinfo);
+gf_boolean_t
+glusterd_peers_support_txns ();
 int
 glusterd_new_brick_validate (char *brick, glusterd_brickinfo_t *brickinfo,
                              char *op_errstr, size_t len);
@@ -1032,12 +1032,63 @@ volgen_graph_merge_sub (volgen_graph_t *dgraph, volgen_graph_t *sgraph)
         return 0;
 }
 
+/* tells whether filename already holds exactly len bytes of buf */
+static gf_boolean_t
+volgen_volfile_unchanged (char *filename, char *buf, size_t len)
+{
+        struct stat     stbuf = {0,};
+        char            *old = NULL;
+        int             fd = -1;
+        gf_boolean_t    same = _gf_false;
+
+        if (stat (filename, &stbuf) || (stbuf.st_size != len))
+                goto out;
+
+        fd = open (filename, O_RDONLY);
+        if (fd == -1)
+                goto out;
+
+        old = GF_MALLOC (len + 1, gf_common_mt_char);
+        if (!old)
+                goto out;
+
+        if ((read (fd, old, len + 1) == len) && !memcmp (old, buf, len))
+                same = _gf_true;
+out:
+        if (old)
+                GF_FREE (old);
+        if (fd != -1)
+                close (fd);
+        return same;
+}
+
+/* Writes graph to filename unless the file already has the same contents.
+ * *changed, if given, is set when the file was (re)written.
+ */
 static int
-volgen_write_volfile (volgen_graph_t *graph, char *filename)
+volgen_write_volfile_changed (volgen_graph_t *graph, char *filename,
+                              gf_boolean_t *changed)
 {
         char *ftmp = NULL;
+        char *buf = NULL;
+        size_t len = 0;
         FILE *f = NULL;
 
+        if (changed)
+                *changed = _gf_false;
+
+        buf = glusterfs_graph_print_buf (&graph->graph);
+        if (!buf)
+                goto error;
+        len = strlen (buf);
+
+        if (volgen_volfile_unchanged (filename, buf, len)) {
+                gf_log ("", GF_LOG_DEBUG, "volfile %s unchanged", filename);
+                GF_FREE (buf);
+
+                return 0;
+        }
+
         if (gf_asprintf (&ftmp, "%s.tmp", filename) == -1) {
                 ftmp = NULL;
 
@@ -1048,7 +1099,7 @@ volgen_write_volfile (volgen_graph_t *graph, char *filename)
         if (!f)
                 goto error;
 
-        if (glusterfs_graph_print_file (f, &graph->graph) == -1)
+        if (len && (fwrite (buf, len, 1, f) != 1))
                 goto error;
 
         if (fclose (f) == -1)
@@ -1057,8 +1108,13 @@ volgen_write_volfile (volgen_graph_t *graph, char *filename)
 
         if (rename (ftmp, filename) == -1)
                 goto error;
+        glusterd_volfile_cache_drop (filename);
 
         GF_FREE (ftmp);
+        GF_FREE (buf);
+
+        if (changed)
+                *changed = _gf_true;
 
         return 0;
 
@@ -1066,6 +1122,8 @@ volgen_write_volfile (volgen_graph_t *graph, char *filename)
 
         if (ftmp)
                 GF_FREE (ftmp);
+        if (buf)
+                GF_FREE (buf);
         if (f)
                 fclose (f);
 
@@ -1074,6 +1132,12 @@ volgen_write_volfile (volgen_graph_t *graph, char *filename)
         return -1;
 }
 
+static int
+volgen_write_volfile (volgen_graph_t *graph, char *filename)
+{
+        return volgen_write_volfile_changed (graph, filename, NULL);
+}
+
 static void
 volgen_graph_free (volgen_graph_t *graph)
 {
@@ -2016,7 +2080,8 @@ out:
 
 static int
 glusterd_generate_brick_volfile (glusterd_volinfo_t *volinfo,
-                                 glusterd_brickinfo_t *brickinfo)
+                                 glusterd_brickinfo_t *brickinfo,
+                                 gf_boolean_t *changed)
 {
         volgen_graph_t graph = {0,};
         char    filename[PATH_MAX] = {0,};
@@ -2029,7 +2094,7 @@ glusterd_generate_brick_volfile (glusterd_volinfo_t *volinfo,
 
         ret = build_server_graph (&graph, volinfo, NULL, brickinfo->path);
         if (!ret)
-                ret = volgen_write_volfile (&graph, filename);
+                ret = volgen_write_volfile_changed (&graph, filename, changed);
 
         volgen_graph_free (&graph);
 
@@ -2050,10 +2115,118 @@ get_vol_tstamp_file (char *filename, glusterd_volinfo_t *volinfo)
                  PATH_MAX - strlen(filename) - 1);
 }
 
-int
-generate_brick_volfiles (glusterd_volinfo_t *volinfo)
+struct volgen_brick_job {
+        xlator_t                *this;
+        glusterd_volinfo_t      *volinfo;
+        glusterd_brickinfo_t    **bricks;
+        int                     count;
+        int                     next;
+        int                     changed;
+        int                     ret;
+        pthread_mutex_t         lock;
+};
+
+static void *
+volgen_brick_worker (void *data)
 {
+        struct volgen_brick_job *job = data;
+        gf_boolean_t             changed = _gf_false;
+        int                      i = 0;
+        int                      ret = 0;
+
+        THIS = job->this;
+
+        for (;;) {
+                pthread_mutex_lock (&job->lock);
+                {
+                        i = job->ret ? job->count : job->next++;
+                }
+                pthread_mutex_unlock (&job->lock);
+                if (i >= job->count)
+                        break;
+
+                ret = glusterd_generate_brick_volfile (job->volinfo,
+                                                       job->bricks[i],
+                                                       &changed);
+
+                pthread_mutex_lock (&job->lock);
+                {
+                        if (ret)
+                                job->ret = ret;
+                        else if (changed)
+                                job->changed++;
+                }
+                pthread_mutex_unlock (&job->lock);
+        }
+
+        return NULL;
+}
+
+/* Builds and writes the brick volfiles of volinfo, spreading them over up
+ * to GLUSTERD_VOLGEN_THREADS threads when there are many. The graphs only
+ * read volinfo, which the caller keeps from changing meanwhile.
+ */
+static int
+generate_brick_volfiles_changed (glusterd_volinfo_t *volinfo, int *changed)
+{
+        struct volgen_brick_job  job = {0,};
         glusterd_brickinfo_t    *brickinfo = NULL;
+        pthread_t                threads[GLUSTERD_VOLGEN_THREADS];
+        int                      nthreads = 0;
+        int                      i = 0;
+
+        job.this = THIS;
+        job.volinfo = volinfo;
+        pthread_mutex_init (&job.lock, NULL);
+
+        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list)
+                i++;
+
+        job.bricks = GF_CALLOC (i + 1, sizeof (*job.bricks),
+                                gf_gld_mt_char);
+        if (!job.bricks) {
+                job.ret = -1;
+                goto out;
+        }
+
+        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
+                gf_log ("", GF_LOG_DEBUG,
+                        "Found a brick - %s:%s", brickinfo->hostname,
+                        brickinfo->path);
+                job.bricks[job.count++] = brickinfo;
+        }
+
+        if (job.count >= GLUSTERD_VOLGEN_PARALLEL_MIN) {
+                nthreads = job.count / GLUSTERD_VOLGEN_PARALLEL_MIN;
+                if (nthreads > GLUSTERD_VOLGEN_THREADS)
+                        nthreads = GLUSTERD_VOLGEN_THREADS;
+        }
+
+        for (i = 0; i < nthreads; i++) {
+                if (pthread_create (&threads[i], NULL, volgen_brick_worker,
+                                    &job))
+                        break;
+        }
+        nthreads = i;
+
+        /* this thread works too, and alone if no thread could be had */
+        volgen_brick_worker (&job);
+
+        for (i = 0; i < nthreads; i++)
+                pthread_join (threads[i], NULL);
+
+        if (changed)
+                *changed += job.changed;
+out:
+        if (job.bricks)
+                GF_FREE (job.bricks);
+        pthread_mutex_destroy (&job.lock);
+        return job.ret;
+}
+
+static int
+generate_brick_volfiles_incr (glusterd_volinfo_t *volinfo, int *changed)
+{
         char                     tstamp_file[PATH_MAX] = {0,};
         int                      ret = -1;
 
@@ -2087,24 +2260,18 @@ generate_brick_volfiles (glusterd_volinfo_t *volinfo)
                 }
         }
 
-        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
-                gf_log ("", GF_LOG_DEBUG,
-                        "Found a brick - %s:%s", brickinfo->hostname,
-                        brickinfo->path);
-
-                ret = glusterd_generate_brick_volfile (volinfo, brickinfo);
-                if (ret)
-                        goto out;
-
-        }
-
-        ret = 0;
+        ret = generate_brick_volfiles_changed (volinfo, changed);
 
-out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
 }
 
+int
+generate_brick_volfiles (glusterd_volinfo_t *volinfo)
+{
+        return generate_brick_volfiles_incr (volinfo, NULL);
+}
+
 static void
 get_client_filepath (char *filename, glusterd_volinfo_t *volinfo)
 {
@@ -2134,12 +2301,13 @@ get_rdma_client_filepath (char *filename, glusterd_volinfo_t *volinfo)
 }
 
 static int
-generate_client_volfile (glusterd_volinfo_t *volinfo)
+generate_client_volfile (glusterd_volinfo_t *volinfo, int *changed)
 {
         volgen_graph_t graph = {0,};
         char    filename[PATH_MAX] = {0,};
         int     ret = -1;
         dict_t *dict = NULL;
+        gf_boolean_t written = _gf_false;
 
         get_client_filepath (filename, volinfo);
 
@@ -2154,7 +2322,10 @@ generate_client_volfile (glusterd_volinfo_t *volinfo)
 
         ret = build_client_graph (&graph, volinfo, dict);
         if (!ret)
-                ret = volgen_write_volfile (&graph, filename);
+                ret = volgen_write_volfile_changed (&graph, filename,
+                                                    &written);
+        if (changed && written)
+                (*changed)++;
 
         volgen_graph_free (&graph);
 
@@ -2170,7 +2341,10 @@ generate_client_volfile (glusterd_volinfo_t *volinfo)
 
                 ret = build_client_graph (&graph, volinfo, dict);
                 if (!ret)
-                        ret = volgen_write_volfile (&graph, filename);
+                        ret = volgen_write_volfile_changed (&graph, filename,
+                                                            &written);
+                if (changed && written)
+                        (*changed)++;
 
                 volgen_graph_free (&graph);
 
@@ -2186,41 +2360,115 @@ glusterd_create_rb_volfiles (glusterd_volinfo_t *volinfo,
                              glusterd_brickinfo_t *brickinfo)
 {
         int ret = -1;
+        int changed = 0;
+        gf_boolean_t written = _gf_false;
 
-        ret = glusterd_generate_brick_volfile (volinfo, brickinfo);
+        ret = glusterd_generate_brick_volfile (volinfo, brickinfo, &written);
         if (!ret)
-                ret = generate_client_volfile (volinfo);
-        if (!ret)
-                ret = glusterd_fetchspec_notify (THIS);
+                ret = generate_client_volfile (volinfo, &changed);
+        if (!ret && (written || changed))
+                ret = glusterd_fetchspec_notify_volume (volinfo);
 
         return ret;
 }
 
+/* Which of the brick and client volfiles an option given to volume set can
+ * change. Options of the nfs server only go into its own volfile.
+ */
 int
-glusterd_create_volfiles_and_notify_services (glusterd_volinfo_t *volinfo)
+glusterd_volopt_graphs (char *key)
 {
-        int ret = -1;
+        struct volopt_map_entry *vme = NULL;
+        int                      graphs = 0;
+        gf_boolean_t             found = _gf_false;
+        char                    *server_types[] = {"storage/posix",
+                                                   "features/access-control",
+                                                   "features/locks",
+                                                   "performance/io-threads",
+                                                   "features/marker",
+                                                   "protocol/server",
+                                                   NULL};
+        int                      i = 0;
+
+        /* the client graph has a quota xlator while quota is on */
+        if (!strcmp (key, VKEY_FEATURES_QUOTA))
+                return GLUSTERD_VOLFILE_ALL;
 
-        ret = generate_brick_volfiles (volinfo);
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR,
-                        "Could not generate volfiles for bricks");
-                goto out;
+        for (vme = glusterd_volopt_map; vme->key; vme++) {
+                if (strcmp (vme->key, key))
+                        continue;
+                found = _gf_true;
+
+                if (!strcmp (vme->voltype, "nfs/server"))
+                        continue;
+
+                if (!strcmp (vme->key, "diagnostics.brick-log-level")) {
+                        graphs |= GLUSTERD_VOLFILE_BRICK;
+                        continue;
+                }
+                if (!strcmp (vme->key, "diagnostics.client-log-level")) {
+                        graphs |= GLUSTERD_VOLFILE_CLIENT;
+                        continue;
+                }
+                if (!strcmp (vme->voltype, "debug/io-stats")) {
+                        graphs |= GLUSTERD_VOLFILE_ALL;
+                        continue;
+                }
+
+                for (i = 0; server_types[i]; i++) {
+                        if (!strcmp (vme->voltype, server_types[i]))
+                                break;
+                }
+                graphs |= server_types[i] ? GLUSTERD_VOLFILE_BRICK :
+                                            GLUSTERD_VOLFILE_CLIENT;
         }
 
-        ret = generate_client_volfile (volinfo);
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR,
-                        "Could not generate volfile for client");
-                goto out;
+        return found ? graphs : GLUSTERD_VOLFILE_ALL;
+}
+
+/* Regenerates the volfiles of volinfo in graphs (GLUSTERD_VOLFILE_*), and
+ * tells their subscribers if any of them came out different.
+ */
+int
+glusterd_regenerate_volfiles (glusterd_volinfo_t *volinfo, int graphs)
+{
+        int ret = 0;
+        int changed = 0;
+
+        if (graphs & GLUSTERD_VOLFILE_BRICK) {
+                ret = generate_brick_volfiles_incr (volinfo, &changed);
+                if (ret) {
+                        gf_log ("", GF_LOG_ERROR,
+                                "Could not generate volfiles for bricks");
+                        goto out;
+                }
+        }
+
+        if (graphs & GLUSTERD_VOLFILE_CLIENT) {
+                ret = generate_client_volfile (volinfo, &changed);
+                if (ret) {
+                        gf_log ("", GF_LOG_ERROR,
+                                "Could not generate volfile for client");
+                        goto out;
+                }
         }
 
-        ret = glusterd_fetchspec_notify (THIS);
+        gf_log ("", GF_LOG_DEBUG, "%d volfiles of %s changed", changed,
+                volinfo->volname);
+
+        if (changed)
+                ret = glusterd_fetchspec_notify_volume (volinfo);
 
 out:
         return ret;
 }
 
+int
+glusterd_create_volfiles_and_notify_services (glusterd_volinfo_t *volinfo)
+{
+        return glusterd_regenerate_volfiles (volinfo, GLUSTERD_VOLFILE_ALL);
+}
+
 void
 glusterd_get_nfs_filepath (char *filename)
 {
@@ -2252,6 +2500,46 @@ glusterd_create_nfs_volfile ()
         return ret;
 }
 
+/* the client graph of @volinfo (over tcp) with features/crawler on top,
+ * for the helper that walks the volume after quota is enabled */
+int
+glusterd_create_quota_crawl_volfile (glusterd_volinfo_t *volinfo,
+                                     char *filename, char *checkpoint)
+{
+        volgen_graph_t graph = {0,};
+        dict_t  *dict = NULL;
+        xlator_t *xl = NULL;
+        int      ret = -1;
+
+        dict = dict_new ();
+        if (!dict)
+                goto out;
+        ret = dict_set_str (dict, "client-transport-type", "tcp");
+        if (ret)
+                goto out;
+
+        ret = build_client_graph (&graph, volinfo, dict);
+        if (ret)
+                goto out;
+
+        ret = -1;
+        xl = volgen_graph_add (&graph, "features/crawler", volinfo->volname);
+        if (!xl)
+                goto out;
+
+        ret = xlator_set_option (xl, "checkpoint-file", checkpoint);
+        if (!ret)
+                ret = xlator_set_option (xl, "exit-on-completion", "on");
+        if (!ret)
+                ret = volgen_write_volfile (&graph, filename);
+out:
+        volgen_graph_free (&graph);
+        if (dict)
+                dict_unref (dict);
+
+        return ret;
+}
+
 int
 glusterd_delete_volfile (glusterd_volinfo_t *volinfo,
                          glusterd_brickinfo_t *brickinfo)
@@ -2263,6 +2551,7 @@ glusterd_delete_volfile (glusterd_volinfo_t *volinfo,
         GF_ASSERT (brickinfo);
 
         get_brick_filepath (filename, volinfo, brickinfo);
+        glusterd_volfile_cache_drop (filename);
         ret = unlink (filename);
         if (ret)
                 gf_log ("glusterd", GF_LOG_ERROR, "failed to delete file: %s, "
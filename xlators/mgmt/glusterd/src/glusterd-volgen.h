@@ -41,15 +41,32 @@ typedef enum gd_volopt_flags_ {
         OPT_FLAG_FORCE = 1,
 } gd_volopt_flags_t;
 
+/* volfiles of a volume, see glusterd_regenerate_volfiles () */
+#define GLUSTERD_VOLFILE_BRICK    0x1
+#define GLUSTERD_VOLFILE_CLIENT   0x2
+#define GLUSTERD_VOLFILE_ALL      (GLUSTERD_VOLFILE_BRICK|GLUSTERD_VOLFILE_CLIENT)
+
+/* brick volfiles are generated in parallel, one thread per this many
+ * bricks, up to GLUSTERD_VOLGEN_THREADS */
+#define GLUSTERD_VOLGEN_PARALLEL_MIN    16
+#define GLUSTERD_VOLGEN_THREADS         8
+
 int glusterd_create_rb_volfiles (glusterd_volinfo_t *volinfo,
                                  glusterd_brickinfo_t *brickinfo);
 
 int glusterd_create_volfiles_and_notify_services (glusterd_volinfo_t *volinfo);
 
+int glusterd_regenerate_volfiles (glusterd_volinfo_t *volinfo, int graphs);
+
+int glusterd_volopt_graphs (char *key);
+
 void glusterd_get_nfs_filepath (char *filename);
 
 int glusterd_create_nfs_volfile ();
 
+int glusterd_create_quota_crawl_volfile (glusterd_volinfo_t *volinfo,
+                                         char *filename, char *checkpoint);
+
 int glusterd_delete_volfile (glusterd_volinfo_t *volinfo,
                              glusterd_brickinfo_t *brickinfo);
 
@@ -50,10 +50,10 @@
 static uuid_t glusterd_uuid;
 extern struct rpcsvc_program glusterd1_mop_prog;
 extern struct rpcsvc_program gd_svc_mgmt_prog;
+extern struct rpcsvc_program gd_svc_mgmt_v2_prog;
 extern struct rpcsvc_program gd_svc_cli_prog;
 extern struct rpcsvc_program gluster_handshake_prog;
 extern struct rpcsvc_program gluster_pmap_prog;
-extern glusterd_op_info_t opinfo;
 extern struct rpc_clnt_program glusterd_glusterfs_3_1_mgmt_prog;
 
 rpcsvc_cbk_program_t glusterd_cbk_prog = {
@@ -63,16 +63,6 @@ rpcsvc_cbk_program_t glusterd_cbk_prog = {
 };
 
 
-static int
-glusterd_opinfo_init ()
-{
-        int32_t ret = -1;
-
-        ret = pthread_mutex_init (&opinfo.lock, NULL);
-
-        return ret;
-}
-
 static int
 glusterd_uuid_init (int flag)
 {
@@ -108,28 +98,65 @@ glusterd_uuid_init (int flag)
         return 0;
 }
 
+/* Tells the transports that fetched a volfile of volinfo that its volfiles
+ * were regenerated. The payload is the new volfile version in network byte
+ * order, which a client compares with the version it got at getspec time.
+ */
 int
-glusterd_fetchspec_notify (xlator_t *this)
+glusterd_fetchspec_notify_volume (glusterd_volinfo_t *volinfo)
 {
-        int              ret   = -1;
-        glusterd_conf_t *priv  = NULL;
-        rpc_transport_t *trans = NULL;
+        glusterd_conf_t         *priv = NULL;
+        glusterd_volfile_sub_t  *sub = NULL;
+        struct list_head        *bucket = NULL;
+        uint32_t                version = 0;
+        struct iovec            iov = {0,};
+        int                     count = 0;
 
-        priv = this->private;
+        GF_ASSERT (volinfo);
+
+        priv = THIS->private;
 
-        list_for_each_entry (trans, &priv->xprt_list, list) {
-                rpcsvc_callback_submit (priv->rpc, trans, &glusterd_cbk_prog,
-                                        GF_CBK_FETCHSPEC, NULL, 0);
+        volinfo->volfile_version = ++priv->volfile_gen;
+        version = hton32 (volinfo->volfile_version);
+        iov.iov_base = &version;
+        iov.iov_len = sizeof (version);
+
+        bucket = glusterd_volfile_sub_bucket (priv, volinfo->volname);
+        list_for_each_entry (sub, bucket, sub_hash) {
+                if (strcmp (sub->volname, volinfo->volname))
+                        continue;
+                rpcsvc_callback_submit (priv->rpc, sub->trans,
+                                        &glusterd_cbk_prog, GF_CBK_FETCHSPEC,
+                                        &iov, 1);
+                count++;
         }
 
-        ret = 0;
+        gf_log ("glusterd", GF_LOG_DEBUG, "notified %d subscribers of %s "
+                "(volfile version %u)", count, volinfo->volname,
+                volinfo->volfile_version);
 
-        return ret;
+        return 0;
 }
 
 int
 glusterd_priv (xlator_t *this)
 {
+        char    key_prefix[GF_DUMP_MAX_BUF_LEN];
+
+        if (!this || !this->private)
+                goto out;
+
+        gf_proc_dump_build_key (key_prefix, "xlator.mgmt.glusterd", "priv");
+        gf_proc_dump_add_section (key_prefix);
+
+        glusterd_store_stats_dump (key_prefix);
+        glusterd_resolve_cache_dump (this->private, key_prefix);
+        glusterd_volfile_cache_dump (this->private, key_prefix);
+        glusterd_brick_spawn_dump (this->private, key_prefix);
+        glusterd_peer_op_stats_dump (this->private, key_prefix);
+        glusterd_txn_stats_dump (this->private, key_prefix);
+        glusterd_defrag_dump (this->private, key_prefix);
+out:
         return 0;
 }
 
@@ -184,6 +211,7 @@ glusterd_rpcsvc_notify (rpcsvc_t *rpc, void *xl, rpcsvc_event_t event,
         case RPCSVC_EVENT_DISCONNECT:
         {
                 list_del (&xprt->list);
+                glusterd_volfile_unsubscribe (xprt);
                 pmap_registry_remove (this, 0, NULL, GF_PMAP_PORT_NONE, xprt);
                 break;
         }
@@ -532,6 +560,13 @@ init (xlator_t *this)
         char               dirname [PATH_MAX];
         char               cmd_log_filename [PATH_MAX] = {0,};
         int                first_time        = 0;
+        char              *snapshot          = NULL;
+        char              *resolve_ttl       = NULL;
+        char              *spawn_parallel    = NULL;
+        char              *spawn_timeout     = NULL;
+        char              *op_timeout        = NULL;
+        char              *rb_threads        = NULL;
+        char              *rb_bandwidth      = NULL;
 
         dir_data = dict_get (this->options, "working-directory");
 
@@ -670,11 +705,20 @@ init (xlator_t *this)
                 goto out;
         }
 
+        ret = glusterd_program_register (this, rpc, &gd_svc_mgmt_v2_prog);
+        if (ret) {
+                rpcsvc_program_unregister (rpc, &glusterd1_mop_prog);
+                rpcsvc_program_unregister (rpc, &gd_svc_cli_prog);
+                rpcsvc_program_unregister (rpc, &gd_svc_mgmt_prog);
+                goto out;
+        }
+
         ret = glusterd_program_register (this, rpc, &gluster_pmap_prog);
         if (ret) {
                 rpcsvc_program_unregister (rpc, &glusterd1_mop_prog);
                 rpcsvc_program_unregister (rpc, &gd_svc_cli_prog);
                 rpcsvc_program_unregister (rpc, &gd_svc_mgmt_prog);
+                rpcsvc_program_unregister (rpc, &gd_svc_mgmt_v2_prog);
                 goto out;
         }
 
@@ -684,6 +728,7 @@ init (xlator_t *this)
                 rpcsvc_program_unregister (rpc, &gluster_pmap_prog);
                 rpcsvc_program_unregister (rpc, &gd_svc_cli_prog);
                 rpcsvc_program_unregister (rpc, &gd_svc_mgmt_prog);
+                rpcsvc_program_unregister (rpc, &gd_svc_mgmt_v2_prog);
                 goto out;
         }
 
@@ -698,6 +743,86 @@ init (xlator_t *this)
         strncpy (conf->workdir, dirname, PATH_MAX);
 
         INIT_LIST_HEAD (&conf->xprt_list);
+        INIT_LIST_HEAD (&conf->store_pending);
+        pthread_mutex_init (&conf->spawner.lock, NULL);
+        INIT_LIST_HEAD (&conf->spawner.queue);
+        INIT_LIST_HEAD (&conf->spawner.running);
+        conf->spawner.parallel = GLUSTERD_BRICK_SPAWN_PARALLEL;
+        conf->spawner.timeout = GLUSTERD_BRICK_SPAWN_TIMEOUT;
+        conf->op_timeout = GLUSTERD_OP_PHASE_TIMEOUT;
+        conf->rebalance_threads = GLUSTERD_DEFRAG_THREADS;
+        pthread_mutex_init (&conf->txn_stats.lock, NULL);
+        conf->txn_stats.since = time (NULL);
+        ret = glusterd_hash_tables_init (conf);
+        if (ret)
+                goto out;
+        ret = glusterd_defer_init (this, conf);
+        if (ret)
+                goto out;
+
+        if (!dict_get_str (this->options, "store-snapshot", &snapshot) &&
+            gf_string2boolean (snapshot, &conf->store_snapshot)) {
+                gf_log (this->name, GF_LOG_ERROR, "store-snapshot option %s "
+                        "is not a valid boolean type", snapshot);
+                ret = -1;
+                goto out;
+        }
+
+        if (!dict_get_str (this->options, "resolve-cache-ttl", &resolve_ttl) &&
+            gf_string2time (resolve_ttl, &conf->resolve.ttl)) {
+                gf_log (this->name, GF_LOG_ERROR, "resolve-cache-ttl option "
+                        "%s is not a valid time", resolve_ttl);
+                ret = -1;
+                goto out;
+        }
+
+        if (!dict_get_str (this->options, "brick-spawn-parallel",
+                           &spawn_parallel) &&
+            (gf_string2uint32 (spawn_parallel, &conf->spawner.parallel) ||
+             !conf->spawner.parallel)) {
+                gf_log (this->name, GF_LOG_ERROR, "brick-spawn-parallel "
+                        "option %s is not a valid count", spawn_parallel);
+                ret = -1;
+                goto out;
+        }
+
+        if (!dict_get_str (this->options, "brick-spawn-timeout",
+                           &spawn_timeout) &&
+            gf_string2time (spawn_timeout, &conf->spawner.timeout)) {
+                gf_log (this->name, GF_LOG_ERROR, "brick-spawn-timeout "
+                        "option %s is not a valid time", spawn_timeout);
+                ret = -1;
+                goto out;
+        }
+
+        if (!dict_get_str (this->options, "op-timeout", &op_timeout) &&
+            (gf_string2time (op_timeout, &conf->op_timeout) ||
+             !conf->op_timeout)) {
+                gf_log (this->name, GF_LOG_ERROR, "op-timeout option %s is "
+                        "not a valid time", op_timeout);
+                ret = -1;
+                goto out;
+        }
+
+        if (!dict_get_str (this->options, "rebalance-threads", &rb_threads) &&
+            (gf_string2uint32 (rb_threads, &conf->rebalance_threads) ||
+             !conf->rebalance_threads ||
+             (conf->rebalance_threads > GLUSTERD_DEFRAG_THREADS_MAX))) {
+                gf_log (this->name, GF_LOG_ERROR, "rebalance-threads option "
+                        "%s is not a valid count", rb_threads);
+                ret = -1;
+                goto out;
+        }
+
+        if (!dict_get_str (this->options, "rebalance-bandwidth",
+                           &rb_bandwidth) &&
+            gf_string2bytesize (rb_bandwidth, &conf->rebalance_bandwidth)) {
+                gf_log (this->name, GF_LOG_ERROR, "rebalance-bandwidth "
+                        "option %s is not a valid size", rb_bandwidth);
+                ret = -1;
+                goto out;
+        }
+
         ret = glusterd_sm_tr_log_init (&conf->op_sm_log,
                                        glusterd_op_sm_state_name_get,
                                        glusterd_op_sm_event_name_get,
@@ -722,7 +847,6 @@ init (xlator_t *this)
 
         glusterd_friend_sm_init ();
         glusterd_op_sm_init ();
-        glusterd_opinfo_init ();
 
         ret = glusterd_handle_upgrade_downgrade (this->options, conf);
         if (ret)
@@ -767,7 +891,13 @@ fini (xlator_t *this)
                 FREE (conf->pmap);
         if (conf->handle)
                 glusterd_store_handle_destroy (conf->handle);
+        if (conf->snap_handle)
+                glusterd_store_handle_destroy (conf->snap_handle);
+        if (conf->spawner.timer)
+                gf_timer_call_cancel (this->ctx, conf->spawner.timer);
+        glusterd_defer_fini (this, conf);
         glusterd_sm_tr_log_delete (&conf->op_sm_log);
+        glusterd_hash_tables_destroy (conf);
         GF_FREE (conf);
         this->private = NULL;
 out:
@@ -839,6 +969,37 @@ struct volume_options options[] = {
         { .key  = {"downgrade"},
           .type = GF_OPTION_TYPE_BOOL,
         },
+        { .key  = {"store-snapshot"},
+          .type = GF_OPTION_TYPE_BOOL,
+        },
+        { .key  = {"resolve-cache-ttl"},
+          .type = GF_OPTION_TYPE_TIME,
+          .min  = 0,
+          .max  = 3600,
+        },
+        { .key  = {"brick-spawn-parallel"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = 1024,
+        },
+        { .key  = {"brick-spawn-timeout"},
+          .type = GF_OPTION_TYPE_TIME,
+          .min  = 1,
+          .max  = 3600,
+        },
+        { .key  = {"op-timeout"},
+          .type = GF_OPTION_TYPE_TIME,
+          .min  = 1,
+          .max  = 3600,
+        },
+        { .key  = {"rebalance-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = GLUSTERD_DEFRAG_THREADS_MAX,
+        },
+        { .key  = {"rebalance-bandwidth"},
+          .type = GF_OPTION_TYPE_SIZET,
+        },
 
         { .key   = {NULL} },
 };
@@ -26,6 +26,7 @@
 #endif
 
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <dirent.h>
 #include <pthread.h>
 #include <libgen.h>
@@ -52,6 +53,13 @@
 #define GLUSTERD_TR_LOG_SIZE            50
 #define GLUSTERD_NAME                   "glusterd"
 #define GLUSTERD_SOCKET_LISTEN_BACKLOG  128
+#define GLUSTERD_HASH_SIZE              4099
+#define GLUSTERD_XDR_ROUNDUP(len)       (((len) + 3) & ~((size_t)3))
+/* of a request with a dict: XDR header, the dict (in one iobuf, a peer
+ * reads a whole request into one) with a spare, XDR padding */
+#define GLUSTERD_REQ_MAX_IOVS           4
+#define GLUSTERD_RESOLVE_CACHE_TTL      60      /* seconds */
+#define GLUSTERD_RESOLVE_CACHE_MAX      1024    /* hostnames */
 
 
 typedef enum glusterd_op_ {
@@ -77,6 +85,7 @@ typedef enum glusterd_op_ {
         GD_OP_PROFILE_VOLUME,
         GD_OP_QUOTA,
         GD_OP_LOG_LEVEL,
+        GD_OP_BATCH,
         GD_OP_MAX,
 } glusterd_op_t;
 
@@ -89,6 +98,163 @@ struct glusterd_store_iter_ {
 
 typedef struct glusterd_store_iter_     glusterd_store_iter_t;
 
+/* identity of a volume's info file as of its last store, recorded in the
+ * store snapshot to tell whether the text store changed behind it */
+typedef struct glusterd_store_stamp_ {
+        uint64_t        ino;
+        uint64_t        size;
+        int64_t         mtime;
+        int64_t         mtime_nsec;
+} glusterd_store_stamp_t;
+
+/* getaddrinfo () results by hostname and the addresses of the local
+ * interfaces, both kept for ttl seconds */
+typedef struct glusterd_resolve_cache_ {
+        struct list_head        *table;         /* GLUSTERD_HASH_SIZE */
+        int                     count;
+        time_t                  next_sweep;
+        uint32_t                ttl;
+        struct sockaddr_storage *iface_addrs;
+        int                     iface_count;
+        time_t                  iface_expires;
+        uint64_t                hits;
+        uint64_t                misses;
+        uint64_t                iface_hits;
+        uint64_t                iface_misses;
+} glusterd_resolve_cache_t;
+
+/* a transport that fetched a volfile, notified when that volume's volfiles
+ * are regenerated */
+typedef struct glusterd_volfile_sub_ {
+        struct list_head        sub_hash;
+        rpc_transport_t         *trans;
+        char                    volname[GLUSTERD_MAX_VOLUME_NAME];
+} glusterd_volfile_sub_t;
+
+/* a volfile as served by server_getspec, in an iobuf zero padded to the
+ * XDR unit so that it goes out as the reply payload as is. A hit takes a
+ * ref on it, the iobuf is never written once cached */
+typedef struct glusterd_volfile_entry_ {
+        struct list_head        key_hash;
+        struct list_head        path_hash;
+        struct list_head        lru;
+        char                    *key;           /* volfile-id asked for */
+        char                    *path;
+        char                    *volname;
+        struct iobuf            *iob;
+        size_t                  len;
+} glusterd_volfile_entry_t;
+
+#define GLUSTERD_VOLFILE_CACHE_SIZE     (8 * GF_UNIT_MB)
+
+/* volfiles by volfile-id and by path. volgen drops an entry when it writes
+ * the file, gen tells a reader that the file changed while it read it.
+ * Once the iobufs of the volfiles cached take more than
+ * GLUSTERD_VOLFILE_CACHE_SIZE bytes the least recently fetched ones are
+ * evicted. */
+typedef struct glusterd_volfile_cache_ {
+        pthread_mutex_t         lock;
+        struct list_head        *key_table;     /* GLUSTERD_HASH_SIZE */
+        struct list_head        *path_table;    /* GLUSTERD_HASH_SIZE */
+        struct list_head        lru;            /* oldest first */
+        size_t                  size;
+        uint64_t                gen;
+        uint64_t                hits;
+        uint64_t                misses;
+        uint64_t                not_modified;
+        uint64_t                evictions;
+} glusterd_volfile_cache_t;
+
+/* a local brick queued for start by glusterd_restart_bricks (). It holds
+ * a spawn slot until the brick signs in with pmap, its launcher fails or
+ * the spawn times out, and is freed once the launcher is reaped too. */
+typedef struct glusterd_brick_spawn_ {
+        struct list_head        list;
+        char                    *volname;
+        char                    *path;
+        pid_t                   pid;            /* launcher, 0 once reaped */
+        struct timeval          start;
+        gf_boolean_t            done;           /* slot released */
+} glusterd_brick_spawn_t;
+
+#define GLUSTERD_BRICK_SPAWN_PARALLEL   16
+#define GLUSTERD_BRICK_SPAWN_TIMEOUT    120
+#define GLUSTERD_OP_PHASE_TIMEOUT       120     /* seconds */
+#define GLUSTERD_VOLUME_PAGE_MAX        256     /* volumes per info reply */
+#define GLUSTERD_BATCH_MAX              4096    /* entries per batch op */
+
+typedef struct glusterd_brick_spawner_ {
+        pthread_mutex_t         lock;
+        struct list_head        queue;          /* not yet spawned */
+        struct list_head        running;        /* spawned, not yet freed */
+        uint32_t                inflight;       /* slots in use */
+        uint32_t                parallel;       /* option brick-spawn-parallel */
+        uint32_t                timeout;        /* option brick-spawn-timeout */
+        gf_timer_t              *timer;
+        gf_boolean_t            resume_posted;  /* to the event thread */
+        uint64_t                spawned;
+        uint64_t                signed_in;
+        uint64_t                failed;
+        uint64_t                timed_out;
+        uint64_t                latency_total;  /* ms, signed in bricks */
+        uint64_t                latency_max;
+} glusterd_brick_spawner_t;
+
+/* work handed from other threads (timers) to the event thread, see
+ * glusterd_defer () */
+typedef void (*glusterd_deferred_fn_t) (void *data);
+
+typedef struct glusterd_deferred_ {
+        struct list_head        list;
+        glusterd_deferred_fn_t  fn;
+        void                    *data;
+} glusterd_deferred_t;
+
+typedef struct glusterd_defer_queue_ {
+        pthread_mutex_t         lock;
+        struct list_head        list;
+        int                     pipe[2];        /* wakes the event thread */
+        int                     idx;
+} glusterd_defer_queue_t;
+
+typedef struct glusterd_store_stats_ {
+        uint64_t        files;          /* files renamed into place */
+        uint64_t        bytes;
+        uint64_t        syscalls;       /* open, write, fsync and rename */
+} glusterd_store_stats_t;
+
+/* What the time of a transaction is charged to. The *_LOCAL phases are
+ * the handlers run on this node, the others the time spent waiting in
+ * the matching *_SENT state, see glusterd_op_sm (). */
+typedef enum glusterd_txn_phase_ {
+        GD_TXN_PHASE_LOCK = 0,
+        GD_TXN_PHASE_STAGE_LOCAL,
+        GD_TXN_PHASE_STAGE,
+        GD_TXN_PHASE_BRICK_OP,
+        GD_TXN_PHASE_COMMIT_LOCAL,      /* includes the store */
+        GD_TXN_PHASE_COMMIT,
+        GD_TXN_PHASE_UNLOCK,
+        GD_TXN_PHASE_TOTAL,             /* out of and back to default */
+        GD_TXN_PHASE_MAX,
+} glusterd_txn_phase_t;
+
+/* bucket 0 counts samples under 1ms, bucket n those in [2^(n-1), 2^n) ms
+ * and the last one everything above */
+#define GLUSTERD_TXN_HIST_BUCKETS       20
+
+typedef struct glusterd_txn_hist_ {
+        uint64_t        count;
+        uint64_t        total_us;
+        uint64_t        max_us;
+        uint64_t        buckets[GLUSTERD_TXN_HIST_BUCKETS];
+} glusterd_txn_hist_t;
+
+typedef struct glusterd_txn_stats_ {
+        pthread_mutex_t         lock;
+        time_t                  since;          /* last reset */
+        glusterd_txn_hist_t     hist[GD_OP_MAX][GD_TXN_PHASE_MAX];
+} glusterd_txn_stats_t;
+
 struct glusterd_volgen {
         dict_t *dict;
 };
@@ -109,6 +275,34 @@ typedef struct {
         gf_timer_t *timer;
         glusterd_sm_tr_log_t op_sm_log;
         struct rpc_clnt_program *gfs_mgmt;
+        /* lookup indexes over the volumes and peers lists, each an
+         * array of GLUSTERD_HASH_SIZE buckets */
+        struct list_head  *vol_table;          /* by volname */
+        struct list_head  *peer_uuid_table;    /* by peer uuid */
+        struct list_head  *peer_host_table;    /* by peer hostname */
+        struct list_head  *brick_table;        /* by brick path */
+        struct list_head  *brick_port_table;   /* by brick port */
+        /* volumes whose store is deferred to the end of the current
+         * store batch, see glusterd_store_batch_begin () */
+        struct list_head  store_pending;
+        int               store_batch;
+        glusterd_store_stats_t store_stats;     /* since start */
+        glusterd_store_stats_t store_txn_stats; /* last batch */
+        gf_boolean_t      store_snapshot;      /* option store-snapshot */
+        gf_boolean_t      store_dirty;         /* snapshot out of date */
+        glusterd_store_handle_t *snap_handle;
+        glusterd_resolve_cache_t resolve;
+        /* fetchspec subscribers by volname, see glusterd_volfile_subscribe ()
+         * and the volfile generation handed out as their version */
+        struct list_head  *volfile_sub_table;
+        uint32_t          volfile_gen;
+        glusterd_brick_spawner_t spawner;
+        glusterd_defer_queue_t  deferred;
+        glusterd_volfile_cache_t volfile_cache;
+        uint32_t                op_timeout;     /* per stage/commit phase */
+        glusterd_txn_stats_t    txn_stats;
+        uint32_t                rebalance_threads;   /* option */
+        uint64_t                rebalance_bandwidth; /* option, bytes/s */
 } glusterd_conf_t;
 
 typedef enum gf_brick_status {
@@ -129,6 +323,9 @@ struct glusterd_brickinfo {
         gf_brick_status_t status;
         struct rpc_clnt *rpc;
         gf_timer_t *timer;
+        struct list_head  brick_hash;
+        struct list_head  port_hash;
+        struct glusterd_volinfo_ *volinfo; /* volume it is hashed under */
 };
 
 typedef struct glusterd_brickinfo glusterd_brickinfo_t;
@@ -150,21 +347,56 @@ typedef enum gf_defrag_status_ {
         GF_DEFRAG_STATUS_MIGRATE_DATA_COMPLETE,
 } gf_defrag_status_t;
 
+#define GLUSTERD_DEFRAG_THREADS         4
+#define GLUSTERD_DEFRAG_THREADS_MAX     64
+#define GLUSTERD_DEFRAG_COPY_SIZE       (1024 * 1024)
+#define GLUSTERD_DEFRAG_CHECKPOINT_SECS 5
+
+/* a directory on the rebalance mount, relative to it ("/" for its root) */
+typedef struct glusterd_defrag_dir_ {
+        struct list_head             list;
+        char                        *path;
+} glusterd_defrag_dir_t;
+
 struct glusterd_defrag_info_ {
         uint64_t                     total_files;
         uint64_t                     total_data;
         uint64_t                     num_files_lookedup;
+        uint64_t                     num_files_skipped; /* not moved */
+        uint64_t                     num_failures;      /* directories */
         gf_lock_t                    lock;
         int                          cmd;
         pthread_t                    th;
         char                         mount[1024];
-        char                         databuf[131072];
         struct gf_defrag_brickinfo_ *bricks; /* volinfo->brick_count */
+
+        /* directories of the current phase, served to the workers */
+        pthread_mutex_t              queue_lock;
+        pthread_cond_t               queue_cond;
+        struct list_head             queue;
+        struct list_head             active;
+        uint64_t                     queued;
+        uint32_t                     busy;
+        uint32_t                     threads;
+        pthread_t                    workers[GLUSTERD_DEFRAG_THREADS_MAX];
+        gf_defrag_status_t           phase;
+        char                         checkpoint[PATH_MAX];
+        time_t                       checkpointed;
+
+        uint64_t                     started_us; /* less the time of the
+                                                    run resumed from */
+        uint64_t                     bandwidth;  /* bytes/s, 0 for no limit */
+        int64_t                      tokens;     /* bytes that may be copied
+                                                    now, < 0 when owed */
+        uint64_t                     refilled_us;
 };
 
 
 typedef struct glusterd_defrag_info_ glusterd_defrag_info_t;
 
+/* the copies may run this long at full speed after being idle */
+#define GLUSTERD_DEFRAG_BURST_US        1000000
+
 typedef enum gf_transport_type_ {
         GF_TRANSPORT_TCP,       //DEFAULT
         GF_TRANSPORT_RDMA,
@@ -184,11 +416,15 @@ struct glusterd_volinfo_ {
         int                     type;
         int                     brick_count;
         struct list_head        vol_list;
+        struct list_head        vol_hash;
+        struct list_head        store_pending;
         struct list_head        bricks;
         glusterd_volume_status  status;
         int                     sub_count;
         int                     port;
         glusterd_store_handle_t *shandle;
+        glusterd_store_stamp_t  info_stamp;
+        uint32_t                volfile_version; /* 0 until first served */
 
         /* Defrag/rebalance related */
         gf_defrag_status_t      defrag_status;
@@ -274,6 +510,18 @@ typedef ssize_t (*gd_serialize_t) (struct iovec outmsg, void *args);
                 snprintf (pidfile, PATH_MAX, "%s/nfs/run/nfs.pid", \
                           priv->workdir);                               \
 
+#define GLUSTERD_GET_QUOTA_CRAWL_PIDFILE(pidfile, volpath)              \
+                snprintf (pidfile, PATH_MAX, "%s/run/quota-crawl.pid",  \
+                          volpath);
+
+#define GLUSTERD_GET_QUOTA_CRAWL_CHECKPOINT(path, volpath)              \
+                snprintf (path, PATH_MAX, "%s/quota-crawl.checkpoint",  \
+                          volpath);
+
+#define GLUSTERD_GET_DEFRAG_CHECKPOINT(path, volpath)                   \
+                snprintf (path, PATH_MAX, "%s/rebalance.checkpoint",    \
+                          volpath);
+
 #define GLUSTERD_REMOVE_SLASH_FROM_PATH(path,string) do {               \
                 int i = 0;                                              \
                 for (i = 1; i < strlen (path); i++) {                   \
@@ -351,15 +599,27 @@ glusterd_handle_probe_query (rpcsvc_request_t *req);
 int
 glusterd_handle_cluster_lock (rpcsvc_request_t *req);
 
+int
+glusterd_handle_cluster_lock_v2 (rpcsvc_request_t *req);
+
 int
 glusterd_handle_cluster_unlock (rpcsvc_request_t *req);
 
+int
+glusterd_handle_cluster_unlock_v2 (rpcsvc_request_t *req);
+
 int
 glusterd_handle_stage_op (rpcsvc_request_t *req);
 
+int
+glusterd_handle_stage_op_v2 (rpcsvc_request_t *req);
+
 int
 glusterd_handle_commit_op (rpcsvc_request_t *req);
 
+int
+glusterd_handle_commit_op_v2 (rpcsvc_request_t *req);
+
 int
 glusterd_handle_cli_probe (rpcsvc_request_t *req);
 
@@ -372,6 +632,13 @@ glusterd_handle_defrag_volume (rpcsvc_request_t *req);
 int
 glusterd_handle_defrag_volume_v2 (rpcsvc_request_t *req);
 
+int
+glusterd_handle_defrag_start (glusterd_volinfo_t *volinfo, char *op_errstr,
+                              size_t len, int cmd);
+
+int
+glusterd_defrag_resume (glusterd_volinfo_t *volinfo);
+
 int
 glusterd_xfer_cli_probe_resp (rpcsvc_request_t *req, int32_t op_ret,
                               int32_t op_errno, char *hostname, int port);
@@ -478,7 +745,7 @@ glusterd_xfer_cli_deprobe_resp (rpcsvc_request_t *req, int32_t op_ret,
                                 int32_t op_errno, char *hostname);
 
 int
-glusterd_fetchspec_notify (xlator_t *this);
+glusterd_fetchspec_notify_volume (glusterd_volinfo_t *volinfo);
 
 int
 glusterd_add_volume_detail_to_dict (glusterd_volinfo_t *volinfo,
@@ -829,7 +829,6 @@ client3_1_getxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
 {
         call_frame_t      *frame    = NULL;
         dict_t            *dict     = NULL;
-        char              *buf      = NULL;
         int                dict_len = 0;
         int                op_ret   = 0;
         int                op_errno = EINVAL;
@@ -866,20 +865,17 @@ client3_1_getxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
 
                 if (dict_len > 0) {
                         dict = dict_new();
-                        buf = memdup (rsp.dict.dict_val, rsp.dict.dict_len);
-
                         GF_VALIDATE_OR_GOTO (frame->this->name, dict, out);
-                        GF_VALIDATE_OR_GOTO (frame->this->name, buf, out);
 
-                        ret = dict_unserialize (buf, dict_len, &dict);
+                        ret = dict_unserialize_pool (this->ctx->iobuf_pool,
+                                                     rsp.dict.dict_val,
+                                                     dict_len, &dict);
                         if (ret < 0) {
                                 gf_log (frame->this->name, GF_LOG_WARNING,
                                         "failed to unserialize xattr dict");
                                 op_errno = EINVAL;
                                 goto out;
                         }
-                        dict->extra_free = buf;
-                        buf = NULL;
                 }
                 op_ret = 0;
         }
@@ -898,9 +894,6 @@ out:
                 rsp.dict.dict_val = NULL;
         }
 
-        if (buf)
-                GF_FREE (buf);
-
         if (dict)
                 dict_unref (dict);
 
@@ -914,7 +907,6 @@ client3_1_fgetxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                          void *myframe)
 {
         call_frame_t       *frame    = NULL;
-        char               *buf      = NULL;
         dict_t             *dict     = NULL;
         gfs3_fgetxattr_rsp  rsp      = {0,};
         int                 ret      = 0;
@@ -952,18 +944,16 @@ client3_1_fgetxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 if (dict_len > 0) {
                         dict = dict_new();
                         GF_VALIDATE_OR_GOTO (frame->this->name, dict, out);
-                        buf = memdup (rsp.dict.dict_val, rsp.dict.dict_len);
-                        GF_VALIDATE_OR_GOTO (frame->this->name, buf, out);
 
-                        ret = dict_unserialize (buf, dict_len, &dict);
+                        ret = dict_unserialize_pool (this->ctx->iobuf_pool,
+                                                     rsp.dict.dict_val,
+                                                     dict_len, &dict);
                         if (ret < 0) {
                                 gf_log (frame->this->name, GF_LOG_WARNING,
                                         "failed to unserialize xattr dict");
                                 op_errno = EINVAL;
                                 goto out;
                         }
-                        dict->extra_free = buf;
-                        buf = NULL;
                 }
                 op_ret = 0;
         }
@@ -980,9 +970,6 @@ out:
                 rsp.dict.dict_val = NULL;
         }
 
-        if (buf)
-                GF_FREE (buf);
-
         if (dict)
                 dict_unref (dict);
 
@@ -1352,7 +1339,6 @@ client3_1_xattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
 {
         call_frame_t     *frame    = NULL;
         dict_t           *dict     = NULL;
-        char             *buf      = NULL;
         gfs3_xattrop_rsp  rsp      = {0,};
         int               ret      = 0;
         int               op_ret   = 0;
@@ -1390,17 +1376,15 @@ client3_1_xattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
                         dict = dict_new();
                         GF_VALIDATE_OR_GOTO (frame->this->name, dict, out);
 
-                        buf = memdup (rsp.dict.dict_val, rsp.dict.dict_len);
-                        GF_VALIDATE_OR_GOTO (frame->this->name, buf, out);
-                        op_ret = dict_unserialize (buf, dict_len, &dict);
+                        op_ret = dict_unserialize_pool (this->ctx->iobuf_pool,
+                                                        rsp.dict.dict_val,
+                                                        dict_len, &dict);
                         if (op_ret < 0) {
                                 gf_log (frame->this->name, GF_LOG_WARNING,
                                         "failed to unserialize xattr dict");
                                 op_errno = EINVAL;
                                 goto out;
                         }
-                        dict->extra_free = buf;
-                        buf = NULL;
                 }
                 op_ret = 0;
         }
@@ -1421,9 +1405,6 @@ out:
                 rsp.dict.dict_val = NULL;
         }
 
-        if (buf)
-                GF_FREE (buf);
-
         if (dict)
                 dict_unref (dict);
 
@@ -1438,7 +1419,6 @@ client3_1_fxattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
 {
         call_frame_t      *frame    = NULL;
         dict_t            *dict     = NULL;
-        char              *buf      = NULL;
         gfs3_fxattrop_rsp  rsp      = {0,};
         int                ret      = 0;
         int                op_ret   = 0;
@@ -1476,17 +1456,15 @@ client3_1_fxattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
                         dict = dict_new();
                         GF_VALIDATE_OR_GOTO (frame->this->name, dict, out);
 
-                        buf = memdup (rsp.dict.dict_val, rsp.dict.dict_len);
-                        GF_VALIDATE_OR_GOTO (frame->this->name, buf, out);
-                        op_ret = dict_unserialize (buf, dict_len, &dict);
+                        op_ret = dict_unserialize_pool (this->ctx->iobuf_pool,
+                                                        rsp.dict.dict_val,
+                                                        dict_len, &dict);
                         if (op_ret < 0) {
                                 gf_log (frame->this->name, GF_LOG_WARNING,
                                         "failed to unserialize xattr dict");
                                 op_errno = EINVAL;
                                 goto out;
                         }
-                        dict->extra_free = buf;
-                        buf = NULL;
                 }
                 op_ret = 0;
         }
@@ -1507,9 +1485,6 @@ out:
                 rsp.dict.dict_val = NULL;
         }
 
-        if (buf)
-                GF_FREE (buf);
-
         if (dict)
                 dict_unref (dict);
 
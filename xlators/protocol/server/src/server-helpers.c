@@ -1517,3 +1517,45 @@ gf_server_check_setxattr_cmd (call_frame_t *frame, dict_t *dict)
 
         return 0;
 }
+
+
+/* The dict of a request is decoded straight into an iobuf when the request
+ * fits in one, so that server_dict_unserialize () can leave the values
+ * there rather than copy them out. NULL when it does not fit.
+ */
+struct iobuf *
+server_dict_iobuf (rpcsvc_request_t *req)
+{
+        struct iobuf_pool *pool = req->svc->ctx->iobuf_pool;
+
+        if (req->msg[0].iov_len > iobpool_pagesize (pool))
+                return NULL;
+
+        return iobuf_get (pool);
+}
+
+int
+server_dict_unserialize (struct iobuf *iobuf, char *buf, int32_t len,
+                         dict_t **dict)
+{
+        struct iobref *iobref = NULL;
+        int            ret    = -1;
+
+        if (!iobuf)
+                return dict_unserialize (buf, len, dict);
+
+        iobref = iobref_new ();
+        if (!iobref)
+                goto out;
+
+        ret = iobref_add (iobref, iobuf);
+        if (ret)
+                goto out;
+
+        ret = dict_unserialize_iobref (buf, len, dict, iobref);
+out:
+        if (iobref)
+                iobref_unref (iobref);
+
+        return ret;
+}
@@ -85,4 +85,8 @@ int serialize_rsp_direntp (gf_dirent_t *entries, gfs3_readdirp_rsp *rsp);
 int readdirp_rsp_cleanup (gfs3_readdirp_rsp *rsp);
 int readdir_rsp_cleanup (gfs3_readdir_rsp *rsp);
 
+struct iobuf *server_dict_iobuf (rpcsvc_request_t *req);
+int server_dict_unserialize (struct iobuf *iobuf, char *buf, int32_t len,
+                             dict_t **dict);
+
 #endif /* !_SERVER_HELPERS_H */
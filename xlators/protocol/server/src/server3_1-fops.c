@@ -3436,7 +3436,7 @@ server_setxattr (rpcsvc_request_t *req)
         dict_t              *dict                  = NULL;
         call_frame_t        *frame                 = NULL;
         server_connection_t *conn                  = NULL;
-        char                *buf                   = NULL;
+        struct iobuf        *iobuf                 = NULL;
         gfs3_setxattr_req    args                  = {{0,},};
         int32_t              ret                   = -1;
 
@@ -3446,7 +3446,9 @@ server_setxattr (rpcsvc_request_t *req)
         conn = req->trans->xl_private;
 
         args.path          = alloca (req->msg[0].iov_len);
-        args.dict.dict_val = alloca (req->msg[0].iov_len);
+        iobuf = server_dict_iobuf (req);
+        args.dict.dict_val = iobuf ? iobuf_ptr (iobuf)
+                                   : alloca (req->msg[0].iov_len);
 
         if (!xdr_to_setxattr_req (req->msg[0], &args)) {
                 //failed to decode msg;
@@ -3476,10 +3478,8 @@ server_setxattr (rpcsvc_request_t *req)
 
         if (args.dict.dict_len) {
                 dict = dict_new ();
-                buf = memdup (args.dict.dict_val, args.dict.dict_len);
-                GF_VALIDATE_OR_GOTO (conn->bound_xl->name, buf, out);
-
-                ret = dict_unserialize (buf, args.dict.dict_len, &dict);
+                ret = server_dict_unserialize (iobuf, args.dict.dict_val,
+                                               args.dict.dict_len, &dict);
                 if (ret < 0) {
                         gf_log (conn->bound_xl->name, GF_LOG_ERROR,
                                 "%"PRId64": %s (%"PRId64"): failed to "
@@ -3489,9 +3489,6 @@ server_setxattr (rpcsvc_request_t *req)
                         goto err;
                 }
 
-                dict->extra_free = buf;
-                buf = NULL;
-
                 state->dict = dict;
         }
 
@@ -3501,7 +3498,7 @@ server_setxattr (rpcsvc_request_t *req)
         ret = 0;
         resolve_and_resume (frame, server_setxattr_resume);
 
-        return ret;
+        goto out;
 err:
         if (dict)
                 dict_unref (dict);
@@ -3509,8 +3506,8 @@ err:
         server_setxattr_cbk (frame, NULL, frame->this, -1, EINVAL);
         ret = 0;
 out:
-        if (buf)
-                GF_FREE (buf);
+        if (iobuf)
+                iobuf_unref (iobuf);
         return ret;
 
 }
@@ -3524,7 +3521,7 @@ server_fsetxattr (rpcsvc_request_t *req)
         dict_t              *dict                 = NULL;
         server_connection_t *conn                 = NULL;
         call_frame_t        *frame                = NULL;
-        char                *buf                  = NULL;
+        struct iobuf        *iobuf                = NULL;
         gfs3_fsetxattr_req   args                 = {{0,},};
         int32_t              ret                  = -1;
 
@@ -3533,7 +3530,9 @@ server_fsetxattr (rpcsvc_request_t *req)
 
         conn = req->trans->xl_private;
 
-        args.dict.dict_val = alloca (req->msg[0].iov_len);
+        iobuf = server_dict_iobuf (req);
+        args.dict.dict_val = iobuf ? iobuf_ptr (iobuf)
+                                   : alloca (req->msg[0].iov_len);
         if (!xdr_to_fsetxattr_req (req->msg[0], &args)) {
                 //failed to decode msg;
                 req->rpc_err = GARBAGE_ARGS;
@@ -3561,10 +3560,8 @@ server_fsetxattr (rpcsvc_request_t *req)
 
         if (args.dict.dict_len) {
                 dict = dict_new ();
-                buf = memdup (args.dict.dict_val, args.dict.dict_len);
-                GF_VALIDATE_OR_GOTO (conn->bound_xl->name, buf, out);
-
-                ret = dict_unserialize (buf, args.dict.dict_len, &dict);
+                ret = server_dict_unserialize (iobuf, args.dict.dict_val,
+                                               args.dict.dict_len, &dict);
                 if (ret < 0) {
                         gf_log (conn->bound_xl->name, GF_LOG_ERROR,
                                 "%"PRId64": %s (%"PRId64"): failed to "
@@ -3573,15 +3570,13 @@ server_fsetxattr (rpcsvc_request_t *req)
                                 state->resolve.ino);
                         goto err;
                 }
-                dict->extra_free = buf;
-                buf = NULL;
                 state->dict = dict;
         }
 
         ret = 0;
         resolve_and_resume (frame, server_fsetxattr_resume);
 
-        return ret;
+        goto out;
 err:
         if (dict)
                 dict_unref (dict);
@@ -3589,8 +3584,8 @@ err:
         server_setxattr_cbk (frame, NULL, frame->this, -1, EINVAL);
         ret = 0;
 out:
-        if (buf)
-                GF_FREE (buf);
+        if (iobuf)
+                iobuf_unref (iobuf);
         return ret;
 }
 
@@ -3603,7 +3598,7 @@ server_fxattrop (rpcsvc_request_t *req)
         server_state_t      *state                = NULL;
         server_connection_t *conn                 = NULL;
         call_frame_t        *frame                = NULL;
-        char                *buf                   = NULL;
+        struct iobuf        *iobuf                 = NULL;
         gfs3_fxattrop_req    args                 = {{0,},};
         int32_t              ret                  = -1;
 
@@ -3612,7 +3607,9 @@ server_fxattrop (rpcsvc_request_t *req)
 
         conn = req->trans->xl_private;
 
-        args.dict.dict_val = alloca (req->msg[0].iov_len);
+        iobuf = server_dict_iobuf (req);
+        args.dict.dict_val = iobuf ? iobuf_ptr (iobuf)
+                                   : alloca (req->msg[0].iov_len);
         if (!xdr_to_fxattrop_req (req->msg[0], &args)) {
                 //failed to decode msg;
                 req->rpc_err = GARBAGE_ARGS;
@@ -3643,10 +3640,8 @@ server_fxattrop (rpcsvc_request_t *req)
                 /* Unserialize the dictionary */
                 dict = dict_new ();
 
-                buf = memdup (args.dict.dict_val, args.dict.dict_len);
-                GF_VALIDATE_OR_GOTO (conn->bound_xl->name, buf, out);
-
-                ret = dict_unserialize (buf, args.dict.dict_len, &dict);
+                ret = server_dict_unserialize (iobuf, args.dict.dict_val,
+                                               args.dict.dict_len, &dict);
                 if (ret < 0) {
                         gf_log (conn->bound_xl->name, GF_LOG_ERROR,
                                 "fd - %"PRId64" (%"PRId64"): failed to unserialize "
@@ -3654,8 +3649,6 @@ server_fxattrop (rpcsvc_request_t *req)
                                 state->resolve.fd_no, state->fd->inode->ino);
                         goto fail;
                 }
-                dict->extra_free = buf;
-                buf = NULL;
 
                 state->dict = dict;
         }
@@ -3663,7 +3656,7 @@ server_fxattrop (rpcsvc_request_t *req)
         ret = 0;
         resolve_and_resume (frame, server_fxattrop_resume);
 
-        return ret;
+        goto out;
 
 fail:
         if (dict)
@@ -3672,6 +3665,8 @@ fail:
         server_fxattrop_cbk (frame, NULL, frame->this, -1, EINVAL, NULL);
         ret = 0;
 out:
+        if (iobuf)
+                iobuf_unref (iobuf);
         return ret;
 }
 
@@ -3684,7 +3679,7 @@ server_xattrop (rpcsvc_request_t *req)
         server_state_t      *state                 = NULL;
         server_connection_t *conn                  = NULL;
         call_frame_t        *frame                 = NULL;
-        char                *buf                   = NULL;
+        struct iobuf        *iobuf                 = NULL;
         gfs3_xattrop_req     args                  = {{0,},};
         int32_t              ret                   = -1;
 
@@ -3693,7 +3688,9 @@ server_xattrop (rpcsvc_request_t *req)
 
         conn = req->trans->xl_private;
 
-        args.dict.dict_val = alloca (req->msg[0].iov_len);
+        iobuf = server_dict_iobuf (req);
+        args.dict.dict_val = iobuf ? iobuf_ptr (iobuf)
+                                   : alloca (req->msg[0].iov_len);
         args.path          = alloca (req->msg[0].iov_len);
 
         if (!xdr_to_xattrop_req (req->msg[0], &args)) {
@@ -3726,10 +3723,8 @@ server_xattrop (rpcsvc_request_t *req)
                 /* Unserialize the dictionary */
                 dict = dict_new ();
 
-                buf = memdup (args.dict.dict_val, args.dict.dict_len);
-                GF_VALIDATE_OR_GOTO (conn->bound_xl->name, buf, out);
-
-                ret = dict_unserialize (buf, args.dict.dict_len, &dict);
+                ret = server_dict_unserialize (iobuf, args.dict.dict_val,
+                                               args.dict.dict_len, &dict);
                 if (ret < 0) {
                         gf_log (conn->bound_xl->name, GF_LOG_ERROR,
                                 "fd - %"PRId64" (%"PRId64"): failed to unserialize "
@@ -3737,8 +3732,6 @@ server_xattrop (rpcsvc_request_t *req)
                                 state->resolve.fd_no, state->fd->inode->ino);
                         goto fail;
                 }
-                dict->extra_free = buf;
-                buf = NULL;
 
                 state->dict = dict;
         }
@@ -3746,7 +3739,7 @@ server_xattrop (rpcsvc_request_t *req)
         ret = 0;
         resolve_and_resume (frame, server_xattrop_resume);
 
-        return ret;
+        goto out;
 fail:
         if (dict)
                 dict_unref (dict);
@@ -3754,6 +3747,8 @@ fail:
         server_xattrop_cbk (frame, NULL, frame->this, -1, EINVAL, NULL);
         ret = 0;
 out:
+        if (iobuf)
+                iobuf_unref (iobuf);
         return ret;
 }
 